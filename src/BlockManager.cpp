@@ -0,0 +1,720 @@
+#include "BlockManager.h"
+#include "GeometryEngine.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <BRep_Builder.hxx>
+#include <BRep_Tool.hxx>
+#include <BRepAdaptor_Curve.hxx>
+#include <BRepBndLib.hxx>
+#include <BRepBuilderAPI_MakeVertex.hxx>
+#include <BRepBuilderAPI_Transform.hxx>
+#include <BRepExtrema_DistShapeShape.hxx>
+#include <Standard_Failure.hxx>
+#include <TopExp.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+
+Q_LOGGING_CATEGORY(cadBlocks, "cad.blocks")
+
+namespace {
+
+const QString BlockNameKey = QStringLiteral("blockName");
+const QString AttributesKey = QStringLiteral("attributes");
+const QString TransformKey = QStringLiteral("transform");
+
+gp_Trsf baseTranslation(const gp_Pnt& basePoint)
+{
+    gp_Trsf translation;
+    translation.SetTranslation(basePoint, gp_Pnt(0, 0, 0));
+    return translation;
+}
+
+// Entity type for geometry that leaves a block through EXPLODE
+CADEntity::Type entityTypeForShape(const TopoDS_Shape& shape)
+{
+    switch (shape.ShapeType()) {
+    case TopAbs_VERTEX: return CADEntity::Point;
+    case TopAbs_EDGE: return CADEntity::Line;
+    case TopAbs_WIRE: return CADEntity::Polyline;
+    case TopAbs_FACE:
+    case TopAbs_SHELL: return CADEntity::Surface;
+    default: return CADEntity::Solid;
+    }
+}
+
+} // namespace
+
+BlockManager::BlockManager(QObject *parent)
+    : QObject(parent)
+    , m_geometryEngine(nullptr)
+{
+}
+
+BlockManager::~BlockManager() = default;
+
+void BlockManager::setGeometryEngine(GeometryEngine* engine)
+{
+    if (m_geometryEngine) {
+        disconnect(m_geometryEngine, nullptr, this, nullptr);
+    }
+
+    m_geometryEngine = engine;
+    m_insertBlocks.clear();
+    m_inserts.clear();
+    if (!engine) {
+        return;
+    }
+
+    // Inserts are tracked from engine notifications so undo and redo keep the index right
+    connect(engine, &GeometryEngine::entityAdded, this, &BlockManager::onEntityAdded);
+    connect(engine, &GeometryEngine::entitiesAdded, this, &BlockManager::onEntitiesAdded);
+    connect(engine, &GeometryEngine::entityRemoved, this, &BlockManager::onEntityRemoved);
+    for (int entityId : engine->getAllEntityIds()) {
+        trackInsert(entityId);
+    }
+}
+
+// Definitions
+bool BlockManager::defineBlock(const BlockDefinition& definition)
+{
+    CAD_TRACE_SCOPE("blocks", "defineBlock");
+
+    const QString& name = definition.name;
+    if (name.trimmed().isEmpty()) {
+        qCWarning(cadBlocks) << "Block name is empty";
+        return false;
+    }
+    for (const NestedBlockReference& nested : definition.nestedBlocks) {
+        if (nested.blockName == name || nestsBlock(nested.blockName, name)) {
+            qCWarning(cadBlocks) << "Block" << name << "cannot nest" << nested.blockName << "(circular reference)";
+            return false;
+        }
+    }
+
+    auto existing = m_definitions.find(name);
+    const bool redefined = existing != m_definitions.end();
+    if (redefined) {
+        for (const NestedBlockReference& nested : existing->second.nestedBlocks) {
+            m_parents[nested.blockName].remove(name);
+        }
+    }
+
+    m_definitions[name] = definition;
+    for (const NestedBlockReference& nested : definition.nestedBlocks) {
+        m_parents[nested.blockName].insert(name);
+    }
+
+    // This block and every block nesting it resolve again on next use
+    QSet<QString> invalidated;
+    invalidate(name, invalidated);
+    refreshInserts(invalidated);
+
+    if (redefined) {
+        emit blockRedefined(name);
+    } else {
+        emit blockDefined(name);
+    }
+    return true;
+}
+
+bool BlockManager::defineBlockFromEntities(const QString& name, const gp_Pnt& basePoint,
+                                           const std::vector<int>& entityIds, bool removeEntities)
+{
+    if (!m_geometryEngine) {
+        return false;
+    }
+
+    BlockDefinition definition;
+    definition.name = name;
+    definition.basePoint = basePoint;
+
+    // Inserts become nested references; everything else is copied by shape handle
+    for (int entityId : entityIds) {
+        const CADEntity* entity = m_geometryEngine->findEntity(entityId);
+        if (!entity || entity->shape.IsNull()) {
+            continue;
+        }
+        if (isBlockInsert(entityId)) {
+            definition.nestedBlocks.push_back(NestedBlockReference{getInsertBlockName(entityId),
+                                                                   insertTransform(*entity)});
+        } else {
+            definition.geometry.push_back(entity->shape);
+        }
+    }
+
+    if (definition.geometry.empty() && definition.nestedBlocks.empty()) {
+        qCWarning(cadBlocks) << "No geometry for block" << name;
+        return false;
+    }
+    if (!defineBlock(definition)) {
+        return false;
+    }
+
+    if (removeEntities) {
+        m_geometryEngine->beginDeferredDisplay();
+        for (int entityId : entityIds) {
+            m_geometryEngine->removeEntity(entityId);
+        }
+        m_geometryEngine->endDeferredDisplay();
+    }
+    return true;
+}
+
+bool BlockManager::deleteBlock(const QString& name)
+{
+    auto it = m_definitions.find(name);
+    if (it == m_definitions.end()) {
+        return false;
+    }
+    if (getInsertCount(name) > 0) {
+        qCWarning(cadBlocks) << "Block is still inserted:" << name;
+        return false;
+    }
+    for (const QString& parent : m_parents.value(name)) {
+        if (m_definitions.count(parent) != 0) {
+            qCWarning(cadBlocks) << "Block" << name << "is nested in" << parent;
+            return false;
+        }
+    }
+
+    for (const NestedBlockReference& nested : it->second.nestedBlocks) {
+        m_parents[nested.blockName].remove(name);
+    }
+    m_definitions.erase(it);
+    m_resolved.erase(name);
+    m_inserts.remove(name);
+
+    emit blockDeleted(name);
+    return true;
+}
+
+bool BlockManager::renameBlock(const QString& oldName, const QString& newName)
+{
+    auto it = m_definitions.find(oldName);
+    if (it == m_definitions.end() || newName.trimmed().isEmpty() || hasBlock(newName)) {
+        qCWarning(cadBlocks) << "Cannot rename block" << oldName << "to" << newName;
+        return false;
+    }
+
+    BlockDefinition definition = std::move(it->second);
+    definition.name = newName;
+    m_definitions.erase(it);
+
+    // Parents refer to blocks by name
+    const QSet<QString> parents = m_parents.take(oldName);
+    for (const QString& parent : parents) {
+        auto parentIt = m_definitions.find(parent);
+        if (parentIt == m_definitions.end()) {
+            continue;
+        }
+        for (NestedBlockReference& nested : parentIt->second.nestedBlocks) {
+            if (nested.blockName == oldName) {
+                nested.blockName = newName;
+            }
+        }
+    }
+    m_parents[newName] = parents;
+    for (const NestedBlockReference& nested : definition.nestedBlocks) {
+        m_parents[nested.blockName].remove(oldName);
+        m_parents[nested.blockName].insert(newName);
+    }
+    m_definitions[newName] = std::move(definition);
+
+    // Geometry is unchanged, so the resolved compound carries over
+    auto resolved = m_resolved.find(oldName);
+    if (resolved != m_resolved.end()) {
+        m_resolved[newName] = std::move(resolved->second);
+        m_resolved.erase(oldName);
+    }
+
+    const QSet<int> inserts = m_inserts.take(oldName);
+    if (m_geometryEngine) {
+        for (int entityId : inserts) {
+            m_insertBlocks[entityId] = newName;
+            CADEntity entity = m_geometryEngine->getEntity(entityId);
+            entity.properties[BlockNameKey] = newName;
+            m_geometryEngine->updateEntity(entityId, entity);
+        }
+    }
+    m_inserts[newName] = inserts;
+
+    emit blockRenamed(oldName, newName);
+    return true;
+}
+
+bool BlockManager::hasBlock(const QString& name) const
+{
+    return m_definitions.count(name) != 0;
+}
+
+QStringList BlockManager::getBlockNames() const
+{
+    QStringList names;
+    for (const auto& entry : m_definitions) {
+        names.append(entry.first);
+    }
+    return names;
+}
+
+const BlockDefinition* BlockManager::getBlockDefinition(const QString& name) const
+{
+    auto it = m_definitions.find(name);
+    return it != m_definitions.end() ? &it->second : nullptr;
+}
+
+void BlockManager::clear()
+{
+    m_definitions.clear();
+    m_resolved.clear();
+    m_parents.clear();
+    m_insertBlocks.clear();
+    m_inserts.clear();
+}
+
+// Inserts
+int BlockManager::insertBlock(const QString& name, const gp_Trsf& transform, const QVariantMap& attributes,
+                              const QString& layer)
+{
+    CAD_TRACE_SCOPE("blocks", "insertBlock");
+
+    const ResolvedBlock* block = resolve(name);
+    if (!block || !m_geometryEngine) {
+        qCWarning(cadBlocks) << "Cannot insert block:" << name;
+        return -1;
+    }
+
+    CADEntity entity;
+    entity.type = CADEntity::Block;
+    placeInsert(entity, block->shape, transform);
+    entity.layer = layer;
+    entity.properties[BlockNameKey] = name;
+
+    // Only values that differ from the definition are stored per insert
+    QVariantMap overrides;
+    for (const BlockAttribute& attribute : m_definitions.at(name).attributes) {
+        auto value = attributes.constFind(attribute.tag);
+        if (value != attributes.constEnd() && value->toString() != attribute.defaultValue) {
+            overrides[attribute.tag] = value->toString();
+        }
+    }
+    if (!overrides.isEmpty()) {
+        entity.properties[AttributesKey] = overrides;
+    }
+
+    return m_geometryEngine->addEntity(entity);
+}
+
+gp_Trsf BlockManager::getInsertTransform(int entityId) const
+{
+    const CADEntity* entity = m_geometryEngine ? m_geometryEngine->findEntity(entityId) : nullptr;
+    return entity ? insertTransform(*entity) : gp_Trsf();
+}
+
+QVariantMap BlockManager::getInsertAttributes(int entityId) const
+{
+    QVariantMap values;
+    const BlockDefinition* definition = getBlockDefinition(getInsertBlockName(entityId));
+    const CADEntity* entity = m_geometryEngine ? m_geometryEngine->findEntity(entityId) : nullptr;
+    if (!definition || !entity) {
+        return values;
+    }
+
+    const QVariantMap overrides = entity->properties.value(AttributesKey).toMap();
+    for (const BlockAttribute& attribute : definition->attributes) {
+        values[attribute.tag] = overrides.value(attribute.tag, attribute.defaultValue);
+    }
+    return values;
+}
+
+bool BlockManager::setInsertAttribute(int entityId, const QString& tag, const QString& value)
+{
+    const BlockDefinition* definition = getBlockDefinition(getInsertBlockName(entityId));
+    if (!definition || !m_geometryEngine) {
+        return false;
+    }
+
+    auto attribute = std::find_if(definition->attributes.begin(), definition->attributes.end(),
+                                  [&tag](const BlockAttribute& candidate) { return candidate.tag == tag; });
+    if (attribute == definition->attributes.end()) {
+        qCWarning(cadBlocks) << "Block" << definition->name << "has no attribute" << tag;
+        return false;
+    }
+
+    CADEntity entity = m_geometryEngine->getEntity(entityId);
+    QVariantMap overrides = entity.properties.value(AttributesKey).toMap();
+    if (value == attribute->defaultValue) {
+        overrides.remove(tag);
+    } else {
+        overrides[tag] = value;
+    }
+    if (overrides.isEmpty()) {
+        entity.properties.remove(AttributesKey);
+    } else {
+        entity.properties[AttributesKey] = overrides;
+    }
+    return m_geometryEngine->updateEntity(entityId, entity);
+}
+
+int BlockManager::getInsertCount(const QString& name) const
+{
+    return m_inserts.value(name).size();
+}
+
+std::vector<int> BlockManager::explodeInsert(int entityId)
+{
+    std::vector<int> created;
+    const BlockDefinition* definition = getBlockDefinition(getInsertBlockName(entityId));
+    if (!definition || !m_geometryEngine) {
+        return created;
+    }
+
+    // One level, as with EXPLODE: own geometry becomes entities, nested blocks become inserts
+    const CADEntity insert = m_geometryEngine->getEntity(entityId);
+    const gp_Trsf toWorld = insertTransform(insert) * baseTranslation(definition->basePoint);
+
+    m_geometryEngine->beginDeferredDisplay();
+    for (const TopoDS_Shape& shape : definition->geometry) {
+        CADEntity entity;
+        entity.type = entityTypeForShape(shape);
+        entity.shape = placedShape(shape, toWorld);
+        entity.layer = insert.layer;
+        entity.color = insert.color;
+        created.push_back(m_geometryEngine->addEntity(entity));
+    }
+    for (const NestedBlockReference& nested : definition->nestedBlocks) {
+        const int id = insertBlock(nested.blockName, toWorld * nested.transform, QVariantMap(), insert.layer);
+        if (id >= 0) {
+            created.push_back(id);
+        }
+    }
+    m_geometryEngine->removeEntity(entityId);
+    m_geometryEngine->endDeferredDisplay();
+
+    return created;
+}
+
+// Geometry
+TopoDS_Shape BlockManager::resolvedShape(const QString& name) const
+{
+    const ResolvedBlock* block = resolve(name);
+    return block ? block->shape : TopoDS_Shape();
+}
+
+Bnd_Box BlockManager::blockBounds(const QString& name) const
+{
+    const ResolvedBlock* block = resolve(name);
+    return block ? block->bounds : Bnd_Box();
+}
+
+const BlockManager::ResolvedBlock* BlockManager::resolve(const QString& name) const
+{
+    QSet<QString> resolving;
+    return resolve(name, resolving);
+}
+
+const BlockManager::ResolvedBlock* BlockManager::resolve(const QString& name, QSet<QString>& resolving) const
+{
+    auto cached = m_resolved.find(name);
+    if (cached != m_resolved.end()) {
+        return cached->second.get();
+    }
+
+    auto it = m_definitions.find(name);
+    if (it == m_definitions.end() || resolving.contains(name)) {
+        return nullptr;
+    }
+    resolving.insert(name);
+
+    CAD_TRACE_SCOPE("blocks", "resolveBlock");
+    const BlockDefinition& definition = it->second;
+    const gp_Trsf toBlock = baseTranslation(definition.basePoint);
+
+    auto block = std::make_unique<ResolvedBlock>();
+    BRep_Builder builder;
+    TopoDS_Compound compound;
+    builder.MakeCompound(compound);
+
+    for (const TopoDS_Shape& shape : definition.geometry) {
+        const TopoDS_Shape located = placedShape(shape, toBlock);
+        builder.Add(compound, located);
+        BRepBndLib::Add(located, block->bounds);
+    }
+
+    // Children are resolved only now, and shared by location
+    for (const NestedBlockReference& nested : definition.nestedBlocks) {
+        const ResolvedBlock* child = resolve(nested.blockName, resolving);
+        if (!child) {
+            qCDebug(cadBlocks) << "Block" << name << "references undefined block" << nested.blockName;
+            continue;
+        }
+        const gp_Trsf childToBlock = toBlock * nested.transform;
+        builder.Add(compound, placedShape(child->shape, childToBlock));
+        if (!child->bounds.IsVoid()) {
+            block->bounds.Add(child->bounds.Transformed(childToBlock));
+        }
+    }
+    block->shape = compound;
+
+    resolving.remove(name);
+    const ResolvedBlock* result = block.get();
+    m_resolved[name] = std::move(block);
+    return result;
+}
+
+TopoDS_Shape BlockManager::placedShape(const TopoDS_Shape& shape, const gp_Trsf& transform, bool* shared)
+{
+    if (shared) {
+        *shared = true;
+    }
+    try {
+        return shape.Moved(TopLoc_Location(transform));
+    } catch (const Standard_Failure&) {
+        // Scaled or mirrored locations are refused by newer OpenCASCADE
+    }
+    if (shared) {
+        *shared = false;
+    }
+    return BRepBuilderAPI_Transform(shape, transform, Standard_True).Shape();
+}
+
+void BlockManager::placeInsert(CADEntity& insert, const TopoDS_Shape& block, const gp_Trsf& transform)
+{
+    bool shared = true;
+    insert.shape = placedShape(block, transform, &shared);
+    if (shared) {
+        insert.properties.remove(TransformKey);
+        return;
+    }
+
+    QVariantList values;
+    for (int row = 1; row <= 3; ++row) {
+        for (int column = 1; column <= 4; ++column) {
+            values.append(transform.Value(row, column));
+        }
+    }
+    insert.properties[TransformKey] = values;
+}
+
+gp_Trsf BlockManager::insertTransform(const CADEntity& insert)
+{
+    const QVariantList values = insert.properties.value(TransformKey).toList();
+    if (values.size() != 12) {
+        return insert.shape.Location().Transformation();
+    }
+
+    gp_Trsf transform;
+    try {
+        transform.SetValues(values[0].toDouble(), values[1].toDouble(), values[2].toDouble(), values[3].toDouble(),
+                            values[4].toDouble(), values[5].toDouble(), values[6].toDouble(), values[7].toDouble(),
+                            values[8].toDouble(), values[9].toDouble(), values[10].toDouble(), values[11].toDouble());
+    } catch (const Standard_Failure&) {
+        qCWarning(cadBlocks) << "Invalid insert transform";
+    }
+    return transform;
+}
+
+const std::vector<BlockManager::SnapPoint>& BlockManager::snapPoints(const ResolvedBlock& block) const
+{
+    if (block.snapPointsBuilt) {
+        return block.snapPoints;
+    }
+
+    // Computed once per definition, in block space
+    ResolvedBlock& mutableBlock = const_cast<ResolvedBlock&>(block);
+    std::vector<SnapPoint>& points = mutableBlock.snapPoints;
+    points.push_back(SnapPoint{gp_Pnt(0, 0, 0), SnapInsertion});
+
+    TopTools_IndexedMapOfShape vertices;
+    TopExp::MapShapes(block.shape, TopAbs_VERTEX, vertices);
+    for (int i = 1; i <= vertices.Extent(); ++i) {
+        points.push_back(SnapPoint{BRep_Tool::Pnt(TopoDS::Vertex(vertices(i))), SnapEndpoint});
+    }
+
+    TopTools_IndexedMapOfShape edges;
+    TopExp::MapShapes(block.shape, TopAbs_EDGE, edges);
+    for (int i = 1; i <= edges.Extent(); ++i) {
+        const TopoDS_Edge& edge = TopoDS::Edge(edges(i));
+        if (BRep_Tool::Degenerated(edge)) {
+            continue;
+        }
+        BRepAdaptor_Curve curve(edge);
+        points.push_back(SnapPoint{curve.Value(0.5 * (curve.FirstParameter() + curve.LastParameter())), SnapMidpoint});
+        if (curve.GetType() == GeomAbs_Circle) {
+            points.push_back(SnapPoint{curve.Circle().Location(), SnapCenter});
+        }
+    }
+
+    mutableBlock.snapPointsBuilt = true;
+    return points;
+}
+
+// Queries in instance space
+std::vector<gp_Pnt> BlockManager::getInsertSnapPoints(int entityId, int modes) const
+{
+    std::vector<gp_Pnt> result;
+    const ResolvedBlock* block = resolve(getInsertBlockName(entityId));
+    if (!block) {
+        return result;
+    }
+
+    const gp_Trsf toWorld = getInsertTransform(entityId);
+    for (const SnapPoint& snap : snapPoints(*block)) {
+        if (snap.mode & modes) {
+            result.push_back(snap.point.Transformed(toWorld));
+        }
+    }
+    return result;
+}
+
+bool BlockManager::nearestInsertSnapPoint(int entityId, const gp_Pnt& point, double tolerance, int modes,
+                                          gp_Pnt& result) const
+{
+    const ResolvedBlock* block = resolve(getInsertBlockName(entityId));
+    if (!block) {
+        return false;
+    }
+
+    // Only the query point and the winner are transformed
+    const gp_Trsf toWorld = getInsertTransform(entityId);
+    const gp_Pnt local = point.Transformed(toWorld.Inverted());
+    const double scale = std::abs(toWorld.ScaleFactor());
+    const double localTolerance = scale > 0.0 ? tolerance / scale : tolerance;
+
+    const SnapPoint* best = nullptr;
+    double bestDistance = localTolerance * localTolerance;
+    for (const SnapPoint& snap : snapPoints(*block)) {
+        if (!(snap.mode & modes)) {
+            continue;
+        }
+        const double distance = snap.point.SquareDistance(local);
+        if (distance <= bestDistance) {
+            bestDistance = distance;
+            best = &snap;
+        }
+    }
+
+    if (!best) {
+        return false;
+    }
+    result = best->point.Transformed(toWorld);
+    return true;
+}
+
+bool BlockManager::hitTestInsert(int entityId, const gp_Pnt& point, double tolerance) const
+{
+    const ResolvedBlock* block = resolve(getInsertBlockName(entityId));
+    if (!block || block->bounds.IsVoid()) {
+        return false;
+    }
+
+    const gp_Trsf toWorld = getInsertTransform(entityId);
+    const gp_Pnt local = point.Transformed(toWorld.Inverted());
+    const double scale = std::abs(toWorld.ScaleFactor());
+    const double localTolerance = scale > 0.0 ? tolerance / scale : tolerance;
+
+    // Cheap reject against the shared definition bounds
+    Bnd_Box bounds = block->bounds;
+    bounds.Enlarge(localTolerance);
+    if (bounds.IsOut(local)) {
+        return false;
+    }
+
+    BRepExtrema_DistShapeShape distance(BRepBuilderAPI_MakeVertex(local).Vertex(), block->shape);
+    return distance.IsDone() && distance.Value() <= localTolerance;
+}
+
+// Bookkeeping
+void BlockManager::invalidate(const QString& name, QSet<QString>& invalidated)
+{
+    if (invalidated.contains(name)) {
+        return;
+    }
+    invalidated.insert(name);
+    m_resolved.erase(name);
+    for (const QString& parent : m_parents.value(name)) {
+        invalidate(parent, invalidated);
+    }
+}
+
+bool BlockManager::nestsBlock(const QString& parent, const QString& child) const
+{
+    auto it = m_definitions.find(parent);
+    if (it == m_definitions.end()) {
+        return false;
+    }
+    for (const NestedBlockReference& nested : it->second.nestedBlocks) {
+        if (nested.blockName == child || nestsBlock(nested.blockName, child)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BlockManager::refreshInserts(const QSet<QString>& blockNames)
+{
+    if (!m_geometryEngine) {
+        return;
+    }
+
+    bool deferred = false;
+    for (const QString& name : blockNames) {
+        const QSet<int> inserts = m_inserts.value(name);
+        const ResolvedBlock* block = inserts.isEmpty() ? nullptr : resolve(name);
+        if (!block) {
+            continue;
+        }
+        if (!deferred) {
+            m_geometryEngine->beginDeferredDisplay();
+            deferred = true;
+        }
+
+        // Same location, new definition compound
+        for (int entityId : inserts) {
+            CADEntity entity = m_geometryEngine->getEntity(entityId);
+            placeInsert(entity, block->shape, insertTransform(entity));
+            m_geometryEngine->updateEntity(entityId, entity);
+        }
+    }
+    if (deferred) {
+        m_geometryEngine->endDeferredDisplay();
+    }
+}
+
+void BlockManager::trackInsert(int entityId)
+{
+    const CADEntity* entity = m_geometryEngine->findEntity(entityId);
+    if (!entity || entity->type != CADEntity::Block) {
+        return;
+    }
+    const QString name = entity->properties.value(BlockNameKey).toString();
+    if (!name.isEmpty()) {
+        m_insertBlocks.insert(entityId, name);
+        m_inserts[name].insert(entityId);
+    }
+}
+
+void BlockManager::onEntityAdded(int entityId)
+{
+    trackInsert(entityId);
+}
+
+void BlockManager::onEntitiesAdded(const std::vector<int>& entityIds)
+{
+    for (int entityId : entityIds) {
+        trackInsert(entityId);
+    }
+}
+
+void BlockManager::onEntityRemoved(int entityId)
+{
+    auto it = m_insertBlocks.find(entityId);
+    if (it != m_insertBlocks.end()) {
+        m_inserts[it.value()].remove(entityId);
+        m_insertBlocks.erase(it);
+    }
+}
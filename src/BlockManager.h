@@ -0,0 +1,179 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QSet>
+#include <QStringList>
+#include <QVariantMap>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <TopoDS_Shape.hxx>
+#include <Bnd_Box.hxx>
+#include <gp_Pnt.hxx>
+#include <gp_Trsf.hxx>
+
+Q_DECLARE_LOGGING_CATEGORY(cadBlocks)
+
+class GeometryEngine;
+struct CADEntity;
+
+/**
+ * @brief Attribute carried by every insert of a block
+ */
+struct BlockAttribute
+{
+    QString tag;
+    QString prompt;
+    QString defaultValue;
+    gp_Pnt position;            // In block coordinates
+};
+
+/**
+ * @brief Reference to another block from inside a definition
+ */
+struct NestedBlockReference
+{
+    QString blockName;
+    gp_Trsf transform;          // Child block space -> parent block space
+};
+
+/**
+ * @brief Block definition; geometry is stored once in block coordinates
+ */
+struct BlockDefinition
+{
+    QString name;
+    QString description;
+    gp_Pnt basePoint;
+    std::vector<TopoDS_Shape> geometry;
+    std::vector<NestedBlockReference> nestedBlocks;
+    std::vector<BlockAttribute> attributes;
+};
+
+/**
+ * @brief Block definitions and their lightweight inserts
+ *
+ * A definition is resolved on first use into one compound in which nested
+ * blocks appear as located references to their own resolved compounds, so
+ * nesting costs no geometry copies and a child is resolved only when a
+ * parent needs it. An insert is a CADEntity of type Block whose shape is the
+ * resolved compound moved by the insert transform: it shares every TShape
+ * with the definition and adds a location, the "blockName" and any
+ * attribute values that differ from the defaults. The geometry engine draws
+ * inserts as instances of one presentation per definition.
+ *
+ * Snapping and hit testing transform the query into block space and run
+ * against per-definition data (bounds, snap points) computed once, instead
+ * of against each insert's geometry.
+ *
+ * Redefining a block re-resolves it and every block nesting it, then moves
+ * all affected inserts onto the new geometry.
+ *
+ * Scaled and mirrored transforms are refused as locations by OpenCASCADE
+ * 7.6 and later; such inserts and nested references get a transformed copy
+ * instead, and an insert then keeps its transform in a "transform" property.
+ */
+class BlockManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum SnapMode {
+        SnapEndpoint = 0x01,
+        SnapMidpoint = 0x02,
+        SnapCenter = 0x04,
+        SnapInsertion = 0x08,
+        SnapAll = 0x0f
+    };
+
+    explicit BlockManager(QObject *parent = nullptr);
+    ~BlockManager();
+
+    void setGeometryEngine(GeometryEngine* engine);
+
+    // Definitions
+    bool defineBlock(const BlockDefinition& definition);
+    bool defineBlockFromEntities(const QString& name, const gp_Pnt& basePoint, const std::vector<int>& entityIds,
+                                 bool removeEntities = false);
+    bool deleteBlock(const QString& name);
+    bool renameBlock(const QString& oldName, const QString& newName);
+    bool hasBlock(const QString& name) const;
+    QStringList getBlockNames() const;
+    const BlockDefinition* getBlockDefinition(const QString& name) const;
+    void clear();
+
+    // Inserts
+    int insertBlock(const QString& name, const gp_Trsf& transform, const QVariantMap& attributes = QVariantMap(),
+                    const QString& layer = QString());
+    bool isBlockInsert(int entityId) const { return m_insertBlocks.contains(entityId); }
+    QString getInsertBlockName(int entityId) const { return m_insertBlocks.value(entityId); }
+    gp_Trsf getInsertTransform(int entityId) const;
+    QVariantMap getInsertAttributes(int entityId) const;
+    bool setInsertAttribute(int entityId, const QString& tag, const QString& value);
+    int getInsertCount(const QString& name) const;
+    std::vector<int> explodeInsert(int entityId);
+
+    // Geometry, resolved on demand
+    TopoDS_Shape resolvedShape(const QString& name) const;
+    Bnd_Box blockBounds(const QString& name) const;
+
+    // Shape moved by a transform: shared through a location where the location
+    // can carry it, otherwise a transformed copy (shared reports which)
+    static TopoDS_Shape placedShape(const TopoDS_Shape& shape, const gp_Trsf& transform, bool* shared = nullptr);
+    // Sets an insert's shape to the placed block and records the transform a copy cannot carry
+    static void placeInsert(CADEntity& insert, const TopoDS_Shape& block, const gp_Trsf& transform);
+    // Insert transform, whether the shape is located or a copy
+    static gp_Trsf insertTransform(const CADEntity& insert);
+
+    // Queries in instance space
+    std::vector<gp_Pnt> getInsertSnapPoints(int entityId, int modes = SnapAll) const;
+    bool nearestInsertSnapPoint(int entityId, const gp_Pnt& point, double tolerance, int modes, gp_Pnt& result) const;
+    bool hitTestInsert(int entityId, const gp_Pnt& point, double tolerance) const;
+
+signals:
+    void blockDefined(const QString& name);
+    void blockRedefined(const QString& name);
+    void blockDeleted(const QString& name);
+    void blockRenamed(const QString& oldName, const QString& newName);
+
+private slots:
+    void onEntityAdded(int entityId);
+    void onEntitiesAdded(const std::vector<int>& entityIds);
+    void onEntityRemoved(int entityId);
+
+private:
+    struct SnapPoint {
+        gp_Pnt point;
+        SnapMode mode;
+    };
+
+    // Per-definition data shared by all inserts; built lazily
+    struct ResolvedBlock {
+        TopoDS_Shape shape;         // Compound in block space, base point at the origin
+        Bnd_Box bounds;
+        bool snapPointsBuilt = false;
+        std::vector<SnapPoint> snapPoints;
+    };
+
+    const ResolvedBlock* resolve(const QString& name) const;
+    const ResolvedBlock* resolve(const QString& name, QSet<QString>& resolving) const;
+    const std::vector<SnapPoint>& snapPoints(const ResolvedBlock& block) const;
+    void invalidate(const QString& name, QSet<QString>& invalidated);
+    bool nestsBlock(const QString& parent, const QString& child) const;
+    void refreshInserts(const QSet<QString>& blockNames);
+    void trackInsert(int entityId);
+
+    GeometryEngine* m_geometryEngine;
+    std::map<QString, BlockDefinition> m_definitions;
+    mutable std::map<QString, std::unique_ptr<ResolvedBlock>> m_resolved;
+
+    // Block name -> blocks whose definitions reference it
+    QHash<QString, QSet<QString>> m_parents;
+
+    // Insert entity id -> block name, and the reverse
+    QHash<int, QString> m_insertBlocks;
+    QHash<QString, QSet<int>> m_inserts;
+};
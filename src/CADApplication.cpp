@@ -7,10 +7,14 @@
 #include "LayoutManager.h"
 #include "MaterialSystem.h"
 #include "ObjectSnaps.h"
+#include "StartupTimeline.h"
+#include "DxfReader.h"
+#include "DxfWriter.h"
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QStandardPaths>
 #include <QDir>
+#include <QFileInfo>
 
 Q_LOGGING_CATEGORY(cadApp, "cad.application")
 
@@ -57,6 +61,7 @@ bool CADApplication::initialize()
     
     try {
         initializeCore();
+        StartupTimeline::mark("core");
         initializeManagers();
         setupDefaultSettings();
         loadSettings();
@@ -102,6 +107,8 @@ void CADApplication::initializeCore()
     
     // Initialize command manager
     m_commandManager = std::make_unique<CommandManager>();
+    m_commandManager->setGeometryEngine(m_geometryEngine.get());
+    m_commandManager->setUndoMemoryBudget(m_settings->value("undoMemoryBudgetMB", 256).toLongLong() * 1024 * 1024);
     
     qCDebug(cadApp) << "Core systems initialized";
 }
@@ -110,17 +117,47 @@ void CADApplication::initializeManagers()
 {
     qCDebug(cadApp) << "Initializing managers...";
     
-    // Initialize all managers
+    // Managers every drawing session needs; xrefs, layouts and materials
+    // are created by their accessors when first used
     m_layerManager = std::make_unique<LayerManager>();
+    m_layerManager->setGeometryEngine(m_geometryEngine.get());
     m_blockManager = std::make_unique<BlockManager>();
-    m_xrefManager = std::make_unique<XrefManager>();
-    m_layoutManager = std::make_unique<LayoutManager>();
-    m_materialSystem = std::make_unique<MaterialSystem>();
+    m_blockManager->setGeometryEngine(m_geometryEngine.get());
     m_objectSnaps = std::make_unique<ObjectSnaps>();
     
     qCDebug(cadApp) << "Managers initialized";
 }
 
+XrefManager* CADApplication::xrefManager() const
+{
+    if (!m_xrefManager) {
+        qCDebug(cadApp) << "Creating xref manager";
+        m_xrefManager = std::make_unique<XrefManager>();
+        m_xrefManager->setGeometryEngine(m_geometryEngine.get());
+    }
+    return m_xrefManager.get();
+}
+
+LayoutManager* CADApplication::layoutManager() const
+{
+    if (!m_layoutManager) {
+        qCDebug(cadApp) << "Creating layout manager";
+        m_layoutManager = std::make_unique<LayoutManager>();
+        m_layoutManager->setGeometryEngine(m_geometryEngine.get());
+        m_layoutManager->setLayerManager(m_layerManager.get());
+    }
+    return m_layoutManager.get();
+}
+
+MaterialSystem* CADApplication::materialSystem() const
+{
+    if (!m_materialSystem) {
+        qCDebug(cadApp) << "Creating material system";
+        m_materialSystem = std::make_unique<MaterialSystem>();
+    }
+    return m_materialSystem.get();
+}
+
 void CADApplication::setupDefaultSettings()
 {
     qCDebug(cadApp) << "Setting up default settings...";
@@ -318,8 +355,12 @@ void CADApplication::newDocument()
     // Clear all managers
     m_layerManager->clear();
     m_blockManager->clear();
-    m_xrefManager->clear();
-    m_layoutManager->clear();
+    if (m_xrefManager) {
+        m_xrefManager->clear();
+    }
+    if (m_layoutManager) {
+        m_layoutManager->clear();
+    }
     
     setCurrentDocument("");
     setModified(false);
@@ -332,7 +373,7 @@ void CADApplication::openDocument(const QString& path)
     QString filePath = path;
     if (filePath.isEmpty()) {
         filePath = QFileDialog::getOpenFileName(nullptr, "Open Document", 
-                                               QString(), "CAD Files (*.dwg *.dxf)");
+                                               QString(), "DXF Drawings (*.dxf)");
         if (filePath.isEmpty()) {
             return;
         }
@@ -340,7 +381,59 @@ void CADApplication::openDocument(const QString& path)
     
     qCDebug(cadApp) << "Opening document:" << filePath;
     
-    // TODO: Implement document loading
+    if (QFileInfo(filePath).suffix().compare("dxf", Qt::CaseInsensitive) != 0) {
+        QMessageBox::warning(nullptr, "Open Document",
+                             QString("Cannot open %1: only DXF drawings can be read.").arg(filePath));
+        return;
+    }
+    
+    if (m_isModified) {
+        // Ask user to save current document
+        int ret = QMessageBox::question(nullptr, "Save Changes", 
+                                       "Do you want to save changes to the current document?",
+                                       QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
+        if (ret == QMessageBox::Save) {
+            saveDocument();
+            if (m_isModified) {
+                return;     // Save failed or was cancelled
+            }
+        } else if (ret == QMessageBox::Cancel) {
+            return;
+        }
+    }
+    
+    // The current drawing is replaced only once the file has parsed; undo steps refer to
+    // entities about to go
+    DxfReader reader(m_geometryEngine.get(), m_layerManager.get(), m_blockManager.get());
+    const DxfReadResult result = reader.read(filePath, [this]() {
+        m_commandManager->clearHistory();
+        m_geometryEngine->clearAllEntities();
+        m_layerManager->clear();
+        m_blockManager->clear();
+        if (m_xrefManager) {
+            m_xrefManager->clear();
+        }
+        if (m_layoutManager) {
+            m_layoutManager->clear();
+        }
+    });
+    if (!result.success) {
+        QMessageBox::warning(nullptr, "Open Document", QString("Cannot open %1: %2").arg(filePath, result.error));
+        return;
+    }
+    // Layers created while reading are part of the drawing, not undoable steps
+    m_layerManager->clearUndoHistory();
+    
+    switch (result.units) {
+    case 1: setCurrentUnits(Units::Inches); break;
+    case 2: setCurrentUnits(Units::Feet); break;
+    case 4: setCurrentUnits(Units::Millimeters); break;
+    case 5: setCurrentUnits(Units::Centimeters); break;
+    case 6: setCurrentUnits(Units::Meters); break;
+    default: break;
+    }
+    
+    qCDebug(cadApp) << "Opened" << result.entities << "entities," << result.skipped << "skipped";
     setCurrentDocument(filePath);
     setModified(false);
 }
@@ -354,8 +447,9 @@ void CADApplication::saveDocument()
     
     qCDebug(cadApp) << "Saving document:" << m_currentDocument;
     
-    // TODO: Implement document saving
-    setModified(false);
+    if (writeDocument(m_currentDocument)) {
+        setModified(false);
+    }
 }
 
 void CADApplication::saveDocumentAs(const QString& path)
@@ -363,7 +457,7 @@ void CADApplication::saveDocumentAs(const QString& path)
     QString filePath = path;
     if (filePath.isEmpty()) {
         filePath = QFileDialog::getSaveFileName(nullptr, "Save Document As", 
-                                               QString(), "CAD Files (*.dwg *.dxf)");
+                                               QString(), "DXF Drawings (*.dxf)");
         if (filePath.isEmpty()) {
             return;
         }
@@ -371,9 +465,36 @@ void CADApplication::saveDocumentAs(const QString& path)
     
     qCDebug(cadApp) << "Saving document as:" << filePath;
     
-    // TODO: Implement document saving
-    setCurrentDocument(filePath);
-    setModified(false);
+    if (writeDocument(filePath)) {
+        setCurrentDocument(filePath);
+        setModified(false);
+    }
+}
+
+bool CADApplication::writeDocument(const QString& filePath)
+{
+    if (QFileInfo(filePath).suffix().compare("dxf", Qt::CaseInsensitive) != 0) {
+        QMessageBox::warning(nullptr, "Save Document",
+                             QString("Cannot save %1: only DXF drawings can be written.").arg(filePath));
+        return false;
+    }
+    
+    DxfWriter writer(m_geometryEngine.get(), m_layerManager.get(), m_blockManager.get());
+    switch (m_currentUnits) {
+    case Units::Inches: writer.setUnits(1); break;
+    case Units::Feet: writer.setUnits(2); break;
+    case Units::Millimeters: writer.setUnits(4); break;
+    case Units::Centimeters: writer.setUnits(5); break;
+    case Units::Meters: writer.setUnits(6); break;
+    }
+    
+    const DxfWriteResult result = writer.write(filePath);
+    if (!result.success) {
+        QMessageBox::warning(nullptr, "Save Document", QString("Cannot save %1: %2").arg(filePath, result.error));
+        return false;
+    }
+    qCDebug(cadApp) << "Saved" << result.entities << "entities," << result.bytes << "bytes";
+    return true;
 }
 
 void CADApplication::closeDocument()
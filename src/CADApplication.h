@@ -42,9 +42,11 @@ public:
     GeometryEngine* geometryEngine() const { return m_geometryEngine.get(); }
     LayerManager* layerManager() const { return m_layerManager.get(); }
     BlockManager* blockManager() const { return m_blockManager.get(); }
-    XrefManager* xrefManager() const { return m_xrefManager.get(); }
-    LayoutManager* layoutManager() const { return m_layoutManager.get(); }
-    MaterialSystem* materialSystem() const { return m_materialSystem.get(); }
+    
+    // Rarely used managers are created on first access
+    XrefManager* xrefManager() const;
+    LayoutManager* layoutManager() const;
+    MaterialSystem* materialSystem() const;
     ObjectSnaps* objectSnaps() const { return m_objectSnaps.get(); }
 
     // Settings management
@@ -132,15 +134,16 @@ private:
     void initializeManagers();
     void setupDefaultSettings();
     void connectSignals();
+    bool writeDocument(const QString& filePath);
 
     // Core systems
     std::unique_ptr<CommandManager> m_commandManager;
     std::unique_ptr<GeometryEngine> m_geometryEngine;
     std::unique_ptr<LayerManager> m_layerManager;
     std::unique_ptr<BlockManager> m_blockManager;
-    std::unique_ptr<XrefManager> m_xrefManager;
-    std::unique_ptr<LayoutManager> m_layoutManager;
-    std::unique_ptr<MaterialSystem> m_materialSystem;
+    mutable std::unique_ptr<XrefManager> m_xrefManager;
+    mutable std::unique_ptr<LayoutManager> m_layoutManager;
+    mutable std::unique_ptr<MaterialSystem> m_materialSystem;
     std::unique_ptr<ObjectSnaps> m_objectSnaps;
 
     // Settings and state
@@ -1,12 +1,81 @@
 #include "CommandManager.h"
+#include "Tracing.h"
+#include "UndoStore.h"
+#include "ScriptCompiler.h"
+#include "CommandCompleter.h"
+#include "CommandTelemetry.h"
+#include "GeometryEngine.h"
+#include "LayerUsageIndex.h"
+#include <QDataStream>
+#include <QFileSystemWatcher>
 #include <QFileInfo>
 #include <QTextStream>
 #include <QRegularExpression>
 #include <QStandardPaths>
+#include <QElapsedTimer>
 #include <QDir>
+#include <algorithm>
+
+#include <Standard_Failure.hxx>
 
 Q_LOGGING_CATEGORY(cadCommands, "cad.commands")
 
+namespace {
+
+/**
+ * @brief Keeps a command group open for its lifetime
+ */
+class GroupScope
+{
+public:
+    GroupScope(CommandManager* manager, const QString& name)
+        : m_manager(manager)
+    {
+        m_manager->beginGroup(name);
+    }
+
+    ~GroupScope()
+    {
+        m_manager->endGroup();
+    }
+
+    GroupScope(const GroupScope&) = delete;
+    GroupScope& operator=(const GroupScope&) = delete;
+
+private:
+    CommandManager* m_manager;
+};
+
+/**
+ * @brief Defers presentations and insertion notifications for its lifetime
+ */
+class DeferredDisplayScope
+{
+public:
+    explicit DeferredDisplayScope(GeometryEngine* engine)
+        : m_engine(engine)
+    {
+        if (m_engine) {
+            m_engine->beginDeferredDisplay();
+        }
+    }
+
+    ~DeferredDisplayScope()
+    {
+        if (m_engine) {
+            m_engine->endDeferredDisplay();
+        }
+    }
+
+    DeferredDisplayScope(const DeferredDisplayScope&) = delete;
+    DeferredDisplayScope& operator=(const DeferredDisplayScope&) = delete;
+
+private:
+    GeometryEngine* m_engine;
+};
+
+} // namespace
+
 // CADCommandGroup implementation
 CADCommandGroup::CADCommandGroup(const QString& name)
     : m_name(name)
@@ -61,10 +130,65 @@ QString CADCommandGroup::description() const
     return QString("%1 (%2 commands)").arg(m_name).arg(m_commands.size());
 }
 
+size_t CADCommandGroup::memoryCost() const
+{
+    size_t cost = sizeof(*this);
+    for (const auto& command : m_commands) {
+        cost += command->memoryCost();
+    }
+    return cost;
+}
+
+bool CADCommandGroup::canSpill() const
+{
+    for (const auto& command : m_commands) {
+        if (!command->canSpill()) {
+            return false;
+        }
+    }
+    return !m_commands.empty();
+}
+
+bool CADCommandGroup::saveState(QDataStream& stream) const
+{
+    for (const auto& command : m_commands) {
+        if (!command->saveState(stream)) {
+            return false;
+        }
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+bool CADCommandGroup::restoreState(QDataStream& stream)
+{
+    for (auto& command : m_commands) {
+        if (!command->restoreState(stream)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CADCommandGroup::releaseState()
+{
+    for (auto& command : m_commands) {
+        command->releaseState();
+    }
+}
+
 // CommandManager implementation
 CommandManager::CommandManager(QObject *parent)
     : QObject(parent)
+    , m_geometryEngine(nullptr)
+    , m_undoStore(std::make_unique<UndoStore>())
+    , m_registryRevision(0)
+    , m_scriptCompiler(std::make_unique<ScriptCompiler>(this))
     , m_recording(false)
+    , m_completer(std::make_unique<CommandCompleter>())
+    , m_completerRevision(~quint64(0))
+    , m_macroWatcher(nullptr)
+    , m_macrosDirty(true)
+    , m_telemetry(std::make_unique<CommandTelemetry>())
     , m_undoLimit(100)
     , m_commandEcho(true)
     , m_commandInProgress(false)
@@ -74,8 +198,7 @@ CommandManager::CommandManager(QObject *parent)
     initializeBuiltinCommands();
     
     // Load saved macros
-    QString macroPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/macros";
-    QDir().mkpath(macroPath);
+    QDir().mkpath(macroDirectory());
 }
 
 CommandManager::~CommandManager()
@@ -115,20 +238,27 @@ bool CommandManager::executeCommand(const QString& commandLine)
     
     // Handle special commands
     if (commandName == "u" || commandName == "undo") {
+        m_completer->recordUsage("undo");
         undo();
         return true;
     } else if (commandName == "redo") {
+        m_completer->recordUsage("redo");
         redo();
         return true;
     } else if (commandName == "repeat" || commandName.isEmpty()) {
         repeatLastCommand();
         return true;
+    } else if (executeImmediateCommand(commandName, args)) {
+        return true;
     }
     
     // Create and execute command
     try {
         auto command = createCommand(commandName, args);
         if (command) {
+            // Feeds completion ranking; typos never reach the history
+            m_completer->recordUsage(commandName);
+            m_completer->addHistory(commandLine);
             return executeCommand(std::move(command));
         } else {
             QString error = QString("Unknown command: %1").arg(commandName);
@@ -146,16 +276,30 @@ bool CommandManager::executeCommand(const QString& commandLine)
 
 bool CommandManager::executeCommand(std::unique_ptr<CADCommand> command)
 {
+    CAD_TRACE_SCOPE("command", "executeCommand");
+
     if (!command) {
         return false;
     }
     
-    qCDebug(cadCommands) << "Executing command:" << command->name();
+    const QString commandName = command->name();
+    qCDebug(cadCommands) << "Executing command:" << commandName;
+
+    // A disabled recorder costs this one branch
+    const bool timing = m_telemetry->isEnabled();
+    CommandTelemetry::Probe probe{};
+    if (timing) {
+        probe = m_telemetry->begin(m_geometryEngine);
+    }
     
     try {
         m_commandInProgress = true;
         command->execute();
         m_commandInProgress = false;
+
+        if (timing) {
+            m_telemetry->end(probe, commandName, true, m_geometryEngine);
+        }
         
         // Add to history if not grouping
         if (m_currentGroup) {
@@ -164,72 +308,90 @@ bool CommandManager::executeCommand(std::unique_ptr<CADCommand> command)
             addToHistory(std::move(command));
         }
         
-        m_lastCommand = command->name();
+        m_lastCommand = commandName;
         return true;
     } catch (const std::exception& e) {
         m_commandInProgress = false;
+        if (timing) {
+            m_telemetry->end(probe, commandName, false, m_geometryEngine);
+        }
         QString error = QString("Command execution failed: %1").arg(e.what());
         qCWarning(cadCommands) << error;
-        emit commandFailed(command->name(), error);
+        emit commandFailed(commandName, error);
         return false;
     }
 }
 
 bool CommandManager::canUndo() const
 {
-    return !m_undoStack.isEmpty();
+    return m_undoStore->canUndo();
 }
 
 bool CommandManager::canRedo() const
 {
-    return !m_redoStack.isEmpty();
+    return m_undoStore->canRedo();
 }
 
 void CommandManager::undo()
 {
+    CAD_TRACE_SCOPE("command", "undo");
+
     if (!canUndo()) {
         qCWarning(cadCommands) << "Cannot undo: no commands in history";
         return;
     }
     
-    auto command = std::move(m_undoStack.top());
-    m_undoStack.pop();
+    // Spilled steps are paged back in by the store
+    auto command = m_undoStore->takeUndo();
+    if (!command) {
+        updateUndoRedoState();
+        emit historyChanged();
+        emit commandFailed("UNDO", "Undo state could not be restored; earlier steps are no longer available");
+        return;
+    }
     
     qCDebug(cadCommands) << "Undoing command:" << command->name();
     
     try {
         command->undo();
-        m_redoStack.push(std::move(command));
+        m_undoStore->pushRedo(std::move(command));
         updateUndoRedoState();
         emit historyChanged();
     } catch (const std::exception& e) {
         qCWarning(cadCommands) << "Undo failed:" << e.what();
         // Put command back on undo stack
-        m_undoStack.push(std::move(command));
+        m_undoStore->pushUndo(std::move(command));
     }
 }
 
 void CommandManager::redo()
 {
+    CAD_TRACE_SCOPE("command", "redo");
+
     if (!canRedo()) {
         qCWarning(cadCommands) << "Cannot redo: no commands in redo stack";
         return;
     }
     
-    auto command = std::move(m_redoStack.top());
-    m_redoStack.pop();
+    auto command = m_undoStore->takeRedo();
+    if (!command) {
+        updateUndoRedoState();
+        emit historyChanged();
+        emit commandFailed("REDO", "Redo state could not be restored; later steps are no longer available");
+        return;
+    }
     
     qCDebug(cadCommands) << "Redoing command:" << command->name();
     
     try {
         command->redo();
-        m_undoStack.push(std::move(command));
+        m_undoStore->pushUndo(std::move(command));
         updateUndoRedoState();
         emit historyChanged();
     } catch (const std::exception& e) {
         qCWarning(cadCommands) << "Redo failed:" << e.what();
         // Put command back on redo stack
-        m_redoStack.push(std::move(command));
+        m_undoStore->pushRedo(std::move(command));
     }
 }
 
@@ -237,40 +399,20 @@ void CommandManager::clearHistory()
 {
     qCDebug(cadCommands) << "Clearing command history";
     
-    m_undoStack.clear();
-    m_redoStack.clear();
+    m_undoStore->clear();
     updateUndoRedoState();
     emit historyChanged();
 }
 
 QStringList CommandManager::getUndoHistory() const
 {
-    QStringList history;
-    
-    // Convert stack to list (most recent first)
-    QStack<std::unique_ptr<CADCommand>> tempStack = m_undoStack;
-    while (!tempStack.isEmpty()) {
-        auto& command = tempStack.top();
-        history.prepend(command->description());
-        tempStack.pop();
-    }
-    
-    return history;
+    // Descriptions are kept by the store, so spilled steps are not paged in
+    return m_undoStore->undoDescriptions();
 }
 
 QStringList CommandManager::getRedoHistory() const
 {
-    QStringList history;
-    
-    // Convert stack to list (most recent first)
-    QStack<std::unique_ptr<CADCommand>> tempStack = m_redoStack;
-    while (!tempStack.isEmpty()) {
-        auto& command = tempStack.top();
-        history.append(command->description());
-        tempStack.pop();
-    }
-    
-    return history;
+    return m_undoStore->redoDescriptions();
 }
 
 QString CommandManager::getLastCommand() const
@@ -317,24 +459,28 @@ void CommandManager::registerCommand(const QString& name, std::function<std::uni
     info.factory = factory;
     
     m_commands[name.toLower()] = info;
+    ++m_registryRevision;
 }
 
 void CommandManager::registerAlias(const QString& alias, const QString& command)
 {
     qCDebug(cadCommands) << "Registering alias:" << alias << "->" << command;
     m_aliases[alias.toLower()] = command.toLower();
+    ++m_registryRevision;
 }
 
 void CommandManager::unregisterCommand(const QString& name)
 {
     qCDebug(cadCommands) << "Unregistering command:" << name;
     m_commands.remove(name.toLower());
+    ++m_registryRevision;
 }
 
 void CommandManager::unregisterAlias(const QString& alias)
 {
     qCDebug(cadCommands) << "Unregistering alias:" << alias;
     m_aliases.remove(alias.toLower());
+    ++m_registryRevision;
 }
 
 QStringList CommandManager::getAvailableCommands() const
@@ -350,24 +496,33 @@ QStringList CommandManager::getAvailableCommands() const
 QStringList CommandManager::getCommandCompletions(const QString& partial) const
 {
     QStringList completions;
-    QString lowerPartial = partial.toLower();
-    
-    for (auto it = m_commands.begin(); it != m_commands.end(); ++it) {
-        if (it.key().startsWith(lowerPartial)) {
-            completions.append(it.key());
-        }
-    }
-    
-    for (auto it = m_aliases.begin(); it != m_aliases.end(); ++it) {
-        if (it.key().startsWith(lowerPartial)) {
-            completions.append(it.key());
-        }
+    for (const CommandCompletion& completion : completeCommand(partial)) {
+        completions.append(completion.text);
     }
-    
-    completions.sort();
     return completions;
 }
 
+QList<CommandCompletion> CommandManager::completeCommand(const QString& partial, int limit) const
+{
+    updateCompleter();
+    return m_completer->complete(partial, limit);
+}
+
+void CommandManager::updateCompleter() const
+{
+    // Registry changes are rare; keystrokes normally skip straight to the lookup
+    if (m_completerRevision != m_registryRevision) {
+        m_completer->setCommands(m_commands.keys());
+        m_completer->setAliases(m_aliases);
+        m_completerRevision = m_registryRevision;
+    }
+
+    watchMacroDirectory();
+    if (m_macrosDirty) {
+        refreshMacroFiles();
+    }
+}
+
 QString CommandManager::getCommandHelp(const QString& command) const
 {
     QString lowerCommand = command.toLower();
@@ -390,49 +545,131 @@ QString CommandManager::getCommandHelp(const QString& command) const
 
 bool CommandManager::executeScript(const QString& scriptPath)
 {
-    QFileInfo fileInfo(scriptPath);
-    if (!fileInfo.exists()) {
-        qCWarning(cadCommands) << "Script file does not exist:" << scriptPath;
-        return false;
-    }
-
-    QFile file(scriptPath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qCWarning(cadCommands) << "Cannot open script file:" << scriptPath;
+    QString error;
+    auto script = m_scriptCompiler->compileFile(scriptPath, &error);
+    if (!script) {
+        qCWarning(cadCommands) << error;
         return false;
     }
 
-    QTextStream in(&file);
-    QString scriptText = in.readAll();
-    file.close();
-
     qCDebug(cadCommands) << "Executing script:" << scriptPath;
-    return executeScriptText(scriptText);
+    return executeCompiledScript(*script);
 }
 
 bool CommandManager::executeScriptText(const QString& scriptText)
 {
-    QStringList lines = scriptText.split('\n', Qt::SkipEmptyParts);
-    bool success = true;
+    return executeCompiledScript(*m_scriptCompiler->compileText(scriptText));
+}
 
-    beginGroup("Script Execution");
+bool CommandManager::executeCompiledScript(const CompiledScript& script, const QString& groupName)
+{
+    CAD_TRACE_SCOPE("command", "executeScript");
 
-    for (const QString& line : lines) {
-        QString trimmedLine = line.trimmed();
+    m_lastScriptStats = ScriptRunStats();
 
-        // Skip comments and empty lines
-        if (trimmedLine.isEmpty() || trimmedLine.startsWith(';') || trimmedLine.startsWith('#')) {
-            continue;
+    // Nothing runs unless the whole script resolved
+    if (!script.isValid()) {
+        for (auto it = script.errors.constBegin(); it != script.errors.constEnd(); ++it) {
+            qCWarning(cadCommands) << "Script error at line" << it.key() << ":" << it.value();
         }
+        emit scriptCompileFailed(script.name, script.errors);
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (m_recording) {
+        m_recordedCommands.append(script.sourceLines);
+    }
+    if (m_commandEcho && !script.name.isEmpty()) {
+        emit commandExecuted(QString("SCRIPT %1").arg(script.name));
+    }
+
+    int executed = 0;
+    int failed = 0;
+    {
+        // Both scopes close however the loop is left
+        GroupScope group(this, groupName);
+
+        // Presentations and insertion notifications are produced once after the script
+        DeferredDisplayScope deferred(m_geometryEngine);
+
+        const bool timing = m_telemetry->isEnabled();
+
+        for (size_t i = 0; i < script.instructions.size(); ++i) {
+            const ScriptInstruction& instruction = script.instructions[i];
+            const bool isCommand = instruction.op == ScriptInstruction::Command;
+
+            CommandTelemetry::Probe probe{};
+            if (timing && isCommand) {
+                probe = m_telemetry->begin(m_geometryEngine);
+            }
+
+            // One failing line, whatever it throws, must not end the script
+            QString error;
+            try {
+                switch (instruction.op) {
+                case ScriptInstruction::Undo:
+                    undo();
+                    ++executed;
+                    continue;
+                case ScriptInstruction::Redo:
+                    redo();
+                    ++executed;
+                    continue;
+                case ScriptInstruction::Repeat:
+                    repeatLastCommand();
+                    ++executed;
+                    continue;
+                case ScriptInstruction::Command:
+                    break;
+                }
+
+                auto command = script.factories[instruction.commandIndex](instruction.args);
+                if (!command) {
+                    // Report commands have no CADCommand and never enter the undo history
+                    if (executeImmediateCommand(script.commandNames[instruction.commandIndex], instruction.args)) {
+                        ++executed;
+                        continue;
+                    }
+                    ++failed;
+                    emit commandFailed(script.sourceLines.value(static_cast<int>(i)),
+                                       QString("Command not available: %1").arg(script.commandNames[instruction.commandIndex]));
+                    continue;
+                }
+
+                command->execute();
+                m_lastCommand = script.commandNames[instruction.commandIndex];
+                m_currentGroup->addCommand(std::move(command));
+                ++executed;
+                if (timing) {
+                    m_telemetry->end(probe, m_lastCommand, true, m_geometryEngine);
+                }
+                continue;
+            } catch (const Standard_Failure& failure) {
+                error = QString::fromLatin1(failure.GetMessageString());
+            } catch (const std::exception& e) {
+                error = QString::fromLocal8Bit(e.what());
+            } catch (...) {
+                error = QStringLiteral("unknown error");
+            }
 
-        if (!executeCommand(trimmedLine)) {
-            success = false;
-            qCWarning(cadCommands) << "Script command failed:" << trimmedLine;
+            ++failed;
+            if (timing && isCommand) {
+                m_telemetry->end(probe, script.commandNames[instruction.commandIndex], false, m_geometryEngine);
+            }
+            qCWarning(cadCommands) << "Script command failed at line" << instruction.line << ":" << error;
         }
     }
 
-    endGroup();
-    return success;
+    m_lastScriptStats.executed = executed;
+    m_lastScriptStats.failed = failed;
+    m_lastScriptStats.elapsedMs = timer.nsecsElapsed() / 1.0e6;
+
+    qCDebug(cadCommands) << "Script finished:" << script.lineCount() << "lines," << failed << "failed in"
+                         << m_lastScriptStats.elapsedMs << "ms";
+    return failed == 0;
 }
 
 void CommandManager::startRecording(const QString& macroName)
@@ -459,9 +696,10 @@ void CommandManager::stopRecording()
 
     if (!m_recordedCommands.isEmpty()) {
         m_macros[m_currentMacroName] = m_recordedCommands;
+        m_macrosDirty = true;
 
         // Save macro to file
-        QString macroPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/macros";
+        QString macroPath = macroDirectory();
         QDir().mkpath(macroPath);
 
         QFile file(macroPath + "/" + m_currentMacroName + ".scr");
@@ -485,14 +723,11 @@ void CommandManager::playMacro(const QString& macroName)
     if (it != m_macros.end()) {
         qCDebug(cadCommands) << "Playing macro:" << macroName;
 
-        beginGroup(QString("Macro: %1").arg(macroName));
-        for (const QString& command : it.value()) {
-            executeCommand(command);
-        }
-        endGroup();
+        auto script = m_scriptCompiler->compileText(it.value().join('\n'), macroName);
+        executeCompiledScript(*script, QString("Macro: %1").arg(macroName));
     } else {
         // Try to load from file
-        QString macroPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/macros/" + macroName + ".scr";
+        QString macroPath = macroDirectory() + "/" + macroName + ".scr";
         if (QFileInfo::exists(macroPath)) {
             executeScript(macroPath);
         } else {
@@ -502,6 +737,49 @@ void CommandManager::playMacro(const QString& macroName)
 }
 
 QStringList CommandManager::getAvailableMacros() const
+{
+    // The folder is only listed again after the watcher reports a change
+    watchMacroDirectory();
+    if (m_macrosDirty) {
+        refreshMacroFiles();
+    }
+    return mergeMacroNames();
+}
+
+QString CommandManager::macroDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/macros";
+}
+
+void CommandManager::watchMacroDirectory() const
+{
+    if (m_macroWatcher) {
+        return;
+    }
+
+    // Created on first use so headless runs never start a watcher
+    auto* self = const_cast<CommandManager*>(this);
+    m_macroWatcher = new QFileSystemWatcher(self);
+    m_macroWatcher->addPath(macroDirectory());
+    connect(m_macroWatcher, &QFileSystemWatcher::directoryChanged, self, [self]() {
+        self->m_macrosDirty = true;
+    });
+}
+
+void CommandManager::refreshMacroFiles() const
+{
+    m_fileMacros.clear();
+
+    QDir macroDir(macroDirectory());
+    for (const QString& file : macroDir.entryList(QStringList() << "*.scr", QDir::Files)) {
+        m_fileMacros.append(QFileInfo(file).baseName());
+    }
+
+    m_macrosDirty = false;
+    m_completer->setMacros(mergeMacroNames());
+}
+
+QStringList CommandManager::mergeMacroNames() const
 {
     QStringList macros;
 
@@ -511,13 +789,8 @@ QStringList CommandManager::getAvailableMacros() const
     }
 
     // Add file-based macros
-    QString macroPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/macros";
-    QDir macroDir(macroPath);
-    QStringList scriptFiles = macroDir.entryList(QStringList() << "*.scr", QDir::Files);
-
-    for (const QString& file : scriptFiles) {
-        QString macroName = QFileInfo(file).baseName();
-        if (!macros.contains(macroName)) {
+    for (const QString& macroName : m_fileMacros) {
+        if (!m_macros.contains(macroName)) {
             macros.append(macroName);
         }
     }
@@ -532,6 +805,18 @@ void CommandManager::setUndoLimit(int limit)
     trimHistory();
 }
 
+void CommandManager::setUndoMemoryBudget(qint64 bytes)
+{
+    m_undoStore->setMemoryBudget(bytes);
+    updateUndoRedoState();
+    emit historyChanged();
+}
+
+qint64 CommandManager::undoMemoryBudget() const
+{
+    return m_undoStore->memoryBudget();
+}
+
 void CommandManager::repeatLastCommand()
 {
     if (m_lastCommand.isEmpty()) {
@@ -570,14 +855,8 @@ void CommandManager::addToHistory(std::unique_ptr<CADCommand> command)
         return;
     }
 
-    // Clear redo stack when adding new command
-    m_redoStack.clear();
-
-    // Add to undo stack
-    m_undoStack.push(std::move(command));
-
-    // Trim history if needed
-    trimHistory();
+    // Adding a new command clears the redo stack and applies count and memory limits
+    m_undoStore->push(std::move(command));
 
     updateUndoRedoState();
     emit historyChanged();
@@ -585,9 +864,7 @@ void CommandManager::addToHistory(std::unique_ptr<CADCommand> command)
 
 void CommandManager::trimHistory()
 {
-    while (m_undoStack.size() > m_undoLimit) {
-        m_undoStack.removeFirst();
-    }
+    m_undoStore->setCountLimit(m_undoLimit);
 }
 
 void CommandManager::updateUndoRedoState()
@@ -599,7 +876,7 @@ void CommandManager::updateUndoRedoState()
     emit redoAvailabilityChanged(canRedoNow);
 }
 
-QStringList CommandManager::parseCommandLine(const QString& commandLine)
+QStringList CommandManager::parseCommandLine(const QString& commandLine) const
 {
     QStringList parts;
     QString current;
@@ -627,7 +904,7 @@ QStringList CommandManager::parseCommandLine(const QString& commandLine)
     return parts;
 }
 
-QString CommandManager::resolveAlias(const QString& command)
+QString CommandManager::resolveAlias(const QString& command) const
 {
     auto it = m_aliases.find(command.toLower());
     if (it != m_aliases.end()) {
@@ -671,6 +948,25 @@ void CommandManager::initializeBuiltinCommands()
         return nullptr;
     });
 
+    // Handled by executeImmediateCommand; registered for help, completion and scripts
+    registerBuiltinCommand("timing", "Command timings: TIMING [ON|OFF|CLEAR|CSV file|JSON file]",
+                           [](const QStringList& args) -> std::unique_ptr<CADCommand> {
+        Q_UNUSED(args);
+        return nullptr;
+    });
+
+    registerBuiltinCommand("trace", "Structured tracing: TRACE [START|STOP|CLEAR|SAVE file]",
+                           [](const QStringList& args) -> std::unique_ptr<CADCommand> {
+        Q_UNUSED(args);
+        return nullptr;
+    });
+
+    registerBuiltinCommand("layerstats", "Per-layer objects, vertices and memory: LAYERSTATS [layer]",
+                           [](const QStringList& args) -> std::unique_ptr<CADCommand> {
+        Q_UNUSED(args);
+        return nullptr;
+    });
+
     // Common aliases
     registerAlias("l", "line");
     registerAlias("c", "circle");
@@ -683,6 +979,120 @@ void CommandManager::initializeBuiltinCommands()
     qCDebug(cadCommands) << "Builtin commands initialized";
 }
 
+bool CommandManager::executeImmediateCommand(const QString& name, const QStringList& args)
+{
+    if (name == "timing") {
+        executeTimingCommand(args);
+    } else if (name == "trace") {
+        executeTraceCommand(args);
+    } else if (name == "layerstats") {
+        executeLayerStatsCommand(args);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void CommandManager::executeTimingCommand(const QStringList& args)
+{
+    const QString option = args.value(0).toLower();
+
+    if (option.isEmpty()) {
+        emit commandOutput(m_telemetry->formatReport());
+    } else if (option == "on") {
+        m_telemetry->setEnabled(true);
+        emit commandOutput("Command timing on");
+    } else if (option == "off") {
+        m_telemetry->setEnabled(false);
+        emit commandOutput("Command timing off");
+    } else if (option == "clear") {
+        m_telemetry->clear();
+        emit commandOutput("Command timings cleared");
+    } else if ((option == "csv" || option == "json") && args.size() > 1) {
+        const QString path = args.mid(1).join(' ');
+        const bool ok = option == "csv" ? m_telemetry->exportCsv(path) : m_telemetry->exportJson(path);
+        emit commandOutput(ok ? QString("Command timings written to %1").arg(path)
+                              : QString("Cannot write %1").arg(path));
+    } else {
+        emit commandOutput(getCommandHelp("timing"));
+    }
+}
+
+void CommandManager::executeTraceCommand(const QStringList& args)
+{
+    if (!Tracing::isCompiledIn()) {
+        emit commandOutput("Tracing is not compiled in; configure with -DCAD_ENABLE_TRACING=ON");
+        return;
+    }
+
+    const QString option = args.value(0).toLower();
+
+    if (option.isEmpty()) {
+        emit commandOutput(QString("Tracing %1, %2 events buffered")
+                               .arg(Tracing::isRecording() ? "on" : "off").arg(Tracing::eventCount()));
+    } else if (option == "start") {
+        Tracing::start();
+        emit commandOutput("Tracing started");
+    } else if (option == "stop") {
+        Tracing::stop();
+        emit commandOutput("Tracing stopped");
+    } else if (option == "clear") {
+        Tracing::clear();
+        emit commandOutput("Trace buffers cleared");
+    } else if (option == "save" && args.size() > 1) {
+        // Rings are read unsynchronized, so recording pauses while exporting
+        const bool wasRecording = Tracing::isRecording();
+        Tracing::stop();
+        const QString path = args.mid(1).join(' ');
+        const bool ok = Tracing::exportChromeTrace(path);
+        if (wasRecording) {
+            Tracing::start();
+        }
+        emit commandOutput(ok ? QString("Trace written to %1").arg(path) : QString("Cannot write %1").arg(path));
+    } else {
+        emit commandOutput(getCommandHelp("trace"));
+    }
+}
+
+void CommandManager::executeLayerStatsCommand(const QStringList& args)
+{
+    if (!m_geometryEngine) {
+        return;
+    }
+
+    const LayerUsageIndex& index = m_geometryEngine->layerIndex();
+    const QStringList names = args.isEmpty() ? index.usedLayers() : QStringList(args.join(' '));
+
+    // Largest layers first, for capacity planning
+    std::vector<std::pair<QString, LayerUsage>> layers;
+    layers.reserve(names.size());
+    for (const QString& name : names) {
+        layers.emplace_back(name, index.usage(name));
+    }
+    std::sort(layers.begin(), layers.end(), [](const auto& a, const auto& b) {
+        return a.second.bytes > b.second.bytes;
+    });
+
+    QString report = QString("%1 %2 %3 %4 %5")
+                         .arg("Layer", -24).arg("Objects", 9).arg("Visible", 9).arg("Vertices", 11).arg("Memory KB", 11);
+    auto addRow = [&report](const QString& name, const LayerUsage& usage) {
+        report += QString("\n%1 %2 %3 %4 %5")
+                      .arg(name, -24)
+                      .arg(usage.objects, 9)
+                      .arg(usage.visibleObjects, 9)
+                      .arg(usage.vertices, 11)
+                      .arg(usage.bytes / 1024.0, 11, 'f', 1);
+    };
+    for (const auto& layer : layers) {
+        addRow(layer.first, layer.second);
+    }
+    if (args.isEmpty()) {
+        addRow("Total", index.totals());
+    }
+
+    emit commandOutput(report);
+}
+
 void CommandManager::registerBuiltinCommand(const QString& name, const QString& help,
                                           std::function<std::unique_ptr<CADCommand>(const QStringList&)> factory)
 {
@@ -692,4 +1102,5 @@ void CommandManager::registerBuiltinCommand(const QString& name, const QString&
     info.factory = factory;
 
     m_commands[name.toLower()] = info;
+    ++m_registryRevision;
 }
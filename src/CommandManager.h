@@ -1,11 +1,23 @@
 #pragma once
 
 #include <QObject>
-#include <QStack>
+#include <QHash>
+#include <QMap>
 #include <QStringList>
 #include <QLoggingCategory>
+#include <functional>
 #include <memory>
 
+class QDataStream;
+class UndoStore;
+class GeometryEngine;
+class ScriptCompiler;
+class CommandCompleter;
+class CommandTelemetry;
+class QFileSystemWatcher;
+struct CompiledScript;
+struct CommandCompletion;
+
 Q_DECLARE_LOGGING_CATEGORY(cadCommands)
 
 /**
@@ -33,6 +45,14 @@ public:
     virtual bool isGroupStart() const { return false; }
     virtual bool isGroupEnd() const { return false; }
     virtual QString groupName() const { return QString(); }
+
+    // Undo storage: approximate bytes held for undo, and optional
+    // serialization so the undo store can compress and spill old steps
+    virtual size_t memoryCost() const { return sizeof(*this); }
+    virtual bool canSpill() const { return false; }
+    virtual bool saveState(QDataStream& stream) const { Q_UNUSED(stream); return false; }
+    virtual bool restoreState(QDataStream& stream) { Q_UNUSED(stream); return false; }
+    virtual void releaseState() {}
 };
 
 /**
@@ -53,6 +73,12 @@ public:
     
     QString name() const override { return m_name; }
     QString description() const override;
+
+    size_t memoryCost() const override;
+    bool canSpill() const override;
+    bool saveState(QDataStream& stream) const override;
+    bool restoreState(QDataStream& stream) override;
+    void releaseState() override;
     
     bool isEmpty() const { return m_commands.empty(); }
     size_t commandCount() const { return m_commands.size(); }
@@ -63,12 +89,24 @@ private:
     bool m_executed;
 };
 
+/**
+ * @brief Counters from the most recent script run
+ */
+struct ScriptRunStats
+{
+    int executed;               // Succeeded; failed lines are not included
+    int failed;
+    double elapsedMs;
+
+    ScriptRunStats() : executed(0), failed(0), elapsedMs(0.0) {}
+};
+
 /**
  * @brief Manages command execution, undo/redo functionality
  * 
  * Provides comprehensive command management including:
  * - Command execution with parameter validation
- * - Unlimited undo/redo with command history
+ * - Undo/redo history held in a memory-budgeted UndoStore
  * - Command grouping for complex operations
  * - Command aliases and shortcuts
  * - Script execution and recording
@@ -82,6 +120,10 @@ public:
     explicit CommandManager(QObject *parent = nullptr);
     ~CommandManager();
 
+    // Engine whose display work is deferred while scripts run
+    void setGeometryEngine(GeometryEngine* engine) { m_geometryEngine = engine; }
+    GeometryEngine* geometryEngine() const { return m_geometryEngine; }
+
     // Command execution
     bool executeCommand(const QString& commandLine);
     bool executeCommand(std::unique_ptr<CADCommand> command);
@@ -112,11 +154,19 @@ public:
     // Command completion and help
     QStringList getAvailableCommands() const;
     QStringList getCommandCompletions(const QString& partial) const;
+    QList<CommandCompletion> completeCommand(const QString& partial, int limit = 20) const;
+    CommandCompleter* commandCompleter() const { return m_completer.get(); }
     QString getCommandHelp(const QString& command) const;
     
-    // Script execution
+    // Script execution (compiled once, cached, run without per-line parsing)
     bool executeScript(const QString& scriptPath);
     bool executeScriptText(const QString& scriptText);
+    bool executeCompiledScript(const CompiledScript& script, const QString& groupName = "Script Execution");
+    const ScriptRunStats& lastScriptStats() const { return m_lastScriptStats; }
+    ScriptCompiler* scriptCompiler() const { return m_scriptCompiler.get(); }
+
+    // Bumped on every command or alias change; compiled scripts depend on it
+    quint64 registryRevision() const { return m_registryRevision; }
     
     // Command recording
     void startRecording(const QString& macroName);
@@ -128,17 +178,26 @@ public:
     // Settings
     void setUndoLimit(int limit);
     int undoLimit() const { return m_undoLimit; }
+
+    void setUndoMemoryBudget(qint64 bytes);
+    qint64 undoMemoryBudget() const;
+    UndoStore* undoStore() const { return m_undoStore.get(); }
     
     void setCommandEcho(bool echo) { m_commandEcho = echo; }
     bool commandEcho() const { return m_commandEcho; }
 
+    // Per-command timing; recording is off until enabled or TIMING ON
+    CommandTelemetry* telemetry() const { return m_telemetry.get(); }
+
 signals:
     void commandExecuted(const QString& command);
     void commandFailed(const QString& command, const QString& error);
+    void commandOutput(const QString& text);
     void undoAvailabilityChanged(bool available);
     void redoAvailabilityChanged(bool available);
     void historyChanged();
     void groupingChanged(bool grouping);
+    void scriptCompileFailed(const QString& script, const QMap<int, QString>& errors);
 
 public slots:
     void repeatLastCommand();
@@ -149,6 +208,8 @@ private slots:
     void onCommandFailed(const QString& error);
 
 private:
+    friend class ScriptCompiler;
+
     struct CommandInfo {
         QString name;
         QString help;
@@ -159,21 +220,36 @@ private:
     void trimHistory();
     void updateUndoRedoState();
     
-    QStringList parseCommandLine(const QString& commandLine);
-    QString resolveAlias(const QString& command);
+    QStringList parseCommandLine(const QString& commandLine) const;
+    QString resolveAlias(const QString& command) const;
     std::unique_ptr<CADCommand> createCommand(const QString& name, const QStringList& args);
     
     void initializeBuiltinCommands();
+    bool executeImmediateCommand(const QString& name, const QStringList& args);   // False if not one
+    void executeTimingCommand(const QStringList& args);
+    void executeTraceCommand(const QStringList& args);
+    void executeLayerStatsCommand(const QStringList& args);
+    void updateCompleter() const;
+    void watchMacroDirectory() const;
+    void refreshMacroFiles() const;
+    QStringList mergeMacroNames() const;
+    static QString macroDirectory();
     void registerBuiltinCommand(const QString& name, const QString& help,
                                std::function<std::unique_ptr<CADCommand>(const QStringList&)> factory);
 
-    // Command history stacks
-    QStack<std::unique_ptr<CADCommand>> m_undoStack;
-    QStack<std::unique_ptr<CADCommand>> m_redoStack;
+    GeometryEngine* m_geometryEngine;
+
+    // Command history (undo and redo stacks with byte accounting and spill)
+    std::unique_ptr<UndoStore> m_undoStore;
     
     // Command registration
     QHash<QString, CommandInfo> m_commands;
     QHash<QString, QString> m_aliases;
+    quint64 m_registryRevision;
+
+    // Script compilation cache
+    std::unique_ptr<ScriptCompiler> m_scriptCompiler;
+    ScriptRunStats m_lastScriptStats;
     
     // Command grouping
     std::unique_ptr<CADCommandGroup> m_currentGroup;
@@ -183,6 +259,16 @@ private:
     QString m_currentMacroName;
     QStringList m_recordedCommands;
     QHash<QString, QStringList> m_macros;
+
+    // Completion index, refreshed lazily from the registry and macro folder
+    std::unique_ptr<CommandCompleter> m_completer;
+    mutable quint64 m_completerRevision;
+    mutable QFileSystemWatcher* m_macroWatcher;
+    mutable QStringList m_fileMacros;
+    mutable bool m_macrosDirty;
+    
+    // Telemetry
+    std::unique_ptr<CommandTelemetry> m_telemetry;
     
     // Settings
     int m_undoLimit;
@@ -1,10 +1,14 @@
 #include "GeometryEngine.h"
+#include "LayerUsageIndex.h"
+#include "Tracing.h"
+#include <algorithm>
 
 // OpenCASCADE includes
 #include <V3d_Viewer.hxx>
 #include <V3d_View.hxx>
 #include <AIS_InteractiveContext.hxx>
 #include <AIS_Shape.hxx>
+#include <AIS_ConnectedInteractive.hxx>
 #include <AIS_Point.hxx>
 #include <OpenGl_GraphicDriver.hxx>
 #include <Aspect_Handle.hxx>
@@ -57,7 +61,11 @@ Q_LOGGING_CATEGORY(cadGeometry, "cad.geometry")
 GeometryEngine::GeometryEngine(QObject *parent)
     : QObject(parent)
     , m_nextEntityId(1)
+    , m_changeCount(0)
+    , m_layerIndex(std::make_unique<LayerUsageIndex>())
     , m_initialized(false)
+    , m_headless(false)
+    , m_deferredDisplay(0)
 {
     qCDebug(cadGeometry) << "Geometry engine created";
 }
@@ -73,9 +81,11 @@ bool GeometryEngine::initialize()
     qCDebug(cadGeometry) << "Initializing geometry engine...";
     
     try {
-        initializeOpenCASCADE();
-        setupViewer();
-        setupContext();
+        if (!m_headless) {
+            initializeOpenCASCADE();
+            setupViewer();
+            setupContext();
+        }
         
         m_initialized = true;
         qCDebug(cadGeometry) << "Geometry engine initialized successfully";
@@ -109,6 +119,72 @@ void GeometryEngine::shutdown()
     qCDebug(cadGeometry) << "Geometry engine shutdown complete";
 }
 
+void GeometryEngine::beginDeferredDisplay()
+{
+    ++m_deferredDisplay;
+}
+
+void GeometryEngine::endDeferredDisplay()
+{
+    CAD_TRACE_SCOPE("geometry", "endDeferredDisplay");
+
+    if (m_deferredDisplay == 0) {
+        qCWarning(cadGeometry) << "endDeferredDisplay without matching begin";
+        return;
+    }
+
+    if (--m_deferredDisplay > 0) {
+        return;
+    }
+
+    // Layers whose object counts changed while deferred, once each
+    if (!m_deferredLayerChanges.empty()) {
+        std::vector<QString> layers;
+        layers.swap(m_deferredLayerChanges);
+        std::sort(layers.begin(), layers.end());
+        layers.erase(std::unique(layers.begin(), layers.end()), layers.end());
+        for (const QString& layer : layers) {
+            emit layerObjectCountChanged(layer);
+        }
+    }
+
+    // Report batched insertions in one go; removed-while-deferred ids are dropped
+    if (!m_deferredAdds.empty()) {
+        std::vector<int> added;
+        added.swap(m_deferredAdds);
+        added.erase(std::remove_if(added.begin(), added.end(),
+                                   [this](int id) { return m_entities.count(id) == 0; }),
+                    added.end());
+        qCDebug(cadGeometry) << "Entities added (batched):" << added.size();
+        emit entitiesAdded(added);
+    }
+
+    if (m_context.IsNull()) {
+        return;
+    }
+
+    // Build the presentations skipped while deferred, then redraw once
+    int created = 0;
+    for (auto& pair : m_entities) {
+        CADEntity& entity = pair.second;
+        if (entity.shape.IsNull() || !entity.aisObject.IsNull()) {
+            continue;
+        }
+
+        Handle(AIS_InteractiveObject) aisObject = createAISObject(entity);
+        if (!aisObject.IsNull()) {
+            entity.aisObject = aisObject;
+            if (entity.visible) {
+                m_context->Display(aisObject, Standard_False);
+            }
+            ++created;
+        }
+    }
+
+    qCDebug(cadGeometry) << "Deferred display flushed:" << created << "presentations";
+    updateDisplay();
+}
+
 void GeometryEngine::initializeOpenCASCADE()
 {
     qCDebug(cadGeometry) << "Initializing OpenCASCADE...";
@@ -159,30 +235,76 @@ int GeometryEngine::getNextEntityId()
 int GeometryEngine::addEntity(const CADEntity& entity)
 {
     int id = getNextEntityId();
-    m_entities[id] = entity;
+    restoreEntity(id, entity);
+    return id;
+}
+
+std::vector<int> GeometryEngine::addEntities(std::vector<CADEntity>&& entities)
+{
+    CAD_TRACE_SCOPE("geometry", "addEntities");
+
+    // Moved in, and reported through entitiesAdded() once
+    std::vector<int> ids;
+    ids.reserve(entities.size());
+    beginDeferredDisplay();
+    for (CADEntity& entity : entities) {
+        const int id = getNextEntityId();
+        insertEntity(id, std::move(entity));
+        ids.push_back(id);
+    }
+    endDeferredDisplay();
+    entities.clear();
+    return ids;
+}
+
+bool GeometryEngine::restoreEntity(int id, const CADEntity& entity)
+{
+    CAD_TRACE_SCOPE("geometry", "addEntity");
+    return insertEntity(id, CADEntity(entity));
+}
+
+bool GeometryEngine::insertEntity(int id, CADEntity&& entity)
+{
+    if (m_entities.count(id) != 0) {
+        qCWarning(cadGeometry) << "Entity already exists:" << id;
+        return false;
+    }
+
+    // Keep freshly allocated ids clear of restored ones
+    m_nextEntityId = std::max(m_nextEntityId, id + 1);
+    CADEntity& stored = m_entities.emplace_hint(m_entities.end(), id, std::move(entity))->second;
+    ++m_changeCount;
     
-    // Create AIS object if shape is valid
-    if (!entity.shape.IsNull()) {
-        Handle(AIS_InteractiveObject) aisObject = createAISObject(entity);
+    // A presentation copied in with the entity belongs to another one
+    stored.aisObject.Nullify();
+
+    // Create AIS object if shape is valid (later, when display is deferred or absent)
+    if (!stored.shape.IsNull() && isDisplayActive()) {
+        Handle(AIS_InteractiveObject) aisObject = createAISObject(stored);
         if (!aisObject.IsNull()) {
-            m_entities[id].aisObject = aisObject;
+            stored.aisObject = aisObject;
             m_context->Display(aisObject, Standard_False);
         }
     }
     
-    // Add to layer
-    if (!entity.layer.isEmpty()) {
-        m_layers[entity.layer].push_back(id);
-    }
+    m_layerIndex->add(id, stored);
+    layerCountChanged(stored.layer);
     
-    qCDebug(cadGeometry) << "Entity added with ID:" << id;
-    emit entityAdded(id);
+    CAD_TRACE_COUNTER("geometry", "entities", m_entities.size());
+
+    if (m_deferredDisplay > 0) {
+        m_deferredAdds.push_back(id);
+    } else {
+        emit entityAdded(id);
+    }
     
-    return id;
+    return true;
 }
 
 bool GeometryEngine::removeEntity(int id)
 {
+    CAD_TRACE_SCOPE("geometry", "removeEntity");
+
     auto it = m_entities.find(id);
     if (it == m_entities.end()) {
         qCWarning(cadGeometry) << "Entity not found:" << id;
@@ -192,17 +314,17 @@ bool GeometryEngine::removeEntity(int id)
     // Remove from display
     if (!it->second.aisObject.IsNull()) {
         m_context->Remove(it->second.aisObject, Standard_False);
+        releaseBlockPrototype(it->second);
     }
     
-    // Remove from layer
-    if (!it->second.layer.isEmpty()) {
-        auto& layerEntities = m_layers[it->second.layer];
-        layerEntities.erase(std::remove(layerEntities.begin(), layerEntities.end(), id), layerEntities.end());
-    }
+    const QString layer = it->second.layer;
+    m_layerIndex->remove(id);
     
     m_entities.erase(it);
+    ++m_changeCount;
+    CAD_TRACE_COUNTER("geometry", "entities", m_entities.size());
+    layerCountChanged(layer);
     
-    qCDebug(cadGeometry) << "Entity removed:" << id;
     emit entityRemoved(id);
     
     return true;
@@ -210,6 +332,8 @@ bool GeometryEngine::removeEntity(int id)
 
 bool GeometryEngine::updateEntity(int id, const CADEntity& entity)
 {
+    CAD_TRACE_SCOPE("geometry", "updateEntity");
+
     auto it = m_entities.find(id);
     if (it == m_entities.end()) {
         qCWarning(cadGeometry) << "Entity not found:" << id;
@@ -219,13 +343,22 @@ bool GeometryEngine::updateEntity(int id, const CADEntity& entity)
     // Remove old AIS object
     if (!it->second.aisObject.IsNull()) {
         m_context->Remove(it->second.aisObject, Standard_False);
+        releaseBlockPrototype(it->second);
     }
     
     // Update entity
+    const QString previousLayer = it->second.layer;
     it->second = entity;
+    ++m_changeCount;
+    m_layerIndex->update(id, entity);
+    if (entity.layer != previousLayer) {
+        layerCountChanged(previousLayer);
+        layerCountChanged(entity.layer);
+    }
     
     // Create new AIS object
-    if (!entity.shape.IsNull()) {
+    it->second.aisObject.Nullify();
+    if (!entity.shape.IsNull() && isDisplayActive()) {
         Handle(AIS_InteractiveObject) aisObject = createAISObject(entity);
         if (!aisObject.IsNull()) {
             it->second.aisObject = aisObject;
@@ -233,7 +366,6 @@ bool GeometryEngine::updateEntity(int id, const CADEntity& entity)
         }
     }
     
-    qCDebug(cadGeometry) << "Entity updated:" << id;
     emit entityModified(id);
     
     return true;
@@ -268,17 +400,25 @@ void GeometryEngine::clearAllEntities()
         }
     }
     
+    const QStringList usedLayers = m_layerIndex->usedLayers();
+    m_changeCount += m_entities.size();
     m_entities.clear();
-    m_layers.clear();
+    m_blockPrototypes.clear();
+    m_layerIndex->clear();
+    m_deferredAdds.clear();
     m_nextEntityId = 1;
+    for (const QString& layer : usedLayers) {
+        layerCountChanged(layer);
+    }
     
+    emit entitiesCleared();
     qCDebug(cadGeometry) << "All entities cleared";
 }
 
 // 2D Primitive creation
 int GeometryEngine::createPoint(const gp_Pnt& point)
 {
-    qCDebug(cadGeometry) << "Creating point at:" << point.X() << point.Y() << point.Z();
+    CAD_TRACE_SCOPE("geometry", "createPoint");
     
     CADEntity entity;
     entity.type = CADEntity::Point;
@@ -289,8 +429,7 @@ int GeometryEngine::createPoint(const gp_Pnt& point)
 
 int GeometryEngine::createLine(const gp_Pnt& start, const gp_Pnt& end)
 {
-    qCDebug(cadGeometry) << "Creating line from:" << start.X() << start.Y() << start.Z() 
-                        << "to:" << end.X() << end.Y() << end.Z();
+    CAD_TRACE_SCOPE("geometry", "createLine");
     
     CADEntity entity;
     entity.type = CADEntity::Line;
@@ -302,8 +441,7 @@ int GeometryEngine::createLine(const gp_Pnt& start, const gp_Pnt& end)
 // 3D Primitive creation
 int GeometryEngine::createBox(const gp_Pnt& corner, double dx, double dy, double dz)
 {
-    qCDebug(cadGeometry) << "Creating box at:" << corner.X() << corner.Y() << corner.Z()
-                        << "size:" << dx << dy << dz;
+    CAD_TRACE_SCOPE("geometry", "createBox");
 
     CADEntity entity;
     entity.type = CADEntity::Box;
@@ -314,8 +452,7 @@ int GeometryEngine::createBox(const gp_Pnt& corner, double dx, double dy, double
 
 int GeometryEngine::createSphere(const gp_Pnt& center, double radius)
 {
-    qCDebug(cadGeometry) << "Creating sphere at:" << center.X() << center.Y() << center.Z()
-                        << "radius:" << radius;
+    CAD_TRACE_SCOPE("geometry", "createSphere");
 
     CADEntity entity;
     entity.type = CADEntity::Sphere;
@@ -326,8 +463,7 @@ int GeometryEngine::createSphere(const gp_Pnt& center, double radius)
 
 int GeometryEngine::createCylinder(const gp_Pnt& center, const gp_Dir& axis, double radius, double height)
 {
-    qCDebug(cadGeometry) << "Creating cylinder at:" << center.X() << center.Y() << center.Z()
-                        << "radius:" << radius << "height:" << height;
+    CAD_TRACE_SCOPE("geometry", "createCylinder");
 
     CADEntity entity;
     entity.type = CADEntity::Cylinder;
@@ -340,8 +476,7 @@ int GeometryEngine::createCylinder(const gp_Pnt& center, const gp_Dir& axis, dou
 
 int GeometryEngine::createCone(const gp_Pnt& center, const gp_Dir& axis, double radius1, double radius2, double height)
 {
-    qCDebug(cadGeometry) << "Creating cone at:" << center.X() << center.Y() << center.Z()
-                        << "radii:" << radius1 << radius2 << "height:" << height;
+    CAD_TRACE_SCOPE("geometry", "createCone");
 
     CADEntity entity;
     entity.type = CADEntity::Cone;
@@ -354,8 +489,7 @@ int GeometryEngine::createCone(const gp_Pnt& center, const gp_Dir& axis, double
 
 int GeometryEngine::createTorus(const gp_Pnt& center, const gp_Dir& axis, double majorRadius, double minorRadius)
 {
-    qCDebug(cadGeometry) << "Creating torus at:" << center.X() << center.Y() << center.Z()
-                        << "radii:" << majorRadius << minorRadius;
+    CAD_TRACE_SCOPE("geometry", "createTorus");
 
     CADEntity entity;
     entity.type = CADEntity::Torus;
@@ -406,6 +540,7 @@ int GeometryEngine::revolveProfile(int profileId, const gp_Ax1& axis, double ang
 // Boolean operations
 int GeometryEngine::booleanUnion(int entity1Id, int entity2Id)
 {
+    CAD_TRACE_SCOPE("geometry", "booleanUnion");
     auto it1 = m_entities.find(entity1Id);
     auto it2 = m_entities.find(entity2Id);
 
@@ -431,6 +566,7 @@ int GeometryEngine::booleanUnion(int entity1Id, int entity2Id)
 
 int GeometryEngine::booleanSubtract(int entity1Id, int entity2Id)
 {
+    CAD_TRACE_SCOPE("geometry", "booleanSubtract");
     auto it1 = m_entities.find(entity1Id);
     auto it2 = m_entities.find(entity2Id);
 
@@ -456,6 +592,7 @@ int GeometryEngine::booleanSubtract(int entity1Id, int entity2Id)
 
 int GeometryEngine::booleanIntersect(int entity1Id, int entity2Id)
 {
+    CAD_TRACE_SCOPE("geometry", "booleanIntersect");
     auto it1 = m_entities.find(entity1Id);
     auto it2 = m_entities.find(entity2Id);
 
@@ -532,8 +669,19 @@ std::pair<gp_Pnt, gp_Pnt> GeometryEngine::getBoundingBox(int entityId)
         return std::make_pair(gp_Pnt(), gp_Pnt());
     }
 
+    // Inserts reuse their definition's bounds instead of walking the shared geometry
     Bnd_Box box;
-    BRepBndLib::Add(it->second.shape, box);
+    const TopoDS_Shape& shape = it->second.shape;
+    auto prototype = it->second.type == CADEntity::Block && !shape.IsNull()
+        ? m_blockPrototypes.find(shape.TShape().get()) : m_blockPrototypes.end();
+    if (prototype != m_blockPrototypes.end()) {
+        box = prototype->second.bounds.Transformed(shape.Location().Transformation());
+    } else {
+        BRepBndLib::Add(shape, box);
+    }
+    if (box.IsVoid()) {
+        return std::make_pair(gp_Pnt(), gp_Pnt());
+    }
 
     double xmin, ymin, zmin, xmax, ymax, zmax;
     box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
@@ -564,6 +712,7 @@ void GeometryEngine::setEntityVisible(int entityId, bool visible)
     }
 
     it->second.visible = visible;
+    m_layerIndex->update(entityId, it->second);
 
     if (!it->second.aisObject.IsNull()) {
         if (visible) {
@@ -606,18 +755,15 @@ void GeometryEngine::setEntityLayer(int entityId, const QString& layer)
         return;
     }
 
-    // Remove from old layer
-    if (!it->second.layer.isEmpty()) {
-        auto& oldLayerEntities = m_layers[it->second.layer];
-        oldLayerEntities.erase(std::remove(oldLayerEntities.begin(), oldLayerEntities.end(), entityId),
-                              oldLayerEntities.end());
+    if (it->second.layer == layer) {
+        return;
     }
 
-    // Add to new layer
+    const QString previousLayer = it->second.layer;
     it->second.layer = layer;
-    if (!layer.isEmpty()) {
-        m_layers[layer].push_back(entityId);
-    }
+    m_layerIndex->update(entityId, it->second);
+    layerCountChanged(previousLayer);
+    layerCountChanged(layer);
 
     emit entityModified(entityId);
 }
@@ -635,11 +781,9 @@ void GeometryEngine::setLayerVisible(const QString& layer, bool visible)
 {
     m_layerVisibility[layer] = visible;
 
-    auto layerIt = m_layers.find(layer);
-    if (layerIt != m_layers.end()) {
-        for (int entityId : layerIt->second) {
-            setEntityVisible(entityId, visible);
-        }
+    // Visibility does not move entities between layers, so the list is stable
+    for (int entityId : m_layerIndex->entities(layer)) {
+        setEntityVisible(entityId, visible);
     }
 }
 
@@ -647,17 +791,61 @@ void GeometryEngine::setLayerColor(const QString& layer, int color)
 {
     m_layerColors[layer] = color;
 
-    auto layerIt = m_layers.find(layer);
-    if (layerIt != m_layers.end()) {
-        for (int entityId : layerIt->second) {
-            setEntityColor(entityId, color);
+    for (int entityId : m_layerIndex->entities(layer)) {
+        setEntityColor(entityId, color);
+    }
+}
+
+void GeometryEngine::renameLayer(const QString& oldName, const QString& newName)
+{
+    if (oldName == newName) {
+        return;
+    }
+
+    const std::vector<int> entities = m_layerIndex->entities(oldName);
+    for (int entityId : entities) {
+        m_entities[entityId].layer = newName;
+    }
+    m_layerIndex->renameLayer(oldName, newName);
+
+    // Visibility and colour overrides follow the layer to its new name
+    auto visibility = m_layerVisibility.find(oldName);
+    if (visibility != m_layerVisibility.end()) {
+        m_layerVisibility[newName] = visibility->second;
+        m_layerVisibility.erase(visibility);
+    }
+    auto color = m_layerColors.find(oldName);
+    if (color != m_layerColors.end()) {
+        m_layerColors[newName] = color->second;
+        m_layerColors.erase(color);
+    }
+
+    if (!entities.empty()) {
+        ++m_changeCount;
+        layerCountChanged(oldName);
+        layerCountChanged(newName);
+        for (int entityId : entities) {
+            emit entityModified(entityId);
+        }
+    }
+}
+
+void GeometryEngine::layerCountChanged(const QString& layer)
+{
+    if (m_deferredDisplay > 0) {
+        // Bulk inserts tend to run layer by layer; duplicates are dropped on flush
+        if (m_deferredLayerChanges.empty() || m_deferredLayerChanges.back() != layer) {
+            m_deferredLayerChanges.push_back(layer);
         }
+    } else {
+        emit layerObjectCountChanged(layer);
     }
 }
 
 // Import/Export
 bool GeometryEngine::importSTEP(const QString& filename)
 {
+    CAD_TRACE_SCOPE("geometry", "importSTEP");
     qCDebug(cadGeometry) << "Importing STEP file:" << filename;
 
     STEPCAFControl_Reader reader;
@@ -686,6 +874,7 @@ bool GeometryEngine::importSTEP(const QString& filename)
 
 bool GeometryEngine::exportSTEP(const QString& filename, const std::vector<int>& entityIds)
 {
+    CAD_TRACE_SCOPE("geometry", "exportSTEP");
     qCDebug(cadGeometry) << "Exporting STEP file:" << filename;
 
     STEPCAFControl_Writer writer;
@@ -721,17 +910,50 @@ bool GeometryEngine::exportSTEP(const QString& filename, const std::vector<int>&
 // Utility functions
 Handle(AIS_InteractiveObject) GeometryEngine::createAISObject(const CADEntity& entity)
 {
+    CAD_TRACE_SCOPE("geometry", "createAISObject");
     if (entity.shape.IsNull()) {
         return Handle(AIS_InteractiveObject)();
     }
 
-    Handle(AIS_Shape) aisShape = new AIS_Shape(entity.shape);
+    Handle(AIS_InteractiveObject) aisObject;
+    if (entity.type == CADEntity::Block) {
+        Handle(AIS_ConnectedInteractive) instance = new AIS_ConnectedInteractive();
+        instance->Connect(acquireBlockPrototype(entity.shape.Located(TopLoc_Location())),
+                          entity.shape.Location().Transformation());
+        aisObject = instance;
+    } else {
+        aisObject = new AIS_Shape(entity.shape);
+    }
 
     // Set display properties
-    aisShape->SetColor(Quantity_Color(entity.color / 255.0, entity.color / 255.0, entity.color / 255.0, Quantity_TOC_RGB));
-    aisShape->SetTransparency(entity.visible ? 0.0 : 0.8);
+    aisObject->SetColor(Quantity_Color(entity.color / 255.0, entity.color / 255.0, entity.color / 255.0, Quantity_TOC_RGB));
+    aisObject->SetTransparency(entity.visible ? 0.0 : 0.8);
+
+    return aisObject;
+}
+
+Handle(AIS_InteractiveObject) GeometryEngine::acquireBlockPrototype(const TopoDS_Shape& definition)
+{
+    BlockPrototype& prototype = m_blockPrototypes[definition.TShape().get()];
+    if (prototype.presentation.IsNull()) {
+        // Tessellated once, however many inserts connect to it
+        prototype.definition = definition;
+        BRepBndLib::Add(definition, prototype.bounds);
+        prototype.presentation = new AIS_Shape(definition);
+    }
+    ++prototype.instances;
+    return prototype.presentation;
+}
 
-    return aisShape;
+void GeometryEngine::releaseBlockPrototype(const CADEntity& entity)
+{
+    if (entity.type != CADEntity::Block || entity.shape.IsNull()) {
+        return;
+    }
+    auto it = m_blockPrototypes.find(entity.shape.TShape().get());
+    if (it != m_blockPrototypes.end() && --it->second.instances <= 0) {
+        m_blockPrototypes.erase(it);
+    }
 }
 
 void GeometryEngine::updateAISObject(int entityId)
@@ -742,12 +964,10 @@ void GeometryEngine::updateAISObject(int entityId)
     }
 
     // Update display properties
-    Handle(AIS_Shape) aisShape = Handle(AIS_Shape)::DownCast(it->second.aisObject);
-    if (!aisShape.IsNull()) {
-        aisShape->SetColor(Quantity_Color(it->second.color / 255.0, it->second.color / 255.0, it->second.color / 255.0, Quantity_TOC_RGB));
-        aisShape->SetTransparency(it->second.visible ? 0.0 : 0.8);
-        m_context->Redisplay(aisShape, Standard_False);
-    }
+    const Handle(AIS_InteractiveObject)& aisObject = it->second.aisObject;
+    aisObject->SetColor(Quantity_Color(it->second.color / 255.0, it->second.color / 255.0, it->second.color / 255.0, Quantity_TOC_RGB));
+    aisObject->SetTransparency(it->second.visible ? 0.0 : 0.8);
+    m_context->Redisplay(aisObject, Standard_False);
 }
 
 void GeometryEngine::updateDisplay()
@@ -759,8 +979,7 @@ void GeometryEngine::updateDisplay()
 
 int GeometryEngine::createCircle(const gp_Pnt& center, double radius, const gp_Dir& normal)
 {
-    qCDebug(cadGeometry) << "Creating circle at:" << center.X() << center.Y() << center.Z() 
-                        << "radius:" << radius;
+    CAD_TRACE_SCOPE("geometry", "createCircle");
     
     CADEntity entity;
     entity.type = CADEntity::Circle;
@@ -774,8 +993,7 @@ int GeometryEngine::createCircle(const gp_Pnt& center, double radius, const gp_D
 
 int GeometryEngine::createRectangle(const gp_Pnt& corner1, const gp_Pnt& corner2)
 {
-    qCDebug(cadGeometry) << "Creating rectangle from:" << corner1.X() << corner1.Y() << corner1.Z()
-                        << "to:" << corner2.X() << corner2.Y() << corner2.Z();
+    CAD_TRACE_SCOPE("geometry", "createRectangle");
     
     CADEntity entity;
     entity.type = CADEntity::Rectangle;
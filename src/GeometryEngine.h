@@ -3,6 +3,7 @@
 #include <QObject>
 #include <QLoggingCategory>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 // OpenCASCADE includes
@@ -19,6 +20,7 @@
 #include <gp_Pln.hxx>
 #include <gp_Circ.hxx>
 #include <gp_Elips.hxx>
+#include <Bnd_Box.hxx>
 #include <Handle_AIS_InteractiveObject.hxx>
 
 Q_DECLARE_LOGGING_CATEGORY(cadGeometry)
@@ -26,6 +28,7 @@ Q_DECLARE_LOGGING_CATEGORY(cadGeometry)
 class AIS_InteractiveContext;
 class V3d_Viewer;
 class V3d_View;
+class LayerUsageIndex;
 
 /**
  * @brief Geometry data structure for CAD entities
@@ -96,15 +99,36 @@ public:
     bool initialize();
     void shutdown();
 
+    // Headless engines (batch mode) never create a viewer or presentations
+    void setHeadless(bool headless) { m_headless = headless; }
+    bool isHeadless() const { return m_headless; }
+
+    // Defer presentation work during bulk edits; nests, flushed on the last end.
+    // While deferred, additions are reported once through entitiesAdded()
+    // instead of one entityAdded() per entity.
+    void beginDeferredDisplay();
+    void endDeferredDisplay();
+    bool isDisplayDeferred() const { return m_deferredDisplay > 0; }
+
     // Viewer management
     Handle(V3d_Viewer) getViewer() const { return m_viewer; }
     Handle(AIS_InteractiveContext) getContext() const { return m_context; }
 
     // Entity management
     int addEntity(const CADEntity& entity);
+    std::vector<int> addEntities(std::vector<CADEntity>&& entities);  // One deferred batch; ids are consecutive
     bool removeEntity(int id);
     bool updateEntity(int id, const CADEntity& entity);
     CADEntity getEntity(int id) const;
+    bool hasEntity(int id) const { return m_entities.count(id) != 0; }
+    const CADEntity* findEntity(int id) const                // No copy; valid until the entity changes
+    {
+        auto it = m_entities.find(id);
+        return it != m_entities.end() ? &it->second : nullptr;
+    }
+    bool restoreEntity(int id, const CADEntity& entity);   // Re-insert under a known id (undo)
+    int nextEntityId() const { return m_nextEntityId; }    // Ids allocated from here on are new
+    quint64 changeCount() const { return m_changeCount; }  // Adds, updates and removals so far
     std::vector<int> getAllEntityIds() const;
     void clearAllEntities();
 
@@ -179,6 +203,8 @@ public:
     QString getEntityLayer(int entityId) const;
     void setLayerVisible(const QString& layer, bool visible);
     void setLayerColor(const QString& layer, int color);
+    void renameLayer(const QString& oldName, const QString& newName);  // Moves every entity on the layer
+    const LayerUsageIndex& layerIndex() const { return *m_layerIndex; }
 
     // Display properties
     void setEntityColor(int entityId, int color);
@@ -203,9 +229,14 @@ public:
 
 signals:
     void entityAdded(int entityId);
+    void entitiesAdded(const std::vector<int>& entityIds);
     void entityRemoved(int entityId);
     void entityModified(int entityId);
+    // Every entity was dropped at once and ids start over; no entityRemoved is sent
+    void entitiesCleared();
     void selectionChanged(const std::vector<int>& selectedIds);
+    // A layer gained or lost objects; reported once per layer for deferred bulk edits
+    void layerObjectCountChanged(const QString& layer);
 
 private:
     void initializeOpenCASCADE();
@@ -213,8 +244,13 @@ private:
     void setupContext();
     
     int getNextEntityId();
+    bool insertEntity(int id, CADEntity&& entity);
+    bool isDisplayActive() const { return !m_context.IsNull() && m_deferredDisplay == 0; }
     Handle(AIS_InteractiveObject) createAISObject(const CADEntity& entity);
     void updateAISObject(int entityId);
+    void layerCountChanged(const QString& layer);
+    Handle(AIS_InteractiveObject) acquireBlockPrototype(const TopoDS_Shape& definition);
+    void releaseBlockPrototype(const CADEntity& entity);
 
     // OpenCASCADE objects
     Handle(V3d_Viewer) m_viewer;
@@ -223,11 +259,26 @@ private:
     // Entity storage
     std::map<int, CADEntity> m_entities;
     int m_nextEntityId;
+    quint64 m_changeCount;
 
     // Layer management
-    std::map<QString, std::vector<int>> m_layers;
+    std::unique_ptr<LayerUsageIndex> m_layerIndex;
+    std::vector<QString> m_deferredLayerChanges;
     std::map<QString, bool> m_layerVisibility;
     std::map<QString, int> m_layerColors;
 
+    // Block inserts share one presentation per definition compound, keyed by
+    // its TShape; each insert displays a connected instance with its location
+    struct BlockPrototype {
+        TopoDS_Shape definition;
+        Bnd_Box bounds;
+        Handle(AIS_InteractiveObject) presentation;
+        int instances = 0;
+    };
+    std::unordered_map<const void*, BlockPrototype> m_blockPrototypes;
+
     bool m_initialized;
+    bool m_headless;
+    int m_deferredDisplay;
+    std::vector<int> m_deferredAdds;
 };
@@ -0,0 +1,1159 @@
+#include "LayerManager.h"
+#include "GeometryEngine.h"
+#include "LayerUsageIndex.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSet>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(cadLayers, "cad.layers")
+
+namespace {
+
+const QString DefaultLayer = QStringLiteral("0");
+const QString DefpointsLayer = QStringLiteral("Defpoints");
+
+QJsonObject layerToJson(const LayerProperties& layer)
+{
+    QJsonObject object;
+    object["name"] = layer.name;
+    object["color"] = layer.color.name();
+    object["lineType"] = layer.lineType;
+    object["lineWeight"] = layer.lineWeight;
+    object["visible"] = layer.visible;
+    object["frozen"] = layer.frozen;
+    object["locked"] = layer.locked;
+    object["plottable"] = layer.plottable;
+    object["description"] = layer.description;
+    return object;
+}
+
+LayerProperties layerFromJson(const QJsonObject& object)
+{
+    LayerProperties layer(object["name"].toString());
+    layer.color = QColor(object["color"].toString("#ffffff"));
+    layer.lineType = object["lineType"].toString("Continuous");
+    layer.lineWeight = object["lineWeight"].toDouble(0.25);
+    layer.visible = object["visible"].toBool(true);
+    layer.frozen = object["frozen"].toBool(false);
+    layer.locked = object["locked"].toBool(false);
+    layer.plottable = object["plottable"].toBool(true);
+    layer.description = object["description"].toString();
+    return layer;
+}
+
+bool writeLayersFile(const QString& filePath, const std::vector<LayerProperties>& layers)
+{
+    QJsonArray array;
+    for (const LayerProperties& layer : layers) {
+        array.append(layerToJson(layer));
+    }
+    QJsonObject root;
+    root["layers"] = array;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(cadLayers) << "Cannot write layer file:" << filePath;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
+
+bool readLayersFile(const QString& filePath, std::vector<LayerProperties>& layers)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(cadLayers) << "Cannot read layer file:" << filePath;
+        return false;
+    }
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    if (!document.isObject()) {
+        qCWarning(cadLayers) << "Invalid layer file:" << filePath;
+        return false;
+    }
+    for (const QJsonValue& value : document.object()["layers"].toArray()) {
+        LayerProperties layer = layerFromJson(value.toObject());
+        if (!layer.name.isEmpty()) {
+            layers.push_back(layer);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief Groups every change made during its lifetime into one undo step
+ */
+class LayerManager::UndoScope
+{
+public:
+    UndoScope(LayerManager* manager, const QString& description)
+        : m_manager(manager)
+    {
+        m_manager->beginUndoGroup(description);
+    }
+
+    ~UndoScope()
+    {
+        m_manager->endUndoGroup();
+    }
+
+    UndoScope(const UndoScope&) = delete;
+    UndoScope& operator=(const UndoScope&) = delete;
+
+private:
+    LayerManager* m_manager;
+};
+
+LayerManager::LayerManager(QObject *parent)
+    : QObject(parent)
+    , m_geometryEngine(nullptr)
+    , m_usageIndex(nullptr)
+    , m_undoGroupDepth(0)
+    , m_applyingHistory(false)
+    , m_maxUndoLevels(100)
+{
+    initializeDefaultLayers();
+}
+
+LayerManager::~LayerManager() = default;
+
+void LayerManager::initializeDefaultLayers()
+{
+    m_layers[DefaultLayer] = LayerProperties(DefaultLayer);
+
+    LayerProperties defpoints(DefpointsLayer);
+    defpoints.plottable = false;
+    m_layers[DefpointsLayer] = defpoints;
+
+    syncLayerRow(DefaultLayer);
+    syncLayerRow(DefpointsLayer);
+    m_currentLayer = DefaultLayer;
+}
+
+// Layer creation and management
+bool LayerManager::createLayer(const QString& name, const LayerProperties& properties)
+{
+    if (!isValidLayerName(name)) {
+        qCWarning(cadLayers) << "Invalid layer name:" << name;
+        return false;
+    }
+    if (layerExists(name)) {
+        qCWarning(cadLayers) << "Layer already exists:" << name;
+        return false;
+    }
+
+    UndoScope scope(this, "Create layer");
+    recordLayer(name);
+
+    LayerProperties layer = properties;
+    layer.name = name;
+    m_layers[name] = layer;
+    syncLayerRow(name);
+
+    emit layerCreated(name);
+    return true;
+}
+
+bool LayerManager::deleteLayer(const QString& name)
+{
+    auto it = m_layers.find(name);
+    if (it == m_layers.end()) {
+        return false;
+    }
+    if (name == DefaultLayer || name == DefpointsLayer || name == m_currentLayer) {
+        qCWarning(cadLayers) << "Layer cannot be deleted:" << name;
+        return false;
+    }
+    if (getObjectCountInLayer(name) > 0) {
+        qCWarning(cadLayers) << "Layer still has objects:" << name;
+        return false;
+    }
+
+    UndoScope scope(this, "Delete layer");
+    recordLayer(name);
+    m_layers.erase(it);
+    syncLayerRow(name);
+
+    emit layerDeleted(name);
+    return true;
+}
+
+bool LayerManager::renameLayer(const QString& oldName, const QString& newName)
+{
+    auto it = m_layers.find(oldName);
+    if (it == m_layers.end() || oldName == DefaultLayer || oldName == DefpointsLayer) {
+        return false;
+    }
+    if (!isValidLayerName(newName) || layerExists(newName)) {
+        qCWarning(cadLayers) << "Cannot rename layer" << oldName << "to" << newName;
+        return false;
+    }
+
+    UndoScope scope(this, "Rename layer");
+    recordLayer(oldName);
+    recordLayer(newName);
+    if (!m_applyingHistory && m_undoGroupDepth > 0) {
+        m_openChange.renames.emplace_back(oldName, newName);
+    }
+
+    LayerProperties layer = it->second;
+    layer.name = newName;
+    m_layers.erase(it);
+    m_layers[newName] = layer;
+    syncLayerRow(oldName);
+    syncLayerRow(newName);
+
+    if (m_currentLayer == oldName) {
+        m_currentLayer = newName;
+    }
+
+    emit layerRenamed(oldName, newName);
+    return true;
+}
+
+bool LayerManager::duplicateLayer(const QString& sourceName, const QString& newName)
+{
+    auto it = m_layers.find(sourceName);
+    if (it == m_layers.end()) {
+        return false;
+    }
+    return createLayer(newName, it->second);
+}
+
+// Layer existence and validation
+bool LayerManager::layerExists(const QString& name) const
+{
+    return m_layers.find(name) != m_layers.end();
+}
+
+bool LayerManager::isValidLayerName(const QString& name) const
+{
+    static const QRegularExpression invalidCharacters(QStringLiteral("[<>/\\\\\":;?*|=`]"));
+    if (name.size() > 255) {
+        return false;
+    }
+
+    // Xref-dependent layers are named "xref|layer"
+    const QStringList parts = name.split(QLatin1Char('|'));
+    if (parts.size() > 2) {
+        return false;
+    }
+    for (const QString& part : parts) {
+        if (part.trimmed().isEmpty() || part.contains(invalidCharacters)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QStringList LayerManager::getLayerNames() const
+{
+    QStringList names;
+    names.reserve(static_cast<int>(m_layers.size()));
+    for (const auto& entry : m_layers) {
+        names.append(entry.first);
+    }
+    return names;
+}
+
+int LayerManager::getLayerCount() const
+{
+    return static_cast<int>(m_layers.size());
+}
+
+// Current layer management
+void LayerManager::setCurrentLayer(const QString& name)
+{
+    auto it = m_layers.find(name);
+    if (it == m_layers.end() || name == m_currentLayer) {
+        return;
+    }
+    if (it->second.frozen) {
+        qCWarning(cadLayers) << "Frozen layer cannot be made current:" << name;
+        return;
+    }
+
+    UndoScope scope(this, "Set current layer");
+    m_currentLayer = name;
+    emit currentLayerChanged(name);
+}
+
+LayerProperties LayerManager::getCurrentLayerProperties() const
+{
+    return getLayerProperties(m_currentLayer);
+}
+
+// Layer properties
+bool LayerManager::modifyLayer(const QString& name, const QString& description,
+                               const std::function<void(LayerProperties&)>& change)
+{
+    auto it = m_layers.find(name);
+    if (it == m_layers.end()) {
+        return false;
+    }
+
+    LayerProperties updated = it->second;
+    change(updated);
+    updated.name = name;
+    if (updated == it->second) {
+        return true;
+    }
+
+    UndoScope scope(this, description);
+    recordLayer(name);
+
+    const LayerProperties previous = it->second;
+    it->second = updated;
+    syncLayerRow(name);
+    emitLayerChanged(previous, updated);
+    return true;
+}
+
+void LayerManager::emitLayerChanged(const LayerProperties& before, const LayerProperties& after)
+{
+    emit layerPropertiesChanged(after.name, after);
+    if (before.visible != after.visible) {
+        emit layerVisibilityChanged(after.name, after.visible);
+    }
+    if (before.frozen != after.frozen) {
+        emit layerFrozenChanged(after.name, after.frozen);
+    }
+    if (before.locked != after.locked) {
+        emit layerLockedChanged(after.name, after.locked);
+    }
+}
+
+bool LayerManager::setLayerProperties(const QString& name, const LayerProperties& properties)
+{
+    if (properties.frozen && name == m_currentLayer) {
+        qCWarning(cadLayers) << "Current layer cannot be frozen:" << name;
+        return false;
+    }
+    return modifyLayer(name, "Layer properties", [&properties](LayerProperties& layer) {
+        layer = properties;
+    });
+}
+
+LayerProperties LayerManager::getLayerProperties(const QString& name) const
+{
+    auto it = m_layers.find(name);
+    return it != m_layers.end() ? it->second : m_defaultProperties;
+}
+
+bool LayerManager::setLayerColor(const QString& name, const QColor& color)
+{
+    return modifyLayer(name, "Layer color", [&color](LayerProperties& layer) { layer.color = color; });
+}
+
+QColor LayerManager::getLayerColor(const QString& name) const
+{
+    return getLayerProperties(name).color;
+}
+
+bool LayerManager::setLayerLineType(const QString& name, const QString& lineType)
+{
+    return modifyLayer(name, "Layer linetype", [&lineType](LayerProperties& layer) { layer.lineType = lineType; });
+}
+
+QString LayerManager::getLayerLineType(const QString& name) const
+{
+    return getLayerProperties(name).lineType;
+}
+
+bool LayerManager::setLayerLineWeight(const QString& name, double weight)
+{
+    return modifyLayer(name, "Layer lineweight", [weight](LayerProperties& layer) { layer.lineWeight = weight; });
+}
+
+double LayerManager::getLayerLineWeight(const QString& name) const
+{
+    return getLayerProperties(name).lineWeight;
+}
+
+bool LayerManager::setLayerDescription(const QString& name, const QString& description)
+{
+    return modifyLayer(name, "Layer description", [&description](LayerProperties& layer) {
+        layer.description = description;
+    });
+}
+
+QString LayerManager::getLayerDescription(const QString& name) const
+{
+    return getLayerProperties(name).description;
+}
+
+// Layer states
+bool LayerManager::setLayerVisible(const QString& name, bool visible)
+{
+    return modifyLayer(name, visible ? "Layer on" : "Layer off", [visible](LayerProperties& layer) {
+        layer.visible = visible;
+    });
+}
+
+bool LayerManager::isLayerVisible(const QString& name) const
+{
+    return getLayerProperties(name).visible;
+}
+
+bool LayerManager::setLayerFrozen(const QString& name, bool frozen)
+{
+    if (frozen && name == m_currentLayer) {
+        qCWarning(cadLayers) << "Current layer cannot be frozen:" << name;
+        return false;
+    }
+    return modifyLayer(name, frozen ? "Freeze layer" : "Thaw layer", [frozen](LayerProperties& layer) {
+        layer.frozen = frozen;
+    });
+}
+
+bool LayerManager::isLayerFrozen(const QString& name) const
+{
+    return getLayerProperties(name).frozen;
+}
+
+bool LayerManager::setLayerLocked(const QString& name, bool locked)
+{
+    return modifyLayer(name, locked ? "Lock layer" : "Unlock layer", [locked](LayerProperties& layer) {
+        layer.locked = locked;
+    });
+}
+
+bool LayerManager::isLayerLocked(const QString& name) const
+{
+    return getLayerProperties(name).locked;
+}
+
+bool LayerManager::setLayerPlottable(const QString& name, bool plottable)
+{
+    return modifyLayer(name, "Layer plot", [plottable](LayerProperties& layer) { layer.plottable = plottable; });
+}
+
+bool LayerManager::isLayerPlottable(const QString& name) const
+{
+    return getLayerProperties(name).plottable;
+}
+
+// Bulk operations; each is a single undo step
+void LayerManager::setAllLayersVisible(bool visible)
+{
+    UndoScope scope(this, visible ? "All layers on" : "All layers off");
+    for (const QString& name : getLayerNames()) {
+        setLayerVisible(name, visible);
+    }
+}
+
+void LayerManager::setAllLayersFrozen(bool frozen)
+{
+    UndoScope scope(this, frozen ? "Freeze all layers" : "Thaw all layers");
+    for (const QString& name : getLayerNames()) {
+        if (!frozen || name != m_currentLayer) {
+            setLayerFrozen(name, frozen);
+        }
+    }
+}
+
+void LayerManager::setAllLayersLocked(bool locked)
+{
+    UndoScope scope(this, locked ? "Lock all layers" : "Unlock all layers");
+    for (const QString& name : getLayerNames()) {
+        setLayerLocked(name, locked);
+    }
+}
+
+void LayerManager::freezeAllLayersExcept(const QString& layerName)
+{
+    if (!layerExists(layerName)) {
+        return;
+    }
+
+    UndoScope scope(this, "Isolate layer");
+    setLayerFrozen(layerName, false);
+    setCurrentLayer(layerName);
+    for (const QString& name : getLayerNames()) {
+        if (name != layerName) {
+            setLayerFrozen(name, true);
+        }
+    }
+}
+
+void LayerManager::lockAllLayersExcept(const QString& layerName)
+{
+    if (!layerExists(layerName)) {
+        return;
+    }
+
+    UndoScope scope(this, "Lock other layers");
+    for (const QString& name : getLayerNames()) {
+        setLayerLocked(name, name != layerName);
+    }
+}
+
+// Layer filters
+bool LayerManager::createFilter(const QString& filterName, const QString& criteria)
+{
+    QString error;
+    LayerPredicate predicate = LayerPredicate::compile(criteria, &error);
+    if (!predicate.isValid()) {
+        qCWarning(cadLayers) << "Invalid filter" << filterName << ":" << error;
+        return false;
+    }
+
+    LayerFilter* filter = findFilter(filterName);
+    if (!filter) {
+        m_filters.push_back(LayerFilter{filterName, LayerPredicate(), {}, 0});
+        filter = &m_filters.back();
+    }
+    filter->predicate = std::move(predicate);
+    evaluateFilter(*filter);
+
+    emit filterMembershipChanged(filterName);
+    if (m_activeFilter == filterName) {
+        emit filterApplied(filterName);
+    }
+    return true;
+}
+
+void LayerManager::deleteFilter(const QString& filterName)
+{
+    m_filters.erase(std::remove_if(m_filters.begin(), m_filters.end(),
+                                   [&filterName](const LayerFilter& filter) { return filter.name == filterName; }),
+                    m_filters.end());
+    if (m_activeFilter == filterName) {
+        clearFilter();
+    }
+}
+
+QStringList LayerManager::getFilterNames() const
+{
+    QStringList names;
+    for (const LayerFilter& filter : m_filters) {
+        names.append(filter.name);
+    }
+    return names;
+}
+
+QString LayerManager::getFilterCriteria(const QString& filterName) const
+{
+    const LayerFilter* filter = findFilter(filterName);
+    return filter ? filter->predicate.criteria() : QString();
+}
+
+QStringList LayerManager::getLayersInFilter(const QString& filterName) const
+{
+    const LayerFilter* filter = findFilter(filterName);
+    if (!filter) {
+        return QStringList();
+    }
+
+    // Membership is current; this only collects it in layer order
+    QStringList layers;
+    layers.reserve(filter->memberCount);
+    for (const auto& entry : m_layers) {
+        const int row = m_table.row(entry.first);
+        if (row >= 0 && row < static_cast<int>(filter->members.size()) && filter->members[row]) {
+            layers.append(entry.first);
+        }
+    }
+    return layers;
+}
+
+int LayerManager::getFilterMemberCount(const QString& filterName) const
+{
+    const LayerFilter* filter = findFilter(filterName);
+    return filter ? filter->memberCount : 0;
+}
+
+bool LayerManager::isLayerInFilter(const QString& filterName, const QString& layerName) const
+{
+    const LayerFilter* filter = findFilter(filterName);
+    const int row = m_table.row(layerName);
+    return filter && row >= 0 && row < static_cast<int>(filter->members.size()) && filter->members[row];
+}
+
+void LayerManager::applyFilter(const QString& filterName)
+{
+    if (findFilter(filterName)) {
+        m_activeFilter = filterName;
+        emit filterApplied(filterName);
+    }
+}
+
+void LayerManager::clearFilter()
+{
+    if (!m_activeFilter.isEmpty()) {
+        m_activeFilter.clear();
+        emit filterCleared();
+    }
+}
+
+bool LayerManager::layerMatches(const QString& layerName, const LayerPredicate& predicate) const
+{
+    return predicate.matches(m_table, m_table.row(layerName));
+}
+
+QStringList LayerManager::layersMatching(const LayerPredicate& predicate) const
+{
+    QStringList layers;
+    for (const auto& entry : m_layers) {
+        if (predicate.matches(m_table, m_table.row(entry.first))) {
+            layers.append(entry.first);
+        }
+    }
+    return layers;
+}
+
+LayerManager::LayerFilter* LayerManager::findFilter(const QString& filterName)
+{
+    for (LayerFilter& filter : m_filters) {
+        if (filter.name == filterName) {
+            return &filter;
+        }
+    }
+    return nullptr;
+}
+
+const LayerManager::LayerFilter* LayerManager::findFilter(const QString& filterName) const
+{
+    return const_cast<LayerManager*>(this)->findFilter(filterName);
+}
+
+void LayerManager::evaluateFilter(LayerFilter& filter)
+{
+    const int rows = m_table.rowCount();
+    filter.members.assign(rows, 0);
+    filter.memberCount = 0;
+    for (int row = 0; row < rows; ++row) {
+        if (filter.predicate.matches(m_table, row)) {
+            filter.members[row] = 1;
+            ++filter.memberCount;
+        }
+    }
+}
+
+void LayerManager::syncLayerRow(const QString& name)
+{
+    auto it = m_layers.find(name);
+    if (it == m_layers.end()) {
+        const int row = m_table.row(name);
+        if (row >= 0) {
+            m_table.release(name);
+            updateFilterMembership(row, LayerTable::AllColumns);
+        }
+        return;
+    }
+
+    const quint8 changed = m_table.store(it->second) | m_table.setObjectCount(name, getObjectCountInLayer(name));
+    if (changed) {
+        updateFilterMembership(m_table.row(name), changed);
+    }
+}
+
+void LayerManager::updateFilterMembership(int row, quint8 changedColumns)
+{
+    // A new or released row is evaluated by every filter; otherwise only by
+    // filters that read one of the changed columns
+    const bool wholeRow = changedColumns == LayerTable::AllColumns;
+    for (LayerFilter& filter : m_filters) {
+        if (!wholeRow && !(filter.predicate.columns() & changedColumns)) {
+            continue;
+        }
+        if (row >= static_cast<int>(filter.members.size())) {
+            filter.members.resize(m_table.rowCount(), 0);
+        }
+
+        const quint8 member = filter.predicate.matches(m_table, row) ? 1 : 0;
+        if (filter.members[row] != member) {
+            filter.members[row] = member;
+            filter.memberCount += member ? 1 : -1;
+            emit filterMembershipChanged(filter.name);
+        }
+    }
+}
+
+// Layer groups
+void LayerManager::createGroup(const QString& groupName, const QStringList& layerNames)
+{
+    deleteGroup(groupName);
+    m_groups.push_back(LayerGroup{groupName, layerNames});
+}
+
+void LayerManager::deleteGroup(const QString& groupName)
+{
+    m_groups.erase(std::remove_if(m_groups.begin(), m_groups.end(),
+                                  [&groupName](const LayerGroup& group) { return group.name == groupName; }),
+                   m_groups.end());
+}
+
+void LayerManager::addLayerToGroup(const QString& groupName, const QString& layerName)
+{
+    for (LayerGroup& group : m_groups) {
+        if (group.name == groupName && !group.layerNames.contains(layerName)) {
+            group.layerNames.append(layerName);
+        }
+    }
+}
+
+void LayerManager::removeLayerFromGroup(const QString& groupName, const QString& layerName)
+{
+    for (LayerGroup& group : m_groups) {
+        if (group.name == groupName) {
+            group.layerNames.removeAll(layerName);
+        }
+    }
+}
+
+QStringList LayerManager::getGroupNames() const
+{
+    QStringList names;
+    for (const LayerGroup& group : m_groups) {
+        names.append(group.name);
+    }
+    return names;
+}
+
+QStringList LayerManager::getLayersInGroup(const QString& groupName) const
+{
+    for (const LayerGroup& group : m_groups) {
+        if (group.name == groupName) {
+            return group.layerNames;
+        }
+    }
+    return QStringList();
+}
+
+// Layer standards and templates
+void LayerManager::saveLayerStandard(const QString& standardName)
+{
+    std::vector<LayerProperties> layers;
+    layers.reserve(m_layers.size());
+    for (const auto& entry : m_layers) {
+        layers.push_back(entry.second);
+    }
+    m_layerStandards[standardName] = std::move(layers);
+}
+
+void LayerManager::loadLayerStandard(const QString& standardName)
+{
+    auto it = m_layerStandards.find(standardName);
+    if (it == m_layerStandards.end()) {
+        return;
+    }
+
+    UndoScope scope(this, "Load layer standard");
+    for (const LayerProperties& layer : it->second) {
+        if (layerExists(layer.name)) {
+            setLayerProperties(layer.name, layer);
+        } else {
+            createLayer(layer.name, layer);
+        }
+    }
+}
+
+QStringList LayerManager::getLayerStandards() const
+{
+    QStringList names;
+    for (const auto& entry : m_layerStandards) {
+        names.append(entry.first);
+    }
+    return names;
+}
+
+void LayerManager::createLayerTemplate(const QString& templateName, const QStringList& layerNames)
+{
+    m_layerTemplates[templateName] = layerNames;
+}
+
+void LayerManager::applyLayerTemplate(const QString& templateName)
+{
+    auto it = m_layerTemplates.find(templateName);
+    if (it == m_layerTemplates.end()) {
+        return;
+    }
+
+    UndoScope scope(this, "Apply layer template");
+    for (const QString& name : it->second) {
+        if (!layerExists(name)) {
+            createLayer(name, LayerProperties(name));
+        }
+    }
+}
+
+QStringList LayerManager::getLayerTemplates() const
+{
+    QStringList names;
+    for (const auto& entry : m_layerTemplates) {
+        names.append(entry.first);
+    }
+    return names;
+}
+
+// Import/Export
+bool LayerManager::exportLayers(const QString& filePath, const QStringList& layerNames)
+{
+    std::vector<LayerProperties> layers;
+    for (const auto& entry : m_layers) {
+        if (layerNames.isEmpty() || layerNames.contains(entry.first)) {
+            layers.push_back(entry.second);
+        }
+    }
+    return writeLayersFile(filePath, layers);
+}
+
+bool LayerManager::importLayers(const QString& filePath, bool replaceExisting)
+{
+    std::vector<LayerProperties> layers;
+    if (!readLayersFile(filePath, layers)) {
+        return false;
+    }
+
+    UndoScope scope(this, "Import layers");
+    for (const LayerProperties& layer : layers) {
+        if (!layerExists(layer.name)) {
+            createLayer(layer.name, layer);
+        } else if (replaceExisting) {
+            setLayerProperties(layer.name, layer);
+        }
+    }
+    return true;
+}
+
+bool LayerManager::exportLayerStandard(const QString& filePath, const QString& standardName)
+{
+    auto it = m_layerStandards.find(standardName);
+    if (it == m_layerStandards.end()) {
+        qCWarning(cadLayers) << "Unknown layer standard:" << standardName;
+        return false;
+    }
+    return writeLayersFile(filePath, it->second);
+}
+
+bool LayerManager::importLayerStandard(const QString& filePath)
+{
+    std::vector<LayerProperties> layers;
+    if (!readLayersFile(filePath, layers)) {
+        return false;
+    }
+    m_layerStandards[QFileInfo(filePath).completeBaseName()] = std::move(layers);
+    return true;
+}
+
+// Utility functions
+void LayerManager::purgeUnusedLayers()
+{
+    UndoScope scope(this, "Purge layers");
+    for (const QString& name : getUnusedLayers()) {
+        deleteLayer(name);
+    }
+}
+
+QStringList LayerManager::getUnusedLayers() const
+{
+    QStringList unused;
+    for (const QString& name : getEmptyLayers()) {
+        if (name != DefaultLayer && name != DefpointsLayer && name != m_currentLayer) {
+            unused.append(name);
+        }
+    }
+    return unused;
+}
+
+void LayerManager::resetToDefaults()
+{
+    clear();
+}
+
+void LayerManager::clear()
+{
+    const QStringList names = getLayerNames();
+
+    m_layers.clear();
+    m_table.clear();
+    m_filters.clear();
+    m_groups.clear();
+    m_activeFilter.clear();
+    clearUndoHistory();
+    initializeDefaultLayers();
+
+    for (const QString& name : names) {
+        if (!layerExists(name)) {
+            emit layerDeleted(name);
+        }
+    }
+    emit currentLayerChanged(m_currentLayer);
+}
+
+// Statistics
+void LayerManager::setGeometryEngine(GeometryEngine* engine)
+{
+    if (m_geometryEngine) {
+        disconnect(m_geometryEngine, nullptr, this, nullptr);
+        disconnect(this, nullptr, m_geometryEngine, nullptr);
+    }
+
+    m_geometryEngine = engine;
+    m_usageIndex = engine ? &engine->layerIndex() : nullptr;
+    if (engine) {
+        connect(engine, &GeometryEngine::layerObjectCountChanged, this, &LayerManager::onLayerObjectCountChanged);
+        connect(this, &LayerManager::layerRenamed, engine, &GeometryEngine::renameLayer);
+    }
+
+    for (const auto& entry : m_layers) {
+        syncLayerRow(entry.first);
+    }
+}
+
+int LayerManager::getObjectCountInLayer(const QString& name) const
+{
+    return m_usageIndex ? m_usageIndex->objectCount(name) : 0;
+}
+
+LayerUsage LayerManager::getLayerUsage(const QString& name) const
+{
+    return m_usageIndex ? m_usageIndex->usage(name) : LayerUsage();
+}
+
+QStringList LayerManager::getLayersWithObjects() const
+{
+    QStringList layers;
+    for (const auto& entry : m_layers) {
+        if (getObjectCountInLayer(entry.first) > 0) {
+            layers.append(entry.first);
+        }
+    }
+    return layers;
+}
+
+QStringList LayerManager::getEmptyLayers() const
+{
+    QStringList layers;
+    for (const auto& entry : m_layers) {
+        if (getObjectCountInLayer(entry.first) == 0) {
+            layers.append(entry.first);
+        }
+    }
+    return layers;
+}
+
+void LayerManager::onLayerObjectCountChanged(const QString& layerName)
+{
+    syncLayerRow(layerName);
+}
+
+// Layer history and undo
+void LayerManager::beginUndoGroup(const QString& description)
+{
+    if (m_applyingHistory) {
+        return;
+    }
+    if (m_undoGroupDepth++ == 0) {
+        m_openChange = LayerChange();
+        m_openChange.description = description;
+        m_openChange.currentBefore = m_currentLayer;
+        m_openChangeIndex.clear();
+    }
+}
+
+void LayerManager::endUndoGroup()
+{
+    if (m_applyingHistory || m_undoGroupDepth == 0 || --m_undoGroupDepth > 0) {
+        return;
+    }
+
+    // Capture after-states and drop layers that ended up unchanged
+    LayerChange change = std::move(m_openChange);
+    m_openChange = LayerChange();
+    m_openChangeIndex.clear();
+
+    std::vector<LayerDelta> deltas;
+    deltas.reserve(change.deltas.size());
+    for (LayerDelta& delta : change.deltas) {
+        auto it = m_layers.find(delta.name);
+        if (it != m_layers.end()) {
+            delta.after = it->second;
+        }
+        if (delta.before != delta.after) {
+            deltas.push_back(std::move(delta));
+        }
+    }
+    change.deltas = std::move(deltas);
+    change.currentAfter = m_currentLayer;
+
+    if (change.deltas.empty() && change.currentBefore == change.currentAfter) {
+        return;
+    }
+
+    m_undoStack.push_back(std::move(change));
+    while (static_cast<int>(m_undoStack.size()) > m_maxUndoLevels) {
+        m_undoStack.pop_front();
+    }
+    m_redoStack.clear();
+}
+
+void LayerManager::recordLayer(const QString& name)
+{
+    // Only the first before-state of each layer within a step matters
+    if (m_applyingHistory || m_undoGroupDepth == 0 || m_openChangeIndex.contains(name)) {
+        return;
+    }
+
+    LayerDelta delta;
+    delta.name = name;
+    auto it = m_layers.find(name);
+    if (it != m_layers.end()) {
+        delta.before = it->second;
+    }
+    m_openChangeIndex.insert(name, static_cast<int>(m_openChange.deltas.size()));
+    m_openChange.deltas.push_back(std::move(delta));
+}
+
+void LayerManager::applyChange(const LayerChange& change, bool forward)
+{
+    m_applyingHistory = true;
+
+    // Renames are reported as renames, not as a delete and a create, so
+    // listeners such as the geometry engine move entities to the new name
+    std::vector<std::pair<QString, QString>> renames = change.renames;
+    if (!forward) {
+        std::reverse(renames.begin(), renames.end());
+        for (auto& rename : renames) {
+            std::swap(rename.first, rename.second);
+        }
+    }
+    QSet<QString> renamed;
+    for (const auto& rename : renames) {
+        renamed.insert(rename.first);
+        renamed.insert(rename.second);
+    }
+
+    // Removals first so a renamed layer's old and new names never coexist
+    for (int pass = 0; pass < 2; ++pass) {
+        for (const LayerDelta& delta : change.deltas) {
+            const std::optional<LayerProperties>& target = forward ? delta.after : delta.before;
+            auto it = m_layers.find(delta.name);
+
+            if (pass == 0) {
+                if (!target && it != m_layers.end()) {
+                    m_layers.erase(it);
+                    syncLayerRow(delta.name);
+                    if (!renamed.contains(delta.name)) {
+                        emit layerDeleted(delta.name);
+                    }
+                }
+                continue;
+            }
+
+            if (!target) {
+                continue;
+            }
+            if (it == m_layers.end()) {
+                m_layers[delta.name] = *target;
+                syncLayerRow(delta.name);
+                if (!renamed.contains(delta.name)) {
+                    emit layerCreated(delta.name);
+                }
+            } else if (it->second != *target) {
+                const LayerProperties previous = it->second;
+                it->second = *target;
+                syncLayerRow(delta.name);
+                emitLayerChanged(previous, *target);
+            }
+        }
+    }
+
+    auto stateOf = [&change, forward](const QString& name, bool after) -> std::optional<LayerProperties> {
+        for (const LayerDelta& delta : change.deltas) {
+            if (delta.name == name) {
+                return after == forward ? delta.after : delta.before;
+            }
+        }
+        return std::nullopt;
+    };
+    for (const auto& rename : renames) {
+        emit layerRenamed(rename.first, rename.second);
+
+        // Properties edited in the same step as the rename
+        std::optional<LayerProperties> previous = stateOf(rename.first, false);
+        const std::optional<LayerProperties> next = stateOf(rename.second, true);
+        if (previous && next) {
+            previous->name = next->name;
+            if (*previous != *next) {
+                emitLayerChanged(*previous, *next);
+            }
+        }
+    }
+
+    const QString& current = forward ? change.currentAfter : change.currentBefore;
+    if (current != m_currentLayer && layerExists(current)) {
+        m_currentLayer = current;
+        emit currentLayerChanged(current);
+    }
+
+    m_applyingHistory = false;
+}
+
+bool LayerManager::undo()
+{
+    if (m_undoStack.empty() || m_undoGroupDepth > 0) {
+        return false;
+    }
+
+    LayerChange change = std::move(m_undoStack.back());
+    m_undoStack.pop_back();
+    applyChange(change, false);
+    m_redoStack.push_back(std::move(change));
+    return true;
+}
+
+bool LayerManager::redo()
+{
+    if (m_redoStack.empty() || m_undoGroupDepth > 0) {
+        return false;
+    }
+
+    LayerChange change = std::move(m_redoStack.back());
+    m_redoStack.pop_back();
+    applyChange(change, true);
+    m_undoStack.push_back(std::move(change));
+    return true;
+}
+
+bool LayerManager::canUndo() const
+{
+    return !m_undoStack.empty();
+}
+
+bool LayerManager::canRedo() const
+{
+    return !m_redoStack.empty();
+}
+
+QString LayerManager::undoDescription() const
+{
+    return m_undoStack.empty() ? QString() : m_undoStack.back().description;
+}
+
+QString LayerManager::redoDescription() const
+{
+    return m_redoStack.empty() ? QString() : m_redoStack.back().description;
+}
+
+void LayerManager::clearUndoHistory()
+{
+    m_undoStack.clear();
+    m_redoStack.clear();
+}
+
+void LayerManager::setMaxUndoLevels(int levels)
+{
+    m_maxUndoLevels = qMax(1, levels);
+    while (static_cast<int>(m_undoStack.size()) > m_maxUndoLevels) {
+        m_undoStack.pop_front();
+    }
+}
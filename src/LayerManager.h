@@ -1,12 +1,23 @@
 #pragma once
 
+#include "LayerPredicate.h"
 #include <QObject>
 #include <QColor>
 #include <QLoggingCategory>
+#include <QHash>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
+#include <optional>
+#include <vector>
 
 Q_DECLARE_LOGGING_CATEGORY(cadLayers)
 
+class GeometryEngine;
+class LayerUsageIndex;
+struct LayerUsage;
+
 /**
  * @brief Layer properties and settings
  */
@@ -42,6 +53,14 @@ struct LayerProperties
         , locked(false)
         , plottable(true)
     {}
+    
+    bool operator==(const LayerProperties& other) const
+    {
+        return name == other.name && color == other.color && lineType == other.lineType
+            && lineWeight == other.lineWeight && visible == other.visible && frozen == other.frozen
+            && locked == other.locked && plottable == other.plottable && description == other.description;
+    }
+    bool operator!=(const LayerProperties& other) const { return !(*this == other); }
 };
 
 /**
@@ -55,6 +74,18 @@ struct LayerProperties
  * - Layer standards and templates
  * - Import/export of layer configurations
  * - Undo/redo support for layer operations
+ *
+ * Filters are compiled once into LayerPredicate trees over a columnar copy
+ * of the layer table. Their membership is kept up to date per layer: a
+ * change re-evaluates only the changed layer, and only against filters that
+ * read the changed property.
+ *
+ * Object counts come from the geometry engine's LayerUsageIndex, so usage
+ * and purge queries cost O(layers).
+ *
+ * Undo records per-layer before/after deltas rather than copies of the
+ * whole table, so a step costs O(layers it touched). Bulk operations, and
+ * anything between beginUndoGroup() and endUndoGroup(), form one step.
  */
 class LayerManager : public QObject
 {
@@ -117,13 +148,21 @@ public:
     void freezeAllLayersExcept(const QString& layerName);
     void lockAllLayersExcept(const QString& layerName);
 
-    // Layer filters
-    void createFilter(const QString& filterName, const QString& criteria);
+    // Layer filters (criteria syntax: see LayerPredicate)
+    bool createFilter(const QString& filterName, const QString& criteria);
     void deleteFilter(const QString& filterName);
     QStringList getFilterNames() const;
+    QString getFilterCriteria(const QString& filterName) const;
     QStringList getLayersInFilter(const QString& filterName) const;
+    int getFilterMemberCount(const QString& filterName) const;
+    bool isLayerInFilter(const QString& filterName, const QString& layerName) const;
     void applyFilter(const QString& filterName);
     void clearFilter();
+    QString getActiveFilter() const { return m_activeFilter; }
+    
+    // Ad-hoc evaluation, e.g. for filter text typed into the layer palette
+    bool layerMatches(const QString& layerName, const LayerPredicate& predicate) const;
+    QStringList layersMatching(const LayerPredicate& predicate) const;
 
     // Layer groups
     void createGroup(const QString& groupName, const QStringList& layerNames);
@@ -153,16 +192,25 @@ public:
     void resetToDefaults();
     void clear();
     
-    // Statistics
+    // Statistics, from the usage index of the drawing's geometry engine; the
+    // engine also follows layer renames
+    void setGeometryEngine(GeometryEngine* engine);
     int getObjectCountInLayer(const QString& name) const;
+    LayerUsage getLayerUsage(const QString& name) const;
     QStringList getLayersWithObjects() const;
     QStringList getEmptyLayers() const;
 
     // Layer history and undo
-    void saveState();
-    void restoreState();
+    void beginUndoGroup(const QString& description);
+    void endUndoGroup();
+    bool undo();
+    bool redo();
     bool canUndo() const;
     bool canRedo() const;
+    QString undoDescription() const;
+    QString redoDescription() const;
+    void clearUndoHistory();
+    void setMaxUndoLevels(int levels);
 
 signals:
     void layerCreated(const QString& name);
@@ -175,17 +223,17 @@ signals:
     void layerLockedChanged(const QString& name, bool locked);
     void filterApplied(const QString& filterName);
     void filterCleared();
+    void filterMembershipChanged(const QString& filterName);
 
 public slots:
-    void onObjectCreated(int objectId, const QString& layerName);
-    void onObjectDeleted(int objectId);
-    void onObjectLayerChanged(int objectId, const QString& oldLayer, const QString& newLayer);
+    void onLayerObjectCountChanged(const QString& layerName);
 
 private:
     struct LayerFilter {
         QString name;
-        QString criteria;
-        QStringList matchingLayers;
+        LayerPredicate predicate;
+        std::vector<quint8> members;  // Indexed by LayerTable row
+        int memberCount;
     };
     
     struct LayerGroup {
@@ -193,23 +241,46 @@ private:
         QStringList layerNames;
     };
     
-    struct LayerState {
-        std::map<QString, LayerProperties> layers;
-        QString currentLayer;
+    // A layer's state before and after one undo step; nullopt means absent
+    struct LayerDelta {
+        QString name;
+        std::optional<LayerProperties> before;
+        std::optional<LayerProperties> after;
     };
+    
+    struct LayerChange {
+        QString description;
+        std::vector<LayerDelta> deltas;
+        std::vector<std::pair<QString, QString>> renames;   // Old and new name, in the order done
+        QString currentBefore;
+        QString currentAfter;
+    };
+    
+    class UndoScope;
 
     void initializeDefaultLayers();
-    void validateLayerName(const QString& name) const;
-    void updateLayerCounts();
-    void applyFilterCriteria(const QString& criteria, QStringList& matchingLayers);
-    bool matchesFilter(const QString& layerName, const QString& criteria) const;
+    void evaluateFilter(LayerFilter& filter);
+    void syncLayerRow(const QString& name);
+    void updateFilterMembership(int row, quint8 changedColumns);
+    LayerFilter* findFilter(const QString& filterName);
+    const LayerFilter* findFilter(const QString& filterName) const;
+    
+    bool modifyLayer(const QString& name, const QString& description,
+                     const std::function<void(LayerProperties&)>& change);
+    void emitLayerChanged(const LayerProperties& before, const LayerProperties& after);
+    void recordLayer(const QString& name);
+    void applyChange(const LayerChange& change, bool forward);
     
     // Layer storage
     std::map<QString, LayerProperties> m_layers;
     QString m_currentLayer;
     
-    // Layer usage tracking
-    std::map<QString, QList<int>> m_layerObjects;
+    // Layer usage, owned by the geometry engine
+    GeometryEngine* m_geometryEngine;
+    const LayerUsageIndex* m_usageIndex;
+    
+    // Columnar mirror of m_layers for filter evaluation
+    LayerTable m_table;
     
     // Filters and groups
     std::vector<LayerFilter> m_filters;
@@ -221,8 +292,12 @@ private:
     std::map<QString, QStringList> m_layerTemplates;
     
     // Undo/Redo
-    std::vector<LayerState> m_undoStack;
-    std::vector<LayerState> m_redoStack;
+    std::deque<LayerChange> m_undoStack;
+    std::vector<LayerChange> m_redoStack;
+    LayerChange m_openChange;
+    QHash<QString, int> m_openChangeIndex;  // Layer name -> index in m_openChange.deltas
+    int m_undoGroupDepth;
+    bool m_applyingHistory;
     int m_maxUndoLevels;
     
     // Default layer properties
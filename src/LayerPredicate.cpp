@@ -0,0 +1,539 @@
+#include "LayerPredicate.h"
+#include "LayerManager.h"
+
+// LayerTable implementation
+quint8 LayerTable::store(const LayerProperties& properties)
+{
+    quint8 changed = 0;
+    int r = row(properties.name);
+    if (r < 0) {
+        if (!m_freeRows.empty()) {
+            r = m_freeRows.back();
+            m_freeRows.pop_back();
+        } else {
+            r = rowCount();
+            m_names.emplace_back();
+            m_colors.push_back(0);
+            m_lineTypes.push_back(0);
+            m_states.push_back(0);
+            m_objectCounts.push_back(0);
+            m_live.push_back(0);
+        }
+        m_rows.insert(properties.name, r);
+        m_names[r] = properties.name;
+        m_objectCounts[r] = 0;
+        m_live[r] = 1;
+        changed = AllColumns;
+    }
+
+    const QRgb color = properties.color.rgb();
+    if (m_colors[r] != color) {
+        m_colors[r] = color;
+        changed |= ColorColumn;
+    }
+
+    const int lineType = internLineType(properties.lineType);
+    if (m_lineTypes[r] != lineType) {
+        m_lineTypes[r] = lineType;
+        changed |= LineTypeColumn;
+    }
+
+    const quint8 state = (properties.visible ? Visible : 0) | (properties.frozen ? Frozen : 0)
+                       | (properties.locked ? Locked : 0) | (properties.plottable ? Plottable : 0);
+    if (m_states[r] != state) {
+        m_states[r] = state;
+        changed |= StateColumn;
+    }
+
+    return changed;
+}
+
+void LayerTable::release(const QString& name)
+{
+    const int r = row(name);
+    if (r < 0) {
+        return;
+    }
+    m_rows.remove(name);
+    m_names[r].clear();
+    m_live[r] = 0;
+    m_freeRows.push_back(r);
+}
+
+quint8 LayerTable::setObjectCount(const QString& name, int count)
+{
+    const int r = row(name);
+    if (r < 0 || m_objectCounts[r] == count) {
+        return 0;
+    }
+    m_objectCounts[r] = count;
+    return ObjectCountColumn;
+}
+
+void LayerTable::clear()
+{
+    m_names.clear();
+    m_colors.clear();
+    m_lineTypes.clear();
+    m_states.clear();
+    m_objectCounts.clear();
+    m_live.clear();
+    m_rows.clear();
+    m_freeRows.clear();
+}
+
+int LayerTable::internLineType(const QString& lineType)
+{
+    auto it = m_lineTypeIds.constFind(lineType);
+    if (it != m_lineTypeIds.constEnd()) {
+        return it.value();
+    }
+    const int id = m_lineTypeNames.size();
+    m_lineTypeNames.append(lineType);
+    m_lineTypeIds.insert(lineType, id);
+    return id;
+}
+
+// LayerPredicate implementation
+
+/**
+ * @brief Recursive descent parser from criteria text to predicate nodes
+ */
+class LayerPredicate::Parser
+{
+public:
+    Parser(LayerPredicate& predicate, const QString& criteria)
+        : m_predicate(predicate)
+        , m_position(0)
+    {
+        tokenize(criteria);
+    }
+
+    int parse()
+    {
+        if (m_tokens.empty()) {
+            return -1;
+        }
+        const int root = parseOr();
+        if (root >= 0 && m_position < m_tokens.size()) {
+            fail(QString("Unexpected '%1'").arg(m_tokens[m_position].text));
+            return -1;
+        }
+        return root;
+    }
+
+    const QString& error() const { return m_error; }
+
+private:
+    struct Token {
+        enum Type { Word, Open, Close, Not, And, Or };
+        Type type;
+        QString text;
+    };
+
+    void tokenize(const QString& text)
+    {
+        const int length = text.size();
+        int i = 0;
+        while (i < length) {
+            const QChar c = text[i];
+            if (c.isSpace()) {
+                ++i;
+            } else if (c == '(') {
+                m_tokens.push_back(Token{Token::Open, "("});
+                ++i;
+            } else if (c == ')') {
+                m_tokens.push_back(Token{Token::Close, ")"});
+                ++i;
+            } else if (c == '|') {
+                m_tokens.push_back(Token{Token::Or, "|"});
+                ++i;
+            } else if (c == '&') {
+                m_tokens.push_back(Token{Token::And, "&"});
+                ++i;
+            } else if (c == '!' && (i + 1 >= length || text[i + 1] != '=')) {
+                m_tokens.push_back(Token{Token::Not, "!"});
+                ++i;
+            } else {
+                // Words run to whitespace or an operator; quotes protect both
+                QString word;
+                bool quoted = false;
+                while (i < length && !text[i].isSpace() && text[i] != '(' && text[i] != ')'
+                       && text[i] != '|' && text[i] != '&') {
+                    if (text[i] == '"') {
+                        quoted = true;
+                        ++i;
+                        while (i < length && text[i] != '"') {
+                            word += text[i++];
+                        }
+                        if (i < length) {
+                            ++i;
+                        }
+                    } else {
+                        word += text[i++];
+                    }
+                }
+
+                Token::Type type = Token::Word;
+                if (!quoted) {
+                    if (word.compare("AND", Qt::CaseInsensitive) == 0) {
+                        type = Token::And;
+                    } else if (word.compare("OR", Qt::CaseInsensitive) == 0) {
+                        type = Token::Or;
+                    } else if (word.compare("NOT", Qt::CaseInsensitive) == 0) {
+                        type = Token::Not;
+                    }
+                }
+                m_tokens.push_back(Token{type, word});
+            }
+        }
+    }
+
+    bool atEnd() const { return m_position >= m_tokens.size(); }
+    Token::Type peek() const { return m_tokens[m_position].type; }
+
+    void fail(const QString& message)
+    {
+        if (m_error.isEmpty()) {
+            m_error = message;
+        }
+    }
+
+    int combine(Node::Kind kind, int left, int right)
+    {
+        Node node{};
+        node.kind = kind;
+        node.left = left;
+        node.right = right;
+        return m_predicate.addNode(node);
+    }
+
+    int parseOr()
+    {
+        int left = parseAnd();
+        while (left >= 0 && !atEnd() && peek() == Token::Or) {
+            ++m_position;
+            const int right = parseAnd();
+            if (right < 0) {
+                return -1;
+            }
+            left = combine(Node::Or, left, right);
+        }
+        return left;
+    }
+
+    int parseAnd()
+    {
+        int left = parseUnary();
+        while (left >= 0 && !atEnd() && peek() != Token::Or && peek() != Token::Close) {
+            if (peek() == Token::And) {
+                ++m_position;
+            }
+            const int right = parseUnary();
+            if (right < 0) {
+                return -1;
+            }
+            left = combine(Node::And, left, right);
+        }
+        return left;
+    }
+
+    int parseUnary()
+    {
+        if (atEnd()) {
+            fail("Incomplete filter expression");
+            return -1;
+        }
+
+        const Token& token = m_tokens[m_position++];
+        switch (token.type) {
+        case Token::Not: {
+            const int operand = parseUnary();
+            return operand < 0 ? -1 : combine(Node::Not, operand, -1);
+        }
+        case Token::Open: {
+            const int inner = parseOr();
+            if (inner < 0) {
+                return -1;
+            }
+            if (atEnd() || peek() != Token::Close) {
+                fail("Missing ')'");
+                return -1;
+            }
+            ++m_position;
+            return inner;
+        }
+        case Token::Word:
+            return parseTerm(token.text);
+        default:
+            fail(QString("Unexpected '%1'").arg(token.text));
+            return -1;
+        }
+    }
+
+    int parseTerm(const QString& word)
+    {
+        if (word.size() > 7 && word.startsWith("objects", Qt::CaseInsensitive)
+            && QStringLiteral("<>=!:").contains(word[7])) {
+            return parseObjectCount(word.mid(7));
+        }
+
+        const int colon = word.indexOf(':');
+        const QString key = colon > 0 ? word.left(colon).toLower() : QString();
+        const QString value = word.mid(colon + 1);
+
+        if (key == "name") {
+            return parsePatterns(Node::Name, value);
+        }
+        if (key == "lt" || key == "linetype") {
+            return parsePatterns(Node::LineType, value);
+        }
+        if (key == "color" || key == "colour") {
+            const QColor color(value);
+            if (!color.isValid()) {
+                fail(QString("Unknown color '%1'").arg(value));
+                return -1;
+            }
+            Node node{};
+            node.kind = Node::Color;
+            node.color = color.rgb();
+            return m_predicate.addNode(node);
+        }
+        if (key == "is") {
+            return parseState(value.toLower());
+        }
+        return parsePatterns(Node::Name, word);
+    }
+
+    int parsePatterns(Node::Kind kind, const QString& value)
+    {
+        // Comma separated alternatives, as in AutoCAD name filters
+        const QStringList alternatives = value.split(',', Qt::SkipEmptyParts);
+        if (alternatives.isEmpty()) {
+            fail("Empty pattern");
+            return -1;
+        }
+
+        int result = -1;
+        for (const QString& alternative : alternatives) {
+            Node node{};
+            node.kind = kind;
+            node.pattern = static_cast<int>(m_predicate.m_patterns.size());
+            m_predicate.m_patterns.push_back(makePattern(alternative));
+            const int leaf = m_predicate.addNode(node);
+            result = result < 0 ? leaf : combine(Node::Or, result, leaf);
+        }
+        return result;
+    }
+
+    int parseState(const QString& state)
+    {
+        struct StateTerm {
+            const char* name;
+            quint8 mask;
+            quint8 value;
+        };
+        static const StateTerm terms[] = {
+            {"on", LayerTable::Visible, LayerTable::Visible},
+            {"off", LayerTable::Visible, 0},
+            {"frozen", LayerTable::Frozen, LayerTable::Frozen},
+            {"thawed", LayerTable::Frozen, 0},
+            {"locked", LayerTable::Locked, LayerTable::Locked},
+            {"unlocked", LayerTable::Locked, 0},
+            {"plot", LayerTable::Plottable, LayerTable::Plottable},
+            {"noplot", LayerTable::Plottable, 0},
+        };
+
+        for (const StateTerm& term : terms) {
+            if (state == QLatin1String(term.name)) {
+                Node node{};
+                node.kind = Node::State;
+                node.stateMask = term.mask;
+                node.stateValue = term.value;
+                return m_predicate.addNode(node);
+            }
+        }
+
+        if (state == "used" || state == "empty") {
+            Node node{};
+            node.kind = Node::ObjectCount;
+            node.compare = state == "used" ? Node::Greater : Node::Equal;
+            node.count = 0;
+            return m_predicate.addNode(node);
+        }
+
+        fail(QString("Unknown state '%1'").arg(state));
+        return -1;
+    }
+
+    int parseObjectCount(const QString& comparison)
+    {
+        struct Operator {
+            const char* text;
+            Node::Compare compare;
+        };
+        // Two-character operators first
+        static const Operator operators[] = {
+            {"<=", Node::LessEqual}, {">=", Node::GreaterEqual}, {"!=", Node::NotEqual},
+            {"<", Node::Less}, {">", Node::Greater}, {"=", Node::Equal}, {":", Node::Equal},
+        };
+
+        for (const Operator& op : operators) {
+            const QLatin1String text(op.text);
+            if (comparison.startsWith(text)) {
+                bool ok = false;
+                const int count = comparison.mid(text.size()).toInt(&ok);
+                if (!ok) {
+                    break;
+                }
+                Node node{};
+                node.kind = Node::ObjectCount;
+                node.compare = op.compare;
+                node.count = count;
+                return m_predicate.addNode(node);
+            }
+        }
+
+        fail(QString("Invalid object count condition 'objects%1'").arg(comparison));
+        return -1;
+    }
+
+    LayerPredicate& m_predicate;
+    std::vector<Token> m_tokens;
+    size_t m_position;
+    QString m_error;
+};
+
+LayerPredicate::LayerPredicate()
+    : m_root(-1)
+    , m_columns(0)
+    , m_valid(true)
+{
+}
+
+LayerPredicate LayerPredicate::compile(const QString& criteria, QString* error)
+{
+    LayerPredicate predicate;
+    predicate.m_criteria = criteria;
+
+    Parser parser(predicate, criteria);
+    predicate.m_root = parser.parse();
+    predicate.m_valid = parser.error().isEmpty();
+    if (!predicate.m_valid) {
+        predicate.m_nodes.clear();
+        predicate.m_patterns.clear();
+        predicate.m_root = -1;
+        predicate.m_columns = 0;
+    }
+
+    if (error) {
+        *error = parser.error();
+    }
+    return predicate;
+}
+
+LayerPredicate::Pattern LayerPredicate::makePattern(const QString& wildcard)
+{
+    Pattern pattern;
+    pattern.mode = Pattern::Regex;
+
+    // Most filters are literals or a single leading/trailing '*'; those skip the regex engine
+    if (wildcard == "*") {
+        pattern.mode = Pattern::Any;
+        return pattern;
+    }
+    if (!wildcard.contains('?') && !wildcard.contains('[')) {
+        QString core = wildcard;
+        const bool leading = core.startsWith('*');
+        const bool trailing = core.size() > 1 && core.endsWith('*');
+        if (leading) {
+            core.remove(0, 1);
+        }
+        if (trailing) {
+            core.chop(1);
+        }
+        if (!core.contains('*')) {
+            pattern.text = core;
+            pattern.mode = leading && trailing ? Pattern::Contains
+                         : leading             ? Pattern::Suffix
+                         : trailing            ? Pattern::Prefix
+                                               : Pattern::Exact;
+            return pattern;
+        }
+    }
+
+    pattern.regex = QRegularExpression(
+        QRegularExpression::wildcardToRegularExpression(wildcard, QRegularExpression::NonPathWildcardConversion),
+        QRegularExpression::CaseInsensitiveOption);
+    pattern.regex.optimize();
+    return pattern;
+}
+
+bool LayerPredicate::Pattern::matches(const QString& value) const
+{
+    switch (mode) {
+    case Exact: return value.compare(text, Qt::CaseInsensitive) == 0;
+    case Prefix: return value.startsWith(text, Qt::CaseInsensitive);
+    case Suffix: return value.endsWith(text, Qt::CaseInsensitive);
+    case Contains: return value.contains(text, Qt::CaseInsensitive);
+    case Any: return true;
+    case Regex: return regex.match(value).hasMatch();
+    }
+    return false;
+}
+
+int LayerPredicate::addNode(const Node& node)
+{
+    switch (node.kind) {
+    case Node::Name: m_columns |= LayerTable::NameColumn; break;
+    case Node::LineType: m_columns |= LayerTable::LineTypeColumn; break;
+    case Node::Color: m_columns |= LayerTable::ColorColumn; break;
+    case Node::State: m_columns |= LayerTable::StateColumn; break;
+    case Node::ObjectCount: m_columns |= LayerTable::ObjectCountColumn; break;
+    default: break;
+    }
+    m_nodes.push_back(node);
+    return static_cast<int>(m_nodes.size()) - 1;
+}
+
+bool LayerPredicate::matches(const LayerTable& table, int row) const
+{
+    if (!m_valid || row < 0 || !table.isLive(row)) {
+        return false;
+    }
+    return m_root < 0 || evaluate(m_root, table, row);
+}
+
+bool LayerPredicate::evaluate(int index, const LayerTable& table, int row) const
+{
+    const Node& node = m_nodes[index];
+    switch (node.kind) {
+    case Node::And:
+        return evaluate(node.left, table, row) && evaluate(node.right, table, row);
+    case Node::Or:
+        return evaluate(node.left, table, row) || evaluate(node.right, table, row);
+    case Node::Not:
+        return !evaluate(node.left, table, row);
+    case Node::Name:
+        return m_patterns[node.pattern].matches(table.name(row));
+    case Node::LineType:
+        return m_patterns[node.pattern].matches(table.lineType(row));
+    case Node::Color:
+        return table.color(row) == node.color;
+    case Node::State:
+        return (table.state(row) & node.stateMask) == node.stateValue;
+    case Node::ObjectCount: {
+        const int count = table.objectCount(row);
+        switch (node.compare) {
+        case Node::Less: return count < node.count;
+        case Node::LessEqual: return count <= node.count;
+        case Node::Equal: return count == node.count;
+        case Node::NotEqual: return count != node.count;
+        case Node::GreaterEqual: return count >= node.count;
+        case Node::Greater: return count > node.count;
+        }
+        return false;
+    }
+    }
+    return false;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QColor>
+#include <vector>
+
+struct LayerProperties;
+
+/**
+ * @brief Columnar copy of the layer table used for filter evaluation
+ *
+ * Each layer owns a row; each property lives in its own array so a filter
+ * reading one property scans one contiguous column. Line types are interned.
+ * Rows of deleted layers are recycled.
+ */
+class LayerTable
+{
+public:
+    enum Column : quint8 {
+        NameColumn = 0x01,
+        ColorColumn = 0x02,
+        LineTypeColumn = 0x04,
+        StateColumn = 0x08,
+        ObjectCountColumn = 0x10,
+        AllColumns = 0x1f
+    };
+
+    enum StateFlag : quint8 {
+        Visible = 0x01,
+        Frozen = 0x02,
+        Locked = 0x04,
+        Plottable = 0x08
+    };
+
+    int rowCount() const { return static_cast<int>(m_names.size()); }
+    int row(const QString& name) const { return m_rows.value(name, -1); }
+    bool isLive(int row) const { return m_live[row] != 0; }
+
+    // Stores the properties in the layer's row, acquiring one if needed;
+    // returns the columns whose values changed
+    quint8 store(const LayerProperties& properties);
+    void release(const QString& name);
+    quint8 setObjectCount(const QString& name, int count);
+    void clear();
+
+    const QString& name(int row) const { return m_names[row]; }
+    QRgb color(int row) const { return m_colors[row]; }
+    const QString& lineType(int row) const { return m_lineTypeNames[m_lineTypes[row]]; }
+    quint8 state(int row) const { return m_states[row]; }
+    int objectCount(int row) const { return m_objectCounts[row]; }
+
+private:
+    int internLineType(const QString& lineType);
+
+    std::vector<QString> m_names;
+    std::vector<QRgb> m_colors;
+    std::vector<int> m_lineTypes;
+    std::vector<quint8> m_states;
+    std::vector<int> m_objectCounts;
+    std::vector<quint8> m_live;
+
+    QHash<QString, int> m_rows;
+    std::vector<int> m_freeRows;
+    QStringList m_lineTypeNames;
+    QHash<QString, int> m_lineTypeIds;
+};
+
+/**
+ * @brief Layer filter criteria compiled into a predicate tree
+ *
+ * Criteria are whitespace separated terms, implicitly AND-ed:
+ *   - a bare word or name:PATTERN is a name wildcard (* ?, comma separated
+ *     alternatives), matched case-insensitively
+ *   - lt:PATTERN / linetype:PATTERN matches the line type
+ *   - color:VALUE matches a color name or #rrggbb
+ *   - is:on|off|frozen|thawed|locked|unlocked|plot|noplot|used|empty
+ *   - objects>N (also <, <=, >=, =, !=) compares the object count
+ * Terms combine with AND/&, OR/|, NOT/! and parentheses.
+ *
+ * compile() parses once; matches() then reads only the columns the tree
+ * references, and columns() tells callers which property changes can
+ * affect membership.
+ */
+class LayerPredicate
+{
+public:
+    LayerPredicate();
+
+    static LayerPredicate compile(const QString& criteria, QString* error = nullptr);
+
+    bool isValid() const { return m_valid; }
+    bool matchesAll() const { return m_valid && m_root < 0; }
+    quint8 columns() const { return m_columns; }
+    const QString& criteria() const { return m_criteria; }
+
+    bool matches(const LayerTable& table, int row) const;
+
+private:
+    struct Pattern {
+        enum Mode { Exact, Prefix, Suffix, Contains, Any, Regex };
+        Mode mode;
+        QString text;
+        QRegularExpression regex;
+
+        bool matches(const QString& value) const;
+    };
+
+    struct Node {
+        enum Kind { And, Or, Not, Name, LineType, Color, State, ObjectCount };
+        enum Compare { Less, LessEqual, Equal, NotEqual, GreaterEqual, Greater };
+        Kind kind;
+        int left;
+        int right;
+        int pattern;
+        QRgb color;
+        quint8 stateMask;
+        quint8 stateValue;
+        Compare compare;
+        int count;
+    };
+
+    class Parser;
+
+    static Pattern makePattern(const QString& wildcard);
+    int addNode(const Node& node);
+    bool evaluate(int node, const LayerTable& table, int row) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<Pattern> m_patterns;
+    int m_root;
+    quint8 m_columns;
+    bool m_valid;
+    QString m_criteria;
+};
@@ -0,0 +1,276 @@
+#include "LayerUsageIndex.h"
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+
+namespace {
+
+// Rough per-object costs for capacity planning; a sub-shape carries its
+// TShape, geometry handle and tolerance data
+constexpr qint64 BytesPerSubShape = 160;
+constexpr qint64 BytesPerProperty = 64;
+
+const std::vector<int> NoEntities;
+
+} // namespace
+
+void LayerUsageIndex::add(int entityId, const CADEntity& entity)
+{
+    if (m_records.count(entityId) != 0) {
+        update(entityId, entity);
+        return;
+    }
+
+    Record record{};
+    record.slot = slotFor(entity.layer);
+    record.type = entity.type;
+    record.visible = entity.visible;
+    measure(entity, record);
+    record.bytes = static_cast<qint64>(sizeof(CADEntity)) + entity.properties.size() * BytesPerProperty + record.shapeBytes;
+
+    attach(entityId, m_records.emplace(entityId, record).first->second);
+}
+
+void LayerUsageIndex::update(int entityId, const CADEntity& entity)
+{
+    auto it = m_records.find(entityId);
+    if (it == m_records.end()) {
+        add(entityId, entity);
+        return;
+    }
+
+    Record& record = it->second;
+    const int slot = slotFor(entity.layer);
+    const bool moved = slot != record.slot;
+    if (moved) {
+        detach(record);
+    } else {
+        count(record, -1);
+    }
+
+    record.slot = slot;
+    record.type = entity.type;
+    record.visible = entity.visible;
+    const void* shape = entity.shape.IsNull() ? nullptr : entity.shape.TShape().get();
+    if (shape != record.shape) {
+        releaseShape(record);
+        measure(entity, record);
+    }
+    record.bytes = static_cast<qint64>(sizeof(CADEntity)) + entity.properties.size() * BytesPerProperty + record.shapeBytes;
+
+    if (moved) {
+        attach(entityId, record);
+    } else {
+        count(record, 1);
+    }
+}
+
+void LayerUsageIndex::remove(int entityId)
+{
+    auto it = m_records.find(entityId);
+    if (it == m_records.end()) {
+        return;
+    }
+    detach(it->second);
+    releaseShape(it->second);
+    m_records.erase(it);
+}
+
+void LayerUsageIndex::clear()
+{
+    m_slots.clear();
+    m_slotIndex.clear();
+    m_records.clear();
+    m_blockVertices.clear();
+}
+
+void LayerUsageIndex::renameLayer(const QString& oldName, const QString& newName)
+{
+    auto it = m_slotIndex.constFind(oldName);
+    if (it == m_slotIndex.constEnd() || oldName == newName) {
+        return;
+    }
+
+    const int from = it.value();
+    m_slotIndex.remove(oldName);
+
+    const int to = m_slotIndex.value(newName, -1);
+    if (to < 0) {
+        m_slots[from].name = newName;
+        m_slotIndex.insert(newName, from);
+        return;
+    }
+
+    // Merge into the existing layer; the old slot stays behind empty
+    const std::vector<int> entities = std::move(m_slots[from].entities);
+    m_slots[from] = Slot{oldName, LayerUsage(), {}, {}};
+    m_slotIndex.insert(oldName, from);
+    for (int entityId : entities) {
+        Record& record = m_records[entityId];
+        record.slot = to;
+        attach(entityId, record);
+    }
+}
+
+int LayerUsageIndex::objectCount(const QString& layer) const
+{
+    auto it = m_slotIndex.constFind(layer);
+    return it != m_slotIndex.constEnd() ? m_slots[it.value()].usage.objects : 0;
+}
+
+int LayerUsageIndex::objectCount(const QString& layer, CADEntity::Type type) const
+{
+    auto it = m_slotIndex.constFind(layer);
+    return it != m_slotIndex.constEnd() ? m_slots[it.value()].usage.byType[type] : 0;
+}
+
+int LayerUsageIndex::objectCount(const QString& layer, CADEntity::Type type, bool visible) const
+{
+    auto it = m_slotIndex.constFind(layer);
+    if (it == m_slotIndex.constEnd()) {
+        return 0;
+    }
+    const Slot& slot = m_slots[it.value()];
+    return visible ? slot.visibleByType[type] : slot.usage.byType[type] - slot.visibleByType[type];
+}
+
+LayerUsage LayerUsageIndex::usage(const QString& layer) const
+{
+    auto it = m_slotIndex.constFind(layer);
+    return it != m_slotIndex.constEnd() ? m_slots[it.value()].usage : LayerUsage();
+}
+
+LayerUsage LayerUsageIndex::totals() const
+{
+    LayerUsage total;
+    for (const Slot& slot : m_slots) {
+        total.objects += slot.usage.objects;
+        total.visibleObjects += slot.usage.visibleObjects;
+        for (int type = 0; type < LayerUsage::TypeCount; ++type) {
+            total.byType[type] += slot.usage.byType[type];
+        }
+        total.vertices += slot.usage.vertices;
+        total.bytes += slot.usage.bytes;
+    }
+    return total;
+}
+
+QStringList LayerUsageIndex::usedLayers() const
+{
+    QStringList layers;
+    for (const Slot& slot : m_slots) {
+        if (slot.usage.objects > 0 && !slot.name.isEmpty()) {
+            layers.append(slot.name);
+        }
+    }
+    return layers;
+}
+
+const std::vector<int>& LayerUsageIndex::entities(const QString& layer) const
+{
+    auto it = m_slotIndex.constFind(layer);
+    return it != m_slotIndex.constEnd() ? m_slots[it.value()].entities : NoEntities;
+}
+
+int LayerUsageIndex::slotFor(const QString& layer)
+{
+    auto it = m_slotIndex.constFind(layer);
+    if (it != m_slotIndex.constEnd()) {
+        return it.value();
+    }
+    const int slot = static_cast<int>(m_slots.size());
+    m_slots.push_back(Slot{layer, LayerUsage(), {}, {}});
+    m_slotIndex.insert(layer, slot);
+    return slot;
+}
+
+void LayerUsageIndex::count(const Record& record, int sign)
+{
+    Slot& slot = m_slots[record.slot];
+    slot.usage.objects += sign;
+    slot.usage.byType[record.type] += sign;
+    if (record.visible) {
+        slot.usage.visibleObjects += sign;
+        slot.visibleByType[record.type] += sign;
+    }
+    slot.usage.vertices += sign * record.vertices;
+    slot.usage.bytes += sign * record.bytes;
+}
+
+void LayerUsageIndex::attach(int entityId, Record& record)
+{
+    std::vector<int>& entities = m_slots[record.slot].entities;
+    record.position = static_cast<int>(entities.size());
+    entities.push_back(entityId);
+    count(record, 1);
+}
+
+void LayerUsageIndex::detach(const Record& record)
+{
+    count(record, -1);
+
+    // Swap-remove; the entity moved into the gap takes over its position
+    std::vector<int>& entities = m_slots[record.slot].entities;
+    const int last = entities.back();
+    entities[record.position] = last;
+    m_records[last].position = record.position;
+    entities.pop_back();
+}
+
+void LayerUsageIndex::measure(const CADEntity& entity, Record& record)
+{
+    record.shape = nullptr;
+    record.blockShape = false;
+    record.vertices = 0;
+    record.shapeBytes = 0;
+    if (entity.shape.IsNull()) {
+        return;
+    }
+    record.shape = entity.shape.TShape().get();
+
+    if (entity.type == CADEntity::Block) {
+        auto cached = m_blockVertices.find(record.shape);
+        if (cached == m_blockVertices.end()) {
+            cached = m_blockVertices.emplace(record.shape,
+                                             BlockShape{entity.shape, countVertices(entity.shape, nullptr), 0}).first;
+        }
+        ++cached->second.inserts;
+        record.blockShape = true;
+        record.vertices = cached->second.vertices;
+        return;
+    }
+
+    int subShapes = 0;
+    record.vertices = countVertices(entity.shape, &subShapes);
+    record.shapeBytes = subShapes * BytesPerSubShape;
+}
+
+void LayerUsageIndex::releaseShape(Record& record)
+{
+    if (!record.blockShape) {
+        return;
+    }
+    record.blockShape = false;
+
+    // Redefined blocks and copied inserts leave shapes nothing else refers to
+    auto cached = m_blockVertices.find(record.shape);
+    if (cached != m_blockVertices.end() && --cached->second.inserts == 0) {
+        m_blockVertices.erase(cached);
+    }
+}
+
+int LayerUsageIndex::countVertices(const TopoDS_Shape& shape, int* subShapes)
+{
+    // Shared sub-shapes are counted once, as they are stored once
+    TopTools_IndexedMapOfShape map;
+    TopExp::MapShapes(shape, map);
+    int vertices = 0;
+    for (int i = 1; i <= map.Extent(); ++i) {
+        if (map(i).ShapeType() == TopAbs_VERTEX) {
+            ++vertices;
+        }
+    }
+    if (subShapes) {
+        *subShapes = map.Extent();
+    }
+    return vertices;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "GeometryEngine.h"
+#include <QHash>
+#include <QStringList>
+#include <array>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Per-layer usage of one layer, as counted by LayerUsageIndex
+ */
+struct LayerUsage
+{
+    static constexpr int TypeCount = CADEntity::Solid + 1;
+
+    int objects = 0;
+    int visibleObjects = 0;
+    std::array<int, TypeCount> byType{};  // All objects, by CADEntity::Type
+    qint64 vertices = 0;
+    qint64 bytes = 0;                     // Estimated entity and B-rep memory
+};
+
+/**
+ * @brief Incrementally maintained per-layer object index
+ *
+ * Counts objects by layer x type x visibility and sums their vertex counts
+ * and estimated memory. Every update adjusts the counters of the one or two
+ * layers involved, so usage queries and purge checks cost O(layers), never
+ * O(entities). Each layer also keeps its member ids (swap-removed, so order
+ * is arbitrary) for operations that must touch every object on a layer.
+ *
+ * Shape statistics are computed when an entity's shape changes identity;
+ * property-only updates (color, visibility, layer) reuse them. Block inserts
+ * share their definition's geometry, so its vertices are counted once per
+ * definition and charged to each insert without adding B-rep memory. The
+ * per-definition count lives as long as an insert still uses that shape.
+ */
+class LayerUsageIndex
+{
+public:
+    void add(int entityId, const CADEntity& entity);
+    void update(int entityId, const CADEntity& entity);
+    void remove(int entityId);
+    void clear();
+
+    // Moves every object of a layer to another name; the caller updates the entities
+    void renameLayer(const QString& oldName, const QString& newName);
+
+    int objectCount(const QString& layer) const;
+    int objectCount(const QString& layer, CADEntity::Type type) const;
+    int objectCount(const QString& layer, CADEntity::Type type, bool visible) const;
+    LayerUsage usage(const QString& layer) const;
+    LayerUsage totals() const;
+
+    // Layers that hold at least one object
+    QStringList usedLayers() const;
+    const std::vector<int>& entities(const QString& layer) const;
+
+private:
+    struct Slot {
+        QString name;
+        LayerUsage usage;
+        std::array<int, LayerUsage::TypeCount> visibleByType{};
+        std::vector<int> entities;
+    };
+
+    struct Record {
+        int slot;
+        int position;        // Index in the slot's entity list
+        CADEntity::Type type;
+        bool visible;
+        const void* shape;   // TShape identity the shape statistics were computed for
+        bool blockShape;     // Holds a reference to m_blockVertices[shape]
+        int vertices;
+        qint64 shapeBytes;
+        qint64 bytes;
+    };
+
+    int slotFor(const QString& layer);
+    void count(const Record& record, int sign);
+    void attach(int entityId, Record& record);
+    void detach(const Record& record);
+    void measure(const CADEntity& entity, Record& record);
+    void releaseShape(Record& record);
+    static int countVertices(const TopoDS_Shape& shape, int* subShapes);
+
+    std::vector<Slot> m_slots;
+    QHash<QString, int> m_slotIndex;
+    std::unordered_map<int, Record> m_records;
+
+    struct BlockShape {
+        TopoDS_Shape shape;  // Pins the TShape address while it is a key
+        int vertices;
+        int inserts;         // Records holding it; the entry goes with the last one
+    };
+
+    // Definition TShape -> vertex count
+    std::unordered_map<const void*, BlockShape> m_blockVertices;
+};
@@ -0,0 +1,334 @@
+#include "LayoutManager.h"
+#include "GeometryEngine.h"
+#include "HiddenLineRemoval.h"
+#include "LayerManager.h"
+#include "Tracing.h"
+#include <algorithm>
+#include <set>
+#include <utility>
+
+Q_LOGGING_CATEGORY(cadLayouts, "cad.layouts")
+
+namespace {
+
+const QString ModelLayout = QStringLiteral("Model");
+
+} // namespace
+
+LayoutManager::LayoutManager(QObject *parent)
+    : QObject(parent)
+    , m_geometryEngine(nullptr)
+    , m_layerManager(nullptr)
+    , m_currentLayout(ModelLayout)
+    , m_boundsTracked(false)
+{
+}
+
+LayoutManager::~LayoutManager() = default;
+
+void LayoutManager::setGeometryEngine(GeometryEngine* engine)
+{
+    if (m_geometryEngine) {
+        disconnect(m_geometryEngine, nullptr, this, nullptr);
+    }
+
+    m_geometryEngine = engine;
+    m_entityBounds.clear();
+    m_boundsTracked = false;
+    m_hiddenLines = engine ? std::make_unique<HiddenLineRemoval>(engine) : nullptr;
+    for (Layout& layout : m_layouts) {
+        for (auto& entry : layout.viewports) {
+            entry.second = makeCache(entry.second->viewport());
+        }
+    }
+    if (!engine) {
+        return;
+    }
+
+    connect(engine, &GeometryEngine::entityAdded, this, &LayoutManager::onEntityAdded);
+    connect(engine, &GeometryEngine::entitiesAdded, this, &LayoutManager::onEntitiesAdded);
+    connect(engine, &GeometryEngine::entityModified, this, &LayoutManager::onEntityModified);
+    connect(engine, &GeometryEngine::entityRemoved, this, &LayoutManager::onEntityRemoved);
+    if (!m_layouts.empty()) {
+        trackBounds();
+    }
+}
+
+void LayoutManager::setLayerManager(LayerManager* layers)
+{
+    if (m_layerManager) {
+        disconnect(m_layerManager, nullptr, this, nullptr);
+    }
+
+    m_layerManager = layers;
+    for (Layout& layout : m_layouts) {
+        for (auto& entry : layout.viewports) {
+            entry.second->setLayerManager(layers);
+        }
+    }
+    if (!layers) {
+        return;
+    }
+
+    // A layer colour shows in every shaded tile of its entities
+    connect(layers, &LayerManager::layerPropertiesChanged, this, &LayoutManager::invalidateViewports);
+    connect(layers, &LayerManager::layerRenamed, this, &LayoutManager::invalidateViewports);
+}
+
+// Layouts
+bool LayoutManager::createLayout(const QString& name, const QSizeF& paperSize)
+{
+    if (name.trimmed().isEmpty() || name.compare(ModelLayout, Qt::CaseInsensitive) == 0 || hasLayout(name)) {
+        qCWarning(cadLayouts) << "Invalid or duplicate layout name:" << name;
+        return false;
+    }
+    if (paperSize.isEmpty()) {
+        qCWarning(cadLayouts) << "Invalid paper size for layout" << name << ":" << paperSize;
+        return false;
+    }
+
+    Layout layout;
+    layout.name = name;
+    layout.paperSize = paperSize;
+    m_layouts.push_back(std::move(layout));
+
+    emit layoutCreated(name);
+    return true;
+}
+
+bool LayoutManager::deleteLayout(const QString& name)
+{
+    auto it = std::find_if(m_layouts.begin(), m_layouts.end(), [&name](const Layout& layout) { return layout.name == name; });
+    if (it == m_layouts.end()) {
+        return false;
+    }
+
+    m_layouts.erase(it);
+    if (m_currentLayout == name) {
+        setCurrentLayout(ModelLayout);
+    }
+
+    emit layoutDeleted(name);
+    return true;
+}
+
+bool LayoutManager::renameLayout(const QString& oldName, const QString& newName)
+{
+    Layout* layout = findLayout(oldName);
+    if (!layout || newName.trimmed().isEmpty() || newName.compare(ModelLayout, Qt::CaseInsensitive) == 0
+        || hasLayout(newName)) {
+        return false;
+    }
+
+    layout->name = newName;
+    if (m_currentLayout == oldName) {
+        m_currentLayout = newName;
+    }
+
+    emit layoutRenamed(oldName, newName);
+    return true;
+}
+
+bool LayoutManager::hasLayout(const QString& name) const
+{
+    return findLayout(name) != nullptr;
+}
+
+QStringList LayoutManager::getLayoutNames() const
+{
+    QStringList names;
+    for (const Layout& layout : m_layouts) {
+        names.append(layout.name);
+    }
+    return names;
+}
+
+QSizeF LayoutManager::getPaperSize(const QString& name) const
+{
+    const Layout* layout = findLayout(name);
+    return layout ? layout->paperSize : QSizeF();
+}
+
+void LayoutManager::clear()
+{
+    m_layouts.clear();
+    m_entityBounds.clear();
+    m_boundsTracked = false;
+    if (m_hiddenLines) {
+        m_hiddenLines->clearCache();
+    }
+    setCurrentLayout(ModelLayout);
+}
+
+void LayoutManager::setCurrentLayout(const QString& name)
+{
+    if (name == m_currentLayout || (name != ModelLayout && !hasLayout(name))) {
+        return;
+    }
+
+    // Switching only changes which caches are drawn; nothing is rebuilt here
+    m_currentLayout = name;
+    emit currentLayoutChanged(name);
+}
+
+// Viewports
+int LayoutManager::addViewport(const QString& layoutName, const LayoutViewport& viewport)
+{
+    Layout* layout = findLayout(layoutName);
+    if (!layout || viewport.paperRect.isEmpty() || viewport.scale <= 0.0) {
+        qCWarning(cadLayouts) << "Cannot add viewport to layout" << layoutName;
+        return -1;
+    }
+
+    trackBounds();
+
+    const int id = layout->nextViewportId++;
+    LayoutViewport placed = viewport;
+    placed.id = id;
+    layout->viewports[id] = makeCache(placed);
+    return id;
+}
+
+bool LayoutManager::updateViewport(const QString& layoutName, const LayoutViewport& viewport)
+{
+    Layout* layout = findLayout(layoutName);
+    if (!layout || viewport.paperRect.isEmpty() || viewport.scale <= 0.0) {
+        return false;
+    }
+    auto it = layout->viewports.find(viewport.id);
+    if (it == layout->viewports.end()) {
+        return false;
+    }
+
+    it->second->setViewport(viewport);
+    emit viewportInvalidated(layoutName, viewport.id);
+    return true;
+}
+
+bool LayoutManager::removeViewport(const QString& layoutName, int viewportId)
+{
+    Layout* layout = findLayout(layoutName);
+    return layout && layout->viewports.erase(viewportId) != 0;
+}
+
+std::vector<LayoutViewport> LayoutManager::getViewports(const QString& layoutName) const
+{
+    std::vector<LayoutViewport> viewports;
+    if (const Layout* layout = findLayout(layoutName)) {
+        for (const auto& entry : layout->viewports) {
+            viewports.push_back(entry.second->viewport());
+        }
+    }
+    return viewports;
+}
+
+ViewportRenderCache* LayoutManager::viewportCache(const QString& layoutName, int viewportId)
+{
+    Layout* layout = findLayout(layoutName);
+    if (!layout || !m_geometryEngine) {
+        return nullptr;
+    }
+    auto it = layout->viewports.find(viewportId);
+    return it != layout->viewports.end() ? it->second.get() : nullptr;
+}
+
+void LayoutManager::invalidateViewports()
+{
+    for (Layout& layout : m_layouts) {
+        for (auto& entry : layout.viewports) {
+            entry.second->invalidateAll();
+            emit viewportInvalidated(layout.name, entry.first);
+        }
+    }
+}
+
+std::unique_ptr<ViewportRenderCache> LayoutManager::makeCache(const LayoutViewport& viewport) const
+{
+    auto cache = std::make_unique<ViewportRenderCache>(m_geometryEngine, m_hiddenLines.get());
+    cache->setLayerManager(m_layerManager);
+    cache->setViewport(viewport);
+    return cache;
+}
+
+// Change routing
+void LayoutManager::onEntityAdded(int entityId)
+{
+    entitiesChanged({entityId}, false);
+}
+
+void LayoutManager::onEntitiesAdded(const std::vector<int>& entityIds)
+{
+    entitiesChanged(entityIds, false);
+}
+
+void LayoutManager::onEntityModified(int entityId)
+{
+    entitiesChanged({entityId}, false);
+}
+
+void LayoutManager::onEntityRemoved(int entityId)
+{
+    entitiesChanged({entityId}, true);
+}
+
+void LayoutManager::entitiesChanged(const std::vector<int>& entityIds, bool removed)
+{
+    if (!m_boundsTracked) {
+        return;     // No viewports yet; they collect their content when first drawn
+    }
+
+    CAD_TRACE_SCOPE("layouts", "routeChanges");
+
+    // Each affected viewport is reported once, however many entities hit it
+    std::set<std::pair<int, int>> touched;
+    for (int entityId : entityIds) {
+        auto known = m_entityBounds.find(entityId);
+        const Bnd_Box before = known != m_entityBounds.end() ? known->second : Bnd_Box();
+        const Bnd_Box after = removed ? Bnd_Box() : ViewportRenderCache::entityBounds(m_geometryEngine, entityId);
+        if (removed) {
+            if (known != m_entityBounds.end()) {
+                m_entityBounds.erase(known);
+            }
+        } else {
+            m_entityBounds[entityId] = after;
+        }
+
+        for (size_t i = 0; i < m_layouts.size(); ++i) {
+            for (auto& entry : m_layouts[i].viewports) {
+                if (entry.second->invalidateEntity(entityId, before, after)) {
+                    touched.emplace(static_cast<int>(i), entry.first);
+                }
+            }
+        }
+    }
+
+    for (const auto& viewport : touched) {
+        emit viewportInvalidated(m_layouts[viewport.first].name, viewport.second);
+    }
+}
+
+void LayoutManager::trackBounds()
+{
+    if (m_boundsTracked || !m_geometryEngine) {
+        return;
+    }
+    for (int entityId : m_geometryEngine->getAllEntityIds()) {
+        m_entityBounds[entityId] = ViewportRenderCache::entityBounds(m_geometryEngine, entityId);
+    }
+    m_boundsTracked = true;
+}
+
+LayoutManager::Layout* LayoutManager::findLayout(const QString& name)
+{
+    for (Layout& layout : m_layouts) {
+        if (layout.name == name) {
+            return &layout;
+        }
+    }
+    return nullptr;
+}
+
+const LayoutManager::Layout* LayoutManager::findLayout(const QString& name) const
+{
+    return const_cast<LayoutManager*>(this)->findLayout(name);
+}
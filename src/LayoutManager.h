@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QObject>
+#include <QLoggingCategory>
+#include <QSizeF>
+#include <QStringList>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "ViewportRenderCache.h"
+
+class GeometryEngine;
+class HiddenLineRemoval;
+class LayerManager;
+
+Q_DECLARE_LOGGING_CATEGORY(cadLayouts)
+
+/**
+ * @brief Paper-space layouts and their floating viewports
+ *
+ * Every viewport owns a ViewportRenderCache that outlives layout switches,
+ * so returning to a layout redraws from cached line work and tiles. Model
+ * changes are routed to the caches with the entity's bounds before and
+ * after the change; a viewport is invalidated only when either intersects
+ * its clip region, and then only for that entity.
+ */
+class LayoutManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LayoutManager(QObject *parent = nullptr);
+    ~LayoutManager();
+
+    void setGeometryEngine(GeometryEngine* engine);
+    void setLayerManager(LayerManager* layers);     // Layer colours for shaded viewports
+
+    // Layouts
+    bool createLayout(const QString& name, const QSizeF& paperSize = QSizeF(420.0, 297.0));
+    bool deleteLayout(const QString& name);
+    bool renameLayout(const QString& oldName, const QString& newName);
+    bool hasLayout(const QString& name) const;
+    QStringList getLayoutNames() const;
+    QSizeF getPaperSize(const QString& name) const;
+    void clear();
+
+    void setCurrentLayout(const QString& name);
+    QString getCurrentLayout() const { return m_currentLayout; }
+
+    // Viewports
+    int addViewport(const QString& layout, const LayoutViewport& viewport);
+    bool updateViewport(const QString& layout, const LayoutViewport& viewport);
+    bool removeViewport(const QString& layout, int viewportId);
+    std::vector<LayoutViewport> getViewports(const QString& layout) const;
+
+    // Cached renders
+    ViewportRenderCache* viewportCache(const QString& layout, int viewportId);
+    void invalidateViewports();     // For drawing-wide changes such as layer visibility
+
+signals:
+    void layoutCreated(const QString& name);
+    void layoutDeleted(const QString& name);
+    void layoutRenamed(const QString& oldName, const QString& newName);
+    void currentLayoutChanged(const QString& name);
+    void viewportInvalidated(const QString& layout, int viewportId);
+
+private slots:
+    void onEntityAdded(int entityId);
+    void onEntitiesAdded(const std::vector<int>& entityIds);
+    void onEntityModified(int entityId);
+    void onEntityRemoved(int entityId);
+
+private:
+    struct Layout {
+        QString name;
+        QSizeF paperSize;
+        int nextViewportId = 1;
+        std::map<int, std::unique_ptr<ViewportRenderCache>> viewports;
+    };
+
+    Layout* findLayout(const QString& name);
+    const Layout* findLayout(const QString& name) const;
+    void trackBounds();
+    std::unique_ptr<ViewportRenderCache> makeCache(const LayoutViewport& viewport) const;
+    void entitiesChanged(const std::vector<int>& entityIds, bool removed);
+
+    GeometryEngine* m_geometryEngine;
+    LayerManager* m_layerManager;
+    std::unique_ptr<HiddenLineRemoval> m_hiddenLines;
+    std::vector<Layout> m_layouts;
+    QString m_currentLayout;
+
+    // Last known bounds per entity, so a change can be tested where it was as well as where it is
+    std::unordered_map<int, Bnd_Box> m_entityBounds;
+    bool m_boundsTracked;
+};
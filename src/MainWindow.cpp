@@ -1,11 +1,17 @@
 #include "MainWindow.h"
 #include "CADApplication.h"
+#include "CommandManager.h"
+#include "GeometryEngine.h"
+#include "StartupTimeline.h"
+#include "Tracing.h"
 #include "ui/RibbonInterface.h"
 #include "ui/DockablePalettes.h"
 #include "ui/ViewportManager.h"
+#include "ui/RenderResources.h"
 #include "ui/StatusBar.h"
 #include "ui/ContextMenus.h"
 #include "ui/NavigationControls.h"
+#include "ui/TimingPanel.h"
 
 #include <QMenuBar>
 #include <QToolBar>
@@ -15,6 +21,9 @@
 #include <QTabWidget>
 #include <QTextEdit>
 #include <QLineEdit>
+#include <QAbstractItemView>
+#include <QCompleter>
+#include <QStringListModel>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
@@ -62,6 +71,9 @@ MainWindow::MainWindow(QWidget *parent)
     , m_commandWidget(nullptr)
     , m_commandLine(nullptr)
     , m_commandHistory(nullptr)
+    , m_commandCompleter(nullptr)
+    , m_completionModel(nullptr)
+    , m_timingDock(nullptr)
     , m_menuBar(nullptr)
     , m_quickAccessToolbar(nullptr)
     , m_navigationToolbar(nullptr)
@@ -69,6 +81,7 @@ MainWindow::MainWindow(QWidget *parent)
     , m_commandLineVisible(true)
     , m_statusBarVisible(true)
     , m_viewportsMaximized(false)
+    , m_firstShow(true)
 {
     qCDebug(cadMainWindow) << "Creating main window...";
     
@@ -101,9 +114,11 @@ void MainWindow::setupUI()
     
     // Setup ribbon interface
     setupRibbonInterface();
+    StartupTimeline::mark("ribbon");
     
     // Setup central widget with viewports
     setupCentralWidget();
+    StartupTimeline::mark("viewports");
     
     // Setup dockable widgets
     setupDockWidgets();
@@ -113,6 +128,7 @@ void MainWindow::setupUI()
     
     // Setup toolbars
     setupToolBars();
+    StartupTimeline::mark("chrome");
     
     qCDebug(cadMainWindow) << "UI setup complete";
 }
@@ -183,8 +199,7 @@ void MainWindow::setupDockWidgets()
 {
     qCDebug(cadMainWindow) << "Setting up dock widgets...";
     
-    // Create dockable palettes
-    m_dockablePalettes = std::make_unique<DockablePalettes>(this);
+    // Palettes and the timing panel are built on first use (see dockablePalettes())
     
     // Setup command line dock
     m_commandDock = new QDockWidget("Command Line", this);
@@ -210,6 +225,13 @@ void MainWindow::setupDockWidgets()
     m_commandLine->setStyleSheet("background-color: #2d2d2d; color: #ffffff; border: 1px solid #555; padding: 5px; font-family: 'Consolas', monospace;");
     m_commandLine->setPlaceholderText("Enter command...");
     
+    // Ranked completions are computed by the command manager; the popup just shows them
+    m_completionModel = new QStringListModel(this);
+    m_commandCompleter = new QCompleter(m_completionModel, this);
+    m_commandCompleter->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    m_commandCompleter->setCaseSensitivity(Qt::CaseInsensitive);
+    m_commandCompleter->setWidget(m_commandLine);
+    
     inputLayout->addWidget(promptLabel);
     inputLayout->addWidget(m_commandLine);
     commandLayout->addLayout(inputLayout);
@@ -222,6 +244,60 @@ void MainWindow::setupDockWidgets()
     resizeDocks({m_commandDock}, {150}, Qt::Vertical);
 }
 
+DockablePalettes* MainWindow::dockablePalettes()
+{
+    if (!m_dockablePalettes) {
+        CAD_TRACE_SCOPE("ui", "createPalettes");
+        const QList<QDockWidget*> existingDocks = findChildren<QDockWidget*>(QString(), Qt::FindDirectChildrenOnly);
+        m_dockablePalettes = std::make_unique<DockablePalettes>(this);
+
+        for (QDockWidget* dock : findChildren<QDockWidget*>(QString(), Qt::FindDirectChildrenOnly)) {
+            if (!existingDocks.contains(dock)) {
+                m_paletteDocks.append(dock);
+            }
+        }
+        restoreLazyDocks(existingDocks);
+
+        // The properties palette follows the engine selection
+        if (GeometryEngine* engine = CADApplication::instance()->geometryEngine()) {
+            connect(engine, &GeometryEngine::selectionChanged, this, [this](const std::vector<int>& selectedIds) {
+                if (PropertiesPalette* palette = m_dockablePalettes->propertiesPalette()) {
+                    palette->setSelectedObjects(QList<int>(selectedIds.begin(), selectedIds.end()));
+                }
+            });
+        }
+    }
+    return m_dockablePalettes.get();
+}
+
+QDockWidget* MainWindow::timingDock()
+{
+    if (!m_timingDock) {
+        CommandManager* commandManager = CADApplication::instance()->commandManager();
+        if (!commandManager) {
+            return nullptr;
+        }
+        const QList<QDockWidget*> existingDocks = findChildren<QDockWidget*>(QString(), Qt::FindDirectChildrenOnly);
+        m_timingDock = new QDockWidget("Command Timing", this);
+        m_timingDock->setObjectName("CommandTimingDock");
+        m_timingDock->setWidget(new TimingPanel(commandManager->telemetry()));
+        addDockWidget(Qt::RightDockWidgetArea, m_timingDock);
+        m_timingDock->hide();
+        restoreLazyDocks(existingDocks);
+    }
+    return m_timingDock;
+}
+
+void MainWindow::restoreLazyDocks(const QList<QDockWidget*>& existingDocks)
+{
+    // Place new docks where the last restored window state had them
+    for (QDockWidget* dock : findChildren<QDockWidget*>(QString(), Qt::FindDirectChildrenOnly)) {
+        if (!existingDocks.contains(dock)) {
+            restoreDockWidget(dock);
+        }
+    }
+}
+
 void MainWindow::setupStatusBar()
 {
     qCDebug(cadMainWindow) << "Setting up status bar...";
@@ -385,6 +461,14 @@ void MainWindow::createViewMenu()
     statusBarAction->setCheckable(true);
     statusBarAction->setChecked(m_statusBarVisible);
     connect(statusBarAction, &QAction::toggled, this, &MainWindow::setStatusBarVisible);
+
+    QAction* timingAction = viewMenu->addAction("Command &Timing");
+    connect(timingAction, &QAction::triggered, this, [this]() {
+        if (QDockWidget* dock = timingDock()) {
+            dock->show();
+            dock->raise();
+        }
+    });
 }
 
 void MainWindow::createDrawMenu()
@@ -696,6 +780,29 @@ void MainWindow::setupConnections()
     // Connect command line
     connect(static_cast<QCommandLineEdit*>(m_commandLine), &QCommandLineEdit::commandEntered,
             this, &MainWindow::onCommandEntered);
+    connect(m_commandLine, &QLineEdit::textEdited, this, [this](const QString& text) {
+        CommandManager* commandManager = CADApplication::instance()->commandManager();
+        if (!commandManager || text.trimmed().isEmpty()) {
+            m_commandCompleter->popup()->hide();
+            return;
+        }
+        m_completionModel->setStringList(commandManager->getCommandCompletions(text));
+        if (m_completionModel->rowCount() > 0) {
+            m_commandCompleter->complete();
+        } else {
+            m_commandCompleter->popup()->hide();
+        }
+    });
+    connect(m_commandCompleter, QOverload<const QString&>::of(&QCompleter::activated),
+            m_commandLine, &QLineEdit::setText);
+
+    // Text produced by commands such as TIMING
+    if (CommandManager* commandManager = CADApplication::instance()->commandManager()) {
+        connect(commandManager, &CommandManager::commandOutput, this, [this](const QString& text) {
+            m_commandHistory->append(text);
+            m_commandHistory->moveCursor(QTextCursor::End);
+        });
+    }
 
     // Connect application signals
     CADApplication* app = CADApplication::instance();
@@ -707,6 +814,43 @@ void MainWindow::setupConnections()
         connect(m_viewportManager.get(), &ViewportManager::viewportChanged,
                 this, &MainWindow::onViewportChanged);
     }
+
+    // Grid settings apply to every viewport; the grid itself is procedural
+    connect(app, &CADApplication::gridSpacingChanged, this, [this](double spacing) {
+        if (!m_viewportManager) {
+            return;
+        }
+        for (int i = 0; i < m_viewportManager->getViewportCount(); ++i) {
+            m_viewportManager->getViewport(i)->setGridSpacing(spacing);
+        }
+    });
+    connect(app, &CADApplication::gridVisibilityChanged, this, [this](bool visible) {
+        if (!m_viewportManager) {
+            return;
+        }
+        for (int i = 0; i < m_viewportManager->getViewportCount(); ++i) {
+            m_viewportManager->getViewport(i)->setGridVisible(visible);
+        }
+    });
+
+    // Entity changes are the only model-side reason for viewports to repaint
+    if (GeometryEngine* engine = app->geometryEngine()) {
+        SharedRenderResources::instance()->attachGeometryEngine(engine);
+
+        auto invalidateViewports = [this]() {
+            if (!m_viewportManager) {
+                return;
+            }
+            for (int i = 0; i < m_viewportManager->getViewportCount(); ++i) {
+                m_viewportManager->getViewport(i)->invalidateScene();
+            }
+        };
+        connect(engine, &GeometryEngine::entityAdded, this, invalidateViewports);
+        connect(engine, &GeometryEngine::entitiesAdded, this, invalidateViewports);
+        connect(engine, &GeometryEngine::entityRemoved, this, invalidateViewports);
+        connect(engine, &GeometryEngine::entityModified, this, invalidateViewports);
+        connect(engine, &GeometryEngine::entitiesCleared, this, invalidateViewports);
+    }
 }
 
 // Slot implementations
@@ -829,33 +973,25 @@ void MainWindow::onOrbit()
 void MainWindow::onLayerManager()
 {
     qCDebug(cadMainWindow) << "Layer manager requested";
-    if (m_dockablePalettes) {
-        m_dockablePalettes->showLayerManager();
-    }
+    dockablePalettes()->showLayerManager();
 }
 
 void MainWindow::onBlockManager()
 {
     qCDebug(cadMainWindow) << "Block manager requested";
-    if (m_dockablePalettes) {
-        m_dockablePalettes->showBlockManager();
-    }
+    dockablePalettes()->showBlockManager();
 }
 
 void MainWindow::onXrefManager()
 {
     qCDebug(cadMainWindow) << "Xref manager requested";
-    if (m_dockablePalettes) {
-        m_dockablePalettes->showXrefManager();
-    }
+    dockablePalettes()->showXrefManager();
 }
 
 void MainWindow::onLayoutManager()
 {
     qCDebug(cadMainWindow) << "Layout manager requested";
-    if (m_dockablePalettes) {
-        m_dockablePalettes->showLayoutManager();
-    }
+    dockablePalettes()->showLayoutManager();
 }
 
 void MainWindow::onOptions()
@@ -996,7 +1132,7 @@ void MainWindow::resetWorkspace()
     setCommandLineVisible(true);
     setStatusBarVisible(true);
 
-    // Reset dock widgets to default positions
+    // Reset dock widgets to default positions; unbuilt palettes already are
     if (m_dockablePalettes) {
         m_dockablePalettes->resetToDefault();
     }
@@ -1063,6 +1199,11 @@ void MainWindow::showEvent(QShowEvent *event)
 {
     QMainWindow::showEvent(event);
     qCDebug(cadMainWindow) << "Window shown";
+
+    if (m_firstShow) {
+        m_firstShow = false;
+        StartupTimeline::mark("windowShown");
+    }
 }
 
 void MainWindow::keyPressEvent(QKeyEvent *event)
@@ -1171,6 +1312,19 @@ void MainWindow::saveWindowState()
     settings.setValue("ribbonVisible", m_ribbonVisible);
     settings.setValue("commandLineVisible", m_commandLineVisible);
     settings.setValue("statusBarVisible", m_statusBarVisible);
+
+    // Lazily built docks that were open get rebuilt on the next start
+    QStringList openLazyDocks;
+    if (m_timingDock && m_timingDock->isVisible()) {
+        openLazyDocks << "timing";
+    }
+    for (QDockWidget* dock : m_paletteDocks) {
+        if (dock->isVisible()) {
+            openLazyDocks << "palettes";
+            break;
+        }
+    }
+    settings.setValue("openLazyDocks", openLazyDocks);
 }
 
 void MainWindow::restoreWindowState()
@@ -1188,5 +1342,13 @@ void MainWindow::restoreWindowState()
         setRibbonVisible(m_ribbonVisible);
         setCommandLineVisible(m_commandLineVisible);
         setStatusBarVisible(m_statusBarVisible);
+
+        const QStringList openLazyDocks = settings.value("openLazyDocks").toStringList();
+        if (openLazyDocks.contains("timing")) {
+            timingDock();
+        }
+        if (openLazyDocks.contains("palettes")) {
+            dockablePalettes();
+        }
     }
 }
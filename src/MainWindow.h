@@ -11,6 +11,8 @@ class QDockWidget;
 class QSplitter;
 class QTabWidget;
 class QCommandLineEdit;
+class QCompleter;
+class QStringListModel;
 
 class RibbonInterface;
 class DockablePalettes;
@@ -44,7 +46,7 @@ public:
 
     // UI component access
     RibbonInterface* ribbonInterface() const { return m_ribbonInterface.get(); }
-    DockablePalettes* dockablePalettes() const { return m_dockablePalettes.get(); }
+    DockablePalettes* dockablePalettes();     // Created on first use
     ViewportManager* viewportManager() const { return m_viewportManager.get(); }
     CADStatusBar* cadStatusBar() const { return m_cadStatusBar.get(); }
     NavigationControls* navigationControls() const { return m_navigationControls.get(); }
@@ -141,6 +143,10 @@ private:
     bool confirmClose();
     void saveWindowState();
     void restoreWindowState();
+    
+    // Docks built on first use; restored from the last restoreState()
+    QDockWidget* timingDock();
+    void restoreLazyDocks(const QList<QDockWidget*>& existingDocks);
 
     // UI Components
     std::unique_ptr<RibbonInterface> m_ribbonInterface;
@@ -160,6 +166,16 @@ private:
     QWidget* m_commandWidget;
     QCommandLineEdit* m_commandLine;
     QTextEdit* m_commandHistory;
+    QCompleter* m_commandCompleter;
+    QStringListModel* m_completionModel;
+    
+    // Command timing panel
+    QDockWidget* m_timingDock;
+    
+    // Docks created by DockablePalettes
+    QList<QDockWidget*> m_paletteDocks;
+    
+    bool m_firstShow;
     
     // Menu and toolbar
     QMenuBar* m_menuBar;
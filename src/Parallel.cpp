@@ -0,0 +1,98 @@
+#include "Parallel.h"
+#include <QRunnable>
+#include <QThreadPool>
+#include <algorithm>
+
+namespace Parallel {
+
+namespace {
+
+// 0: no cap beyond the global pool size
+thread_local int t_threadLimit = 0;
+
+} // namespace
+
+int maxThreads()
+{
+    const int poolThreads = std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+    return t_threadLimit > 0 ? std::min(t_threadLimit, poolThreads) : poolThreads;
+}
+
+ThreadLimit::ThreadLimit(int threads)
+    : m_previous(t_threadLimit)
+{
+    t_threadLimit = std::max(1, threads);
+}
+
+ThreadLimit::~ThreadLimit()
+{
+    t_threadLimit = m_previous;
+}
+
+class Loop::Helper : public QRunnable
+{
+public:
+    explicit Helper(Loop* loop) : m_loop(loop) { setAutoDelete(false); }
+
+    void run() override
+    {
+        m_loop->work();
+        m_loop->m_finished.release();
+    }
+
+private:
+    Loop* m_loop;
+};
+
+Loop::Loop(int count, std::function<void(int)> body)
+    : m_count(std::max(0, count))
+    , m_body(std::move(body))
+    , m_next(0)
+    , m_waited(false)
+{
+    // The caller is one of the threads
+    const int helpers = std::min(m_count, maxThreads()) - 1;
+    QThreadPool* pool = QThreadPool::globalInstance();
+    m_helpers.reserve(std::max(0, helpers));
+    for (int i = 0; i < helpers; ++i) {
+        m_helpers.push_back(new Helper(this));
+        pool->start(m_helpers.back());
+    }
+}
+
+Loop::~Loop()
+{
+    wait();
+}
+
+void Loop::wait()
+{
+    if (m_waited) {
+        return;
+    }
+    m_waited = true;
+
+    work();
+
+    // Helpers still queued never touch the loop; the rest are finishing their last index
+    QThreadPool* pool = QThreadPool::globalInstance();
+    int running = 0;
+    for (QRunnable* helper : m_helpers) {
+        running += pool->tryTake(helper) ? 0 : 1;
+    }
+    m_finished.acquire(running);
+    for (QRunnable* helper : m_helpers) {
+        delete helper;
+    }
+    m_helpers.clear();
+}
+
+void Loop::work()
+{
+    ThreadLimit nested(1);
+    for (int i = m_next++; i < m_count; i = m_next++) {
+        m_body(i);
+    }
+}
+
+} // namespace Parallel
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QSemaphore>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+class QRunnable;
+
+/**
+ * @brief Index loops spread over the global thread pool
+ *
+ * The calling thread works on the loop too, so a loop started from a pool
+ * thread cannot starve waiting for helpers queued behind it; helpers that
+ * have not started by the time the work runs out are taken back off the
+ * queue. Bodies run with a thread limit of one, so loops nested inside a
+ * parallel body run serially instead of multiplying threads.
+ *
+ * Each thread may cap the threads its loops use (ThreadLimit); the batch
+ * processor does so for its document workers, which would otherwise each
+ * fan out to every core.
+ */
+namespace Parallel {
+
+// Threads a loop started on this thread may use, the caller included
+int maxThreads();
+
+/**
+ * @brief Caps maxThreads() on the current thread for its lifetime
+ */
+class ThreadLimit
+{
+public:
+    explicit ThreadLimit(int threads);
+    ~ThreadLimit();
+
+    ThreadLimit(const ThreadLimit&) = delete;
+    ThreadLimit& operator=(const ThreadLimit&) = delete;
+
+private:
+    int m_previous;
+};
+
+/**
+ * @brief Runs body(i) for i in [0, count); helpers start at construction
+ *
+ * wait() joins the loop from the calling thread and returns once every
+ * index has run, which lets the caller do other work first.
+ */
+class Loop
+{
+public:
+    Loop(int count, std::function<void(int)> body);
+    ~Loop();
+
+    void wait();
+
+    Loop(const Loop&) = delete;
+    Loop& operator=(const Loop&) = delete;
+
+private:
+    class Helper;
+
+    void work();
+
+    const int m_count;
+    const std::function<void(int)> m_body;
+    std::atomic<int> m_next;
+    std::vector<QRunnable*> m_helpers;
+    QSemaphore m_finished;
+    bool m_waited;
+};
+
+inline void forEach(int count, std::function<void(int)> body)
+{
+    if (count == 1) {
+        body(0);
+    } else if (count > 1) {
+        Loop(count, std::move(body)).wait();
+    }
+}
+
+} // namespace Parallel
@@ -0,0 +1,123 @@
+#include "StartupTimeline.h"
+#include "Tracing.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QTimer>
+#include <vector>
+
+Q_LOGGING_CATEGORY(cadStartup, "cad.startup")
+
+namespace StartupTimeline {
+
+namespace {
+
+struct Phase
+{
+    const char* name;
+    qint64 elapsedNs;
+};
+
+// Startup runs on the GUI thread only, so no locking
+QElapsedTimer s_clock;
+std::vector<Phase> s_phases;
+bool s_firstFrameSeen = false;
+bool s_complete = false;
+
+void finish()
+{
+    mark("interactive");
+    s_complete = true;
+
+    qCInfo(cadStartup).noquote() << report();
+
+    const QString reportPath = qEnvironmentVariable("CAD_STARTUP_REPORT");
+    if (!reportPath.isEmpty()) {
+        QJsonArray phases;
+        for (const Phase& phase : s_phases) {
+            QJsonObject entry;
+            entry["phase"] = QString::fromLatin1(phase.name);
+            entry["ms"] = phase.elapsedNs / 1.0e6;
+            phases.append(entry);
+        }
+        QJsonObject root;
+        root["timeToInteractiveMs"] = elapsedMs();
+        root["phases"] = phases;
+
+        QFile file(reportPath);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            file.write(QJsonDocument(root).toJson());
+        } else {
+            qCWarning(cadStartup) << "Cannot write startup report:" << reportPath;
+        }
+    }
+
+    if (qEnvironmentVariableIntValue("CAD_STARTUP_EXIT") > 0) {
+        QCoreApplication::quit();
+    }
+}
+
+} // namespace
+
+void start()
+{
+    s_clock.start();
+    s_phases.clear();
+    s_firstFrameSeen = false;
+    s_complete = false;
+    mark("processStart");
+}
+
+void mark(const char* phase)
+{
+    if (!s_clock.isValid() || s_complete) {
+        return;
+    }
+    s_phases.push_back(Phase{phase, s_clock.nsecsElapsed()});
+    CAD_TRACE_INSTANT("startup", phase);
+}
+
+void frameRendered()
+{
+    if (s_firstFrameSeen || !s_clock.isValid()) {
+        return;
+    }
+    s_firstFrameSeen = true;
+    mark("firstFrame");
+
+    // Interactive once the events queued behind the first frame are handled
+    QTimer::singleShot(0, QCoreApplication::instance(), &finish);
+}
+
+bool isComplete()
+{
+    return s_complete;
+}
+
+qint64 elapsedMs()
+{
+    if (!s_clock.isValid()) {
+        return 0;
+    }
+    return (s_complete ? s_phases.back().elapsedNs : s_clock.nsecsElapsed()) / 1000000;
+}
+
+QString report()
+{
+    QString text = QString("Startup: %1 ms to first interactive frame").arg(elapsedMs());
+    qint64 previousNs = 0;
+    for (const Phase& phase : s_phases) {
+        text += QString("\n  %1 %2 ms (+%3)")
+                    .arg(QString::fromLatin1(phase.name), -18)
+                    .arg(phase.elapsedNs / 1.0e6, 8, 'f', 1)
+                    .arg((phase.elapsedNs - previousNs) / 1.0e6, 0, 'f', 1);
+        previousNs = phase.elapsedNs;
+    }
+    return text;
+}
+
+} // namespace StartupTimeline
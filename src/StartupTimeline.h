@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief Cold-start timeline from process entry to first interactive frame
+ *
+ * main() starts the clock before the application object exists; phases are
+ * marked as startup proceeds. The first viewport frame completes the
+ * timeline once the event loop has gone idle after it, i.e. when input
+ * would be handled. The summary is logged to cad.startup and, when
+ * CAD_STARTUP_REPORT names a file, written there as JSON. Setting
+ * CAD_STARTUP_EXIT=1 quits right after, for measuring launches from a
+ * dispatcher or script.
+ */
+namespace StartupTimeline {
+
+void start();
+void mark(const char* phase);
+
+// Called by the renderer after every frame; only the first one counts
+void frameRendered();
+
+bool isComplete();
+qint64 elapsedMs();
+QString report();
+
+} // namespace StartupTimeline
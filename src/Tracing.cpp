@@ -0,0 +1,257 @@
+#include "Tracing.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace Tracing {
+
+std::atomic<bool> g_recording(false);
+
+namespace {
+
+struct ThreadRing
+{
+    std::vector<Event> events;
+    std::atomic<quint64> written;   // Total ever written; slot = written % capacity
+    int threadIndex;
+    QString threadName;
+
+    explicit ThreadRing(int capacity) : events(capacity), written(0), threadIndex(0) {}
+};
+
+// Registration happens once per thread; recording never takes this lock
+QMutex s_registryMutex;
+std::vector<std::shared_ptr<ThreadRing>> s_rings;
+std::deque<ThreadRing*> s_retired;      // Rings of exited threads, oldest first
+int s_nextThreadIndex = 1;
+std::atomic<int> s_ringCapacity(1 << 16);
+
+thread_local ThreadRing* t_ring = nullptr;
+
+// Pool threads come and go, so the rings of exited threads are kept for export
+// only up to this many and then handed to new threads
+int retiredRingLimit()
+{
+    return std::max(4, QThread::idealThreadCount());
+}
+
+/**
+ * Retires the ring of the owning thread when that thread exits
+ */
+struct RingOwner
+{
+    ThreadRing* ring = nullptr;
+
+    ~RingOwner()
+    {
+        if (ring) {
+            QMutexLocker locker(&s_registryMutex);
+            s_retired.push_back(ring);
+        }
+        t_ring = nullptr;
+    }
+};
+
+ThreadRing* currentRing()
+{
+    if (t_ring) {
+        return t_ring;
+    }
+
+    QString threadName;
+    QThread* thread = QThread::currentThread();
+    if (thread && !thread->objectName().isEmpty()) {
+        threadName = thread->objectName();
+    } else if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        threadName = "Main";
+    }
+
+    const int capacity = s_ringCapacity.load();
+    QMutexLocker locker(&s_registryMutex);
+    ThreadRing* ring = nullptr;
+    if (static_cast<int>(s_retired.size()) >= retiredRingLimit()) {
+        // The oldest exited thread's events make room for this one
+        ring = s_retired.front();
+        s_retired.pop_front();
+        if (static_cast<int>(ring->events.size()) != capacity) {
+            ring->events.assign(capacity, Event());
+        }
+        ring->written.store(0, std::memory_order_relaxed);
+    } else {
+        s_rings.push_back(std::make_shared<ThreadRing>(capacity));
+        ring = s_rings.back().get();
+    }
+    ring->threadIndex = s_nextThreadIndex++;
+    ring->threadName = threadName.isEmpty() ? QString("Worker %1").arg(ring->threadIndex) : threadName;
+
+    static thread_local RingOwner owner;
+    owner.ring = ring;
+    t_ring = ring;
+    return t_ring;
+}
+
+void appendEscaped(QByteArray& out, const char* text)
+{
+    for (const char* c = text ? text : ""; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out.append('\\');
+        }
+        out.append(*c);
+    }
+}
+
+void appendMicros(QByteArray& out, quint64 ns)
+{
+    out.append(QByteArray::number(ns / 1000));
+    out.append('.');
+    const quint64 fraction = ns % 1000;
+    out.append(fraction < 100 ? (fraction < 10 ? "00" : "0") : "");
+    out.append(QByteArray::number(fraction));
+}
+
+} // namespace
+
+quint64 nowNs()
+{
+    return static_cast<quint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void record(const Event& event)
+{
+    ThreadRing* ring = currentRing();
+    const quint64 index = ring->written.load(std::memory_order_relaxed);
+    ring->events[index % ring->events.size()] = event;
+    ring->written.store(index + 1, std::memory_order_release);
+}
+
+void start()
+{
+    g_recording.store(true, std::memory_order_relaxed);
+}
+
+void stop()
+{
+    g_recording.store(false, std::memory_order_relaxed);
+}
+
+void clear()
+{
+    QMutexLocker locker(&s_registryMutex);
+    for (const auto& ring : s_rings) {
+        ring->written.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool isCompiledIn()
+{
+#ifdef CAD_ENABLE_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+int eventCount()
+{
+    QMutexLocker locker(&s_registryMutex);
+    quint64 count = 0;
+    for (const auto& ring : s_rings) {
+        count += std::min<quint64>(ring->written.load(std::memory_order_acquire), ring->events.size());
+    }
+    return static_cast<int>(count);
+}
+
+void setRingCapacity(int events)
+{
+    s_ringCapacity.store(qMax(1024, events));
+}
+
+bool exportChromeTrace(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    QMutexLocker locker(&s_registryMutex);
+
+    // Timestamps are written relative to the oldest retained event
+    quint64 origin = ~quint64(0);
+    for (const auto& ring : s_rings) {
+        const quint64 written = ring->written.load(std::memory_order_acquire);
+        const quint64 size = ring->events.size();
+        const quint64 first = written > size ? written - size : 0;
+        if (written > first) {
+            origin = std::min(origin, ring->events[first % size].startNs);
+        }
+    }
+    if (origin == ~quint64(0)) {
+        origin = 0;
+    }
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+    QByteArray out;
+    out.reserve(1 << 20);
+    out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool firstEvent = true;
+
+    auto flushIfLarge = [&]() {
+        if (out.size() > (1 << 20) - 4096) {
+            file.write(out);
+            out.clear();
+        }
+    };
+
+    for (const auto& ring : s_rings) {
+        const QByteArray tid = QByteArray::number(ring->threadIndex);
+
+        if (!firstEvent) {
+            out.append(",\n");
+        }
+        firstEvent = false;
+        out.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":").append(pid)
+           .append(",\"tid\":").append(tid)
+           .append(",\"args\":{\"name\":\"").append(ring->threadName.toUtf8()).append("\"}}");
+
+        const quint64 written = ring->written.load(std::memory_order_acquire);
+        const quint64 size = ring->events.size();
+        const quint64 first = written > size ? written - size : 0;
+
+        for (quint64 i = first; i < written; ++i) {
+            const Event& event = ring->events[i % size];
+            out.append(",\n{\"name\":\"");
+            appendEscaped(out, event.name);
+            out.append("\",\"cat\":\"");
+            appendEscaped(out, event.category);
+            out.append("\",\"ph\":\"").append(event.phase).append("\",\"pid\":").append(pid)
+               .append(",\"tid\":").append(tid).append(",\"ts\":");
+            appendMicros(out, event.startNs - std::min(origin, event.startNs));
+
+            if (event.phase == 'X') {
+                out.append(",\"dur\":");
+                appendMicros(out, event.durationNs);
+            } else if (event.phase == 'C') {
+                out.append(",\"args\":{\"value\":").append(QByteArray::number(event.value)).append('}');
+            } else if (event.phase == 'i') {
+                out.append(",\"s\":\"t\"");
+            }
+            out.append('}');
+            flushIfLarge();
+        }
+    }
+
+    out.append("\n]}\n");
+    file.write(out);
+    return true;
+}
+
+} // namespace Tracing
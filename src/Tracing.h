@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * @brief Low-overhead structured tracing
+ *
+ * Spans, instants and counters are written as fixed-size records into a
+ * per-thread ring buffer. Only the owning thread writes its ring, so
+ * recording takes no locks and allocates nothing; names must be string
+ * literals and are stored as pointers, never formatted. Rings of exited
+ * threads stay exportable until a bounded number of them has piled up;
+ * new threads then reuse the oldest, so short-lived pool threads do not
+ * grow memory without bound.
+ *
+ * The CAD_TRACE_* macros compile to nothing unless the build sets
+ * CAD_ENABLE_TRACING. When compiled in, each macro costs one relaxed
+ * atomic load while recording is stopped.
+ *
+ * Export writes Chrome trace-event JSON (chrome://tracing, Perfetto).
+ * Export while recording is stopped; rings are read without
+ * synchronizing with their writers.
+ */
+namespace Tracing {
+
+/**
+ * @brief One ring buffer record
+ */
+struct Event
+{
+    const char* name;
+    const char* category;
+    quint64 startNs;
+    quint64 durationNs;
+    qint64 value;               // Counter value
+    char phase;                 // 'X' span, 'i' instant, 'C' counter
+};
+
+extern std::atomic<bool> g_recording;
+
+inline bool isRecording() { return g_recording.load(std::memory_order_relaxed); }
+
+void start();
+void stop();
+void clear();
+bool exportChromeTrace(const QString& path);
+
+bool isCompiledIn();
+int eventCount();
+
+// Per-thread ring capacity in events; applies to threads that start tracing afterwards
+void setRingCapacity(int events);
+
+quint64 nowNs();
+void record(const Event& event);
+
+/**
+ * @brief Scoped span; records a complete event on destruction
+ */
+class Span
+{
+public:
+    Span(const char* category, const char* name)
+        : m_category(category)
+        , m_name(name)
+        , m_startNs(isRecording() ? nowNs() : 0)
+    {
+    }
+
+    ~Span()
+    {
+        if (m_startNs != 0 && isRecording()) {
+            record(Event{m_name, m_category, m_startNs, nowNs() - m_startNs, 0, 'X'});
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* m_category;
+    const char* m_name;
+    quint64 m_startNs;
+};
+
+inline void counter(const char* category, const char* name, qint64 value)
+{
+    if (isRecording()) {
+        record(Event{name, category, nowNs(), 0, value, 'C'});
+    }
+}
+
+inline void instant(const char* category, const char* name)
+{
+    if (isRecording()) {
+        record(Event{name, category, nowNs(), 0, 0, 'i'});
+    }
+}
+
+} // namespace Tracing
+
+#define CAD_TRACE_CONCAT_INNER(a, b) a##b
+#define CAD_TRACE_CONCAT(a, b) CAD_TRACE_CONCAT_INNER(a, b)
+
+#ifdef CAD_ENABLE_TRACING
+#define CAD_TRACE_SCOPE(category, name) \
+    ::Tracing::Span CAD_TRACE_CONCAT(cadTraceSpan_, __LINE__)(category, name)
+#define CAD_TRACE_COUNTER(category, name, value) ::Tracing::counter(category, name, static_cast<qint64>(value))
+#define CAD_TRACE_INSTANT(category, name) ::Tracing::instant(category, name)
+#else
+#define CAD_TRACE_SCOPE(category, name) do {} while (false)
+#define CAD_TRACE_COUNTER(category, name, value) do {} while (false)
+#define CAD_TRACE_INSTANT(category, name) do {} while (false)
+#endif
@@ -0,0 +1,757 @@
+#include "XrefManager.h"
+#include "BlockManager.h"
+#include "GeometryEngine.h"
+#include "Tracing.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <BRep_Builder.hxx>
+#include <BRep_Tool.hxx>
+#include <BRepBndLib.hxx>
+#include <BRepTools.hxx>
+#include <STEPCAFControl_Controller.hxx>
+#include <STEPCAFControl_Reader.hxx>
+#include <Standard_Failure.hxx>
+#include <TCollection_AsciiString.hxx>
+#include <TColStd_HSequenceOfExtendedString.hxx>
+#include <TDF_LabelSequence.hxx>
+#include <TDF_Tool.hxx>
+#include <TDocStd_Document.hxx>
+#include <TopExp.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Iterator.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <XCAFApp_Application.hxx>
+#include <XCAFDoc_DocumentTool.hxx>
+#include <XCAFDoc_LayerTool.hxx>
+#include <XCAFDoc_ShapeTool.hxx>
+
+Q_LOGGING_CATEGORY(cadXrefs, "cad.xrefs")
+
+namespace {
+
+const QString DefaultLayer = QStringLiteral("0");
+
+// Editors often write a file in several steps; reload once it has settled
+constexpr int ReloadDelayMs = 500;
+
+// Coordinates closer than this produce the same fingerprint
+constexpr double FingerprintQuantum = 1.0e-6;
+
+/**
+ * Process-wide parsed references. Entries are weak: data lives while some
+ * drawing has it attached and is dropped with the last one.
+ */
+class SharedXrefCache
+{
+public:
+    std::shared_ptr<const XrefData> find(const QString& path, const QDateTime& modified)
+    {
+        QMutexLocker locker(&m_mutex);
+        std::shared_ptr<const XrefData> data = m_entries.value(path).lock();
+        return data && data->modified == modified ? data : nullptr;
+    }
+
+    void store(const std::shared_ptr<const XrefData>& data)
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            it = it.value().expired() ? m_entries.erase(it) : std::next(it);
+        }
+        m_entries.insert(data->path, data);
+    }
+
+    int size()
+    {
+        QMutexLocker locker(&m_mutex);
+        int count = 0;
+        for (const auto& entry : m_entries) {
+            count += entry.expired() ? 0 : 1;
+        }
+        return count;
+    }
+
+private:
+    QMutex m_mutex;
+    QHash<QString, std::weak_ptr<const XrefData>> m_entries;
+};
+
+SharedXrefCache& sharedCache()
+{
+    static SharedXrefCache cache;
+    return cache;
+}
+
+inline quint64 mix(quint64 seed, quint64 value)
+{
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+inline quint64 quantize(double value)
+{
+    return static_cast<quint64>(static_cast<qint64>(std::llround(value / FingerprintQuantum)));
+}
+
+QString toQString(const TCollection_ExtendedString& text)
+{
+    return QString::fromUtf16(reinterpret_cast<const char16_t*>(text.ToExtString()), text.Length());
+}
+
+// Compounds are split into their children so clipping works per object
+void addShape(const QString& key, const QString& layer, const TopoDS_Shape& shape, std::vector<XrefEntity>& entities)
+{
+    if (shape.IsNull()) {
+        return;
+    }
+    if (shape.ShapeType() == TopAbs_COMPOUND) {
+        int index = 0;
+        for (TopoDS_Iterator it(shape); it.More(); it.Next(), ++index) {
+            addShape(key + QLatin1Char('#') + QString::number(index), layer, it.Value(), entities);
+        }
+        return;
+    }
+
+    XrefEntity entity;
+    entity.key = key;
+    entity.layer = layer;
+    entity.shape = shape;
+    entity.fingerprint = 0;
+    entities.push_back(std::move(entity));
+}
+
+void collectLabel(const Handle(XCAFDoc_LayerTool)& layerTool, const TDF_Label& label, const TopLoc_Location& location,
+                  const QString& parentKey, const QString& parentLayer, std::vector<XrefEntity>& entities)
+{
+    TCollection_AsciiString entry;
+    TDF_Tool::Entry(label, entry);
+    const QString key = parentKey.isEmpty() ? QString::fromLatin1(entry.ToCString())
+                                            : parentKey + QLatin1Char('/') + QString::fromLatin1(entry.ToCString());
+
+    TDF_Label shapeLabel = label;
+    TopLoc_Location shapeLocation = location;
+    if (XCAFDoc_ShapeTool::IsReference(label)) {
+        XCAFDoc_ShapeTool::GetReferredShape(label, shapeLabel);
+        shapeLocation = location * XCAFDoc_ShapeTool::GetLocation(label);
+    }
+
+    // The nearest layer assignment wins; objects without one inherit their parent's
+    QString layer = parentLayer;
+    for (const TDF_Label& candidate : {label, shapeLabel}) {
+        Handle(TColStd_HSequenceOfExtendedString) layers = layerTool->GetLayers(candidate);
+        if (!layers.IsNull() && layers->Length() > 0) {
+            layer = toQString(layers->Value(1));
+            break;
+        }
+    }
+
+    if (XCAFDoc_ShapeTool::IsAssembly(shapeLabel)) {
+        TDF_LabelSequence components;
+        XCAFDoc_ShapeTool::GetComponents(shapeLabel, components);
+        for (int i = 1; i <= components.Length(); ++i) {
+            collectLabel(layerTool, components.Value(i), shapeLocation, key, layer, entities);
+        }
+        return;
+    }
+
+    addShape(key, layer, XCAFDoc_ShapeTool::GetShape(shapeLabel).Moved(shapeLocation), entities);
+}
+
+// Translator and XCAF registration touch process-wide tables, so it happens
+// once on the GUI thread before any parse runs on the pool
+void initializeReaders()
+{
+    static const bool initialized = []() {
+        STEPCAFControl_Controller::Init();
+        XCAFApp_Application::GetApplication();
+        return true;
+    }();
+    Q_UNUSED(initialized);
+}
+
+bool readStep(const QString& path, std::vector<XrefEntity>& entities, QString* error)
+{
+    Handle(TDocStd_Document) document = new TDocStd_Document("MDTV-XCAF");
+    XCAFApp_Application::GetApplication()->InitDocument(document);
+
+    STEPCAFControl_Reader reader;
+    reader.SetLayerMode(true);
+    if (reader.ReadFile(path.toStdString().c_str()) != IFSelect_RetDone || !reader.Transfer(document)) {
+        *error = QStringLiteral("Failed to read STEP file");
+        return false;
+    }
+
+    Handle(XCAFDoc_ShapeTool) shapeTool = XCAFDoc_DocumentTool::ShapeTool(document->Main());
+    Handle(XCAFDoc_LayerTool) layerTool = XCAFDoc_DocumentTool::LayerTool(document->Main());
+    TDF_LabelSequence roots;
+    shapeTool->GetFreeShapes(roots);
+    for (int i = 1; i <= roots.Length(); ++i) {
+        collectLabel(layerTool, roots.Value(i), TopLoc_Location(), QString(), DefaultLayer, entities);
+    }
+    return true;
+}
+
+bool readBrep(const QString& path, std::vector<XrefEntity>& entities, QString* error)
+{
+    BRep_Builder builder;
+    TopoDS_Shape shape;
+    if (!BRepTools::Read(shape, path.toStdString().c_str(), builder)) {
+        *error = QStringLiteral("Failed to read BREP file");
+        return false;
+    }
+    addShape(QStringLiteral("0"), DefaultLayer, shape, entities);
+    return true;
+}
+
+// Bounds for clipping, and a geometry fingerprint for reload diffs
+void measure(XrefEntity& entity)
+{
+    BRepBndLib::Add(entity.shape, entity.bounds);
+
+    quint64 fingerprint = mix(qHash(entity.layer), entity.shape.ShapeType());
+    TopTools_IndexedMapOfShape vertices;
+    TopExp::MapShapes(entity.shape, TopAbs_VERTEX, vertices);
+    fingerprint = mix(fingerprint, vertices.Extent());
+    for (int i = 1; i <= vertices.Extent(); ++i) {
+        const gp_Pnt point = BRep_Tool::Pnt(TopoDS::Vertex(vertices(i)));
+        fingerprint = mix(fingerprint, quantize(point.X()));
+        fingerprint = mix(fingerprint, quantize(point.Y()));
+        fingerprint = mix(fingerprint, quantize(point.Z()));
+    }
+
+    // Bounds also move when curved geometry changes between fixed vertices
+    if (!entity.bounds.IsVoid()) {
+        double xmin, ymin, zmin, xmax, ymax, zmax;
+        entity.bounds.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+        for (double value : {xmin, ymin, zmin, xmax, ymax, zmax}) {
+            fingerprint = mix(fingerprint, quantize(value));
+        }
+    }
+    entity.fingerprint = fingerprint;
+}
+
+CADEntity::Type entityTypeForShape(const TopoDS_Shape& shape)
+{
+    switch (shape.ShapeType()) {
+    case TopAbs_VERTEX: return CADEntity::Point;
+    case TopAbs_EDGE: return CADEntity::Line;
+    case TopAbs_WIRE: return CADEntity::Polyline;
+    case TopAbs_FACE:
+    case TopAbs_SHELL: return CADEntity::Surface;
+    default: return CADEntity::Solid;
+    }
+}
+
+CADEntity makeEntity(const QString& xrefName, const XrefEntity& source, const XrefOptions& options)
+{
+    CADEntity entity;
+    entity.type = entityTypeForShape(source.shape);
+    entity.shape = options.transform.Form() == gp_Identity ? source.shape
+                                                          : BlockManager::placedShape(source.shape, options.transform);
+    entity.layer = xrefName + QLatin1Char('|') + source.layer;
+    entity.properties[QStringLiteral("xref")] = xrefName;
+    entity.properties[QStringLiteral("xrefKey")] = source.key;
+    return entity;
+}
+
+} // namespace
+
+XrefManager::XrefManager(QObject *parent)
+    : QObject(parent)
+    , m_geometryEngine(nullptr)
+    , m_autoReload(true)
+{
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(ReloadDelayMs);
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &XrefManager::onFileChanged);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &XrefManager::onReloadTimer);
+}
+
+XrefManager::~XrefManager()
+{
+    for (auto& entry : m_xrefs) {
+        if (entry.second.cancel) {
+            *entry.second.cancel = true;
+        }
+    }
+}
+
+void XrefManager::setGeometryEngine(GeometryEngine* engine)
+{
+    m_geometryEngine = engine;
+}
+
+// Attachments
+bool XrefManager::attachXref(const QString& name, const QString& path, const XrefOptions& options)
+{
+    if (name.isEmpty() || name.contains(QLatin1Char('|')) || hasXref(name)) {
+        qCWarning(cadXrefs) << "Invalid or duplicate xref name:" << name;
+        return false;
+    }
+
+    QFileInfo info(path);
+    if (!info.exists()) {
+        qCWarning(cadXrefs) << "Xref file not found:" << path;
+        return false;
+    }
+
+    Xref& xref = m_xrefs[name];
+    xref.name = name;
+    xref.path = info.canonicalFilePath();
+    xref.options = options;
+    if (!m_watcher.files().contains(xref.path)) {
+        m_watcher.addPath(xref.path);
+    }
+
+    emit xrefAttached(name);
+    startLoad(xref);
+    return true;
+}
+
+bool XrefManager::detachXref(const QString& name)
+{
+    auto it = m_xrefs.find(name);
+    if (it == m_xrefs.end()) {
+        return false;
+    }
+
+    Xref& xref = it->second;
+    if (xref.cancel) {
+        *xref.cancel = true;
+    }
+    removeEntities(xref);
+    const QString path = xref.path;
+    m_xrefs.erase(it);
+    unwatch(path);
+
+    emit xrefDetached(name);
+    return true;
+}
+
+bool XrefManager::reloadXref(const QString& name)
+{
+    Xref* xref = findXref(name);
+    if (!xref) {
+        return false;
+    }
+    startLoad(*xref);
+    return true;
+}
+
+void XrefManager::clear()
+{
+    for (auto& entry : m_xrefs) {
+        if (entry.second.cancel) {
+            *entry.second.cancel = true;
+        }
+        removeEntities(entry.second);
+    }
+    m_xrefs.clear();
+    m_changedPaths.clear();
+    m_reloadTimer.stop();
+    if (!m_watcher.files().isEmpty()) {
+        m_watcher.removePaths(m_watcher.files());
+    }
+}
+
+// Partial loading
+bool XrefManager::setClipRegion(const QString& name, const Bnd_Box& region)
+{
+    Xref* xref = findXref(name);
+    if (!xref) {
+        return false;
+    }
+    xref->options.clipRegion = region;
+    if (xref->data) {
+        apply(*xref, xref->data, false);
+    }
+    return true;
+}
+
+bool XrefManager::setLayerFilter(const QString& name, const QStringList& layerPatterns)
+{
+    Xref* xref = findXref(name);
+    if (!xref) {
+        return false;
+    }
+    xref->options.layerPatterns = layerPatterns;
+    if (xref->data) {
+        apply(*xref, xref->data, false);
+    }
+    return true;
+}
+
+bool XrefManager::setTransform(const QString& name, const gp_Trsf& transform)
+{
+    Xref* xref = findXref(name);
+    if (!xref) {
+        return false;
+    }
+    xref->options.transform = transform;
+    if (xref->data) {
+        apply(*xref, xref->data, true);
+    }
+    return true;
+}
+
+void XrefManager::setAutoReload(bool enabled)
+{
+    m_autoReload = enabled;
+    if (!enabled) {
+        m_changedPaths.clear();
+        m_reloadTimer.stop();
+    }
+}
+
+// Queries
+QStringList XrefManager::getXrefNames() const
+{
+    QStringList names;
+    for (const auto& entry : m_xrefs) {
+        names.append(entry.first);
+    }
+    return names;
+}
+
+bool XrefManager::hasXref(const QString& name) const
+{
+    return m_xrefs.count(name) != 0;
+}
+
+QString XrefManager::getXrefPath(const QString& name) const
+{
+    const Xref* xref = findXref(name);
+    return xref ? xref->path : QString();
+}
+
+XrefManager::Status XrefManager::getXrefStatus(const QString& name) const
+{
+    const Xref* xref = findXref(name);
+    return xref ? xref->status : Unloaded;
+}
+
+XrefOptions XrefManager::getXrefOptions(const QString& name) const
+{
+    const Xref* xref = findXref(name);
+    return xref ? xref->options : XrefOptions();
+}
+
+QStringList XrefManager::getXrefLayers(const QString& name) const
+{
+    const Xref* xref = findXref(name);
+    return xref && xref->data ? xref->data->layers : QStringList();
+}
+
+int XrefManager::getLoadedEntityCount(const QString& name) const
+{
+    const Xref* xref = findXref(name);
+    return xref ? xref->entityIds.size() : 0;
+}
+
+int XrefManager::getTotalEntityCount(const QString& name) const
+{
+    const Xref* xref = findXref(name);
+    return xref && xref->data ? static_cast<int>(xref->data->entities.size()) : 0;
+}
+
+bool XrefManager::isLoading() const
+{
+    for (const auto& entry : m_xrefs) {
+        if (entry.second.status == Loading) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int XrefManager::cachedReferenceCount()
+{
+    return sharedCache().size();
+}
+
+// Loading
+void XrefManager::startLoad(Xref& xref)
+{
+    if (xref.cancel) {
+        *xref.cancel = true;
+    }
+    auto cancel = std::make_shared<std::atomic<bool>>(false);
+    xref.cancel = cancel;
+
+    QFileInfo info(xref.path);
+    if (!info.exists()) {
+        xref.status = NotFound;
+        emit xrefLoadFailed(xref.name, QStringLiteral("File not found"));
+        return;
+    }
+
+    // Another drawing may already hold this revision
+    if (std::shared_ptr<const XrefData> cached = sharedCache().find(xref.path, info.lastModified())) {
+        qCDebug(cadXrefs) << "Xref" << xref.name << "served from cache";
+        finishLoad(xref.name, cancel, std::move(cached), QString());
+        return;
+    }
+
+    initializeReaders();
+    xref.status = Loading;
+    const QString name = xref.name;
+    const QString path = xref.path;
+    QPointer<XrefManager> guard(this);
+    QThreadPool::globalInstance()->start([guard, name, path, cancel]() {
+        auto progress = [guard, name, cancel](int completed, int total) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, name, cancel, completed, total]() {
+                if (guard && !cancel->load()) {
+                    emit guard->xrefLoadProgress(name, completed, total);
+                }
+            }, Qt::QueuedConnection);
+        };
+
+        QString error;
+        std::shared_ptr<const XrefData> data = parse(path, *cancel, progress, &error);
+        if (cancel->load()) {
+            return;
+        }
+        if (data) {
+            sharedCache().store(data);
+        }
+
+        // Entities are only created on the GUI thread
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, name, cancel, data, error]() {
+            if (guard) {
+                guard->finishLoad(name, cancel, data, error);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void XrefManager::finishLoad(const QString& name, const std::shared_ptr<std::atomic<bool>>& cancel,
+                             std::shared_ptr<const XrefData> data, const QString& error)
+{
+    Xref* xref = findXref(name);
+    if (!xref || xref->cancel != cancel || cancel->load()) {
+        return;     // Detached or superseded by a newer load
+    }
+
+    if (!data) {
+        xref->status = Failed;
+        qCWarning(cadXrefs) << "Failed to load xref" << name << ":" << error;
+        emit xrefLoadFailed(name, error);
+        return;
+    }
+
+    const bool reload = xref->data != nullptr;
+    const ApplyResult result = apply(*xref, std::move(data), false);
+    xref->status = Loaded;
+
+    if (reload) {
+        emit xrefReloaded(name, result.added, result.modified, result.removed);
+    } else {
+        emit xrefLoaded(name);
+    }
+}
+
+std::shared_ptr<XrefData> XrefManager::parse(const QString& path, const std::atomic<bool>& cancel,
+                                             const std::function<void(int, int)>& progress, QString* error)
+{
+    CAD_TRACE_SCOPE("xrefs", "parseXref");
+
+    auto data = std::make_shared<XrefData>();
+    data->path = path;
+    data->modified = QFileInfo(path).lastModified();
+
+    // Reading the file has no progress of its own; report it as indeterminate
+    progress(0, 0);
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    try {
+        bool read = false;
+        if (suffix == QLatin1String("step") || suffix == QLatin1String("stp")) {
+            read = readStep(path, data->entities, error);
+        } else if (suffix == QLatin1String("brep") || suffix == QLatin1String("brp")) {
+            read = readBrep(path, data->entities, error);
+        } else {
+            *error = QStringLiteral("Unsupported reference format: %1").arg(suffix);
+        }
+        if (!read) {
+            return nullptr;
+        }
+    } catch (const Standard_Failure& failure) {
+        *error = QString::fromLatin1(failure.GetMessageString());
+        return nullptr;
+    }
+
+    const int total = static_cast<int>(data->entities.size());
+    const int step = std::max(1, total / 100);
+    QSet<QString> layers;
+    for (int i = 0; i < total; ++i) {
+        if (cancel.load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        XrefEntity& entity = data->entities[i];
+        measure(entity);
+        if (!layers.contains(entity.layer)) {
+            layers.insert(entity.layer);
+            data->layers.append(entity.layer);
+        }
+        if ((i + 1) % step == 0) {
+            progress(i + 1, total);
+        }
+    }
+    progress(total, total);
+
+    qCDebug(cadXrefs) << "Parsed" << path << ":" << total << "entities on" << data->layers.size() << "layers";
+    return data;
+}
+
+XrefManager::ApplyResult XrefManager::apply(Xref& xref, std::shared_ptr<const XrefData> data, bool replaceAll)
+{
+    CAD_TRACE_SCOPE("xrefs", "applyXref");
+
+    ApplyResult result;
+    if (!m_geometryEngine) {
+        xref.data = std::move(data);
+        return result;
+    }
+
+    // Fingerprints of the loaded objects, to tell changed ones from unchanged
+    QHash<QString, quint64> previous;
+    if (xref.data && !replaceAll) {
+        previous.reserve(xref.entityIds.size());
+        for (const XrefEntity& entity : xref.data->entities) {
+            if (xref.entityIds.contains(entity.key)) {
+                previous.insert(entity.key, entity.fingerprint);
+            }
+        }
+    }
+
+    std::vector<QRegularExpression> patterns;
+    for (const QString& pattern : xref.options.layerPatterns) {
+        patterns.emplace_back(QRegularExpression::wildcardToRegularExpression(pattern),
+                              QRegularExpression::CaseInsensitiveOption);
+    }
+    QHash<QString, bool> layerIncluded;
+    auto includesLayer = [&patterns, &layerIncluded](const QString& layer) {
+        auto it = layerIncluded.constFind(layer);
+        if (it != layerIncluded.constEnd()) {
+            return it.value();
+        }
+        bool included = patterns.empty();
+        for (const QRegularExpression& pattern : patterns) {
+            included = included || pattern.match(layer).hasMatch();
+        }
+        layerIncluded.insert(layer, included);
+        return included;
+    };
+    const Bnd_Box& clip = xref.options.clipRegion;
+
+    QHash<QString, int> loaded;
+    loaded.reserve(xref.entityIds.size());
+    m_geometryEngine->beginDeferredDisplay();
+    for (const XrefEntity& source : data->entities) {
+        if ((!clip.IsVoid() && clip.IsOut(source.bounds)) || !includesLayer(source.layer)) {
+            continue;
+        }
+
+        auto existing = xref.entityIds.find(source.key);
+        if (existing != xref.entityIds.end()) {
+            const int entityId = existing.value();
+            xref.entityIds.erase(existing);
+            if (replaceAll || previous.value(source.key) != source.fingerprint) {
+                m_geometryEngine->updateEntity(entityId, makeEntity(xref.name, source, xref.options));
+                ++result.modified;
+            }
+            loaded.insert(source.key, entityId);
+        } else {
+            const int entityId = m_geometryEngine->addEntity(makeEntity(xref.name, source, xref.options));
+            if (entityId >= 0) {
+                loaded.insert(source.key, entityId);
+                ++result.added;
+            }
+        }
+    }
+
+    // Whatever is left was deleted from the file or is now filtered out
+    for (int entityId : std::as_const(xref.entityIds)) {
+        m_geometryEngine->removeEntity(entityId);
+        ++result.removed;
+    }
+    m_geometryEngine->endDeferredDisplay();
+
+    xref.entityIds = std::move(loaded);
+    xref.data = std::move(data);
+
+    qCDebug(cadXrefs) << "Xref" << xref.name << "applied:" << result.added << "added," << result.modified
+                      << "modified," << result.removed << "removed," << xref.entityIds.size() << "loaded";
+    return result;
+}
+
+void XrefManager::removeEntities(Xref& xref)
+{
+    if (!m_geometryEngine || xref.entityIds.isEmpty()) {
+        xref.entityIds.clear();
+        return;
+    }
+    m_geometryEngine->beginDeferredDisplay();
+    for (int entityId : std::as_const(xref.entityIds)) {
+        m_geometryEngine->removeEntity(entityId);
+    }
+    m_geometryEngine->endDeferredDisplay();
+    xref.entityIds.clear();
+}
+
+void XrefManager::unwatch(const QString& path)
+{
+    for (const auto& entry : m_xrefs) {
+        if (entry.second.path == path) {
+            return;
+        }
+    }
+    m_watcher.removePath(path);
+}
+
+XrefManager::Xref* XrefManager::findXref(const QString& name)
+{
+    auto it = m_xrefs.find(name);
+    return it != m_xrefs.end() ? &it->second : nullptr;
+}
+
+const XrefManager::Xref* XrefManager::findXref(const QString& name) const
+{
+    auto it = m_xrefs.find(name);
+    return it != m_xrefs.end() ? &it->second : nullptr;
+}
+
+// File watching
+void XrefManager::onFileChanged(const QString& path)
+{
+    if (!m_autoReload) {
+        return;
+    }
+    m_changedPaths.insert(path);
+    m_reloadTimer.start();
+}
+
+void XrefManager::onReloadTimer()
+{
+    const QSet<QString> paths = std::exchange(m_changedPaths, QSet<QString>());
+    for (const QString& path : paths) {
+        // Files replaced on save drop out of the watcher
+        if (QFileInfo::exists(path) && !m_watcher.files().contains(path)) {
+            m_watcher.addPath(path);
+        }
+        for (auto& entry : m_xrefs) {
+            if (entry.second.path == path) {
+                qCDebug(cadXrefs) << "Reloading changed xref" << entry.first;
+                startLoad(entry.second);
+            }
+        }
+    }
+}
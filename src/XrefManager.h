@@ -0,0 +1,174 @@
+#pragma once
+
+#include <QObject>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <TopoDS_Shape.hxx>
+#include <Bnd_Box.hxx>
+#include <gp_Trsf.hxx>
+
+Q_DECLARE_LOGGING_CATEGORY(cadXrefs)
+
+class GeometryEngine;
+
+/**
+ * @brief One object of a reference file, in reference coordinates
+ */
+struct XrefEntity
+{
+    QString key;                // Stable across reloads while the object exists
+    QString layer;
+    TopoDS_Shape shape;
+    Bnd_Box bounds;
+    quint64 fingerprint;        // Changes when the object's geometry or layer changes
+};
+
+/**
+ * @brief Parsed contents of a reference file
+ *
+ * Immutable once loaded and shared, through the process-wide xref cache, by
+ * every drawing that attaches the same file revision.
+ */
+struct XrefData
+{
+    QString path;
+    QDateTime modified;
+    std::vector<XrefEntity> entities;
+    QStringList layers;
+};
+
+/**
+ * @brief Which part of a reference is brought into the drawing
+ */
+struct XrefOptions
+{
+    gp_Trsf transform;          // Reference space -> drawing space
+    Bnd_Box clipRegion;         // In reference space; void loads everything
+    QStringList layerPatterns;  // Wildcards on reference layer names; empty loads all layers
+};
+
+/**
+ * @brief External references attached to the drawing
+ *
+ * Files are parsed on the global thread pool and only the resulting entities
+ * are added on the GUI thread, in one deferred batch. Parsed data is kept in
+ * a process-wide cache keyed by canonical path and modification time, so a
+ * reference attached by several drawings is read and held once.
+ *
+ * Partial loading: entities whose bounds miss the clip region, or whose
+ * layer matches none of the layer patterns, are not added. Changing either
+ * re-filters the cached data without reading the file again.
+ *
+ * Attached files are watched; after a change settles the file is re-parsed
+ * in the background and the drawing is patched by entity key: only added,
+ * removed and changed objects touch the geometry engine.
+ *
+ * Entities are placed on "xref|layer" and carry "xref" and "xrefKey"
+ * properties.
+ */
+class XrefManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Status {
+        Unloaded,
+        Loading,
+        Loaded,
+        NotFound,
+        Failed
+    };
+
+    explicit XrefManager(QObject *parent = nullptr);
+    ~XrefManager();
+
+    void setGeometryEngine(GeometryEngine* engine);
+
+    // Attachments; loading completes asynchronously
+    bool attachXref(const QString& name, const QString& path, const XrefOptions& options = XrefOptions());
+    bool detachXref(const QString& name);
+    bool reloadXref(const QString& name);
+    void clear();
+
+    // Partial loading
+    bool setClipRegion(const QString& name, const Bnd_Box& region);
+    bool setLayerFilter(const QString& name, const QStringList& layerPatterns);
+    bool setTransform(const QString& name, const gp_Trsf& transform);
+
+    void setAutoReload(bool enabled);
+    bool isAutoReload() const { return m_autoReload; }
+
+    // Queries
+    QStringList getXrefNames() const;
+    bool hasXref(const QString& name) const;
+    QString getXrefPath(const QString& name) const;
+    Status getXrefStatus(const QString& name) const;
+    XrefOptions getXrefOptions(const QString& name) const;
+    QStringList getXrefLayers(const QString& name) const;
+    int getLoadedEntityCount(const QString& name) const;
+    int getTotalEntityCount(const QString& name) const;
+    bool isLoading() const;
+
+    // References currently held by the process-wide cache
+    static int cachedReferenceCount();
+
+signals:
+    void xrefAttached(const QString& name);
+    void xrefDetached(const QString& name);
+    void xrefLoadProgress(const QString& name, int completed, int total);
+    void xrefLoaded(const QString& name);
+    void xrefReloaded(const QString& name, int added, int modified, int removed);
+    void xrefLoadFailed(const QString& name, const QString& error);
+
+private slots:
+    void onFileChanged(const QString& path);
+    void onReloadTimer();
+
+private:
+    struct Xref {
+        QString name;
+        QString path;
+        XrefOptions options;
+        Status status = Unloaded;
+        std::shared_ptr<const XrefData> data;
+        QHash<QString, int> entityIds;      // Entity key -> engine id, for loaded entities
+        std::shared_ptr<std::atomic<bool>> cancel;
+    };
+
+    struct ApplyResult {
+        int added = 0;
+        int modified = 0;
+        int removed = 0;
+    };
+
+    Xref* findXref(const QString& name);
+    const Xref* findXref(const QString& name) const;
+    void startLoad(Xref& xref);
+    void finishLoad(const QString& name, const std::shared_ptr<std::atomic<bool>>& cancel,
+                    std::shared_ptr<const XrefData> data, const QString& error);
+    ApplyResult apply(Xref& xref, std::shared_ptr<const XrefData> data, bool replaceAll);
+    void removeEntities(Xref& xref);
+    void unwatch(const QString& path);
+
+    static std::shared_ptr<XrefData> parse(const QString& path, const std::atomic<bool>& cancel,
+                                           const std::function<void(int, int)>& progress, QString* error);
+
+    GeometryEngine* m_geometryEngine;
+    std::map<QString, Xref> m_xrefs;
+
+    bool m_autoReload;
+    QFileSystemWatcher m_watcher;
+    QTimer m_reloadTimer;
+    QSet<QString> m_changedPaths;
+};
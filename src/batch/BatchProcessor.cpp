@@ -0,0 +1,194 @@
+#include "BatchProcessor.h"
+#include "Parallel.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <vector>
+
+#include <IGESControl_Controller.hxx>
+#include <STEPControl_Controller.hxx>
+
+BatchProcessor::BatchProcessor(QObject* parent)
+    : QObject(parent)
+    , m_maxConcurrent(qMax(1, QThread::idealThreadCount()))
+    , m_memoryBudget(0)
+    , m_expansionFactor(10.0)
+    , m_defaultFormat("step")
+    , m_stopOnError(false)
+    , m_cancelled(false)
+    , m_memoryInUse(0)
+{
+}
+
+BatchProcessor::~BatchProcessor() = default;
+
+void BatchProcessor::setMaxConcurrentDocuments(int count)
+{
+    m_maxConcurrent = qMax(1, count);
+}
+
+QList<BatchJobResult> BatchProcessor::process(const QList<BatchJob>& jobs)
+{
+    const int total = jobs.size();
+    std::vector<BatchJobResult> results(total);
+    std::vector<char> started(total, 0);
+    if (total == 0) {
+        return {};
+    }
+
+    // Translator registration touches process-wide tables; do it once up front
+    initializeTranslators();
+
+    m_cancelled = false;
+    m_memoryInUse = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::atomic<int> nextJob(0);
+    std::atomic<int> finished(0);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMin(m_maxConcurrent, total));
+
+    // One task per thread pulling jobs; runners are never shared between jobs.
+    // Loops inside a document share the cores with the other documents
+    const int workers = pool.maxThreadCount();
+    const int threadsPerDocument = std::max(1, QThread::idealThreadCount() / workers);
+    for (int w = 0; w < workers; ++w) {
+        pool.start([&]() {
+            Parallel::ThreadLimit limit(threadsPerDocument);
+            for (int index = nextJob++; index < total; index = nextJob++) {
+                if (m_cancelled) {
+                    break;
+                }
+                started[index] = 1;
+                results[index] = runIsolated(jobs[index]);
+                if (m_stopOnError && !results[index].success) {
+                    m_cancelled = true;
+                    m_memoryAvailable.wakeAll();
+                }
+                ++finished;
+            }
+        });
+    }
+
+    // Report progress from the calling thread so slots run where they were connected
+    int reported = -1;
+    while (!pool.waitForDone(50)) {
+        const int done = finished.load();
+        if (done != reported) {
+            reported = done;
+            emit progressChanged(done, total);
+        }
+    }
+
+    QList<BatchJobResult> ordered;
+    ordered.reserve(total);
+    for (int i = 0; i < total; ++i) {
+        if (!started[i]) {
+            qCWarning(cadBatch) << "Skipped after failed job:"
+                                << (jobs[i].inputPath.isEmpty() ? jobs[i].scriptPath : jobs[i].inputPath);
+            continue;
+        }
+        ordered.append(results[i]);
+        emit jobFinished(results[i]);
+    }
+    emit progressChanged(finished.load(), total);
+
+    qCDebug(cadBatch) << "Processed" << ordered.size() << "of" << total << "documents on" << workers
+                      << "workers in" << timer.elapsed() << "ms";
+    return ordered;
+}
+
+BatchJobResult BatchProcessor::runIsolated(const BatchJob& job)
+{
+    const qint64 footprint = estimateFootprint(job);
+    acquireMemory(footprint);
+
+    BatchJobResult result;
+    if (m_cancelled) {
+        result.inputPath = job.inputPath;
+        result.scriptPath = job.scriptPath;
+        result.outputPath = job.outputPath;
+        result.error = "Cancelled";
+    } else {
+        // Engine lives and dies on this worker thread
+        BatchRunner runner;
+        runner.setDefaultFormat(m_defaultFormat);
+        runner.setPlotSettings(m_plotSettings);
+        if (runner.initialize()) {
+            result = runner.run(job);
+        } else {
+            result.inputPath = job.inputPath;
+            result.scriptPath = job.scriptPath;
+            result.outputPath = job.outputPath;
+            result.error = "Failed to initialize headless engine";
+        }
+    }
+
+    releaseMemory(footprint);
+    return result;
+}
+
+qint64 BatchProcessor::estimateFootprint(const BatchJob& job) const
+{
+    if (m_memoryBudget <= 0 || job.inputPath.isEmpty()) {
+        return 0;
+    }
+
+    // An oversized document still runs, but only once nothing else is open
+    const qint64 estimate = static_cast<qint64>(QFileInfo(job.inputPath).size() * m_expansionFactor);
+    return std::min(estimate, m_memoryBudget);
+}
+
+void BatchProcessor::acquireMemory(qint64 bytes)
+{
+    if (bytes <= 0) {
+        return;
+    }
+
+    QMutexLocker locker(&m_memoryMutex);
+    while (m_memoryInUse > 0 && m_memoryInUse + bytes > m_memoryBudget && !m_cancelled) {
+        m_memoryAvailable.wait(&m_memoryMutex);
+    }
+    m_memoryInUse += bytes;
+}
+
+void BatchProcessor::releaseMemory(qint64 bytes)
+{
+    if (bytes <= 0) {
+        return;
+    }
+
+    QMutexLocker locker(&m_memoryMutex);
+    m_memoryInUse -= bytes;
+    m_memoryAvailable.wakeAll();
+}
+
+void BatchProcessor::initializeTranslators()
+{
+    STEPControl_Controller::Init();
+    IGESControl_Controller::Init();
+}
+
+QString BatchProcessor::loadMacro(const QString& name, QString* error)
+{
+    const QString macroDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/macros";
+    const QString path = QDir(macroDir).filePath(name + ".scr");
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) {
+            *error = QString("Macro not found: %1").arg(name);
+        }
+        return QString();
+    }
+    return QString::fromUtf8(file.readAll());
+}
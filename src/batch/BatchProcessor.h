@@ -0,0 +1,87 @@
+#pragma once
+
+#include "BatchRunner.h"
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+
+/**
+ * @brief Processes many documents in parallel, one isolated engine each
+ *
+ * Every job gets its own headless BatchRunner (GeometryEngine, LayerManager
+ * and CommandManager) created and destroyed on the worker thread that runs
+ * it, so documents never share entities, undo history or command state.
+ *
+ * Peak memory is capped two ways:
+ * - At most maxConcurrentDocuments documents are open at once
+ * - With a memory budget set, a document is only opened when its estimated
+ *   footprint (input size times the expansion factor) fits next to the
+ *   documents already open; an oversized document runs alone
+ *
+ * Parallel loops inside a document (DXF, plotting) run on the global pool
+ * with a thread cap of idealThreadCount / workers, so concurrent documents
+ * do not each fan out to every core.
+ *
+ * Results come back in job order whatever order the jobs finish in.
+ */
+class BatchProcessor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchProcessor(QObject* parent = nullptr);
+    ~BatchProcessor();
+
+    QList<BatchJobResult> process(const QList<BatchJob>& jobs);
+
+    // Concurrency
+    void setMaxConcurrentDocuments(int count);
+    int maxConcurrentDocuments() const { return m_maxConcurrent; }
+
+    // Memory cap; 0 disables the budget and only the document count applies
+    void setMemoryBudget(qint64 bytes) { m_memoryBudget = bytes; }
+    qint64 memoryBudget() const { return m_memoryBudget; }
+    void setExpansionFactor(double factor) { m_expansionFactor = factor; }
+    double expansionFactor() const { return m_expansionFactor; }
+
+    // Options applied to every runner
+    void setDefaultFormat(const QString& format) { m_defaultFormat = format.toLower(); }
+    QString defaultFormat() const { return m_defaultFormat; }
+    void setPlotSettings(const PlotSettings& settings) { m_plotSettings = settings; }
+    const PlotSettings& plotSettings() const { return m_plotSettings; }
+
+    // Jobs not yet started are skipped after the first failure
+    void setStopOnError(bool stop) { m_stopOnError = stop; }
+    bool stopOnError() const { return m_stopOnError; }
+
+    // Resolves a macro name to the script text stored by the macro recorder
+    static QString loadMacro(const QString& name, QString* error = nullptr);
+
+signals:
+    void progressChanged(int finished, int total);
+    void jobFinished(const BatchJobResult& result);
+
+private:
+    BatchJobResult runIsolated(const BatchJob& job);
+    qint64 estimateFootprint(const BatchJob& job) const;
+    void acquireMemory(qint64 bytes);
+    void releaseMemory(qint64 bytes);
+    static void initializeTranslators();
+
+    int m_maxConcurrent;
+    qint64 m_memoryBudget;
+    double m_expansionFactor;
+    QString m_defaultFormat;
+    bool m_stopOnError;
+    PlotSettings m_plotSettings;
+
+    std::atomic<bool> m_cancelled;
+
+    // Memory admission
+    QMutex m_memoryMutex;
+    QWaitCondition m_memoryAvailable;
+    qint64 m_memoryInUse;
+};
@@ -0,0 +1,309 @@
+#include "BatchRunner.h"
+#include "GeometryEngine.h"
+#include "LayerManager.h"
+#include "BlockManager.h"
+#include "DxfReader.h"
+#include "DxfWriter.h"
+#include "CommandManager.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+Q_LOGGING_CATEGORY(cadBatch, "cad.batch")
+
+BatchRunner::BatchRunner(QObject* parent)
+    : QObject(parent)
+    , m_defaultFormat("step")
+    , m_stopOnError(false)
+{
+}
+
+BatchRunner::~BatchRunner()
+{
+    // Command history may reference entities, drop it before the engine
+    m_commandManager.reset();
+    m_blockManager.reset();
+    m_layerManager.reset();
+    m_geometryEngine.reset();
+}
+
+bool BatchRunner::initialize()
+{
+    m_geometryEngine = std::make_unique<GeometryEngine>();
+    m_geometryEngine->setHeadless(true);
+    if (!m_geometryEngine->initialize()) {
+        qCCritical(cadBatch) << "Failed to initialize headless geometry engine";
+        return false;
+    }
+
+    m_layerManager = std::make_unique<LayerManager>();
+    m_layerManager->setGeometryEngine(m_geometryEngine.get());
+    m_blockManager = std::make_unique<BlockManager>();
+    m_blockManager->setGeometryEngine(m_geometryEngine.get());
+
+    m_commandManager = std::make_unique<CommandManager>();
+    m_commandManager->setGeometryEngine(m_geometryEngine.get());
+    m_commandManager->setCommandEcho(false);
+
+    // Batch jobs are never undone; keep only what grouping needs
+    m_commandManager->setUndoLimit(1);
+
+    qCDebug(cadBatch) << "Headless batch runner initialized";
+    return true;
+}
+
+BatchJobResult BatchRunner::run(const BatchJob& job)
+{
+    BatchJobResult result;
+    result.inputPath = job.inputPath;
+    result.scriptPath = job.scriptPath;
+    result.outputPath = job.outputPath;
+
+    if (!m_commandManager) {
+        result.error = "Batch runner not initialized";
+        return result;
+    }
+
+    emit jobStarted(job.inputPath.isEmpty() ? job.scriptPath : job.inputPath);
+    resetDocument();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!job.inputPath.isEmpty()) {
+        QString error;
+        bool loaded = importDocument(job.inputPath, error);
+        result.loadTimeMs = timer.elapsed();
+        if (!loaded) {
+            result.error = error;
+            emit jobFinished(result);
+            return result;
+        }
+        timer.restart();
+    }
+
+    // Display stays deferred for the whole job; a headless engine never builds presentations
+    m_geometryEngine->beginDeferredDisplay();
+    bool scriptOk = job.scriptText.isEmpty() ? m_commandManager->executeScript(job.scriptPath)
+                                             : m_commandManager->executeScriptText(job.scriptText);
+    m_geometryEngine->endDeferredDisplay();
+
+    result.scriptTimeMs = timer.elapsed();
+
+    const ScriptRunStats& stats = m_commandManager->lastScriptStats();
+    const int commands = stats.executed;
+    const int failures = stats.failed;
+    result.commands = commands;
+    result.failures = failures;
+    result.entities = static_cast<int>(m_geometryEngine->getAllEntityIds().size());
+
+    if (!scriptOk && commands == 0 && failures == 0) {
+        // Missing file or parse errors; the latter are logged per line by the compiler
+        result.error = QString("Cannot run script: %1").arg(job.scriptPath);
+        emit jobFinished(result);
+        return result;
+    }
+
+    if (!job.outputPath.isEmpty()) {
+        timer.restart();
+        QString error;
+        if (!exportDocument(job.outputPath, error)) {
+            result.error = error;
+            result.exportTimeMs = timer.elapsed();
+            emit jobFinished(result);
+            return result;
+        }
+        result.exportTimeMs = timer.elapsed();
+    }
+
+    result.success = scriptOk;
+    if (!scriptOk) {
+        result.error = QString("%1 command(s) failed").arg(failures);
+    }
+
+    qCDebug(cadBatch) << "Job finished:" << job.scriptPath << commands << "commands in"
+                      << result.scriptTimeMs << "ms";
+    emit jobFinished(result);
+    return result;
+}
+
+QList<BatchJobResult> BatchRunner::runAll(const QList<BatchJob>& jobs)
+{
+    QList<BatchJobResult> results;
+    for (const BatchJob& job : jobs) {
+        results.append(run(job));
+        if (m_stopOnError && !results.last().success) {
+            qCWarning(cadBatch) << "Stopping after failed job:" << job.scriptPath;
+            break;
+        }
+    }
+    return results;
+}
+
+bool BatchRunner::importDocument(const QString& path, QString& error)
+{
+    const QString suffix = QFileInfo(path).suffix().toLower();
+
+    bool ok = false;
+    if (suffix == "step" || suffix == "stp") {
+        ok = m_geometryEngine->importSTEP(path);
+    } else if (suffix == "iges" || suffix == "igs") {
+        ok = m_geometryEngine->importIGES(path);
+    } else if (suffix == "brep") {
+        ok = m_geometryEngine->importBREP(path);
+    } else if (suffix == "dxf") {
+        DxfReader reader(m_geometryEngine.get(), m_layerManager.get(), m_blockManager.get());
+        const DxfReadResult read = reader.read(path);
+        if (!read.success) {
+            error = QString("Import failed: %1").arg(read.error);
+        }
+        return read.success;
+    } else {
+        error = QString("Unsupported input format: %1").arg(suffix);
+        return false;
+    }
+
+    if (!ok) {
+        error = QString("Import failed: %1").arg(path);
+    }
+    return ok;
+}
+
+bool BatchRunner::exportDocument(const QString& path, QString& error)
+{
+    QFileInfo info(path);
+    QDir().mkpath(info.absolutePath());
+
+    QString suffix = info.suffix().toLower();
+    if (suffix.isEmpty()) {
+        suffix = m_defaultFormat;
+    }
+
+    bool ok = false;
+    if (suffix == "step" || suffix == "stp") {
+        ok = m_geometryEngine->exportSTEP(path);
+    } else if (suffix == "iges" || suffix == "igs") {
+        ok = m_geometryEngine->exportIGES(path);
+    } else if (suffix == "brep") {
+        ok = m_geometryEngine->exportBREP(path);
+    } else if (suffix == "png" || suffix == "tif" || suffix == "tiff" || suffix == "pdf" || suffix == "svg") {
+        PlotEngine plotter(m_geometryEngine.get(), m_layerManager.get());
+        const QString target = info.suffix().isEmpty() ? path + "." + suffix : path;
+        const PlotResult plot = suffix == "pdf" || suffix == "svg" ? plotter.plotVector(target, m_plotSettings)
+                                                                   : plotter.plotRaster(target, m_plotSettings);
+        if (!plot.success) {
+            error = QString("Plot failed: %1").arg(plot.error);
+        }
+        return plot.success;
+    } else if (suffix == "dxf") {
+        DxfWriter writer(m_geometryEngine.get(), m_layerManager.get(), m_blockManager.get());
+        const DxfWriteResult written = writer.write(info.suffix().isEmpty() ? path + ".dxf" : path);
+        if (!written.success) {
+            error = QString("Export failed: %1").arg(written.error);
+        }
+        return written.success;
+    } else {
+        error = QString("Unsupported output format: %1").arg(suffix);
+        return false;
+    }
+
+    if (!ok) {
+        error = QString("Export failed: %1").arg(path);
+    }
+    return ok;
+}
+
+void BatchRunner::resetDocument()
+{
+    m_commandManager->clearHistory();
+    m_geometryEngine->clearAllEntities();
+    m_blockManager->clear();
+    m_layerManager->clear();
+}
+
+// Reporting
+QString BatchRunner::formatReport(const QList<BatchJobResult>& results)
+{
+    QString report;
+    QTextStream out(&report);
+
+    int totalCommands = 0;
+    int totalFailures = 0;
+    int succeeded = 0;
+    qint64 totalLoadMs = 0;
+    qint64 totalScriptMs = 0;
+    qint64 totalExportMs = 0;
+
+    out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+               .arg("Job", -40).arg("Cmds", 8).arg("Failed", 8).arg("Load ms", 10)
+               .arg("Script ms", 10).arg("Export ms", 10).arg("Cmds/s", 10);
+
+    for (const BatchJobResult& result : results) {
+        const QString name = QFileInfo(result.inputPath.isEmpty() ? result.scriptPath : result.inputPath).fileName();
+        out << QString("%1 %2 %3 %4 %5 %6 %7")
+                   .arg(name, -40)
+                   .arg(result.commands, 8).arg(result.failures, 8)
+                   .arg(result.loadTimeMs, 10).arg(result.scriptTimeMs, 10).arg(result.exportTimeMs, 10)
+                   .arg(result.commandsPerSecond(), 10, 'f', 1);
+        if (!result.error.isEmpty()) {
+            out << "  " << result.error;
+        }
+        out << "\n";
+
+        totalCommands += result.commands;
+        totalFailures += result.failures;
+        totalLoadMs += result.loadTimeMs;
+        totalScriptMs += result.scriptTimeMs;
+        totalExportMs += result.exportTimeMs;
+        succeeded += result.success ? 1 : 0;
+    }
+
+    double throughput = totalScriptMs > 0 ? totalCommands * 1000.0 / totalScriptMs : 0.0;
+    out << QString("\n%1/%2 jobs succeeded, %3 commands (%4 failed), load %5 ms, script %6 ms, export %7 ms, "
+                   "%8 commands/sec\n")
+               .arg(succeeded).arg(results.size()).arg(totalCommands).arg(totalFailures)
+               .arg(totalLoadMs).arg(totalScriptMs).arg(totalExportMs).arg(throughput, 0, 'f', 1);
+
+    return report;
+}
+
+bool BatchRunner::writeJsonReport(const QString& path, const QList<BatchJobResult>& results)
+{
+    QJsonArray jobs;
+    for (const BatchJobResult& result : results) {
+        QJsonObject job;
+        if (!result.inputPath.isEmpty()) {
+            job["input"] = result.inputPath;
+        }
+        job["script"] = result.scriptPath;
+        job["output"] = result.outputPath;
+        job["commands"] = result.commands;
+        job["failures"] = result.failures;
+        job["entities"] = result.entities;
+        job["loadMs"] = result.loadTimeMs;
+        job["scriptMs"] = result.scriptTimeMs;
+        job["exportMs"] = result.exportTimeMs;
+        job["commandsPerSecond"] = result.commandsPerSecond();
+        job["success"] = result.success;
+        if (!result.error.isEmpty()) {
+            job["error"] = result.error;
+        }
+        jobs.append(job);
+    }
+
+    QJsonObject root;
+    root["jobs"] = jobs;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(cadBatch) << "Cannot write report:" << path;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
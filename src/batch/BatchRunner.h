@@ -0,0 +1,114 @@
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QLoggingCategory>
+#include <memory>
+
+#include "PlotEngine.h"
+
+class GeometryEngine;
+class LayerManager;
+class BlockManager;
+class CommandManager;
+
+Q_DECLARE_LOGGING_CATEGORY(cadBatch)
+
+/**
+ * @brief One script to run and where to write its result
+ */
+struct BatchJob
+{
+    QString inputPath;          // Document to open first; empty: start from an empty drawing
+    QString scriptPath;
+    QString scriptText;         // Used instead of scriptPath when set (in-memory macros)
+    QString outputPath;         // Empty: no export
+};
+
+/**
+ * @brief Outcome and throughput of one batch job
+ */
+struct BatchJobResult
+{
+    QString inputPath;
+    QString scriptPath;
+    QString outputPath;
+    int commands;
+    int failures;
+    int entities;
+    qint64 loadTimeMs;
+    qint64 scriptTimeMs;
+    qint64 exportTimeMs;
+    bool success;
+    QString error;
+
+    BatchJobResult()
+        : commands(0), failures(0), entities(0), loadTimeMs(0), scriptTimeMs(0), exportTimeMs(0), success(false) {}
+
+    double commandsPerSecond() const
+    {
+        return scriptTimeMs > 0 ? commands * 1000.0 / scriptTimeMs : 0.0;
+    }
+};
+
+/**
+ * @brief Runs command scripts without widgets, viewer or GL context
+ *
+ * Boots a headless GeometryEngine together with LayerManager, BlockManager
+ * and CommandManager. Each job starts from an empty drawing, optionally
+ * loaded from a STEP, IGES, BREP or DXF file; presentation work
+ * is deferred for the whole script and undo history is kept minimal, so
+ * only the commands themselves cost time. Exports happen once at the end;
+ * png and tif outputs are raster plots of the drawing's extents, pdf and
+ * svg vector plots; dxf keeps layers and blocks.
+ */
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchRunner(QObject* parent = nullptr);
+    ~BatchRunner();
+
+    bool initialize();
+
+    BatchJobResult run(const BatchJob& job);
+    QList<BatchJobResult> runAll(const QList<BatchJob>& jobs);
+
+    // Export format used when a job has no explicit output extension
+    void setDefaultFormat(const QString& format) { m_defaultFormat = format.toLower(); }
+    QString defaultFormat() const { return m_defaultFormat; }
+
+    void setStopOnError(bool stop) { m_stopOnError = stop; }
+    bool stopOnError() const { return m_stopOnError; }
+
+    // Sheet, resolution and tiling for plot outputs (png, tif, pdf, svg) of the model extents
+    void setPlotSettings(const PlotSettings& settings) { m_plotSettings = settings; }
+    const PlotSettings& plotSettings() const { return m_plotSettings; }
+
+    GeometryEngine* geometryEngine() const { return m_geometryEngine.get(); }
+    CommandManager* commandManager() const { return m_commandManager.get(); }
+
+    // Reporting
+    static QString formatReport(const QList<BatchJobResult>& results);
+    static bool writeJsonReport(const QString& path, const QList<BatchJobResult>& results);
+
+signals:
+    void jobStarted(const QString& scriptPath);
+    void jobFinished(const BatchJobResult& result);
+
+private:
+    bool importDocument(const QString& path, QString& error);
+    bool exportDocument(const QString& path, QString& error);
+    void resetDocument();
+
+    std::unique_ptr<GeometryEngine> m_geometryEngine;
+    std::unique_ptr<LayerManager> m_layerManager;
+    std::unique_ptr<BlockManager> m_blockManager;
+    std::unique_ptr<CommandManager> m_commandManager;
+
+    QString m_defaultFormat;
+    bool m_stopOnError;
+    PlotSettings m_plotSettings;
+};
@@ -0,0 +1,220 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QTextStream>
+#include "BatchRunner.h"
+#include "BatchProcessor.h"
+#include "Tracing.h"
+
+Q_LOGGING_CATEGORY(cadBatchMain, "cad.batch.main")
+
+static QStringList collectFiles(const QString& argument, const QStringList& patterns)
+{
+    QFileInfo info(argument);
+    if (!info.isDir()) {
+        return QStringList() << argument;
+    }
+
+    QStringList files;
+    QDir dir(argument);
+    for (const QString& name : dir.entryList(patterns, QDir::Files, QDir::Name)) {
+        files.append(dir.filePath(name));
+    }
+    return files;
+}
+
+int main(int argc, char *argv[])
+{
+    // Plain core application: no display server, widgets or GL context needed
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("AutoCAD Clone");
+    app.setApplicationVersion("1.0.0");
+    app.setOrganizationName("Darkspace Software and Security");
+    app.setOrganizationDomain("darkspacesoftwareandsecurity.com");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Run CAD command scripts headless");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("scripts", "Script files (.scr) or directories containing them", "<script...>");
+
+    QCommandLineOption outputDirOption(QStringList() << "o" << "output-dir",
+                                       "Write one export per script into <dir>", "dir");
+    QCommandLineOption formatOption(QStringList() << "f" << "format",
+                                    "Export format: step, iges, brep, dxf, or png, tif, pdf, svg to plot (default: step)", "format", "step");
+    QCommandLineOption reportOption(QStringList() << "r" << "report",
+                                    "Write a JSON throughput report to <file>", "file");
+    QCommandLineOption stopOption("stop-on-error", "Stop at the first failed script");
+    QCommandLineOption verboseOption(QStringList() << "v" << "verbose", "Enable debug logging");
+    QCommandLineOption inputOption(QStringList() << "i" << "input",
+                                   "Open document(s) <path> and apply the script to each; repeatable, "
+                                   "directories are scanned for STEP, IGES, BREP and DXF files", "path");
+    QCommandLineOption macroOption(QStringList() << "m" << "macro",
+                                   "Apply the saved macro <name> instead of a script file", "name");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  "Process up to <n> documents concurrently (default: CPU count)", "n");
+    QCommandLineOption memoryOption("memory-mb",
+                                    "Only open documents while their estimated size fits in <mb>", "mb");
+    QCommandLineOption paperOption("paper", "Plot sheet: A0 to A4 (default: A0)", "size", "A0");
+    QCommandLineOption dpiOption("dpi", "Plot resolution; for pdf/svg it sets curve accuracy (default: 600)", "dpi", "600");
+    QCommandLineOption traceOption("trace",
+                                   "Write a Chrome trace of the run to <file> (needs CAD_ENABLE_TRACING)", "file");
+    parser.addOption(outputDirOption);
+    parser.addOption(formatOption);
+    parser.addOption(reportOption);
+    parser.addOption(stopOption);
+    parser.addOption(verboseOption);
+    parser.addOption(inputOption);
+    parser.addOption(macroOption);
+    parser.addOption(jobsOption);
+    parser.addOption(memoryOption);
+    parser.addOption(paperOption);
+    parser.addOption(dpiOption);
+    parser.addOption(traceOption);
+    parser.process(app);
+
+    // Per-entity debug output would dominate batch run time
+    QLoggingCategory::setFilterRules(parser.isSet(verboseOption) ? "cad.*=true" : "cad.*.debug=false");
+
+    const QString format = parser.value(formatOption).toLower();
+    const QString outputDir = parser.value(outputDirOption);
+
+    PlotSettings plotSettings;
+    plotSettings.paperSize = PlotSettings::isoPaperSize(parser.value(paperOption));
+    plotSettings.dpi = parser.value(dpiOption).toDouble();
+    if (plotSettings.paperSize.isEmpty() || plotSettings.dpi <= 0.0) {
+        qCCritical(cadBatchMain) << "Invalid --paper or --dpi";
+        return 2;
+    }
+
+    if (parser.isSet(traceOption)) {
+        if (Tracing::isCompiledIn()) {
+            Tracing::start();
+        } else {
+            qCWarning(cadBatchMain) << "--trace ignored: build without CAD_ENABLE_TRACING";
+        }
+    }
+
+    QList<BatchJob> jobs;
+    QList<BatchJobResult> results;
+
+    if (parser.isSet(inputOption)) {
+        // Document mode: one script or macro applied to every input document
+        QStringList scripts;
+        for (const QString& argument : parser.positionalArguments()) {
+            scripts.append(collectFiles(argument, QStringList() << "*.scr"));
+        }
+
+        QString scriptText;
+        QString scriptName;
+        if (parser.isSet(macroOption)) {
+            QString error;
+            scriptName = parser.value(macroOption);
+            scriptText = BatchProcessor::loadMacro(scriptName, &error);
+            if (scriptText.isEmpty()) {
+                qCCritical(cadBatchMain) << error;
+                return 2;
+            }
+        } else if (scripts.size() == 1) {
+            scriptName = scripts.first();
+        } else {
+            qCCritical(cadBatchMain) << "Document mode needs exactly one script or --macro";
+            return 2;
+        }
+
+        const QStringList documentPatterns = QStringList() << "*.step" << "*.stp" << "*.iges" << "*.igs" << "*.brep" << "*.dxf";
+        for (const QString& argument : parser.values(inputOption)) {
+            for (const QString& document : collectFiles(argument, documentPatterns)) {
+                BatchJob job;
+                job.inputPath = document;
+                job.scriptPath = scriptName;
+                job.scriptText = scriptText;
+                if (!outputDir.isEmpty()) {
+                    job.outputPath = QDir(outputDir).filePath(QFileInfo(document).completeBaseName() + "." + format);
+                }
+                jobs.append(job);
+            }
+        }
+
+        if (jobs.isEmpty()) {
+            parser.showHelp(1);
+        }
+
+        BatchProcessor processor;
+        processor.setDefaultFormat(format);
+        processor.setPlotSettings(plotSettings);
+        processor.setStopOnError(parser.isSet(stopOption));
+        if (parser.isSet(jobsOption)) {
+            processor.setMaxConcurrentDocuments(parser.value(jobsOption).toInt());
+        }
+        if (parser.isSet(memoryOption)) {
+            processor.setMemoryBudget(parser.value(memoryOption).toLongLong() * 1024 * 1024);
+        }
+        results = processor.process(jobs);
+    } else {
+        if (parser.isSet(macroOption)) {
+            BatchJob job;
+            QString error;
+            job.scriptPath = parser.value(macroOption);
+            job.scriptText = BatchProcessor::loadMacro(job.scriptPath, &error);
+            if (job.scriptText.isEmpty()) {
+                qCCritical(cadBatchMain) << error;
+                return 2;
+            }
+            if (!outputDir.isEmpty()) {
+                job.outputPath = QDir(outputDir).filePath(job.scriptPath + "." + format);
+            }
+            jobs.append(job);
+        }
+
+        for (const QString& argument : parser.positionalArguments()) {
+            for (const QString& script : collectFiles(argument, QStringList() << "*.scr")) {
+                BatchJob job;
+                job.scriptPath = script;
+                if (!outputDir.isEmpty()) {
+                    job.outputPath = QDir(outputDir).filePath(QFileInfo(script).completeBaseName() + "." + format);
+                }
+                jobs.append(job);
+            }
+        }
+
+        if (jobs.isEmpty()) {
+            parser.showHelp(1);
+        }
+
+        BatchRunner runner;
+        runner.setDefaultFormat(format);
+        runner.setPlotSettings(plotSettings);
+        runner.setStopOnError(parser.isSet(stopOption));
+        if (!runner.initialize()) {
+            qCCritical(cadBatchMain) << "Failed to initialize batch runner";
+            return 2;
+        }
+
+        results = runner.runAll(jobs);
+    }
+
+    if (Tracing::isRecording()) {
+        Tracing::stop();
+        if (!Tracing::exportChromeTrace(parser.value(traceOption))) {
+            qCWarning(cadBatchMain) << "Cannot write trace:" << parser.value(traceOption);
+        }
+    }
+
+    QTextStream out(stdout);
+    out << BatchRunner::formatReport(results);
+    out.flush();
+
+    if (parser.isSet(reportOption)) {
+        BatchRunner::writeJsonReport(parser.value(reportOption), results);
+    }
+
+    for (const BatchJobResult& result : results) {
+        if (!result.success) {
+            return 1;
+        }
+    }
+    return results.size() == jobs.size() ? 0 : 1;
+}
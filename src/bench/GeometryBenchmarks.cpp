@@ -0,0 +1,511 @@
+#include "SyntheticDrawing.h"
+#include "BlockManager.h"
+#include "CommandManager.h"
+#include "DxfReader.h"
+#include "DxfWriter.h"
+#include "EntityDeltaCommand.h"
+#include "GeometryEngine.h"
+#include "SceneBVH.h"
+
+#include <benchmark/benchmark.h>
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QMatrix4x4>
+#include <QTemporaryDir>
+
+#include <BRepBndLib.hxx>
+#include <BRepBuilderAPI_MakeEdge.hxx>
+#include <Bnd_Box.hxx>
+#include <TopLoc_Location.hxx>
+
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Benchmarks take the drawing scale as their range argument: 1 is the default
+// mix of ~2000 entities, 10 is ~20000.
+
+namespace {
+
+SceneBounds boundsOf(const TopoDS_Shape& shape)
+{
+    Bnd_Box box;
+    BRepBndLib::Add(shape, box);
+    if (box.IsVoid()) {
+        return SceneBounds();
+    }
+    double xmin, ymin, zmin, xmax, ymax, zmax;
+    box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+    return SceneBounds(xmin, ymin, zmin, xmax, ymax, zmax);
+}
+
+/**
+ * @brief Populated engine shared by the read-only benchmarks of one scale
+ */
+struct Fixture
+{
+    std::unique_ptr<GeometryEngine> engine;
+    std::vector<int> ids;
+    SceneBVH bvh;
+    SyntheticDrawingOptions options;
+
+    explicit Fixture(int scale)
+        : engine(std::make_unique<GeometryEngine>())
+        , options(SyntheticDrawingOptions::scaled(scale))
+    {
+        ids = SyntheticDrawing(options).populate(engine.get());
+        for (int id : ids) {
+            bvh.insert(id, boundsOf(engine->getEntity(id).shape));
+        }
+        bvh.build();
+    }
+};
+
+Fixture& fixture(int scale)
+{
+    // Built on first use per scale and kept for the process lifetime
+    static std::map<int, std::unique_ptr<Fixture>> fixtures;
+    auto& slot = fixtures[scale];
+    if (!slot) {
+        slot = std::make_unique<Fixture>(scale);
+    }
+    return *slot;
+}
+
+/**
+ * @brief The synthetic block references as BlockManager inserts
+ *
+ * Each synthetic definition becomes a block and each reference an insert
+ * at the same placement, in an engine of their own so the other fixtures
+ * keep their entity counts.
+ */
+struct InsertFixture
+{
+    std::unique_ptr<GeometryEngine> engine;
+    std::unique_ptr<BlockManager> blocks;
+    std::vector<int> ids;
+    SceneBVH bvh;
+    SyntheticDrawingOptions options;
+
+    explicit InsertFixture(int scale)
+        : engine(std::make_unique<GeometryEngine>())
+        , blocks(std::make_unique<BlockManager>())
+        , options(SyntheticDrawingOptions::scaled(scale))
+    {
+        blocks->setGeometryEngine(engine.get());
+        engine->beginDeferredDisplay();
+        for (const CADEntity& entity : SyntheticDrawing(options).entities()) {
+            if (entity.type != CADEntity::Block) {
+                continue;
+            }
+            const QString name = QStringLiteral("SYN_%1").arg(entity.properties.value("blockDefinition").toInt());
+            if (!blocks->hasBlock(name)) {
+                BlockDefinition definition;
+                definition.name = name;
+                definition.geometry.push_back(entity.shape.Located(TopLoc_Location()));
+                blocks->defineBlock(definition);
+            }
+            const int id = blocks->insertBlock(name, entity.shape.Location().Transformation(), {}, entity.layer);
+            if (id >= 0) {
+                ids.push_back(id);
+                bvh.insert(id, boundsOf(engine->getEntity(id).shape));
+            }
+        }
+        engine->endDeferredDisplay();
+        bvh.build();
+    }
+};
+
+InsertFixture& insertFixture(int scale)
+{
+    static std::map<int, std::unique_ptr<InsertFixture>> fixtures;
+    auto& slot = fixtures[scale];
+    if (!slot) {
+        slot = std::make_unique<InsertFixture>(scale);
+    }
+    return *slot;
+}
+
+SceneBounds aperture(const gp_Pnt& cursor, double size)
+{
+    return SceneBounds(cursor.X() - size, cursor.Y() - size, -1e6, cursor.X() + size, cursor.Y() + size, 1e6);
+}
+
+SceneBounds pickWindow(SyntheticRandom& random, double extent, double size)
+{
+    const double x = random.uniform(0.0, extent - size);
+    const double y = random.uniform(0.0, extent - size);
+    return SceneBounds(x, y, -1e6, x + size, y + size, 1e6);
+}
+
+} // namespace
+
+// Generation
+
+static void BM_GenerateDrawing(benchmark::State& state)
+{
+    const SyntheticDrawing drawing(SyntheticDrawingOptions::scaled(state.range(0)));
+    for (auto _ : state) {
+        std::vector<CADEntity> entities = drawing.entities();
+        benchmark::DoNotOptimize(entities.data());
+    }
+    state.SetItemsProcessed(state.iterations() * drawing.options().entityCount());
+}
+BENCHMARK(BM_GenerateDrawing)->Arg(1)->Arg(10)->Unit(benchmark::kMillisecond);
+
+// Entity insertion
+
+static void BM_AddEntity(benchmark::State& state)
+{
+    const std::vector<CADEntity> entities = SyntheticDrawing(SyntheticDrawingOptions::scaled(state.range(0))).entities();
+    GeometryEngine engine;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        engine.clearAllEntities();
+        state.ResumeTiming();
+
+        engine.beginDeferredDisplay();
+        for (const CADEntity& entity : entities) {
+            benchmark::DoNotOptimize(engine.addEntity(entity));
+        }
+        engine.endDeferredDisplay();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(entities.size()));
+}
+BENCHMARK(BM_AddEntity)->Arg(1)->Arg(10)->Unit(benchmark::kMillisecond);
+
+static void BM_UpdateEntity(benchmark::State& state)
+{
+    Fixture& f = fixture(state.range(0));
+    size_t next = 0;
+    for (auto _ : state) {
+        const int id = f.ids[next++ % f.ids.size()];
+        CADEntity entity = f.engine->getEntity(id);
+        entity.color = entity.color % 7 + 1;
+        benchmark::DoNotOptimize(f.engine->updateEntity(id, entity));
+    }
+}
+BENCHMARK(BM_UpdateEntity)->Arg(1)->Arg(10);
+
+// Selection
+
+static void BM_BuildBVH(benchmark::State& state)
+{
+    Fixture& f = fixture(state.range(0));
+    std::vector<std::pair<int, SceneBounds>> bounds;
+    for (int id : f.ids) {
+        bounds.emplace_back(id, boundsOf(f.engine->getEntity(id).shape));
+    }
+
+    for (auto _ : state) {
+        SceneBVH bvh;
+        for (const auto& entry : bounds) {
+            bvh.insert(entry.first, entry.second);
+        }
+        bvh.build();
+        benchmark::DoNotOptimize(bvh.entityCount());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(bounds.size()));
+}
+BENCHMARK(BM_BuildBVH)->Arg(1)->Arg(10)->Unit(benchmark::kMillisecond);
+
+// Raw hierarchy query, the candidate search under picking and snapping
+static void BM_BVHWindowQuery(benchmark::State& state)
+{
+    Fixture& f = fixture(state.range(0));
+    SyntheticRandom random(7);
+    std::vector<int> hits;
+    int64_t found = 0;
+
+    for (auto _ : state) {
+        hits.clear();
+        f.bvh.query(pickWindow(random, f.options.extent, f.options.extent * 0.1), hits);
+        found += static_cast<int64_t>(hits.size());
+    }
+    state.counters["hits"] = benchmark::Counter(static_cast<double>(found), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_BVHWindowQuery)->Arg(1)->Arg(10);
+
+static void BM_ViewCull(benchmark::State& state)
+{
+    Fixture& f = fixture(state.range(0));
+    const double extent = f.options.extent;
+
+    QMatrix4x4 viewProjection;
+    viewProjection.ortho(0.0f, float(extent * 0.5), 0.0f, float(extent * 0.5), -1000.0f, 1000.0f);
+
+    CullResult result;
+    for (auto _ : state) {
+        result.clear();
+        f.bvh.cull(viewProjection, 1920, 1080, 1.0, result);
+        benchmark::DoNotOptimize(result.visibleEntities.data());
+    }
+}
+BENCHMARK(BM_ViewCull)->Arg(1)->Arg(10);
+
+// Picking an insert: BVH candidates, then BlockManager::hitTestInsert()
+
+static void BM_InsertHitTest(benchmark::State& state)
+{
+    InsertFixture& f = insertFixture(state.range(0));
+    SyntheticRandom random(13);
+    const double tolerance = f.options.extent * 0.005;
+    std::vector<int> candidates;
+    int64_t hits = 0;
+
+    for (auto _ : state) {
+        const gp_Pnt cursor(random.uniform(0.0, f.options.extent), random.uniform(0.0, f.options.extent), 0.0);
+        candidates.clear();
+        f.bvh.query(aperture(cursor, tolerance), candidates);
+        for (int id : candidates) {
+            if (f.blocks->hitTestInsert(id, cursor, tolerance)) {
+                ++hits;
+                break;
+            }
+        }
+    }
+    state.counters["hits"] = benchmark::Counter(static_cast<double>(hits), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_InsertHitTest)->Arg(1)->Arg(10);
+
+// Object snap on inserts: BVH candidates, then BlockManager::nearestInsertSnapPoint()
+
+static void BM_InsertSnap(benchmark::State& state)
+{
+    InsertFixture& f = insertFixture(state.range(0));
+    SyntheticRandom random(11);
+    const double tolerance = f.options.extent * 0.005;
+    std::vector<int> candidates;
+    int64_t snapped = 0;
+
+    for (auto _ : state) {
+        const gp_Pnt cursor(random.uniform(0.0, f.options.extent), random.uniform(0.0, f.options.extent), 0.0);
+        candidates.clear();
+        f.bvh.query(aperture(cursor, tolerance), candidates);
+
+        double best = std::numeric_limits<double>::max();
+        gp_Pnt snap = cursor;
+        for (int id : candidates) {
+            gp_Pnt point;
+            if (f.blocks->nearestInsertSnapPoint(id, cursor, tolerance, BlockManager::SnapAll, point)
+                && point.SquareDistance(cursor) < best) {
+                best = point.SquareDistance(cursor);
+                snap = point;
+            }
+        }
+        snapped += best < std::numeric_limits<double>::max() ? 1 : 0;
+        benchmark::DoNotOptimize(snap);
+    }
+    state.counters["snapped"] = benchmark::Counter(static_cast<double>(snapped), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_InsertSnap)->Arg(1)->Arg(10);
+
+// Booleans
+
+static void BM_Boolean(benchmark::State& state)
+{
+    GeometryEngine engine;
+    const int operation = static_cast<int>(state.range(0));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        engine.clearAllEntities();
+        const int a = engine.createBox(gp_Pnt(0, 0, 0), 10, 10, 10);
+        const int b = engine.createCylinder(gp_Pnt(5, 5, -5), gp_Dir(0, 0, 1), 4, 20);
+        state.ResumeTiming();
+
+        int result = -1;
+        switch (operation) {
+        case 0: result = engine.booleanUnion(a, b); break;
+        case 1: result = engine.booleanSubtract(a, b); break;
+        default: result = engine.booleanIntersect(a, b); break;
+        }
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetLabel(operation == 0 ? "union" : operation == 1 ? "subtract" : "intersect");
+}
+BENCHMARK(BM_Boolean)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Mass properties
+
+static void BM_MassProperties(benchmark::State& state)
+{
+    Fixture& f = fixture(state.range(0));
+    std::vector<int> solids;
+    for (int id : f.ids) {
+        const CADEntity::Type type = f.engine->getEntity(id).type;
+        if (type == CADEntity::Box || type == CADEntity::Cylinder) {
+            solids.push_back(id);
+        }
+    }
+
+    for (auto _ : state) {
+        double total = 0.0;
+        for (int id : solids) {
+            total += f.engine->getVolume(id) + f.engine->getArea(id);
+            total += f.engine->getCentroid(id).X();
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(solids.size()));
+}
+BENCHMARK(BM_MassProperties)->Arg(1)->Arg(10)->Unit(benchmark::kMillisecond);
+
+// Import / export
+
+static void BM_ExportSTEP(benchmark::State& state)
+{
+    Fixture& f = fixture(state.range(0));
+    QTemporaryDir dir;
+    const QString path = dir.filePath("bench.step");
+
+    for (auto _ : state) {
+        if (!f.engine->exportSTEP(path)) {
+            state.SkipWithError("STEP export failed");
+            break;
+        }
+    }
+    state.counters["bytes"] = static_cast<double>(QFileInfo(path).size());
+}
+BENCHMARK(BM_ExportSTEP)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_ImportSTEP(benchmark::State& state)
+{
+    Fixture& f = fixture(state.range(0));
+    QTemporaryDir dir;
+    const QString path = dir.filePath("bench.step");
+    if (!f.engine->exportSTEP(path)) {
+        state.SkipWithError("STEP export failed");
+        return;
+    }
+
+    GeometryEngine engine;
+    for (auto _ : state) {
+        state.PauseTiming();
+        engine.clearAllEntities();
+        state.ResumeTiming();
+
+        if (!engine.importSTEP(path)) {
+            state.SkipWithError("STEP import failed");
+            break;
+        }
+    }
+    state.counters["bytes"] = static_cast<double>(QFileInfo(path).size());
+}
+BENCHMARK(BM_ImportSTEP)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Same drawing both ways; bytes/s compares the writer against the reader
+static void BM_WriteDXF(benchmark::State& state)
+{
+    Fixture& f = fixture(state.range(0));
+    QTemporaryDir dir;
+    const QString path = dir.filePath("bench.dxf");
+
+    DxfWriter writer(f.engine.get());
+    qint64 bytes = 0;
+    for (auto _ : state) {
+        const DxfWriteResult result = writer.write(path);
+        if (!result.success) {
+            state.SkipWithError("DXF export failed");
+            break;
+        }
+        bytes = result.bytes;
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(f.ids.size()));
+}
+BENCHMARK(BM_WriteDXF)->Arg(1)->Arg(10)->Unit(benchmark::kMillisecond);
+
+static void BM_ReadDXF(benchmark::State& state)
+{
+    Fixture& f = fixture(state.range(0));
+    QTemporaryDir dir;
+    const QString path = dir.filePath("bench.dxf");
+    const DxfWriteResult written = DxfWriter(f.engine.get()).write(path);
+    if (!written.success) {
+        state.SkipWithError("DXF export failed");
+        return;
+    }
+
+    GeometryEngine engine;
+    DxfReader reader(&engine);
+    for (auto _ : state) {
+        state.PauseTiming();
+        engine.clearAllEntities();
+        state.ResumeTiming();
+
+        if (!reader.read(path).success) {
+            state.SkipWithError("DXF import failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * written.bytes);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(f.ids.size()));
+}
+BENCHMARK(BM_ReadDXF)->Arg(1)->Arg(10)->Unit(benchmark::kMillisecond);
+
+// Undo / redo
+
+static void BM_UndoRedo(benchmark::State& state)
+{
+    GeometryEngine engine;
+    CommandManager commands;
+    commands.setGeometryEngine(&engine);
+    SyntheticDrawing(SyntheticDrawingOptions::scaled(state.range(0))).populate(&engine);
+
+    // A stack of small delta commands, fully undone and redone per iteration
+    const int depth = 64;
+    for (int i = 0; i < depth; ++i) {
+        const double x = i * 10.0;
+        commands.executeCommand(std::make_unique<EntityDeltaCommand>(
+            &engine, "LINE", [x](GeometryEngine* target) {
+                CADEntity entity;
+                entity.type = CADEntity::Line;
+                entity.shape = BRepBuilderAPI_MakeEdge(gp_Pnt(x, 0, 0), gp_Pnt(x, 10, 0)).Edge();
+                target->addEntity(entity);
+            }));
+    }
+
+    for (auto _ : state) {
+        for (int i = 0; i < depth; ++i) {
+            commands.undo();
+        }
+        for (int i = 0; i < depth; ++i) {
+            commands.redo();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * depth * 2);
+}
+BENCHMARK(BM_UndoRedo)->Arg(1)->Arg(10)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    // Results go to cadbench.json unless the caller chose an output
+    std::vector<char*> args(argv, argv + argc);
+    bool hasOutput = false;
+    for (int i = 1; i < argc; ++i) {
+        hasOutput = hasOutput || std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+    }
+    std::string outArg = "--benchmark_out=cadbench.json";
+    std::string formatArg = "--benchmark_out_format=json";
+    if (!hasOutput) {
+        args.push_back(outArg.data());
+        args.push_back(formatArg.data());
+    }
+
+    int count = static_cast<int>(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "SyntheticDrawing.h"
+
+#include <BRepBuilderAPI_MakeEdge.hxx>
+#include <BRepBuilderAPI_MakePolygon.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <BRepPrimAPI_MakeCylinder.hxx>
+#include <BRep_Builder.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS_Compound.hxx>
+#include <gp_Trsf.hxx>
+
+#include <algorithm>
+#include <cmath>
+
+SyntheticDrawingOptions SyntheticDrawingOptions::scaled(double factor)
+{
+    SyntheticDrawingOptions options;
+    auto scale = [factor](int value) { return std::max(1, static_cast<int>(std::lround(value * factor))); };
+    options.lines = scale(options.lines);
+    options.arcs = scale(options.arcs);
+    options.polylines = scale(options.polylines);
+    options.solids = scale(options.solids);
+    options.blockInstances = scale(options.blockInstances);
+    options.extent *= std::sqrt(std::max(factor, 0.01));
+    return options;
+}
+
+SyntheticDrawing::SyntheticDrawing(const SyntheticDrawingOptions& options)
+    : m_options(options)
+{
+}
+
+QString SyntheticDrawing::layerName(int index)
+{
+    return QString("Layer-%1").arg(index, 2, 10, QChar('0'));
+}
+
+std::vector<CADEntity> SyntheticDrawing::entities() const
+{
+    const SyntheticDrawingOptions& o = m_options;
+    SyntheticRandom random(o.seed);
+
+    std::vector<CADEntity> result;
+    result.reserve(o.entityCount());
+
+    auto makeEntity = [&](CADEntity::Type type, const TopoDS_Shape& shape) {
+        CADEntity entity;
+        entity.type = type;
+        entity.shape = shape;
+        entity.layer = layerName(random.index(std::max(1, o.layers)));
+        entity.color = 1 + random.index(7);
+        result.push_back(entity);
+    };
+
+    auto randomPoint = [&]() {
+        return gp_Pnt(random.uniform(0.0, o.extent), random.uniform(0.0, o.extent), 0.0);
+    };
+
+    // Short segments, like typical drafting content
+    const double feature = o.extent * 0.01;
+    for (int i = 0; i < o.lines; ++i) {
+        const gp_Pnt start = randomPoint();
+        const gp_Pnt end(start.X() + random.uniform(-feature, feature),
+                         start.Y() + random.uniform(-feature, feature), 0.0);
+        if (start.Distance(end) < 1e-6) {
+            continue;
+        }
+        makeEntity(CADEntity::Line, BRepBuilderAPI_MakeEdge(start, end).Edge());
+    }
+
+    for (int i = 0; i < o.arcs; ++i) {
+        const gp_Circ circle(gp_Ax2(randomPoint(), gp_Dir(0, 0, 1)), random.uniform(feature * 0.1, feature));
+        const double startAngle = random.uniform(0.0, 2.0 * M_PI);
+        const double sweep = random.uniform(0.1, 1.9 * M_PI);
+        makeEntity(CADEntity::Arc, BRepBuilderAPI_MakeEdge(circle, startAngle, startAngle + sweep).Edge());
+    }
+
+    for (int i = 0; i < o.polylines; ++i) {
+        // Star-shaped around a center so the polygon never self-intersects
+        const gp_Pnt center = randomPoint();
+        BRepBuilderAPI_MakePolygon polygon;
+        const int vertices = std::max(3, o.polylineVertices);
+        for (int v = 0; v < vertices; ++v) {
+            const double angle = 2.0 * M_PI * v / vertices;
+            const double radius = random.uniform(feature * 0.3, feature);
+            polygon.Add(gp_Pnt(center.X() + radius * std::cos(angle), center.Y() + radius * std::sin(angle), 0.0));
+        }
+        polygon.Close();
+        makeEntity(CADEntity::Polyline, polygon.Wire());
+    }
+
+    for (int i = 0; i < o.solids; ++i) {
+        const gp_Pnt corner = randomPoint();
+        const double size = random.uniform(feature * 0.5, feature * 2.0);
+        if (i % 2 == 0) {
+            makeEntity(CADEntity::Box, BRepPrimAPI_MakeBox(corner, size, size * 0.8, size * 0.6).Solid());
+        } else {
+            makeEntity(CADEntity::Cylinder,
+                       BRepPrimAPI_MakeCylinder(gp_Ax2(corner, gp_Dir(0, 0, 1)), size * 0.4, size).Solid());
+        }
+    }
+
+    // Block definitions: a few edges each, referenced through locations
+    std::vector<TopoDS_Shape> definitions;
+    for (int d = 0; d < std::max(1, o.blockDefinitions); ++d) {
+        BRep_Builder builder;
+        TopoDS_Compound compound;
+        builder.MakeCompound(compound);
+        const int edges = 3 + random.index(6);
+        for (int e = 0; e < edges; ++e) {
+            const gp_Pnt a(random.uniform(-feature, feature), random.uniform(-feature, feature), 0.0);
+            const gp_Pnt b(random.uniform(-feature, feature), random.uniform(-feature, feature), 0.0);
+            if (a.Distance(b) > 1e-6) {
+                builder.Add(compound, BRepBuilderAPI_MakeEdge(a, b).Edge());
+            }
+        }
+        definitions.push_back(compound);
+    }
+
+    for (int i = 0; i < o.blockInstances; ++i) {
+        gp_Trsf transform;
+        transform.SetRotation(gp_Ax1(gp_Pnt(0, 0, 0), gp_Dir(0, 0, 1)), random.uniform(0.0, 2.0 * M_PI));
+        gp_Trsf translation;
+        translation.SetTranslation(gp_Vec(gp_Pnt(0, 0, 0), randomPoint()));
+        const int definition = random.index(static_cast<int>(definitions.size()));
+        makeEntity(CADEntity::Block, definitions[definition].Moved(TopLoc_Location(translation * transform)));
+        result.back().properties["blockDefinition"] = definition;
+    }
+
+    return result;
+}
+
+std::vector<int> SyntheticDrawing::populate(GeometryEngine* engine) const
+{
+    const std::vector<CADEntity> generated = entities();
+
+    std::vector<int> ids;
+    ids.reserve(generated.size());
+
+    engine->beginDeferredDisplay();
+    for (const CADEntity& entity : generated) {
+        ids.push_back(engine->addEntity(entity));
+    }
+    engine->endDeferredDisplay();
+
+    return ids;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "GeometryEngine.h"
+#include <QString>
+#include <vector>
+
+/**
+ * @brief Size and mix of a generated drawing
+ *
+ * scaled() multiplies every entity count by the same factor so benchmark
+ * sizes stay comparable; the seed makes the output identical across runs,
+ * compilers and platforms.
+ */
+struct SyntheticDrawingOptions
+{
+    int lines;
+    int arcs;
+    int polylines;
+    int solids;
+    int blockDefinitions;
+    int blockInstances;
+    int layers;
+    int polylineVertices;
+    double extent;              // Drawing spans [0, extent] in X and Y
+    quint32 seed;
+
+    SyntheticDrawingOptions()
+        : lines(1000), arcs(500), polylines(200), solids(50), blockDefinitions(10), blockInstances(200),
+          layers(16), polylineVertices(8), extent(10000.0), seed(20240601u) {}
+
+    static SyntheticDrawingOptions scaled(double factor);
+    int entityCount() const { return lines + arcs + polylines + solids + blockInstances; }
+};
+
+/**
+ * @brief Deterministic generator of synthetic CAD content
+ *
+ * Produces lines, arcs, closed polylines, primitive solids and block
+ * references spread over a number of layers. Block references share the
+ * definition's TShape through a location, the way inserts share geometry.
+ */
+class SyntheticDrawing
+{
+public:
+    explicit SyntheticDrawing(const SyntheticDrawingOptions& options = SyntheticDrawingOptions());
+
+    // Entities in generation order; does not touch any engine
+    std::vector<CADEntity> entities() const;
+
+    // Adds all entities under deferred display, returns their ids
+    std::vector<int> populate(GeometryEngine* engine) const;
+
+    static QString layerName(int index);
+
+    const SyntheticDrawingOptions& options() const { return m_options; }
+
+private:
+    SyntheticDrawingOptions m_options;
+};
+
+/**
+ * @brief Small deterministic PRNG (xorshift32)
+ *
+ * Standard distributions differ between library implementations, so values
+ * are derived directly from the raw sequence.
+ */
+class SyntheticRandom
+{
+public:
+    explicit SyntheticRandom(quint32 seed) : m_state(seed ? seed : 1u) {}
+
+    quint32 next()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+
+    double uniform(double low, double high) { return low + (high - low) * (next() / 4294967296.0); }
+    int index(int count) { return static_cast<int>(next() % static_cast<quint32>(count)); }
+
+private:
+    quint32 m_state;
+};
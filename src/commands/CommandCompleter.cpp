@@ -0,0 +1,310 @@
+#include "CommandCompleter.h"
+#include <algorithm>
+#include <cmath>
+
+CommandCompleter::CommandCompleter()
+    : m_historyLimit(50)
+    , m_indexDirty(true)
+{
+}
+
+CommandCompleter::~CommandCompleter() = default;
+
+// Vocabulary
+void CommandCompleter::setCommands(const QStringList& commands)
+{
+    m_commands = commands;
+    m_indexDirty = true;
+}
+
+void CommandCompleter::setAliases(const QHash<QString, QString>& aliases)
+{
+    m_aliases = aliases;
+    m_indexDirty = true;
+}
+
+void CommandCompleter::setMacros(const QStringList& macros)
+{
+    m_macros = macros;
+    m_indexDirty = true;
+}
+
+void CommandCompleter::addHistory(const QString& commandLine)
+{
+    const QString line = commandLine.trimmed();
+    if (line.isEmpty()) {
+        return;
+    }
+
+    // Repeated lines move to the front instead of filling the history
+    m_history.removeAll(line);
+    m_history.prepend(line);
+    while (m_history.size() > m_historyLimit) {
+        m_history.removeLast();
+    }
+}
+
+void CommandCompleter::clearHistory()
+{
+    m_history.clear();
+}
+
+void CommandCompleter::setHistoryLimit(int limit)
+{
+    m_historyLimit = qMax(0, limit);
+    while (m_history.size() > m_historyLimit) {
+        m_history.removeLast();
+    }
+}
+
+void CommandCompleter::recordUsage(const QString& name)
+{
+    ++m_usage[name.toLower()];
+}
+
+// Completion
+QList<CommandCompletion> CommandCompleter::complete(const QString& partial, int limit, bool fuzzy) const
+{
+    ensureIndex();
+
+    const QString pattern = partial.trimmed().toLower();
+    std::vector<CommandCompletion> matches;
+
+    // Prefix matches from the trie
+    std::vector<int> prefixEntries;
+    const int node = findNode(pattern);
+    if (node >= 0) {
+        collect(node, prefixEntries);
+    }
+
+    matches.reserve(prefixEntries.size() + m_history.size());
+    for (int index : prefixEntries) {
+        const Entry& entry = m_entries[index];
+        CommandCompletion completion;
+        completion.text = entry.text;
+        completion.target = entry.target;
+        completion.kind = entry.kind;
+        const int extra = static_cast<int>(entry.key.size() - pattern.size());
+        completion.score = 1000 + (extra == 0 ? 500 : 0) - 2 * extra
+                         + usageBonus(entry.target.isEmpty() ? entry.key : entry.target) + kindBonus(entry.kind);
+        matches.push_back(completion);
+    }
+
+    // Recent command lines, newest first
+    if (!pattern.isEmpty()) {
+        for (int age = 0; age < m_history.size(); ++age) {
+            const QString& line = m_history[age];
+            if (line.size() <= pattern.size() || !line.startsWith(pattern, Qt::CaseInsensitive)) {
+                continue;
+            }
+            CommandCompletion completion;
+            completion.text = line;
+            completion.kind = CommandCompletion::History;
+            completion.score = 900 + qMax(0, 50 - age) + kindBonus(CommandCompletion::History);
+            matches.push_back(completion);
+        }
+    }
+
+    // Subsequence matches only when prefixes leave room
+    if (fuzzy && pattern.size() >= 2 && static_cast<int>(matches.size()) < limit) {
+        const quint64 patternMask = charMask(pattern);
+        for (const Entry& entry : m_entries) {
+            if ((patternMask & ~entry.mask) != 0 || entry.key.startsWith(pattern)) {
+                continue;
+            }
+            const int score = fuzzyScore(pattern, entry.key);
+            if (score < 0) {
+                continue;
+            }
+            CommandCompletion completion;
+            completion.text = entry.text;
+            completion.target = entry.target;
+            completion.kind = entry.kind;
+            completion.fuzzy = true;
+            completion.score = score + usageBonus(entry.target.isEmpty() ? entry.key : entry.target)
+                             + kindBonus(entry.kind);
+            matches.push_back(completion);
+        }
+    }
+
+    auto better = [](const CommandCompletion& a, const CommandCompletion& b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        if (a.text.size() != b.text.size()) {
+            return a.text.size() < b.text.size();
+        }
+        return a.text < b.text;
+    };
+
+    const size_t count = std::min(matches.size(), static_cast<size_t>(qMax(0, limit)));
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), better);
+
+    QList<CommandCompletion> result;
+    result.reserve(static_cast<int>(count));
+    for (size_t i = 0; i < count; ++i) {
+        result.append(matches[i]);
+    }
+    return result;
+}
+
+// Trie
+void CommandCompleter::ensureIndex() const
+{
+    if (!m_indexDirty) {
+        return;
+    }
+
+    m_entries.clear();
+    m_nodes.clear();
+    m_nodes.push_back(Node{QChar(), -1, -1, {}});
+
+    for (const QString& command : m_commands) {
+        addEntry(command, QString(), CommandCompletion::Command);
+    }
+    for (auto it = m_aliases.constBegin(); it != m_aliases.constEnd(); ++it) {
+        addEntry(it.key(), it.value(), CommandCompletion::Alias);
+    }
+    for (const QString& macro : m_macros) {
+        addEntry(macro, QString(), CommandCompletion::Macro);
+    }
+
+    m_indexDirty = false;
+}
+
+void CommandCompleter::addEntry(const QString& text, const QString& target, CommandCompletion::Kind kind) const
+{
+    Entry entry;
+    entry.text = text;
+    entry.key = text.toLower();
+    entry.target = target.toLower();
+    entry.kind = kind;
+    entry.mask = charMask(entry.key);
+
+    const int entryIndex = static_cast<int>(m_entries.size());
+    m_entries.push_back(entry);
+
+    // Children stay sorted so collection order is stable
+    int node = 0;
+    for (const QChar ch : entry.key) {
+        int previous = -1;
+        int child = m_nodes[node].firstChild;
+        while (child >= 0 && m_nodes[child].ch < ch) {
+            previous = child;
+            child = m_nodes[child].nextSibling;
+        }
+
+        if (child < 0 || m_nodes[child].ch != ch) {
+            const int created = static_cast<int>(m_nodes.size());
+            m_nodes.push_back(Node{ch, -1, child, {}});
+            if (previous < 0) {
+                m_nodes[node].firstChild = created;
+            } else {
+                m_nodes[previous].nextSibling = created;
+            }
+            child = created;
+        }
+        node = child;
+    }
+
+    m_nodes[node].entries.push_back(entryIndex);
+}
+
+int CommandCompleter::findNode(const QString& prefix) const
+{
+    int node = 0;
+    for (const QChar ch : prefix) {
+        int child = m_nodes[node].firstChild;
+        while (child >= 0 && m_nodes[child].ch < ch) {
+            child = m_nodes[child].nextSibling;
+        }
+        if (child < 0 || m_nodes[child].ch != ch) {
+            return -1;
+        }
+        node = child;
+    }
+    return node;
+}
+
+void CommandCompleter::collect(int node, std::vector<int>& out) const
+{
+    // Iterative walk; deep macro names must not grow the call stack
+    std::vector<int> stack;
+    stack.push_back(node);
+    while (!stack.empty()) {
+        const int current = stack.back();
+        stack.pop_back();
+
+        const Node& n = m_nodes[current];
+        out.insert(out.end(), n.entries.begin(), n.entries.end());
+        for (int child = n.firstChild; child >= 0; child = m_nodes[child].nextSibling) {
+            stack.push_back(child);
+        }
+    }
+}
+
+// Scoring
+int CommandCompleter::usageBonus(const QString& name) const
+{
+    const int count = m_usage.value(name);
+    if (count <= 0) {
+        return 0;
+    }
+    return qMin(300, static_cast<int>(60.0 * std::log2(1.0 + count)));
+}
+
+int CommandCompleter::kindBonus(CommandCompletion::Kind kind)
+{
+    switch (kind) {
+    case CommandCompletion::Command: return 30;
+    case CommandCompletion::Alias:   return 20;
+    case CommandCompletion::Macro:   return 10;
+    case CommandCompletion::History: return 0;
+    }
+    return 0;
+}
+
+int CommandCompleter::fuzzyScore(const QString& pattern, const QString& text)
+{
+    int score = 0;
+    int previousMatch = -2;
+    int position = 0;
+
+    for (const QChar ch : pattern) {
+        const int found = static_cast<int>(text.indexOf(ch, position));
+        if (found < 0) {
+            return -1;
+        }
+
+        score += 10;
+        if (found == previousMatch + 1) {
+            score += 15;
+        }
+        if (found == 0 || text[found - 1] == '_' || text[found - 1] == '-' || text[found - 1] == '.') {
+            score += 20;
+        }
+        score -= static_cast<int>(found - position);
+
+        previousMatch = found;
+        position = found + 1;
+    }
+
+    // Always below any prefix match
+    return qBound(1, score + 100, 800);
+}
+
+quint64 CommandCompleter::charMask(const QString& text)
+{
+    quint64 mask = 0;
+    for (const QChar ch : text) {
+        const ushort c = ch.unicode();
+        if (c >= 'a' && c <= 'z') {
+            mask |= quint64(1) << (c - 'a');
+        } else if (c >= '0' && c <= '9') {
+            mask |= quint64(1) << (26 + c - '0');
+        } else {
+            mask |= quint64(1) << (36 + c % 28);
+        }
+    }
+    return mask;
+}
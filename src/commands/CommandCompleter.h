@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <vector>
+
+/**
+ * @brief One ranked completion candidate
+ */
+struct CommandCompletion
+{
+    enum Kind : quint8 {
+        Command,
+        Alias,
+        Macro,
+        History
+    };
+
+    QString text;
+    QString target;             // Command an alias resolves to; empty otherwise
+    Kind kind;
+    int score;
+    bool fuzzy;                 // Matched as a subsequence rather than a prefix
+
+    CommandCompletion() : kind(Command), score(0), fuzzy(false) {}
+};
+
+/**
+ * @brief Prefix trie plus fuzzy matcher over command-line vocabulary
+ *
+ * Commands, aliases and macros live in the trie, which is rebuilt lazily
+ * after the vocabulary changes; prefix lookups only visit the matching
+ * subtree. When those do not fill the requested count, a subsequence
+ * matcher scans the remaining candidates, skipping most of them with a
+ * per-candidate character mask. Recent command lines are few and change on
+ * every command, so they are matched linearly instead of being indexed.
+ *
+ * Ranking prefers exact and prefix matches, then usage frequency, then
+ * kind (command, alias, macro, history), then shorter text.
+ */
+class CommandCompleter
+{
+public:
+    CommandCompleter();
+    ~CommandCompleter();
+
+    // Vocabulary; each call replaces the previous set of that kind
+    void setCommands(const QStringList& commands);
+    void setAliases(const QHash<QString, QString>& aliases);
+    void setMacros(const QStringList& macros);
+
+    // Recent full command lines, most recent first when completing
+    void addHistory(const QString& commandLine);
+    void clearHistory();
+    void setHistoryLimit(int limit);
+    int historyLimit() const { return m_historyLimit; }
+
+    // Usage frequency; names are case-insensitive
+    void recordUsage(const QString& name);
+    int usageCount(const QString& name) const { return m_usage.value(name.toLower()); }
+    const QHash<QString, int>& usageCounts() const { return m_usage; }
+    void setUsageCounts(const QHash<QString, int>& counts) { m_usage = counts; }
+
+    QList<CommandCompletion> complete(const QString& partial, int limit = 20, bool fuzzy = true) const;
+
+    int candidateCount() const { return m_commands.size() + m_aliases.size() + m_macros.size() + m_history.size(); }
+
+private:
+    struct Entry {
+        QString text;
+        QString key;            // Lower case, used for matching
+        QString target;
+        CommandCompletion::Kind kind;
+        quint64 mask;           // Characters present, for fuzzy rejection
+    };
+
+    struct Node {
+        QChar ch;
+        int firstChild;
+        int nextSibling;
+        std::vector<int> entries;
+    };
+
+    void ensureIndex() const;
+    void addEntry(const QString& text, const QString& target, CommandCompletion::Kind kind) const;
+    int findNode(const QString& prefix) const;
+    void collect(int node, std::vector<int>& out) const;
+
+    int usageBonus(const QString& name) const;
+    static int kindBonus(CommandCompletion::Kind kind);
+    static int fuzzyScore(const QString& pattern, const QString& text);
+    static quint64 charMask(const QString& text);
+
+    // Vocabulary by kind; the flat entry table is rebuilt from these
+    QStringList m_commands;
+    QHash<QString, QString> m_aliases;
+    QStringList m_macros;
+    QStringList m_history;
+    int m_historyLimit;
+
+    // Trie over commands, aliases and macros
+    mutable std::vector<Entry> m_entries;
+    mutable std::vector<Node> m_nodes;
+    mutable bool m_indexDirty;
+
+    QHash<QString, int> m_usage;
+};
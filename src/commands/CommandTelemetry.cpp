@@ -0,0 +1,364 @@
+#include "CommandTelemetry.h"
+#include "GeometryEngine.h"
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <chrono>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef CAD_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+#endif
+
+Q_LOGGING_CATEGORY(cadTelemetry, "cad.telemetry")
+
+#ifdef CAD_COUNT_ALLOCATIONS
+// Per-thread count of every operator new; only built with CAD_COUNT_ALLOCATIONS
+namespace {
+thread_local qint64 t_allocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    ++t_allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    ++t_allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
+namespace {
+
+double percentile(const std::vector<qint64>& sorted, double fraction)
+{
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    // Nearest rank
+    size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.5);
+    rank = std::clamp<size_t>(rank, 1, sorted.size());
+    return sorted[rank - 1] / 1.0e6;
+}
+
+QString csvField(const QString& value)
+{
+    if (!value.contains(',') && !value.contains('"') && !value.contains('\n')) {
+        return value;
+    }
+    QString escaped = value;
+    escaped.replace('"', "\"\"");
+    return '"' + escaped + '"';
+}
+
+} // namespace
+
+CommandTelemetry::CommandTelemetry(QObject* parent)
+    : QObject(parent)
+    , m_enabled(false)
+    , m_ring(4096)
+    , m_head(0)
+    , m_count(0)
+{
+}
+
+CommandTelemetry::~CommandTelemetry() = default;
+
+void CommandTelemetry::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) {
+        return;
+    }
+    m_enabled = enabled;
+    qCDebug(cadTelemetry) << "Command telemetry" << (enabled ? "enabled" : "disabled");
+    emit enabledChanged(enabled);
+}
+
+void CommandTelemetry::setCapacity(int capacity)
+{
+    // Keep the newest samples that still fit
+    QList<CommandSample> kept = samples();
+    const int size = qMax(1, capacity);
+    if (kept.size() > size) {
+        kept = kept.mid(kept.size() - size);
+    }
+
+    m_ring.assign(size, CommandSample());
+    m_head = 0;
+    m_count = 0;
+    for (const CommandSample& sample : kept) {
+        m_ring[m_head] = sample;
+        m_head = (m_head + 1) % size;
+        ++m_count;
+    }
+}
+
+void CommandTelemetry::clear()
+{
+    std::fill(m_ring.begin(), m_ring.end(), CommandSample());
+    m_head = 0;
+    m_count = 0;
+    emit cleared();
+}
+
+// Measurement
+CommandTelemetry::Probe CommandTelemetry::begin(const GeometryEngine* engine) const
+{
+    Probe probe;
+    probe.changeStart = engine ? engine->changeCount() : 0;
+    probe.allocationsStart = allocationCount();
+    probe.cpuStartNs = threadCpuTimeNs();
+    probe.wallStartNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return probe;
+}
+
+void CommandTelemetry::end(const Probe& probe, const QString& name, bool success, const GeometryEngine* engine)
+{
+    const qint64 wallEnd = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    const qint64 cpuEnd = threadCpuTimeNs();
+    const qint64 allocationsEnd = allocationCount();
+
+    CommandSample sample;
+    sample.name = name;
+    sample.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    sample.wallNs = wallEnd - probe.wallStartNs;
+    sample.cpuNs = cpuEnd - probe.cpuStartNs;
+    sample.allocations = allocationCountingAvailable() ? allocationsEnd - probe.allocationsStart : -1;
+    sample.entitiesTouched = engine ? static_cast<int>(engine->changeCount() - probe.changeStart) : 0;
+    sample.success = success;
+    record(sample);
+}
+
+void CommandTelemetry::record(const CommandSample& sample)
+{
+    m_ring[m_head] = sample;
+    m_head = (m_head + 1) % static_cast<int>(m_ring.size());
+    m_count = qMin(m_count + 1, static_cast<int>(m_ring.size()));
+    emit sampleRecorded(sample);
+}
+
+QList<CommandSample> CommandTelemetry::samples() const
+{
+    QList<CommandSample> result;
+    result.reserve(m_count);
+
+    const int size = static_cast<int>(m_ring.size());
+    const int start = (m_head - m_count + size) % size;
+    for (int i = 0; i < m_count; ++i) {
+        result.append(m_ring[(start + i) % size]);
+    }
+    return result;
+}
+
+QList<CommandTimingStats> CommandTelemetry::statistics() const
+{
+    struct Accumulator {
+        std::vector<qint64> wall;
+        qint64 cpu = 0;
+        qint64 allocations = 0;
+        bool allocationsKnown = true;
+        int failures = 0;
+        qint64 entities = 0;
+    };
+
+    QHash<QString, Accumulator> byName;
+    const QList<CommandSample> all = samples();
+    for (const CommandSample& sample : all) {
+        Accumulator& acc = byName[sample.name];
+        acc.wall.push_back(sample.wallNs);
+        acc.cpu += sample.cpuNs;
+        if (sample.allocations < 0) {
+            acc.allocationsKnown = false;
+        } else {
+            acc.allocations += sample.allocations;
+        }
+        acc.failures += sample.success ? 0 : 1;
+        acc.entities += sample.entitiesTouched;
+    }
+
+    QList<CommandTimingStats> result;
+    result.reserve(byName.size());
+    for (auto it = byName.begin(); it != byName.end(); ++it) {
+        Accumulator& acc = it.value();
+        std::sort(acc.wall.begin(), acc.wall.end());
+
+        CommandTimingStats stats;
+        stats.name = it.key();
+        stats.count = static_cast<int>(acc.wall.size());
+        stats.failures = acc.failures;
+        stats.p50Ms = percentile(acc.wall, 0.50);
+        stats.p90Ms = percentile(acc.wall, 0.90);
+        stats.p99Ms = percentile(acc.wall, 0.99);
+        stats.maxMs = acc.wall.back() / 1.0e6;
+        stats.meanCpuMs = acc.cpu / 1.0e6 / stats.count;
+        stats.meanAllocations = acc.allocationsKnown ? static_cast<double>(acc.allocations) / stats.count : -1.0;
+        stats.entitiesTouched = acc.entities;
+        result.append(stats);
+    }
+
+    // Most expensive first
+    std::sort(result.begin(), result.end(), [](const CommandTimingStats& a, const CommandTimingStats& b) {
+        return a.p90Ms * a.count > b.p90Ms * b.count;
+    });
+    return result;
+}
+
+// Reporting
+QString CommandTelemetry::formatReport() const
+{
+    QString report;
+    QTextStream out(&report);
+
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+               .arg("Command", -20).arg("Count", 7).arg("p50 ms", 9).arg("p90 ms", 9).arg("p99 ms", 9)
+               .arg("max ms", 9).arg("cpu ms", 9).arg("allocs", 9).arg("entities", 9);
+
+    for (const CommandTimingStats& stats : statistics()) {
+        out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9")
+                   .arg(stats.name, -20).arg(stats.count, 7)
+                   .arg(stats.p50Ms, 9, 'f', 3).arg(stats.p90Ms, 9, 'f', 3).arg(stats.p99Ms, 9, 'f', 3)
+                   .arg(stats.maxMs, 9, 'f', 3).arg(stats.meanCpuMs, 9, 'f', 3)
+                   .arg(stats.meanAllocations < 0 ? QString("n/a") : QString::number(stats.meanAllocations, 'f', 0), 9)
+                   .arg(stats.entitiesTouched, 9);
+        if (stats.failures > 0) {
+            out << "  " << stats.failures << " failed";
+        }
+        out << "\n";
+    }
+
+    out << QString("%1 samples (ring holds %2)%3\n")
+               .arg(m_count).arg(capacity()).arg(m_enabled ? "" : ", recording off");
+    return report;
+}
+
+bool CommandTelemetry::exportCsv(const QString& path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qCWarning(cadTelemetry) << "Cannot write telemetry CSV:" << path;
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "command,timestamp,wall_ms,cpu_ms,allocations,entities,success\n";
+    for (const CommandSample& sample : samples()) {
+        out << csvField(sample.name) << ','
+            << QDateTime::fromMSecsSinceEpoch(sample.timestampMs).toString(Qt::ISODateWithMs) << ','
+            << QString::number(sample.wallNs / 1.0e6, 'f', 3) << ','
+            << QString::number(sample.cpuNs / 1.0e6, 'f', 3) << ','
+            << sample.allocations << ','
+            << sample.entitiesTouched << ','
+            << (sample.success ? 1 : 0) << '\n';
+    }
+    return true;
+}
+
+bool CommandTelemetry::exportJson(const QString& path) const
+{
+    QJsonArray sampleArray;
+    for (const CommandSample& sample : samples()) {
+        QJsonObject object;
+        object["command"] = sample.name;
+        object["timestamp"] = QDateTime::fromMSecsSinceEpoch(sample.timestampMs).toString(Qt::ISODateWithMs);
+        object["wallMs"] = sample.wallNs / 1.0e6;
+        object["cpuMs"] = sample.cpuNs / 1.0e6;
+        object["allocations"] = sample.allocations;
+        object["entities"] = sample.entitiesTouched;
+        object["success"] = sample.success;
+        sampleArray.append(object);
+    }
+
+    QJsonArray statsArray;
+    for (const CommandTimingStats& stats : statistics()) {
+        QJsonObject object;
+        object["command"] = stats.name;
+        object["count"] = stats.count;
+        object["failures"] = stats.failures;
+        object["p50Ms"] = stats.p50Ms;
+        object["p90Ms"] = stats.p90Ms;
+        object["p99Ms"] = stats.p99Ms;
+        object["maxMs"] = stats.maxMs;
+        object["meanCpuMs"] = stats.meanCpuMs;
+        object["meanAllocations"] = stats.meanAllocations;
+        object["entities"] = stats.entitiesTouched;
+        statsArray.append(object);
+    }
+
+    QJsonObject root;
+    root["samples"] = sampleArray;
+    root["statistics"] = statsArray;
+    root["allocationCounting"] = allocationCountingAvailable();
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(cadTelemetry) << "Cannot write telemetry JSON:" << path;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
+
+bool CommandTelemetry::allocationCountingAvailable()
+{
+#ifdef CAD_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+qint64 CommandTelemetry::threadCpuTimeNs()
+{
+#ifdef Q_OS_WIN
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    auto toNs = [](const FILETIME& time) {
+        return ((static_cast<qint64>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 100;
+    };
+    return toNs(kernel) + toNs(user);
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return static_cast<qint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+qint64 CommandTelemetry::allocationCount()
+{
+#ifdef CAD_COUNT_ALLOCATIONS
+    return t_allocations;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QLoggingCategory>
+#include <vector>
+
+class GeometryEngine;
+
+Q_DECLARE_LOGGING_CATEGORY(cadTelemetry)
+
+/**
+ * @brief Measurements for one executed command
+ */
+struct CommandSample
+{
+    QString name;
+    qint64 timestampMs;         // Wall clock at completion, ms since epoch
+    qint64 wallNs;
+    qint64 cpuNs;               // Thread CPU time
+    qint64 allocations;         // -1 when allocation counting is not compiled in
+    int entitiesTouched;        // Adds, updates and removals in the geometry engine
+    bool success;
+
+    CommandSample()
+        : timestampMs(0), wallNs(0), cpuNs(0), allocations(-1), entitiesTouched(0), success(false) {}
+};
+
+/**
+ * @brief Aggregated timings for one command name
+ */
+struct CommandTimingStats
+{
+    QString name;
+    int count;
+    int failures;
+    double p50Ms;
+    double p90Ms;
+    double p99Ms;
+    double maxMs;
+    double meanCpuMs;
+    double meanAllocations;     // -1 when not counted
+    qint64 entitiesTouched;
+
+    CommandTimingStats()
+        : count(0), failures(0), p50Ms(0.0), p90Ms(0.0), p99Ms(0.0), maxMs(0.0),
+          meanCpuMs(0.0), meanAllocations(-1.0), entitiesTouched(0) {}
+};
+
+/**
+ * @brief Rolling per-command performance record
+ *
+ * Samples go into a fixed-size ring buffer, so memory stays constant and
+ * old samples are overwritten. Statistics are computed on demand from
+ * whatever the ring holds.
+ *
+ * Recording is off by default. Callers check isEnabled() before taking a
+ * Probe, so a disabled recorder costs one branch per command. Allocation
+ * counts need the CAD_COUNT_ALLOCATIONS build option, which replaces the
+ * global operator new; without it they are reported as unavailable.
+ */
+class CommandTelemetry : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Start-of-command readings, taken only while recording is on
+     */
+    struct Probe
+    {
+        qint64 wallStartNs;
+        qint64 cpuStartNs;
+        qint64 allocationsStart;
+        quint64 changeStart;
+    };
+
+    explicit CommandTelemetry(QObject* parent = nullptr);
+    ~CommandTelemetry();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    void setCapacity(int capacity);
+    int capacity() const { return static_cast<int>(m_ring.size()); }
+    int sampleCount() const { return m_count; }
+    void clear();
+
+    // Measurement
+    Probe begin(const GeometryEngine* engine) const;
+    void end(const Probe& probe, const QString& name, bool success, const GeometryEngine* engine);
+    void record(const CommandSample& sample);
+
+    // Oldest first
+    QList<CommandSample> samples() const;
+    QList<CommandTimingStats> statistics() const;
+
+    // Reporting
+    QString formatReport() const;
+    bool exportCsv(const QString& path) const;
+    bool exportJson(const QString& path) const;
+
+    static bool allocationCountingAvailable();
+
+signals:
+    void enabledChanged(bool enabled);
+    void sampleRecorded(const CommandSample& sample);
+    void cleared();
+
+private:
+    static qint64 threadCpuTimeNs();
+    static qint64 allocationCount();
+
+    bool m_enabled;
+    std::vector<CommandSample> m_ring;
+    int m_head;                 // Next slot to write
+    int m_count;
+};
@@ -0,0 +1,302 @@
+#include "EntityDeltaCommand.h"
+#include <QDataStream>
+#include <algorithm>
+#include <sstream>
+
+#include <BinTools.hxx>
+#include <BRep_Tool.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Standard_Failure.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS.hxx>
+
+namespace {
+
+// Rough in-memory cost of B-rep topology, used for budget accounting only
+constexpr size_t VertexBytes = 48;
+constexpr size_t EdgeBytes = 160;
+constexpr size_t FaceBytes = 320;
+
+size_t estimateShapeBytes(const TopoDS_Shape& shape)
+{
+    if (shape.IsNull()) {
+        return 0;
+    }
+
+    size_t bytes = 0;
+    for (TopExp_Explorer exp(shape, TopAbs_VERTEX); exp.More(); exp.Next()) {
+        bytes += VertexBytes;
+    }
+    for (TopExp_Explorer exp(shape, TopAbs_EDGE); exp.More(); exp.Next()) {
+        bytes += EdgeBytes;
+    }
+    for (TopExp_Explorer exp(shape, TopAbs_FACE); exp.More(); exp.Next()) {
+        bytes += FaceBytes;
+        TopLoc_Location location;
+        Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(TopoDS::Face(exp.Current()), location);
+        if (!triangulation.IsNull()) {
+            bytes += triangulation->NbNodes() * 3 * sizeof(double) + triangulation->NbTriangles() * 3 * sizeof(int);
+        }
+    }
+    return bytes;
+}
+
+} // namespace
+
+EntityDeltaCommand::EntityDeltaCommand(GeometryEngine* engine, const QString& name, Operation operation,
+                                       const std::vector<int>& touchedIds)
+    : m_geometryEngine(engine)
+    , m_name(name)
+    , m_operation(std::move(operation))
+    , m_touchedIds(touchedIds)
+    , m_stateBytes(0)
+    , m_executed(false)
+    , m_released(false)
+{
+}
+
+EntityDeltaCommand::~EntityDeltaCommand() = default;
+
+void EntityDeltaCommand::execute()
+{
+    if (!m_geometryEngine) {
+        return;
+    }
+
+    if (m_executed) {
+        apply(true);
+        return;
+    }
+
+    // Before states of everything the operation declares it will touch
+    std::vector<EntityDelta> deltas;
+    deltas.reserve(m_touchedIds.size());
+    for (int id : m_touchedIds) {
+        EntityDelta delta;
+        delta.entityId = id;
+        delta.before = snapshot(id, delta.existedBefore);
+        delta.existsAfter = false;
+        deltas.push_back(delta);
+    }
+
+    // Anything allocated past the current id watermark was added by the operation;
+    // unlike entityAdded this also works while the engine batches insertions
+    const int firstNewId = m_geometryEngine->nextEntityId();
+
+    if (m_operation) {
+        m_operation(m_geometryEngine);
+    }
+
+    for (int id = firstNewId; id < m_geometryEngine->nextEntityId(); ++id) {
+        if (std::find(m_touchedIds.begin(), m_touchedIds.end(), id) == m_touchedIds.end()) {
+            EntityDelta delta;
+            delta.entityId = id;
+            delta.existedBefore = false;
+            delta.existsAfter = false;
+            deltas.push_back(delta);
+        }
+    }
+
+    m_stateBytes = 0;
+    for (EntityDelta& delta : deltas) {
+        delta.after = snapshot(delta.entityId, delta.existsAfter);
+        if (!delta.existedBefore && !delta.existsAfter) {
+            continue;
+        }
+
+        m_stateBytes += estimateBytes(delta.before);
+        if (!delta.after.shape.IsSame(delta.before.shape)) {
+            m_stateBytes += estimateBytes(delta.after);
+        }
+        m_deltas.push_back(delta);
+    }
+
+    // The captured operation may hold large inputs that undo no longer needs
+    m_operation = nullptr;
+    m_executed = true;
+}
+
+void EntityDeltaCommand::undo()
+{
+    apply(false);
+}
+
+void EntityDeltaCommand::redo()
+{
+    apply(true);
+}
+
+QString EntityDeltaCommand::description() const
+{
+    return QString("%1 (%2 entities)").arg(m_name).arg(m_deltas.size());
+}
+
+size_t EntityDeltaCommand::memoryCost() const
+{
+    size_t cost = sizeof(*this) + m_deltas.capacity() * sizeof(EntityDelta);
+    return m_released ? cost : cost + m_stateBytes;
+}
+
+void EntityDeltaCommand::apply(bool forward)
+{
+    if (!m_geometryEngine) {
+        return;
+    }
+
+    auto applyDelta = [this, forward](const EntityDelta& delta) {
+        bool exists = forward ? delta.existsAfter : delta.existedBefore;
+        const CADEntity& state = forward ? delta.after : delta.before;
+
+        if (!exists) {
+            if (m_geometryEngine->hasEntity(delta.entityId)) {
+                m_geometryEngine->removeEntity(delta.entityId);
+            }
+        } else if (m_geometryEngine->hasEntity(delta.entityId)) {
+            m_geometryEngine->updateEntity(delta.entityId, state);
+        } else {
+            m_geometryEngine->restoreEntity(delta.entityId, state);
+        }
+    };
+
+    if (forward) {
+        std::for_each(m_deltas.begin(), m_deltas.end(), applyDelta);
+    } else {
+        std::for_each(m_deltas.rbegin(), m_deltas.rend(), applyDelta);
+    }
+}
+
+CADEntity EntityDeltaCommand::snapshot(int entityId, bool& exists) const
+{
+    exists = m_geometryEngine->hasEntity(entityId);
+    if (!exists) {
+        return CADEntity();
+    }
+
+    CADEntity entity = m_geometryEngine->getEntity(entityId);
+    // Presentation objects are rebuilt by the engine and must not be kept alive here
+    entity.aisObject.Nullify();
+    entity.selected = false;
+    return entity;
+}
+
+size_t EntityDeltaCommand::estimateBytes(const CADEntity& entity)
+{
+    return sizeof(CADEntity) + entity.layer.size() * sizeof(QChar) + entity.properties.size() * 64
+         + estimateShapeBytes(entity.shape);
+}
+
+// Serialization
+bool EntityDeltaCommand::saveState(QDataStream& stream) const
+{
+    stream << static_cast<qint32>(m_deltas.size());
+    for (const EntityDelta& delta : m_deltas) {
+        bool sameShape = delta.existedBefore && delta.existsAfter && delta.after.shape.IsSame(delta.before.shape);
+        stream << static_cast<qint32>(delta.entityId) << delta.existedBefore << delta.existsAfter << sameShape;
+        if (delta.existedBefore) {
+            writeEntity(stream, delta.before, true);
+        }
+        if (delta.existsAfter) {
+            writeEntity(stream, delta.after, !sameShape);
+        }
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+bool EntityDeltaCommand::restoreState(QDataStream& stream)
+{
+    qint32 count = 0;
+    stream >> count;
+
+    std::vector<EntityDelta> deltas;
+    deltas.reserve(qMax(0, count));
+    m_stateBytes = 0;
+
+    for (qint32 i = 0; i < count; ++i) {
+        EntityDelta delta;
+        qint32 entityId = 0;
+        bool sameShape = false;
+        stream >> entityId >> delta.existedBefore >> delta.existsAfter >> sameShape;
+        delta.entityId = entityId;
+
+        if (delta.existedBefore && !readEntity(stream, delta.before, true)) {
+            return false;
+        }
+        if (delta.existsAfter) {
+            if (!readEntity(stream, delta.after, !sameShape)) {
+                return false;
+            }
+            if (sameShape) {
+                delta.after.shape = delta.before.shape;
+            }
+        }
+
+        m_stateBytes += estimateBytes(delta.before) + (sameShape ? 0 : estimateBytes(delta.after));
+        deltas.push_back(delta);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    m_deltas = std::move(deltas);
+    m_released = false;
+    return true;
+}
+
+void EntityDeltaCommand::releaseState()
+{
+    // Ids and flags are small; shapes and properties are what the budget is about
+    for (EntityDelta& delta : m_deltas) {
+        delta.before = CADEntity();
+        delta.after = CADEntity();
+    }
+    m_released = true;
+}
+
+void EntityDeltaCommand::writeEntity(QDataStream& stream, const CADEntity& entity, bool writeShape)
+{
+    stream << static_cast<qint32>(entity.type) << entity.layer << static_cast<qint32>(entity.color)
+           << static_cast<qint32>(entity.lineType) << entity.lineWeight << entity.visible << entity.properties;
+
+    if (!writeShape) {
+        return;
+    }
+
+    QByteArray shapeData;
+    if (!entity.shape.IsNull()) {
+        std::ostringstream out;
+        BinTools::Write(entity.shape, out);
+        const std::string data = out.str();
+        shapeData = QByteArray(data.data(), static_cast<int>(data.size()));
+    }
+    stream << shapeData;
+}
+
+bool EntityDeltaCommand::readEntity(QDataStream& stream, CADEntity& entity, bool readShape)
+{
+    qint32 type = 0;
+    qint32 color = 0;
+    qint32 lineType = 0;
+    stream >> type >> entity.layer >> color >> lineType >> entity.lineWeight >> entity.visible >> entity.properties;
+    entity.type = static_cast<CADEntity::Type>(type);
+    entity.color = color;
+    entity.lineType = lineType;
+
+    if (!readShape) {
+        return stream.status() == QDataStream::Ok;
+    }
+
+    QByteArray shapeData;
+    stream >> shapeData;
+    if (!shapeData.isEmpty()) {
+        try {
+            std::istringstream in(std::string(shapeData.constData(), shapeData.size()));
+            BinTools::Read(entity.shape, in);
+        } catch (const Standard_Failure& e) {
+            qCWarning(cadCommands) << "Failed to restore shape from undo state:" << e.GetMessageString();
+            return false;
+        }
+    }
+    return stream.status() == QDataStream::Ok;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CommandManager.h"
+#include "GeometryEngine.h"
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Undoable command storing only the entities it touched
+ *
+ * The first execute() snapshots the listed entities, runs the operation and
+ * snapshots them again together with any entities the operation added.
+ * Undo and redo then apply the before/after states directly instead of
+ * re-running the operation or keeping a copy of the whole drawing.
+ *
+ * Entities the operation modifies or removes must be listed in touchedIds;
+ * added entities are discovered from the engine's id watermark.
+ *
+ * Deltas serialize shapes with BinTools so the undo store can spill them.
+ */
+class EntityDeltaCommand : public CADCommand
+{
+public:
+    using Operation = std::function<void(GeometryEngine*)>;
+
+    EntityDeltaCommand(GeometryEngine* engine, const QString& name, Operation operation,
+                       const std::vector<int>& touchedIds = {});
+    ~EntityDeltaCommand() override;
+
+    void execute() override;
+    void undo() override;
+    void redo() override;
+
+    QString name() const override { return m_name; }
+    QString description() const override;
+
+    size_t memoryCost() const override;
+    bool canSpill() const override { return m_executed; }
+    bool saveState(QDataStream& stream) const override;
+    bool restoreState(QDataStream& stream) override;
+    void releaseState() override;
+
+    int deltaCount() const { return static_cast<int>(m_deltas.size()); }
+
+private:
+    struct EntityDelta {
+        int entityId;
+        bool existedBefore;
+        bool existsAfter;
+        CADEntity before;
+        CADEntity after;
+    };
+
+    void apply(bool forward);
+    CADEntity snapshot(int entityId, bool& exists) const;
+    static size_t estimateBytes(const CADEntity& entity);
+    static void writeEntity(QDataStream& stream, const CADEntity& entity, bool writeShape);
+    static bool readEntity(QDataStream& stream, CADEntity& entity, bool readShape);
+
+    GeometryEngine* m_geometryEngine;
+    QString m_name;
+    Operation m_operation;
+    std::vector<int> m_touchedIds;
+    std::vector<EntityDelta> m_deltas;
+    size_t m_stateBytes;
+    bool m_executed;
+    bool m_released;
+};
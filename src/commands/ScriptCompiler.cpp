@@ -0,0 +1,160 @@
+#include "ScriptCompiler.h"
+#include "CommandManager.h"
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+ScriptCompiler::ScriptCompiler(const CommandManager* manager)
+    : m_manager(manager)
+{
+}
+
+ScriptCompiler::~ScriptCompiler() = default;
+
+std::shared_ptr<const CompiledScript> ScriptCompiler::compileFile(const QString& path, QString* error)
+{
+    QFileInfo info(path);
+    if (!info.exists()) {
+        if (error) {
+            *error = QString("Script file does not exist: %1").arg(path);
+        }
+        return nullptr;
+    }
+
+    const QString key = info.absoluteFilePath();
+    const quint64 revision = m_manager->registryRevision();
+
+    auto it = m_fileCache.find(key);
+    if (it != m_fileCache.end() && it->registryRevision == revision &&
+        it->modified == info.lastModified() && it->size == info.size()) {
+        return it->script;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QString("Cannot open script file: %1").arg(path);
+        }
+        return nullptr;
+    }
+    const QByteArray data = file.readAll();
+    const QByteArray hash = hashOf(data);
+
+    // Touched but unchanged files keep their compiled form
+    if (it != m_fileCache.end() && it->registryRevision == revision && it->hash == hash) {
+        it->modified = info.lastModified();
+        it->size = info.size();
+        return it->script;
+    }
+
+    FileEntry entry;
+    entry.modified = info.lastModified();
+    entry.size = info.size();
+    entry.hash = hash;
+    entry.registryRevision = revision;
+    entry.script = compile(QString::fromUtf8(data), key);
+    m_fileCache.insert(key, entry);
+
+    return entry.script;
+}
+
+std::shared_ptr<const CompiledScript> ScriptCompiler::compileText(const QString& text, const QString& name)
+{
+    const QByteArray hash = hashOf(text.toUtf8());
+    const quint64 revision = m_manager->registryRevision();
+
+    auto it = m_textCache.find(hash);
+    if (it != m_textCache.end() && it->registryRevision == revision) {
+        return it->script;
+    }
+
+    if (m_textCache.size() >= MaxCachedTexts) {
+        m_textCache.clear();
+    }
+
+    TextEntry entry;
+    entry.registryRevision = revision;
+    entry.script = compile(text, name);
+    m_textCache.insert(hash, entry);
+    return entry.script;
+}
+
+void ScriptCompiler::clearCache()
+{
+    m_fileCache.clear();
+    m_textCache.clear();
+}
+
+std::shared_ptr<CompiledScript> ScriptCompiler::compile(const QString& text, const QString& name) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto script = std::make_shared<CompiledScript>();
+    script->name = name;
+
+    // Command name -> index into the factory table
+    QHash<QString, int> commandIndex;
+
+    const QStringList lines = text.split('\n');
+    script->instructions.reserve(lines.size());
+    script->sourceLines.reserve(lines.size());
+
+    for (int i = 0; i < lines.size(); ++i) {
+        const QString line = lines[i].trimmed();
+
+        // Skip comments and empty lines
+        if (line.isEmpty() || line.startsWith(';') || line.startsWith('#')) {
+            continue;
+        }
+
+        QStringList parts = m_manager->parseCommandLine(line);
+        if (parts.isEmpty()) {
+            continue;
+        }
+
+        ScriptInstruction instruction;
+        instruction.line = i + 1;
+        instruction.commandIndex = -1;
+
+        const QString commandName = m_manager->resolveAlias(parts.first());
+        if (commandName == "u" || commandName == "undo") {
+            instruction.op = ScriptInstruction::Undo;
+        } else if (commandName == "redo") {
+            instruction.op = ScriptInstruction::Redo;
+        } else if (commandName == "repeat") {
+            instruction.op = ScriptInstruction::Repeat;
+        } else {
+            auto indexIt = commandIndex.constFind(commandName);
+            if (indexIt == commandIndex.constEnd()) {
+                auto commandIt = m_manager->m_commands.constFind(commandName);
+                if (commandIt == m_manager->m_commands.constEnd()) {
+                    script->errors.insert(instruction.line, QString("Unknown command: %1").arg(parts.first()));
+                    continue;
+                }
+                indexIt = commandIndex.insert(commandName, static_cast<int>(script->factories.size()));
+                script->commandNames.append(commandName);
+                script->factories.push_back(commandIt->factory);
+            }
+
+            instruction.op = ScriptInstruction::Command;
+            instruction.commandIndex = indexIt.value();
+            parts.removeFirst();
+            instruction.args = parts;
+        }
+
+        script->instructions.push_back(std::move(instruction));
+        script->sourceLines.append(line);
+    }
+
+    script->compileTimeMs = timer.nsecsElapsed() / 1.0e6;
+    qCDebug(cadCommands) << "Compiled script" << name << ":" << script->instructions.size() << "instructions,"
+                         << script->errors.size() << "errors in" << script->compileTimeMs << "ms";
+    return script;
+}
+
+QByteArray ScriptCompiler::hashOf(const QByteArray& data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class CADCommand;
+class CommandManager;
+
+/**
+ * @brief One pre-parsed, pre-resolved script line
+ */
+struct ScriptInstruction
+{
+    enum Op : quint8 {
+        Command,
+        Undo,
+        Redo,
+        Repeat
+    };
+
+    Op op;
+    int commandIndex;           // Into CompiledScript::commandNames / factories
+    int line;                   // 1-based source line
+    QStringList args;
+};
+
+/**
+ * @brief Compact, validated form of a .scr script or macro
+ *
+ * Aliases are resolved and factories looked up once at compile time; each
+ * distinct command appears once in the factory table no matter how many
+ * lines use it. Scripts with errors are never executed.
+ */
+struct CompiledScript
+{
+    using Factory = std::function<std::unique_ptr<CADCommand>(const QStringList&)>;
+
+    QString name;
+    std::vector<ScriptInstruction> instructions;
+    QStringList commandNames;
+    std::vector<Factory> factories;
+    QStringList sourceLines;            // Executable lines, for macro recording
+    QMap<int, QString> errors;          // Line -> message
+    double compileTimeMs;
+
+    CompiledScript() : compileTimeMs(0.0) {}
+
+    bool isValid() const { return errors.isEmpty(); }
+    int lineCount() const { return static_cast<int>(instructions.size()); }
+};
+
+/**
+ * @brief Compiles scripts against a CommandManager's registry and caches them
+ *
+ * File results are keyed on path and revalidated by modification time and
+ * size first, then by content hash, so unchanged files are never re-read.
+ * Text (macros) is keyed on its hash. Any change to the command registry
+ * invalidates every cached result.
+ */
+class ScriptCompiler
+{
+public:
+    explicit ScriptCompiler(const CommandManager* manager);
+    ~ScriptCompiler();
+
+    std::shared_ptr<const CompiledScript> compileFile(const QString& path, QString* error = nullptr);
+    std::shared_ptr<const CompiledScript> compileText(const QString& text, const QString& name = QString());
+
+    void clearCache();
+    int cachedScriptCount() const { return m_fileCache.size() + m_textCache.size(); }
+
+private:
+    struct FileEntry {
+        QDateTime modified;
+        qint64 size;
+        QByteArray hash;
+        quint64 registryRevision;
+        std::shared_ptr<const CompiledScript> script;
+    };
+
+    struct TextEntry {
+        quint64 registryRevision;
+        std::shared_ptr<const CompiledScript> script;
+    };
+
+    std::shared_ptr<CompiledScript> compile(const QString& text, const QString& name) const;
+    static QByteArray hashOf(const QByteArray& data);
+
+    const CommandManager* m_manager;
+    QHash<QString, FileEntry> m_fileCache;
+    QHash<QByteArray, TextEntry> m_textCache;
+
+    static constexpr int MaxCachedTexts = 64;
+};
@@ -0,0 +1,432 @@
+#include "UndoStore.h"
+#include "CommandManager.h"
+#include <QDataStream>
+#include <QDir>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+
+Q_LOGGING_CATEGORY(cadUndo, "cad.undo")
+
+UndoStore::UndoStore(QObject* parent)
+    : QObject(parent)
+    , m_countLimit(100)
+    , m_hotEntries(4)
+    , m_memoryBudget(256LL * 1024 * 1024)
+    , m_residentBytes(0)
+    , m_spilledBytes(0)
+    , m_spillFailed(false)
+{
+    // One writer keeps appends to the spill file ordered
+    m_spillPool.setMaxThreadCount(1);
+}
+
+UndoStore::~UndoStore()
+{
+    clear();
+    m_spillPool.waitForDone();
+}
+
+// Undo stack
+void UndoStore::push(std::unique_ptr<CADCommand> command)
+{
+    if (!command) {
+        return;
+    }
+
+    clearRedo();
+    m_undo.push_back(makeEntry(std::move(command)));
+    enforceLimits();
+}
+
+void UndoStore::pushUndo(std::unique_ptr<CADCommand> command)
+{
+    if (!command) {
+        return;
+    }
+
+    m_undo.push_back(makeEntry(std::move(command)));
+    enforceLimits();
+}
+
+std::unique_ptr<CADCommand> UndoStore::takeUndo()
+{
+    if (m_undo.empty()) {
+        return nullptr;
+    }
+
+    EntryPtr entry = m_undo.back();
+    m_undo.pop_back();
+    std::unique_ptr<CADCommand> command = release(entry);
+    if (!command) {
+        // Older steps build on the lost one and cannot be undone past it
+        for (const EntryPtr& older : m_undo) {
+            discard(older);
+        }
+        m_undo.clear();
+        emit memoryUsageChanged(m_residentBytes.load(), m_spilledBytes.load());
+    }
+    return command;
+}
+
+// Redo stack
+void UndoStore::pushRedo(std::unique_ptr<CADCommand> command)
+{
+    if (!command) {
+        return;
+    }
+
+    m_redo.push_back(makeEntry(std::move(command)));
+    enforceLimits();
+}
+
+std::unique_ptr<CADCommand> UndoStore::takeRedo()
+{
+    if (m_redo.empty()) {
+        return nullptr;
+    }
+
+    EntryPtr entry = m_redo.back();
+    m_redo.pop_back();
+    std::unique_ptr<CADCommand> command = release(entry);
+    if (!command) {
+        // Later steps build on the lost one and cannot be redone past it
+        clearRedo();
+        emit memoryUsageChanged(m_residentBytes.load(), m_spilledBytes.load());
+    }
+    return command;
+}
+
+QStringList UndoStore::undoDescriptions() const
+{
+    QStringList descriptions;
+    for (const EntryPtr& entry : m_undo) {
+        descriptions.append(entry->description);
+    }
+    return descriptions;
+}
+
+QStringList UndoStore::redoDescriptions() const
+{
+    QStringList descriptions;
+    for (auto it = m_redo.rbegin(); it != m_redo.rend(); ++it) {
+        descriptions.append((*it)->description);
+    }
+    return descriptions;
+}
+
+QString UndoStore::lastUndoName() const
+{
+    return m_undo.empty() ? QString() : m_undo.back()->command->name();
+}
+
+void UndoStore::clear()
+{
+    for (const EntryPtr& entry : m_undo) {
+        discard(entry);
+    }
+    m_undo.clear();
+    clearRedo();
+
+    // Wait for in-flight writes before truncating; they see the discarded state and skip
+    m_spillPool.waitForDone();
+    QMutexLocker locker(&m_fileMutex);
+    if (m_spillFile) {
+        m_spillFile->resize(0);
+    }
+    m_freeRanges.clear();
+    m_spilledBytes = 0;
+    m_spillFailed = false;
+}
+
+void UndoStore::clearRedo()
+{
+    for (const EntryPtr& entry : m_redo) {
+        discard(entry);
+    }
+    m_redo.clear();
+}
+
+// Limits
+void UndoStore::setCountLimit(int limit)
+{
+    m_countLimit = qMax(1, limit);
+    enforceLimits();
+}
+
+void UndoStore::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = qMax<qint64>(0, bytes);
+    enforceLimits();
+}
+
+int UndoStore::spilledCount() const
+{
+    QMutexLocker locker(&m_fileMutex);
+    int count = 0;
+    for (const EntryPtr& entry : m_undo) {
+        count += entry->state != State::Resident ? 1 : 0;
+    }
+    for (const EntryPtr& entry : m_redo) {
+        count += entry->state != State::Resident ? 1 : 0;
+    }
+    return count;
+}
+
+void UndoStore::flush()
+{
+    m_spillPool.waitForDone();
+}
+
+// Private methods
+UndoStore::EntryPtr UndoStore::makeEntry(std::unique_ptr<CADCommand> command)
+{
+    auto entry = std::make_shared<Entry>();
+    entry->description = command->description();
+    entry->bytes = static_cast<qint64>(command->memoryCost());
+    entry->command = std::move(command);
+    m_residentBytes += entry->bytes;
+    return entry;
+}
+
+std::unique_ptr<CADCommand> UndoStore::release(EntryPtr entry)
+{
+    const bool restored = pageIn(*entry);
+    m_residentBytes -= entry->bytes;
+    emit memoryUsageChanged(m_residentBytes.load(), m_spilledBytes.load());
+    if (!restored) {
+        // Running the command without its state would silently do the wrong thing
+        return nullptr;
+    }
+    return std::move(entry->command);
+}
+
+bool UndoStore::pageIn(Entry& entry)
+{
+    QByteArray payload;
+    {
+        QMutexLocker locker(&m_fileMutex);
+        if (entry.state == State::Resident) {
+            return true;
+        }
+
+        if (entry.state == State::Spilling) {
+            // Still queued for the writer, or its write failed: the raw payload is at hand
+            payload = entry.pending;
+        } else {
+            if (m_spillFile && m_spillFile->seek(entry.offset)) {
+                payload = qUncompress(m_spillFile->read(entry.length));
+            }
+            freeRange(entry.offset, entry.length);
+            m_spilledBytes -= entry.length;
+        }
+
+        dropPending(entry);
+        entry.state = State::Resident;
+    }
+
+    QDataStream in(&payload, QIODevice::ReadOnly);
+    if (payload.isEmpty() || !entry.command->restoreState(in)) {
+        qCWarning(cadUndo) << "Failed to page in undo state for" << entry.description << "- step dropped";
+        return false;
+    }
+
+    // The command was accounted at its released size while spilled
+    m_residentBytes -= entry.bytes;
+    entry.bytes = static_cast<qint64>(entry.command->memoryCost());
+    m_residentBytes += entry.bytes;
+
+    qCDebug(cadUndo) << "Paged in" << entry.description << "(" << payload.size() << "bytes)";
+    return true;
+}
+
+// Called with m_fileMutex held
+void UndoStore::dropPending(Entry& entry)
+{
+    entry.pending.clear();
+    m_residentBytes -= entry.heldBytes;
+    entry.heldBytes = 0;
+}
+
+void UndoStore::spill(const EntryPtr& entry)
+{
+    CADCommand* command = entry->command.get();
+    if (entry->state != State::Resident || !command->canSpill() || m_spillFailed) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_fileMutex);
+        if (!ensureSpillFile()) {
+            return;
+        }
+    }
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    if (!command->saveState(out)) {
+        return;
+    }
+
+    command->releaseState();
+    m_residentBytes -= entry->bytes;
+    entry->bytes = static_cast<qint64>(command->memoryCost());
+    m_residentBytes += entry->bytes;
+
+    {
+        QMutexLocker locker(&m_fileMutex);
+        entry->pending = payload;
+        entry->state = State::Spilling;
+    }
+
+    // Compression and the disk write happen off the UI thread
+    m_spillPool.start([this, entry]() {
+        QByteArray raw;
+        {
+            QMutexLocker locker(&m_fileMutex);
+            if (entry->state != State::Spilling) {
+                return;
+            }
+            raw = entry->pending;
+        }
+
+        QByteArray compressed = qCompress(raw, 1);
+
+        QMutexLocker locker(&m_fileMutex);
+        if (entry->state != State::Spilling || !m_spillFile) {
+            return;     // Paged back in or discarded meanwhile
+        }
+
+        const qint64 offset = allocateRange(compressed.size());
+        if (!m_spillFile->seek(offset) || m_spillFile->write(compressed) != compressed.size()) {
+            // Keep the raw payload in memory rather than losing the step, and count it:
+            // the budget then drops old steps instead of spilling into a full disk
+            qCWarning(cadUndo) << "Failed to write undo spill file, spilling disabled:" << m_spillFile->errorString();
+            freeRange(offset, compressed.size());
+            entry->heldBytes = entry->pending.size();
+            m_residentBytes += entry->heldBytes;
+            m_spillFailed = true;
+            return;
+        }
+
+        entry->offset = offset;
+        entry->length = compressed.size();
+        entry->pending.clear();
+        entry->state = State::Spilled;
+        m_spilledBytes += entry->length;
+    });
+}
+
+void UndoStore::discard(const EntryPtr& entry)
+{
+    {
+        QMutexLocker locker(&m_fileMutex);
+        if (entry->state == State::Spilled) {
+            freeRange(entry->offset, entry->length);
+            m_spilledBytes -= entry->length;
+        }
+        // Any queued write for this entry now sees a resident state and skips
+        dropPending(*entry);
+        entry->state = State::Resident;
+    }
+    m_residentBytes -= entry->bytes;
+}
+
+void UndoStore::enforceLimits()
+{
+    while (static_cast<int>(m_undo.size()) > m_countLimit) {
+        discard(m_undo.front());
+        m_undo.pop_front();
+    }
+
+    if (m_memoryBudget > 0 && m_residentBytes > m_memoryBudget) {
+        // Spill oldest undo steps first, then the deepest redo steps
+        const size_t undoCold = m_undo.size() > static_cast<size_t>(m_hotEntries) ? m_undo.size() - m_hotEntries : 0;
+        for (size_t i = 0; i < undoCold && m_residentBytes > m_memoryBudget; ++i) {
+            spill(m_undo[i]);
+        }
+
+        const size_t redoCold = m_redo.size() > static_cast<size_t>(m_hotEntries) ? m_redo.size() - m_hotEntries : 0;
+        for (size_t i = 0; i < redoCold && m_residentBytes > m_memoryBudget; ++i) {
+            spill(m_redo[i]);
+        }
+
+        // Whatever cannot spill is dropped, oldest first, keeping the hot window
+        int dropped = 0;
+        while (m_residentBytes > m_memoryBudget && static_cast<int>(m_undo.size()) > m_hotEntries) {
+            discard(m_undo.front());
+            m_undo.pop_front();
+            ++dropped;
+        }
+
+        if (dropped > 0) {
+            qCWarning(cadUndo) << "Undo memory budget exceeded, dropped" << dropped << "oldest steps";
+        }
+    }
+
+    emit memoryUsageChanged(m_residentBytes.load(), m_spilledBytes.load());
+}
+
+bool UndoStore::ensureSpillFile()
+{
+    if (m_spillFile) {
+        return true;
+    }
+
+    auto file = std::make_unique<QTemporaryFile>(QDir::tempPath() + "/cad_undo_XXXXXX.bin");
+    if (!file->open()) {
+        qCWarning(cadUndo) << "Cannot create undo spill file:" << file->errorString();
+        return false;
+    }
+
+    qCDebug(cadUndo) << "Undo spill file:" << file->fileName();
+    m_spillFile = std::move(file);
+    return true;
+}
+
+// Spill file space; called with m_fileMutex held
+qint64 UndoStore::allocateRange(qint64 length)
+{
+    // First fit keeps the front of the file dense and lets the tail be truncated
+    for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it) {
+        if (it->second < length) {
+            continue;
+        }
+        const qint64 offset = it->first;
+        const qint64 remaining = it->second - length;
+        m_freeRanges.erase(it);
+        if (remaining > 0) {
+            m_freeRanges.emplace(offset + length, remaining);
+        }
+        return offset;
+    }
+    return m_spillFile->size();
+}
+
+void UndoStore::freeRange(qint64 offset, qint64 length)
+{
+    if (offset < 0 || length <= 0) {
+        return;
+    }
+
+    // Merge with the neighbouring free ranges
+    auto next = m_freeRanges.lower_bound(offset);
+    if (next != m_freeRanges.end() && offset + length == next->first) {
+        length += next->second;
+        next = m_freeRanges.erase(next);
+    }
+    if (next != m_freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            length += previous->second;
+            m_freeRanges.erase(previous);
+        }
+    }
+
+    // A free tail is given back to the file system instead of being kept for reuse
+    if (m_spillFile && offset + length >= m_spillFile->size()) {
+        m_spillFile->resize(offset);
+        return;
+    }
+    m_freeRanges.emplace(offset, length);
+}
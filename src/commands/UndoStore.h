@@ -0,0 +1,137 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+#include <QLoggingCategory>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+
+class CADCommand;
+class QTemporaryFile;
+
+Q_DECLARE_LOGGING_CATEGORY(cadUndo)
+
+/**
+ * @brief Memory-budgeted storage for the undo and redo history
+ *
+ * Every command is accounted by CADCommand::memoryCost(). When the resident
+ * total exceeds the budget:
+ * - The oldest spillable entries (outside the hot window of recent steps)
+ *   are serialized, their in-memory state is released, and the payload is
+ *   compressed and written to a temp file on a background thread
+ * - Ranges of the file freed by paged-in or discarded entries are reused by
+ *   later spills, and a free tail is truncated, so the file stays bounded
+ *   by the spilled history rather than by the session length
+ * - Entries that cannot spill are dropped oldest-first once nothing else
+ *   can be reclaimed
+ *
+ * Taking a spilled entry for undo or redo pages its state back in
+ * transparently; callers only ever see fully resident commands. If the
+ * state cannot be read back, take returns null and the steps that build on
+ * the lost one are dropped with it. A failed disk write keeps the payload
+ * in memory, counted as resident, and turns spilling off until clear().
+ */
+class UndoStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UndoStore(QObject* parent = nullptr);
+    ~UndoStore();
+
+    // Undo stack
+    void push(std::unique_ptr<CADCommand> command);         // New command, clears redo
+    void pushUndo(std::unique_ptr<CADCommand> command);     // Redone command, keeps redo
+    std::unique_ptr<CADCommand> takeUndo();     // Null if the step could not be paged in
+
+    // Redo stack
+    void pushRedo(std::unique_ptr<CADCommand> command);
+    std::unique_ptr<CADCommand> takeRedo();     // Null if the step could not be paged in
+
+    bool canUndo() const { return !m_undo.empty(); }
+    bool canRedo() const { return !m_redo.empty(); }
+    int undoCount() const { return static_cast<int>(m_undo.size()); }
+    int redoCount() const { return static_cast<int>(m_redo.size()); }
+
+    QStringList undoDescriptions() const;       // Oldest first
+    QStringList redoDescriptions() const;       // Next redo first
+    QString lastUndoName() const;
+
+    void clear();
+    void clearRedo();
+
+    // Limits
+    void setCountLimit(int limit);
+    int countLimit() const { return m_countLimit; }
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const { return m_memoryBudget; }
+
+    void setHotEntries(int count) { m_hotEntries = qMax(1, count); }
+    int hotEntries() const { return m_hotEntries; }
+
+    // Accounting
+    qint64 residentBytes() const { return m_residentBytes.load(); }
+    qint64 spilledBytes() const { return m_spilledBytes.load(); }
+    int spilledCount() const;
+
+    // Block until queued spills have reached the disk
+    void flush();
+
+signals:
+    void memoryUsageChanged(qint64 residentBytes, qint64 spilledBytes);
+
+private:
+    enum class State {
+        Resident,
+        Spilling,       // State released, payload waiting for the writer
+        Spilled         // Compressed payload in the temp file
+    };
+
+    struct Entry {
+        std::unique_ptr<CADCommand> command;
+        QString description;
+        qint64 bytes;
+        State state;
+        QByteArray pending;
+        qint64 heldBytes;           // Pending payload kept after a failed write, counted as resident
+        qint64 offset;
+        qint64 length;
+
+        Entry() : bytes(0), state(State::Resident), heldBytes(0), offset(-1), length(0) {}
+    };
+
+    using EntryPtr = std::shared_ptr<Entry>;
+
+    EntryPtr makeEntry(std::unique_ptr<CADCommand> command);
+    std::unique_ptr<CADCommand> release(EntryPtr entry);
+    bool pageIn(Entry& entry);
+    void dropPending(Entry& entry);
+    void spill(const EntryPtr& entry);
+    void discard(const EntryPtr& entry);
+    void enforceLimits();
+    bool ensureSpillFile();
+    qint64 allocateRange(qint64 length);
+    void freeRange(qint64 offset, qint64 length);
+
+    std::deque<EntryPtr> m_undo;        // Back is the most recent
+    std::deque<EntryPtr> m_redo;        // Back is the next redo
+
+    int m_countLimit;
+    int m_hotEntries;
+    qint64 m_memoryBudget;
+    std::atomic<qint64> m_residentBytes;
+    std::atomic<qint64> m_spilledBytes;
+    std::atomic<bool> m_spillFailed;
+
+    // Writer state, shared with the spill thread
+    mutable QMutex m_fileMutex;
+    std::unique_ptr<QTemporaryFile> m_spillFile;
+    std::map<qint64, qint64> m_freeRanges;     // Offset to length, coalesced
+    QThreadPool m_spillPool;
+};
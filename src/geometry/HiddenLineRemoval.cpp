@@ -0,0 +1,484 @@
+#include "HiddenLineRemoval.h"
+#include "Tracing.h"
+#include "GeometryEngine.h"
+#include "Parallel.h"
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <unordered_set>
+
+#include <BRep_Builder.hxx>
+#include <BRepAdaptor_Curve.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <GCPnts_TangentialDeflection.hxx>
+#include <HLRAlgo_Projector.hxx>
+#include <HLRBRep_Algo.hxx>
+#include <HLRBRep_HLRToShape.hxx>
+#include <HLRBRep_PolyAlgo.hxx>
+#include <HLRBRep_PolyHLRToShape.hxx>
+#include <Standard_Failure.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+#include <gp.hxx>
+#include <gp_Ax2.hxx>
+
+Q_LOGGING_CATEGORY(cadHLR, "cad.hlr")
+
+namespace {
+
+// Directions closer than this are treated as the same view
+constexpr double DirectionQuantum = 1.0e-4;
+
+inline quint64 mix(quint64 seed, quint64 value)
+{
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+inline quint64 quantize(double value)
+{
+    return static_cast<quint64>(static_cast<qint64>(std::llround(value / DirectionQuantum)));
+}
+
+gp_Ax2 projectionAxes(const HLRView& view)
+{
+    gp_Dir xDir(1, 0, 0);
+    gp_Vec x = gp_Vec(view.upDirection).Crossed(gp_Vec(view.viewDirection));
+    if (x.Magnitude() > gp::Resolution()) {
+        xDir = gp_Dir(x);
+    } else if (std::abs(view.viewDirection.X()) > 0.9) {
+        xDir = gp_Dir(0, 1, 0);
+    }
+    return gp_Ax2(gp_Pnt(0, 0, 0), view.viewDirection, xDir);
+}
+
+void addIfValid(BRep_Builder& builder, TopoDS_Compound& compound, const TopoDS_Shape& shape)
+{
+    if (!shape.IsNull()) {
+        builder.Add(compound, shape);
+    }
+}
+
+struct Rect2D {
+    int entityId;
+    double minX, minY, maxX, maxY;
+};
+
+int findRoot(std::vector<int>& parent, int i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+} // namespace
+
+// HLRView / HLRResult
+quint64 HLRView::cacheKey() const
+{
+    quint64 key = 0;
+    key = mix(key, quantize(viewDirection.X()));
+    key = mix(key, quantize(viewDirection.Y()));
+    key = mix(key, quantize(viewDirection.Z()));
+    key = mix(key, quantize(upDirection.X()));
+    key = mix(key, quantize(upDirection.Y()));
+    key = mix(key, quantize(upDirection.Z()));
+    key = mix(key, perspective ? 1 : 0);
+    if (perspective) {
+        key = mix(key, quantize(focalDistance));
+    }
+    return key;
+}
+
+size_t HLRResult::visibleSegmentCount() const
+{
+    size_t count = 0;
+    for (const auto& cluster : clusters) {
+        count += cluster->visibleSegments.size() / 4;
+    }
+    return count;
+}
+
+size_t HLRResult::hiddenSegmentCount() const
+{
+    size_t count = 0;
+    for (const auto& cluster : clusters) {
+        count += cluster->hiddenSegments.size() / 4;
+    }
+    return count;
+}
+
+// HiddenLineRemoval implementation
+HiddenLineRemoval::HiddenLineRemoval(GeometryEngine* engine, QObject* parent)
+    : QObject(parent)
+    , m_geometryEngine(engine)
+    , m_useCounter(0)
+    , m_exact(false)
+    , m_deflection(0.1)
+    , m_maxCachedViews(8)
+{
+    if (m_geometryEngine) {
+        connect(m_geometryEngine, &GeometryEngine::entityModified, this, &HiddenLineRemoval::onEntityChanged);
+        connect(m_geometryEngine, &GeometryEngine::entityRemoved, this, &HiddenLineRemoval::onEntityRemoved);
+        connect(m_geometryEngine, &GeometryEngine::entitiesCleared, this, &HiddenLineRemoval::onEntitiesCleared);
+    }
+}
+
+HiddenLineRemoval::~HiddenLineRemoval() = default;
+
+void HiddenLineRemoval::setExact(bool exact)
+{
+    if (m_exact != exact) {
+        m_exact = exact;
+        clearCache();
+    }
+}
+
+void HiddenLineRemoval::setDeflection(double deflection)
+{
+    if (deflection > 0.0 && deflection != m_deflection) {
+        m_deflection = deflection;
+        clearCache();
+    }
+}
+
+void HiddenLineRemoval::setMaxCachedViews(int count)
+{
+    m_maxCachedViews = std::max(1, count);
+    evictViews();
+}
+
+void HiddenLineRemoval::invalidateEntity(int entityId)
+{
+    // Bumping the revision changes the key of every cluster containing the entity
+    ++m_revisions[entityId];
+}
+
+void HiddenLineRemoval::clearCache()
+{
+    m_viewCaches.clear();
+}
+
+void HiddenLineRemoval::onEntityChanged(int entityId)
+{
+    invalidateEntity(entityId);
+}
+
+void HiddenLineRemoval::onEntityRemoved(int entityId)
+{
+    m_revisions.erase(entityId);
+}
+
+void HiddenLineRemoval::onEntitiesCleared()
+{
+    // Ids start over, so cluster keys of the new drawing would match old results
+    m_revisions.clear();
+    clearCache();
+}
+
+HLRResult HiddenLineRemoval::compute(const HLRView& view, const std::vector<int>& entityIds)
+{
+    CAD_TRACE_SCOPE("render", "hiddenLineRemoval");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    HLRResult result;
+    result.viewKey = view.cacheKey();
+    if (!m_geometryEngine) {
+        return result;
+    }
+
+    std::vector<int> ids = entityIds;
+    if (ids.empty()) {
+        for (int id : m_geometryEngine->getAllEntityIds()) {
+            if (m_geometryEngine->getEntity(id).visible) {
+                ids.push_back(id);
+            }
+        }
+    }
+
+    ViewCache& cache = m_viewCaches[result.viewKey];
+    cache.lastUsed = ++m_useCounter;
+
+    // Split into independent clusters and separate cache hits from work
+    QHash<quint64, std::shared_ptr<const HLRClusterResult>> retained;
+    std::vector<ClusterInput> pending;
+
+    for (auto& clusterIds : buildClusters(view, ids)) {
+        quint64 key = clusterKey(clusterIds);
+        auto hit = cache.clusters.constFind(key);
+        if (hit != cache.clusters.constEnd()) {
+            retained.insert(key, hit.value());
+            result.clusters.push_back(hit.value());
+            ++result.clustersReused;
+            continue;
+        }
+
+        ClusterInput input;
+        input.key = key;
+        input.shapes.reserve(clusterIds.size());
+        for (int id : clusterIds) {
+            input.shapes.push_back(m_geometryEngine->getEntity(id).shape);
+        }
+        input.entityIds = std::move(clusterIds);
+        pending.push_back(std::move(input));
+    }
+
+    if (!pending.empty()) {
+        // Largest clusters first so the pool drains evenly
+        std::sort(pending.begin(), pending.end(), [](const ClusterInput& a, const ClusterInput& b) {
+            return a.entityIds.size() > b.entityIds.size();
+        });
+
+        std::vector<std::shared_ptr<const HLRClusterResult>> computed(pending.size());
+        std::atomic<int> next(0);
+        std::atomic<int> completed(0);
+        const int total = static_cast<int>(pending.size());
+        const bool exact = m_exact;
+        const double deflection = m_deflection;
+
+        // Triangulations are stored on the shared TShapes, and block inserts
+        // share theirs across clusters: mesh each one here, before the workers
+        // read them, instead of concurrently inside the clusters
+        if (!exact) {
+            CAD_TRACE_SCOPE("render", "hlrMesh");
+            std::unordered_set<const void*> meshed;
+            for (const ClusterInput& input : pending) {
+                for (const TopoDS_Shape& shape : input.shapes) {
+                    if (!shape.IsNull() && meshed.insert(shape.TShape().get()).second) {
+                        BRepMesh_IncrementalMesh mesher(shape, deflection);
+                    }
+                }
+            }
+        }
+
+        // A local pool so progress can be reported while it drains
+        QThreadPool pool;
+        int workers = std::min(total, Parallel::maxThreads());
+        pool.setMaxThreadCount(workers);
+        for (int w = 0; w < workers; ++w) {
+            pool.start([&]() {
+                for (int i = next++; i < total; i = next++) {
+                    computed[i] = computeCluster(pending[i], view, exact, deflection);
+                    ++completed;
+                }
+            });
+        }
+
+        while (!pool.waitForDone(50)) {
+            emit progressChanged(completed.load(), total);
+        }
+        emit progressChanged(total, total);
+
+        for (size_t i = 0; i < pending.size(); ++i) {
+            if (computed[i]) {
+                retained.insert(pending[i].key, computed[i]);
+                result.clusters.push_back(computed[i]);
+            }
+        }
+        result.clustersComputed = total;
+    }
+
+    // Clusters that no longer exist in this view are dropped
+    cache.clusters = retained;
+    evictViews();
+
+    result.totalTimeMs = timer.nsecsElapsed() / 1.0e6;
+    qCDebug(cadHLR) << "HLR:" << ids.size() << "entities," << result.clustersComputed << "clusters computed,"
+                    << result.clustersReused << "reused in" << result.totalTimeMs << "ms";
+    return result;
+}
+
+std::vector<std::vector<int>> HiddenLineRemoval::buildClusters(const HLRView& view,
+                                                               const std::vector<int>& entityIds) const
+{
+    gp_Ax2 axes = projectionAxes(view);
+    const gp_Dir& xDir = axes.XDirection();
+    const gp_Dir& yDir = axes.YDirection();
+
+    std::vector<Rect2D> rects;
+    rects.reserve(entityIds.size());
+    for (int id : entityIds) {
+        auto box = m_geometryEngine->getBoundingBox(id);
+        const gp_Pnt& lo = box.first;
+        const gp_Pnt& hi = box.second;
+
+        Rect2D rect = {id, 1e300, 1e300, -1e300, -1e300};
+        for (int corner = 0; corner < 8; ++corner) {
+            gp_Vec p((corner & 1) ? hi.X() : lo.X(),
+                     (corner & 2) ? hi.Y() : lo.Y(),
+                     (corner & 4) ? hi.Z() : lo.Z());
+            double x = p.Dot(gp_Vec(xDir));
+            double y = p.Dot(gp_Vec(yDir));
+            rect.minX = std::min(rect.minX, x);
+            rect.maxX = std::max(rect.maxX, x);
+            rect.minY = std::min(rect.minY, y);
+            rect.maxY = std::max(rect.maxY, y);
+        }
+        rects.push_back(rect);
+    }
+
+    // Sweep along x; entities whose projected rectangles overlap end up in one cluster
+    std::vector<int> order(rects.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&rects](int a, int b) { return rects[a].minX < rects[b].minX; });
+
+    std::vector<int> parent(rects.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    std::vector<int> active;
+
+    for (int i : order) {
+        const Rect2D& r = rects[i];
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [&rects, &r](int a) { return rects[a].maxX < r.minX; }),
+                     active.end());
+        for (int a : active) {
+            if (rects[a].maxY >= r.minY && rects[a].minY <= r.maxY) {
+                parent[findRoot(parent, a)] = findRoot(parent, i);
+            }
+        }
+        active.push_back(i);
+    }
+
+    std::unordered_map<int, size_t> clusterIndex;
+    std::vector<std::vector<int>> clusters;
+    for (size_t i = 0; i < rects.size(); ++i) {
+        int root = findRoot(parent, static_cast<int>(i));
+        auto it = clusterIndex.find(root);
+        if (it == clusterIndex.end()) {
+            it = clusterIndex.emplace(root, clusters.size()).first;
+            clusters.emplace_back();
+        }
+        clusters[it->second].push_back(rects[i].entityId);
+    }
+
+    return clusters;
+}
+
+quint64 HiddenLineRemoval::clusterKey(const std::vector<int>& entityIds) const
+{
+    std::vector<int> sorted = entityIds;
+    std::sort(sorted.begin(), sorted.end());
+
+    quint64 key = sorted.size();
+    for (int id : sorted) {
+        auto it = m_revisions.find(id);
+        key = mix(key, static_cast<quint64>(id));
+        key = mix(key, it != m_revisions.end() ? it->second : 0);
+    }
+    return key;
+}
+
+void HiddenLineRemoval::evictViews()
+{
+    while (m_viewCaches.size() > m_maxCachedViews) {
+        auto oldest = m_viewCaches.begin();
+        for (auto it = m_viewCaches.begin(); it != m_viewCaches.end(); ++it) {
+            if (it->lastUsed < oldest->lastUsed) {
+                oldest = it;
+            }
+        }
+        m_viewCaches.erase(oldest);
+    }
+}
+
+std::shared_ptr<const HLRClusterResult> HiddenLineRemoval::computeCluster(const ClusterInput& input,
+                                                                          const HLRView& view,
+                                                                          bool exact, double deflection)
+{
+    CAD_TRACE_SCOPE("render", "hlrCluster");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    auto result = std::make_shared<HLRClusterResult>();
+    result->entityIds = input.entityIds;
+
+    HLRAlgo_Projector projector = view.perspective
+        ? HLRAlgo_Projector(projectionAxes(view), view.focalDistance)
+        : HLRAlgo_Projector(projectionAxes(view));
+
+    BRep_Builder builder;
+    TopoDS_Compound visible;
+    TopoDS_Compound hidden;
+    builder.MakeCompound(visible);
+    builder.MakeCompound(hidden);
+
+    try {
+        if (exact) {
+            Handle(HLRBRep_Algo) algo = new HLRBRep_Algo();
+            for (const TopoDS_Shape& shape : input.shapes) {
+                if (!shape.IsNull()) {
+                    algo->Add(shape);
+                }
+            }
+            algo->Projector(projector);
+            algo->Update();
+            algo->Hide();
+
+            HLRBRep_HLRToShape toShape(algo);
+            addIfValid(builder, visible, toShape.VCompound());
+            addIfValid(builder, visible, toShape.OutLineVCompound());
+            addIfValid(builder, visible, toShape.Rg1LineVCompound());
+            addIfValid(builder, hidden, toShape.HCompound());
+            addIfValid(builder, hidden, toShape.OutLineHCompound());
+        } else {
+            // Polygonal HLR works on the triangulation, which is far cheaper for
+            // display; compute() has meshed every shape already
+            Handle(HLRBRep_PolyAlgo) algo = new HLRBRep_PolyAlgo();
+            for (const TopoDS_Shape& shape : input.shapes) {
+                if (!shape.IsNull()) {
+                    algo->Load(shape);
+                }
+            }
+            algo->Projector(projector);
+            algo->Update();
+
+            HLRBRep_PolyHLRToShape toShape;
+            toShape.Update(algo);
+            addIfValid(builder, visible, toShape.VCompound());
+            addIfValid(builder, visible, toShape.OutLineVCompound());
+            addIfValid(builder, visible, toShape.Rg1LineVCompound());
+            addIfValid(builder, hidden, toShape.HCompound());
+            addIfValid(builder, hidden, toShape.OutLineHCompound());
+        }
+    } catch (const Standard_Failure& e) {
+        qCWarning(cadHLR) << "HLR failed for cluster of" << input.entityIds.size() << "entities:"
+                          << e.GetMessageString();
+    }
+
+    result->visibleShape = visible;
+    result->hiddenShape = hidden;
+    discretize(visible, deflection, result->visibleSegments);
+    discretize(hidden, deflection, result->hiddenSegments);
+    result->computeTimeMs = timer.nsecsElapsed() / 1.0e6;
+
+    return result;
+}
+
+void HiddenLineRemoval::discretize(const TopoDS_Shape& shape, double deflection, std::vector<float>& segments)
+{
+    for (TopExp_Explorer exp(shape, TopAbs_EDGE); exp.More(); exp.Next()) {
+        try {
+            BRepAdaptor_Curve curve(TopoDS::Edge(exp.Current()));
+            GCPnts_TangentialDeflection points(curve, 0.1, deflection);
+            for (int i = 1; i < points.NbPoints(); ++i) {
+                gp_Pnt a = points.Value(i);
+                gp_Pnt b = points.Value(i + 1);
+                segments.push_back(static_cast<float>(a.X()));
+                segments.push_back(static_cast<float>(a.Y()));
+                segments.push_back(static_cast<float>(b.X()));
+                segments.push_back(static_cast<float>(b.Y()));
+            }
+        } catch (const Standard_Failure&) {
+            // Degenerate projected edge, nothing to draw
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QLoggingCategory>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <TopoDS_Shape.hxx>
+#include <gp_Dir.hxx>
+
+class GeometryEngine;
+
+Q_DECLARE_LOGGING_CATEGORY(cadHLR)
+
+/**
+ * @brief View parameters an HLR result is computed for
+ *
+ * Directions are quantized so that tiny orbit jitter still hits the cache.
+ */
+struct HLRView
+{
+    gp_Dir viewDirection;       // From target towards the eye
+    gp_Dir upDirection;
+    bool perspective;
+    double focalDistance;
+
+    HLRView()
+        : viewDirection(0, 0, 1), upDirection(0, 1, 0), perspective(false), focalDistance(0.0) {}
+
+    quint64 cacheKey() const;
+};
+
+/**
+ * @brief Projected 2D line work for one cluster of mutually occluding entities
+ *
+ * Segment arrays hold x0, y0, x1, y1 in view-plane coordinates so they can
+ * be drawn directly on screen or sent to a plotter.
+ */
+struct HLRClusterResult
+{
+    std::vector<int> entityIds;
+    TopoDS_Shape visibleShape;
+    TopoDS_Shape hiddenShape;
+    std::vector<float> visibleSegments;
+    std::vector<float> hiddenSegments;
+    double computeTimeMs;
+
+    HLRClusterResult() : computeTimeMs(0.0) {}
+};
+
+/**
+ * @brief Complete hidden-line result for one view
+ */
+struct HLRResult
+{
+    quint64 viewKey;
+    std::vector<std::shared_ptr<const HLRClusterResult>> clusters;
+    int clustersComputed;
+    int clustersReused;
+    double totalTimeMs;
+
+    HLRResult() : viewKey(0), clustersComputed(0), clustersReused(0), totalTimeMs(0.0) {}
+
+    size_t visibleSegmentCount() const;
+    size_t hiddenSegmentCount() const;
+};
+
+/**
+ * @brief Cached, parallel hidden-line removal for the Hidden visual style
+ *
+ * Pipeline:
+ * - Entity bounding boxes are projected onto the view plane and grouped into
+ *   clusters whose projections overlap; only entities in the same cluster
+ *   can hide each other, so clusters are computed independently
+ * - Clusters run on a thread pool local to compute() with HLRBRep_PolyAlgo
+ *   (or the exact HLRBRep_Algo when requested, e.g. for final plots); shapes
+ *   are meshed once beforehand on the calling thread
+ * - Results are cached per quantized view direction and per cluster content;
+ *   a cluster is recomputed only when one of its entities changed revision
+ */
+class HiddenLineRemoval : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HiddenLineRemoval(GeometryEngine* engine, QObject* parent = nullptr);
+    ~HiddenLineRemoval();
+
+    // Computation
+    HLRResult compute(const HLRView& view, const std::vector<int>& entityIds = {});
+
+    // Settings
+    void setExact(bool exact);
+    bool isExact() const { return m_exact; }
+
+    void setDeflection(double deflection);
+    double deflection() const { return m_deflection; }
+
+    void setMaxCachedViews(int count);
+    int maxCachedViews() const { return m_maxCachedViews; }
+
+    // Cache management
+    void invalidateEntity(int entityId);
+    void clearCache();
+    int cachedViewCount() const { return m_viewCaches.size(); }
+
+signals:
+    void progressChanged(int completed, int total);
+
+private slots:
+    void onEntityChanged(int entityId);
+    void onEntityRemoved(int entityId);
+    void onEntitiesCleared();
+
+private:
+    struct ClusterInput {
+        quint64 key;
+        std::vector<int> entityIds;
+        std::vector<TopoDS_Shape> shapes;
+    };
+
+    struct ViewCache {
+        QHash<quint64, std::shared_ptr<const HLRClusterResult>> clusters;
+        quint64 lastUsed;
+    };
+
+    std::vector<std::vector<int>> buildClusters(const HLRView& view, const std::vector<int>& entityIds) const;
+    quint64 clusterKey(const std::vector<int>& entityIds) const;
+    void evictViews();
+
+    static std::shared_ptr<const HLRClusterResult> computeCluster(const ClusterInput& input, const HLRView& view,
+                                                                  bool exact, double deflection);
+    static void discretize(const TopoDS_Shape& shape, double deflection, std::vector<float>& segments);
+
+    GeometryEngine* m_geometryEngine;
+    std::unordered_map<int, quint64> m_revisions;
+    QHash<quint64, ViewCache> m_viewCaches;
+    quint64 m_useCounter;
+
+    bool m_exact;
+    double m_deflection;
+    int m_maxCachedViews;
+};
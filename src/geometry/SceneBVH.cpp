@@ -0,0 +1,416 @@
+#include "SceneBVH.h"
+#include "Tracing.h"
+#include <QElapsedTimer>
+#include <QVector4D>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Q_LOGGING_CATEGORY(cadCulling, "cad.culling")
+
+namespace {
+
+bool overlaps(const SceneBounds& a, const SceneBounds& b)
+{
+    for (int i = 0; i < 3; ++i) {
+        if (a.max[i] < b.min[i] || a.min[i] > b.max[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// ViewFrustum implementation
+ViewFrustum::ViewFrustum(const QMatrix4x4& viewProjection)
+{
+    setViewProjection(viewProjection);
+}
+
+void ViewFrustum::setViewProjection(const QMatrix4x4& viewProjection)
+{
+    // Gribb/Hartmann plane extraction; normals point into the frustum
+    const QVector4D r0 = viewProjection.row(0);
+    const QVector4D r1 = viewProjection.row(1);
+    const QVector4D r2 = viewProjection.row(2);
+    const QVector4D r3 = viewProjection.row(3);
+
+    const QVector4D planes[6] = {
+        r3 + r0,    // Left
+        r3 - r0,    // Right
+        r3 + r1,    // Bottom
+        r3 - r1,    // Top
+        r3 + r2,    // Near
+        r3 - r2     // Far
+    };
+
+    for (int i = 0; i < 6; ++i) {
+        double a = planes[i].x();
+        double b = planes[i].y();
+        double c = planes[i].z();
+        double d = planes[i].w();
+        double length = std::sqrt(a * a + b * b + c * c);
+        if (length > 0.0) {
+            a /= length;
+            b /= length;
+            c /= length;
+            d /= length;
+        }
+        m_planes[i][0] = a;
+        m_planes[i][1] = b;
+        m_planes[i][2] = c;
+        m_planes[i][3] = d;
+    }
+}
+
+ViewFrustum::Containment ViewFrustum::classify(const SceneBounds& bounds) const
+{
+    Containment result = Inside;
+
+    for (int i = 0; i < 6; ++i) {
+        const double* plane = m_planes[i];
+
+        // Positive vertex is the corner furthest along the plane normal
+        double pDist = plane[3];
+        double nDist = plane[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            if (plane[axis] >= 0.0) {
+                pDist += plane[axis] * bounds.max[axis];
+                nDist += plane[axis] * bounds.min[axis];
+            } else {
+                pDist += plane[axis] * bounds.min[axis];
+                nDist += plane[axis] * bounds.max[axis];
+            }
+        }
+
+        if (pDist < 0.0) {
+            return Outside;
+        }
+        if (nDist < 0.0) {
+            result = Intersects;
+        }
+    }
+
+    return result;
+}
+
+// SceneBVH implementation
+SceneBVH::SceneBVH()
+    : m_dirty(false)
+{
+}
+
+SceneBVH::~SceneBVH() = default;
+
+void SceneBVH::insert(int entityId, const SceneBounds& bounds)
+{
+    if (bounds.isEmpty()) {
+        return;
+    }
+
+    auto it = m_entityIndex.find(entityId);
+    if (it != m_entityIndex.end()) {
+        update(entityId, bounds);
+        return;
+    }
+
+    Item item;
+    item.entityId = entityId;
+    item.bounds = bounds;
+    m_entityIndex[entityId] = static_cast<int>(m_items.size());
+    m_items.push_back(item);
+    m_dirty = true;
+}
+
+void SceneBVH::update(int entityId, const SceneBounds& bounds)
+{
+    auto it = m_entityIndex.find(entityId);
+    if (it == m_entityIndex.end()) {
+        insert(entityId, bounds);
+        return;
+    }
+
+    m_items[it->second].bounds = bounds;
+
+    // Moving an entity keeps the topology valid; only bounds on the path grow or shrink
+    if (!m_dirty && it->second < static_cast<int>(m_itemLeaf.size())) {
+        refit(m_itemLeaf[it->second]);
+    }
+}
+
+void SceneBVH::remove(int entityId)
+{
+    auto it = m_entityIndex.find(entityId);
+    if (it == m_entityIndex.end()) {
+        return;
+    }
+
+    int index = it->second;
+    int last = static_cast<int>(m_items.size()) - 1;
+    if (index != last) {
+        m_items[index] = m_items[last];
+        m_entityIndex[m_items[index].entityId] = index;
+    }
+    m_items.pop_back();
+    m_entityIndex.erase(entityId);
+    m_dirty = true;
+}
+
+void SceneBVH::clear()
+{
+    m_items.clear();
+    m_nodes.clear();
+    m_itemLeaf.clear();
+    m_entityIndex.clear();
+    m_dirty = false;
+}
+
+SceneBounds SceneBVH::sceneBounds()
+{
+    build();
+    return m_nodes.empty() ? SceneBounds() : m_nodes.front().bounds;
+}
+
+void SceneBVH::build()
+{
+    if (!m_dirty) {
+        return;
+    }
+
+    CAD_TRACE_SCOPE("render", "buildBVH");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    m_nodes.clear();
+    m_nodes.reserve(m_items.size() * 2 / LeafSize + 1);
+    m_itemLeaf.assign(m_items.size(), -1);
+
+    if (!m_items.empty()) {
+        buildRecursive(-1, 0, static_cast<int>(m_items.size()));
+    }
+
+    // Partitioning reordered the items
+    for (int i = 0; i < static_cast<int>(m_items.size()); ++i) {
+        m_entityIndex[m_items[i].entityId] = i;
+    }
+
+    m_dirty = false;
+    qCDebug(cadCulling) << "BVH built:" << m_items.size() << "entities," << m_nodes.size()
+                        << "nodes in" << timer.elapsed() << "ms";
+}
+
+int SceneBVH::buildRecursive(int parent, int begin, int end)
+{
+    int index = static_cast<int>(m_nodes.size());
+    m_nodes.push_back(Node());
+
+    SceneBounds bounds;
+    SceneBounds centroids;
+    for (int i = begin; i < end; ++i) {
+        const SceneBounds& b = m_items[i].bounds;
+        bounds.expand(b);
+        SceneBounds c(b.center(0), b.center(1), b.center(2), b.center(0), b.center(1), b.center(2));
+        centroids.expand(c);
+    }
+
+    Node& node = m_nodes[index];
+    node.bounds = bounds;
+    node.parent = parent;
+    node.count = end - begin;
+
+    if (end - begin <= LeafSize) {
+        node.left = begin;
+        node.right = -1;
+        for (int i = begin; i < end; ++i) {
+            m_itemLeaf[i] = index;
+        }
+        return index;
+    }
+
+    // Median split along the axis with the widest centroid spread
+    int axis = 0;
+    if (centroids.extent(1) > centroids.extent(axis)) axis = 1;
+    if (centroids.extent(2) > centroids.extent(axis)) axis = 2;
+
+    int mid = begin + (end - begin) / 2;
+    std::nth_element(m_items.begin() + begin, m_items.begin() + mid, m_items.begin() + end,
+                     [axis](const Item& a, const Item& b) {
+                         return a.bounds.center(axis) < b.bounds.center(axis);
+                     });
+
+    int left = buildRecursive(index, begin, mid);
+    int right = buildRecursive(index, mid, end);
+
+    // m_nodes may have reallocated during recursion
+    m_nodes[index].left = left;
+    m_nodes[index].right = right;
+    return index;
+}
+
+void SceneBVH::refit(int nodeIndex)
+{
+    while (nodeIndex >= 0) {
+        Node& node = m_nodes[nodeIndex];
+        SceneBounds bounds;
+        if (node.isLeaf()) {
+            for (int i = node.left; i < node.left + node.count; ++i) {
+                bounds.expand(m_items[i].bounds);
+            }
+        } else {
+            bounds.expand(m_nodes[node.left].bounds);
+            bounds.expand(m_nodes[node.right].bounds);
+        }
+        node.bounds = bounds;
+        nodeIndex = node.parent;
+    }
+}
+
+double SceneBVH::projectedSize(const SceneBounds& bounds, const QMatrix4x4& viewProjection,
+                               int viewportWidth, int viewportHeight) const
+{
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double maxY = std::numeric_limits<double>::lowest();
+
+    for (int corner = 0; corner < 8; ++corner) {
+        QVector4D p(static_cast<float>((corner & 1) ? bounds.max[0] : bounds.min[0]),
+                    static_cast<float>((corner & 2) ? bounds.max[1] : bounds.min[1]),
+                    static_cast<float>((corner & 4) ? bounds.max[2] : bounds.min[2]),
+                    1.0f);
+        QVector4D clip = viewProjection * p;
+
+        // Crossing the camera plane: treat as arbitrarily large
+        if (clip.w() <= 1e-6f) {
+            return std::numeric_limits<double>::max();
+        }
+
+        double x = clip.x() / clip.w();
+        double y = clip.y() / clip.w();
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+    }
+
+    double widthPixels = (maxX - minX) * 0.5 * viewportWidth;
+    double heightPixels = (maxY - minY) * 0.5 * viewportHeight;
+    return std::max(widthPixels, heightPixels);
+}
+
+void SceneBVH::cull(const QMatrix4x4& viewProjection, int viewportWidth, int viewportHeight,
+                    double pixelThreshold, CullResult& result)
+{
+    CAD_TRACE_SCOPE("render", "cull");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    build();
+    result.clear();
+    result.stats.totalEntities = static_cast<int>(m_items.size());
+
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    ViewFrustum frustum(viewProjection);
+    const bool proxyEnabled = pixelThreshold > 0.0;
+
+    // Stack entries encode the node index and whether it is known to be fully inside
+    m_stack.clear();
+    m_stack.push_back(0);
+
+    while (!m_stack.empty()) {
+        int entry = m_stack.back();
+        m_stack.pop_back();
+
+        int nodeIndex = entry >> 1;
+        bool inside = entry & 1;
+        const Node& node = m_nodes[nodeIndex];
+        ++result.stats.nodesVisited;
+
+        if (!inside) {
+            ViewFrustum::Containment containment = frustum.classify(node.bounds);
+            if (containment == ViewFrustum::Outside) {
+                result.stats.culledEntities += node.count;
+                continue;
+            }
+            inside = containment == ViewFrustum::Inside;
+        }
+
+        if (proxyEnabled && node.count > 1) {
+            double size = projectedSize(node.bounds, viewProjection, viewportWidth, viewportHeight);
+            if (size < pixelThreshold) {
+                result.proxies.push_back({node.bounds, node.count, size < 1.0});
+                result.stats.proxiedEntities += node.count;
+                ++result.stats.proxyCount;
+                continue;
+            }
+        }
+
+        if (!node.isLeaf()) {
+            m_stack.push_back((node.left << 1) | (inside ? 1 : 0));
+            m_stack.push_back((node.right << 1) | (inside ? 1 : 0));
+            continue;
+        }
+
+        for (int i = node.left; i < node.left + node.count; ++i) {
+            const Item& item = m_items[i];
+            if (!inside && frustum.classify(item.bounds) == ViewFrustum::Outside) {
+                ++result.stats.culledEntities;
+                continue;
+            }
+
+            if (proxyEnabled) {
+                double size = projectedSize(item.bounds, viewProjection, viewportWidth, viewportHeight);
+                if (size < pixelThreshold) {
+                    result.proxies.push_back({item.bounds, 1, size < 1.0});
+                    ++result.stats.proxiedEntities;
+                    ++result.stats.proxyCount;
+                    continue;
+                }
+            }
+
+            result.visibleEntities.push_back(item.entityId);
+            ++result.stats.drawnEntities;
+        }
+    }
+
+    result.stats.cullTimeMs = timer.nsecsElapsed() / 1.0e6;
+}
+
+void SceneBVH::query(const SceneBounds& region, std::vector<int>& entityIds)
+{
+    CAD_TRACE_SCOPE("snap", "spatialQuery");
+
+    build();
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    m_stack.clear();
+    m_stack.push_back(0);
+
+    while (!m_stack.empty()) {
+        const Node& node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+
+        if (!overlaps(node.bounds, region)) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            for (int i = node.left; i < node.left + node.count; ++i) {
+                if (overlaps(m_items[i].bounds, region)) {
+                    entityIds.push_back(m_items[i].entityId);
+                }
+            }
+        } else {
+            m_stack.push_back(node.left);
+            m_stack.push_back(node.right);
+        }
+    }
+}
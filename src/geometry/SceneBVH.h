@@ -0,0 +1,178 @@
+#pragma once
+
+#include <QMatrix4x4>
+#include <QLoggingCategory>
+#include <unordered_map>
+#include <vector>
+
+Q_DECLARE_LOGGING_CATEGORY(cadCulling)
+
+/**
+ * @brief Axis-aligned bounding box in model space
+ */
+struct SceneBounds
+{
+    double min[3];
+    double max[3];
+
+    SceneBounds() { setEmpty(); }
+    SceneBounds(double xmin, double ymin, double zmin, double xmax, double ymax, double zmax)
+    {
+        min[0] = xmin; min[1] = ymin; min[2] = zmin;
+        max[0] = xmax; max[1] = ymax; max[2] = zmax;
+    }
+
+    void setEmpty()
+    {
+        min[0] = min[1] = min[2] = 1e300;
+        max[0] = max[1] = max[2] = -1e300;
+    }
+
+    bool isEmpty() const { return min[0] > max[0]; }
+
+    void expand(const SceneBounds& other)
+    {
+        for (int i = 0; i < 3; ++i) {
+            if (other.min[i] < min[i]) min[i] = other.min[i];
+            if (other.max[i] > max[i]) max[i] = other.max[i];
+        }
+    }
+
+    double center(int axis) const { return 0.5 * (min[axis] + max[axis]); }
+    double extent(int axis) const { return max[axis] - min[axis]; }
+};
+
+/**
+ * @brief View frustum planes extracted from a view-projection matrix
+ */
+class ViewFrustum
+{
+public:
+    enum Containment {
+        Outside,
+        Intersects,
+        Inside
+    };
+
+    ViewFrustum() = default;
+    explicit ViewFrustum(const QMatrix4x4& viewProjection);
+
+    void setViewProjection(const QMatrix4x4& viewProjection);
+    Containment classify(const SceneBounds& bounds) const;
+
+private:
+    double m_planes[6][4];
+};
+
+/**
+ * @brief Counters from one culling pass, exposed for profiling
+ */
+struct CullStats
+{
+    int totalEntities;
+    int culledEntities;
+    int proxiedEntities;
+    int drawnEntities;
+    int proxyCount;
+    int nodesVisited;
+    double cullTimeMs;
+
+    CullStats()
+        : totalEntities(0), culledEntities(0), proxiedEntities(0), drawnEntities(0)
+        , proxyCount(0), nodesVisited(0), cullTimeMs(0.0) {}
+};
+
+/**
+ * @brief Stand-in for entities that project smaller than the pixel threshold
+ */
+struct CullProxy
+{
+    SceneBounds bounds;
+    int entityCount;
+    bool point;                 // Below one pixel: draw as a point, otherwise as a box
+};
+
+/**
+ * @brief Result of culling the scene against one viewport
+ */
+struct CullResult
+{
+    std::vector<int> visibleEntities;
+    std::vector<CullProxy> proxies;
+    CullStats stats;
+
+    void clear()
+    {
+        visibleEntities.clear();
+        proxies.clear();
+        stats = CullStats();
+    }
+};
+
+/**
+ * @brief Bounding volume hierarchy over entity bounding boxes
+ *
+ * Built once per scene and shared by every viewport:
+ * - Median split on the longest axis, flat node array, small leaves
+ * - Bounds changes refit the path to the root without a rebuild
+ * - Insertions and removals mark the tree for a lazy rebuild
+ * - cull() walks the tree hierarchically: subtrees outside the frustum
+ *   are rejected whole, subtrees fully inside skip further plane tests,
+ *   and subtrees projecting below the pixel threshold collapse to proxies
+ */
+class SceneBVH
+{
+public:
+    SceneBVH();
+    ~SceneBVH();
+
+    // Scene maintenance
+    void insert(int entityId, const SceneBounds& bounds);
+    void update(int entityId, const SceneBounds& bounds);
+    void remove(int entityId);
+    void clear();
+
+    bool contains(int entityId) const { return m_entityIndex.count(entityId) != 0; }
+    int entityCount() const { return static_cast<int>(m_items.size()); }
+    SceneBounds sceneBounds();
+
+    // Rebuild if insertions/removals happened since the last build
+    void build();
+    bool isDirty() const { return m_dirty; }
+
+    // Culling
+    void cull(const QMatrix4x4& viewProjection, int viewportWidth, int viewportHeight,
+              double pixelThreshold, CullResult& result);
+
+    // Spatial queries for selection and snapping
+    void query(const SceneBounds& region, std::vector<int>& entityIds);
+
+private:
+    struct Item {
+        int entityId;
+        SceneBounds bounds;
+    };
+
+    struct Node {
+        SceneBounds bounds;
+        int parent;
+        int left;               // Child index, or first item for leaves
+        int right;              // Child index, or -1 for leaves
+        int count;              // Number of items in the subtree
+        bool isLeaf() const { return right < 0; }
+    };
+
+    int buildRecursive(int parent, int begin, int end);
+    void refit(int nodeIndex);
+    double projectedSize(const SceneBounds& bounds, const QMatrix4x4& viewProjection,
+                         int viewportWidth, int viewportHeight) const;
+
+    std::vector<Item> m_items;
+    std::vector<Node> m_nodes;
+    std::vector<int> m_itemLeaf;                        // Item index -> leaf node
+    std::unordered_map<int, int> m_entityIndex;         // Entity id -> item index
+    std::vector<int> m_stack;
+    bool m_dirty;
+
+    static constexpr int LeafSize = 4;
+};
@@ -0,0 +1,557 @@
+#include "ViewportRenderCache.h"
+#include "DxfReader.h"
+#include "GeometryEngine.h"
+#include "HiddenLineRemoval.h"
+#include "LayerManager.h"
+#include "Parallel.h"
+#include "Tracing.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <BRep_Tool.hxx>
+#include <BRepAdaptor_Curve.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <GCPnts_TangentialDeflection.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Standard_Failure.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <gp.hxx>
+#include <gp_Ax3.hxx>
+
+Q_LOGGING_CATEGORY(cadLayoutCache, "cad.layout.cache")
+
+namespace {
+
+// Chordal tolerance on the sheet; model deflection follows the viewport scale
+constexpr double PaperDeflection = 0.05;
+
+// AutoCAD colour indices that defer to the layer
+constexpr int ByBlock = 0;
+constexpr int ByLayer = 256;
+
+// Same axes as HiddenLineRemoval, so HLR line work lines up with ours
+gp_Dir viewXDirection(const gp_Dir& viewDirection, const gp_Dir& upDirection)
+{
+    gp_Vec x = gp_Vec(upDirection).Crossed(gp_Vec(viewDirection));
+    if (x.Magnitude() > gp::Resolution()) {
+        return gp_Dir(x);
+    }
+    return std::abs(viewDirection.X()) > 0.9 ? gp_Dir(0, 1, 0) : gp_Dir(1, 0, 0);
+}
+
+// Closed-interval overlap; projected lines have zero width or height
+inline bool overlaps(const QRectF& a, const QRectF& b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+inline float edge(float ax, float ay, float bx, float by, float px, float py)
+{
+    return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+// Flat-shaded triangle with depth test; corners in tile pixels, larger depth is nearer
+void fillTriangle(QImage& image, std::vector<float>& depth, const float* x, const float* y, const float* z, QRgb color)
+{
+    const float area = edge(x[0], y[0], x[1], y[1], x[2], y[2]);
+    if (std::abs(area) < 1.0e-6f) {
+        return;
+    }
+
+    const int width = image.width();
+    const int height = image.height();
+    const int minX = std::max(0, static_cast<int>(std::floor(std::min({x[0], x[1], x[2]}))));
+    const int maxX = std::min(width - 1, static_cast<int>(std::ceil(std::max({x[0], x[1], x[2]}))));
+    const int minY = std::max(0, static_cast<int>(std::floor(std::min({y[0], y[1], y[2]}))));
+    const int maxY = std::min(height - 1, static_cast<int>(std::ceil(std::max({y[0], y[1], y[2]}))));
+
+    for (int py = minY; py <= maxY; ++py) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(py));
+        float* depthLine = depth.data() + static_cast<size_t>(py) * width;
+        const float sy = py + 0.5f;
+        for (int px = minX; px <= maxX; ++px) {
+            const float sx = px + 0.5f;
+            const float w0 = edge(x[1], y[1], x[2], y[2], sx, sy) / area;
+            const float w1 = edge(x[2], y[2], x[0], y[0], sx, sy) / area;
+            const float w2 = 1.0f - w0 - w1;
+            if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+                continue;
+            }
+            const float d = w0 * z[0] + w1 * z[1] + w2 * z[2];
+            if (d > depthLine[px]) {
+                depthLine[px] = d;
+                line[px] = color;
+            }
+        }
+    }
+}
+
+} // namespace
+
+ViewportRenderCache::ViewportRenderCache(GeometryEngine* engine, HiddenLineRemoval* hiddenLines)
+    : m_geometryEngine(engine)
+    , m_hiddenLines(hiddenLines)
+    , m_layerManager(nullptr)
+    , m_targetX(0.0)
+    , m_targetY(0.0)
+    , m_deflection(PaperDeflection)
+    , m_collected(false)
+    , m_lineWorkValid(false)
+    , m_pixelsPerUnit(0.0)
+    , m_tileColumns(0)
+{
+}
+
+ViewportRenderCache::~ViewportRenderCache() = default;
+
+Bnd_Box ViewportRenderCache::entityBounds(GeometryEngine* engine, int entityId)
+{
+    Bnd_Box box;
+    const CADEntity* entity = engine->findEntity(entityId);
+    if (entity && !entity->shape.IsNull()) {
+        auto bounds = engine->getBoundingBox(entityId);
+        box.Update(bounds.first.X(), bounds.first.Y(), bounds.first.Z(),
+                   bounds.second.X(), bounds.second.Y(), bounds.second.Z());
+    }
+    return box;
+}
+
+void ViewportRenderCache::setViewport(const LayoutViewport& viewport)
+{
+    m_viewport = viewport;
+
+    const gp_Dir xDir = viewXDirection(viewport.viewDirection, viewport.upDirection);
+    m_toView.SetTransformation(gp_Ax3(viewport.target, viewport.viewDirection, xDir));
+    m_paperCenter = viewport.paperRect.center();
+
+    const gp_Dir yDir = gp_Dir(gp_Vec(viewport.viewDirection).Crossed(gp_Vec(xDir)));
+    m_targetX = gp_Vec(viewport.target.XYZ()).Dot(gp_Vec(xDir));
+    m_targetY = gp_Vec(viewport.target.XYZ()).Dot(gp_Vec(yDir));
+    m_deflection = PaperDeflection / std::max(viewport.scale, 1.0e-12);
+
+    invalidateAll();
+}
+
+QRectF ViewportRenderCache::project(const Bnd_Box& bounds) const
+{
+    if (bounds.IsVoid()) {
+        return QRectF();
+    }
+
+    double xmin, ymin, zmin, xmax, ymax, zmax;
+    bounds.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+    double left = 1e300, right = -1e300, bottom = 1e300, top = -1e300;
+    for (int corner = 0; corner < 8; ++corner) {
+        const gp_Pnt p = toPaper(gp_Pnt((corner & 1) ? xmax : xmin, (corner & 2) ? ymax : ymin, (corner & 4) ? zmax : zmin));
+        left = std::min(left, p.X());
+        right = std::max(right, p.X());
+        bottom = std::min(bottom, p.Y());
+        top = std::max(top, p.Y());
+    }
+    return QRectF(QPointF(left, bottom), QPointF(right, top));
+}
+
+bool ViewportRenderCache::invalidateEntity(int entityId, const Bnd_Box& before, const Bnd_Box& after)
+{
+    if (!m_collected) {
+        return false;       // Nothing cached yet
+    }
+
+    const bool wasMember = m_members.count(entityId) != 0;
+    const bool isMember = includes(entityId, after);
+    if (!wasMember && !isMember) {
+        ++m_stats.invalidationsIgnored;
+        return false;
+    }
+
+    if (m_viewport.style == LayoutViewport::Shaded) {
+        if (wasMember) {
+            invalidateTiles(project(before));
+        }
+        if (isMember) {
+            invalidateTiles(project(after));
+        }
+    }
+
+    if (isMember) {
+        m_members.insert(entityId);
+        m_dirtyLines.insert(entityId);
+        m_dirtyMeshes.insert(entityId);
+    } else {
+        m_members.erase(entityId);
+        m_dirtyLines.erase(entityId);
+        m_dirtyMeshes.erase(entityId);
+        m_lines.erase(entityId);
+        m_meshes.erase(entityId);
+    }
+    m_stats.entities = static_cast<int>(m_members.size());
+    m_lineWorkValid = false;
+    return true;
+}
+
+void ViewportRenderCache::setLayerManager(const LayerManager* layers)
+{
+    if (layers != m_layerManager) {
+        m_layerManager = layers;
+        invalidateAll();
+    }
+}
+
+void ViewportRenderCache::invalidateAll()
+{
+    m_collected = false;
+    m_members.clear();
+    m_dirtyLines.clear();
+    m_dirtyMeshes.clear();
+    m_lines.clear();
+    m_meshes.clear();
+    m_lineWork.clear();
+    m_lineWorkValid = false;
+    m_tiles.clear();
+    m_pixelsPerUnit = 0.0;
+}
+
+bool ViewportRenderCache::isCurrent() const
+{
+    if (!m_collected || !m_lineWorkValid) {
+        return false;
+    }
+    if (m_viewport.style != LayoutViewport::Shaded) {
+        return true;
+    }
+    return m_dirtyMeshes.empty()
+        && std::all_of(m_tiles.begin(), m_tiles.end(), [](const ViewportTile& tile) { return tile.valid; });
+}
+
+void ViewportRenderCache::resetStats()
+{
+    const int entities = m_stats.entities;
+    m_stats = ViewportCacheStats();
+    m_stats.entities = entities;
+}
+
+const std::vector<float>& ViewportRenderCache::lineWork()
+{
+    if (!m_collected) {
+        collectEntities();
+    }
+    if (m_lineWorkValid) {
+        return m_lineWork;
+    }
+
+    CAD_TRACE_SCOPE("render", "viewportLineWork");
+    if (m_viewport.style == LayoutViewport::Hidden && m_hiddenLines) {
+        rebuildHiddenLines();
+    } else {
+        for (int entityId : m_dirtyLines) {
+            rebuildLines(entityId);
+        }
+        m_dirtyLines.clear();
+
+        size_t size = 0;
+        for (const auto& entry : m_lines) {
+            size += entry.second.segments.size();
+        }
+        m_lineWork.clear();
+        m_lineWork.reserve(size);
+        for (const auto& entry : m_lines) {
+            m_lineWork.insert(m_lineWork.end(), entry.second.segments.begin(), entry.second.segments.end());
+        }
+    }
+    m_lineWorkValid = true;
+    return m_lineWork;
+}
+
+const std::vector<ViewportTile>& ViewportRenderCache::tiles(double pixelsPerUnit)
+{
+    if (!m_collected) {
+        collectEntities();
+    }
+    if (pixelsPerUnit <= 0.0) {
+        static const std::vector<ViewportTile> none;
+        return none;
+    }
+    if (pixelsPerUnit != m_pixelsPerUnit) {
+        layoutTiles(pixelsPerUnit);
+    }
+
+    for (int entityId : m_dirtyMeshes) {
+        rebuildMesh(entityId);
+    }
+    m_dirtyMeshes.clear();
+
+    std::vector<int> pending;
+    for (size_t i = 0; i < m_tiles.size(); ++i) {
+        if (!m_tiles[i].valid) {
+            pending.push_back(static_cast<int>(i));
+        }
+    }
+    if (pending.empty()) {
+        return m_tiles;
+    }
+
+    CAD_TRACE_SCOPE("render", "viewportTiles");
+
+    // Tiles are independent; meshes are only read while they render
+    const int total = static_cast<int>(pending.size());
+    Parallel::forEach(total, [&](int i) {
+        renderTile(m_tiles[pending[i]]);
+    });
+
+    m_stats.tilesRendered += total;
+    qCDebug(cadLayoutCache) << "Viewport" << m_viewport.id << "rendered" << total << "of" << m_tiles.size() << "tiles";
+    return m_tiles;
+}
+
+gp_Pnt ViewportRenderCache::toPaper(const gp_Pnt& point) const
+{
+    const gp_Pnt local = point.Transformed(m_toView);
+    return gp_Pnt(m_paperCenter.x() + local.X() * m_viewport.scale,
+                  m_paperCenter.y() + local.Y() * m_viewport.scale,
+                  local.Z() * m_viewport.scale);
+}
+
+QPointF ViewportRenderCache::viewPlaneToPaper(double x, double y) const
+{
+    return QPointF(m_paperCenter.x() + (x - m_targetX) * m_viewport.scale,
+                   m_paperCenter.y() + (y - m_targetY) * m_viewport.scale);
+}
+
+bool ViewportRenderCache::includes(int entityId, const Bnd_Box& bounds) const
+{
+    if (bounds.IsVoid()) {
+        return false;
+    }
+    const CADEntity* entity = m_geometryEngine->findEntity(entityId);
+    if (!entity || !entity->visible || entity->shape.IsNull() || m_viewport.frozenLayers.contains(entity->layer)) {
+        return false;
+    }
+    return overlaps(project(bounds), m_viewport.paperRect);
+}
+
+void ViewportRenderCache::collectEntities()
+{
+    CAD_TRACE_SCOPE("render", "viewportCollect");
+
+    m_members.clear();
+    if (m_geometryEngine) {
+        for (int entityId : m_geometryEngine->getAllEntityIds()) {
+            if (includes(entityId, ViewportRenderCache::entityBounds(m_geometryEngine, entityId))) {
+                m_members.insert(entityId);
+            }
+        }
+    }
+    m_dirtyLines = m_members;
+    m_dirtyMeshes = m_members;
+    m_stats.entities = static_cast<int>(m_members.size());
+    m_lineWorkValid = false;
+    m_collected = true;
+}
+
+void ViewportRenderCache::rebuildLines(int entityId)
+{
+    const CADEntity* entity = m_geometryEngine->findEntity(entityId);
+    if (!entity) {
+        m_lines.erase(entityId);
+        return;
+    }
+
+    std::vector<float> projected;
+    for (TopExp_Explorer exp(entity->shape, TopAbs_EDGE); exp.More(); exp.Next()) {
+        try {
+            BRepAdaptor_Curve curve(TopoDS::Edge(exp.Current()));
+            GCPnts_TangentialDeflection points(curve, 0.1, m_deflection);
+            for (int i = 1; i < points.NbPoints(); ++i) {
+                const gp_Pnt a = toPaper(points.Value(i));
+                const gp_Pnt b = toPaper(points.Value(i + 1));
+                projected.insert(projected.end(), {static_cast<float>(a.X()), static_cast<float>(a.Y()),
+                                                   static_cast<float>(b.X()), static_cast<float>(b.Y())});
+            }
+        } catch (const Standard_Failure&) {
+            // Degenerate edge, nothing to draw
+        }
+    }
+
+    EntityLines& lines = m_lines[entityId];
+    lines.rect = project(ViewportRenderCache::entityBounds(m_geometryEngine, entityId));
+    lines.segments.clear();
+    clipSegments(projected, lines.segments);
+    ++m_stats.entitiesRebuilt;
+}
+
+void ViewportRenderCache::rebuildMesh(int entityId)
+{
+    const CADEntity* entity = m_geometryEngine->findEntity(entityId);
+    if (!entity) {
+        m_meshes.erase(entityId);
+        return;
+    }
+
+    EntityMesh& mesh = m_meshes[entityId];
+    mesh.rect = project(ViewportRenderCache::entityBounds(m_geometryEngine, entityId));
+    mesh.color = shadeColor(*entity);
+    mesh.triangles.clear();
+
+    BRepMesh_IncrementalMesh mesher(entity->shape, m_deflection);
+    for (TopExp_Explorer exp(entity->shape, TopAbs_FACE); exp.More(); exp.Next()) {
+        TopLoc_Location location;
+        Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(TopoDS::Face(exp.Current()), location);
+        if (triangulation.IsNull()) {
+            continue;
+        }
+        const gp_Trsf& trsf = location.Transformation();
+        for (int i = 1; i <= triangulation->NbTriangles(); ++i) {
+            int nodes[3];
+            triangulation->Triangle(i).Get(nodes[0], nodes[1], nodes[2]);
+            for (int node : nodes) {
+                const gp_Pnt p = toPaper(triangulation->Node(node).Transformed(trsf));
+                mesh.triangles.insert(mesh.triangles.end(), {static_cast<float>(p.X()), static_cast<float>(p.Y()),
+                                                             static_cast<float>(p.Z())});
+            }
+        }
+    }
+}
+
+QRgb ViewportRenderCache::shadeColor(const CADEntity& entity) const
+{
+    // Same resolution as plot pens: ByLayer and ByBlock take the layer colour, anything else is an index
+    if (entity.color == ByLayer || entity.color == ByBlock) {
+        return m_layerManager ? m_layerManager->getLayerProperties(entity.layer).color.rgb() : qRgb(255, 255, 255);
+    }
+    return DxfReader::aciColor(entity.color).rgb();
+}
+
+void ViewportRenderCache::rebuildHiddenLines()
+{
+    m_lineWork.clear();
+    m_dirtyLines.clear();
+    if (m_members.empty()) {
+        return;
+    }
+
+    // The HLR cache reuses every cluster the change did not touch
+    HLRView view;
+    view.viewDirection = m_viewport.viewDirection;
+    view.upDirection = m_viewport.upDirection;
+    const HLRResult result = m_hiddenLines->compute(view, std::vector<int>(m_members.begin(), m_members.end()));
+
+    std::vector<float> projected;
+    for (const auto& cluster : result.clusters) {
+        const std::vector<float>& segments = cluster->visibleSegments;
+        for (size_t i = 0; i + 1 < segments.size(); i += 2) {
+            const QPointF p = viewPlaneToPaper(segments[i], segments[i + 1]);
+            projected.push_back(static_cast<float>(p.x()));
+            projected.push_back(static_cast<float>(p.y()));
+        }
+    }
+    clipSegments(projected, m_lineWork);
+}
+
+void ViewportRenderCache::layoutTiles(double pixelsPerUnit)
+{
+    m_pixelsPerUnit = pixelsPerUnit;
+    m_tiles.clear();
+
+    // Rows run from the top of the sheet down, as images do
+    const QRectF& area = m_viewport.paperRect;
+    const double tileExtent = TileSize / pixelsPerUnit;
+    m_tileColumns = std::max(1, static_cast<int>(std::ceil(area.width() / tileExtent)));
+    const int rows = std::max(1, static_cast<int>(std::ceil(area.height() / tileExtent)));
+    m_tiles.resize(static_cast<size_t>(m_tileColumns) * rows);
+    for (int row = 0; row < rows; ++row) {
+        const double top = area.bottom() - row * tileExtent;
+        const double bottom = std::max(area.top(), top - tileExtent);
+        for (int column = 0; column < m_tileColumns; ++column) {
+            const double left = area.left() + column * tileExtent;
+            const double right = std::min(area.right(), left + tileExtent);
+            m_tiles[static_cast<size_t>(row) * m_tileColumns + column].paperRect =
+                QRectF(QPointF(left, bottom), QPointF(right, top));
+        }
+    }
+}
+
+void ViewportRenderCache::invalidateTiles(const QRectF& rect)
+{
+    for (ViewportTile& tile : m_tiles) {
+        if (tile.valid && overlaps(tile.paperRect, rect)) {
+            tile.valid = false;
+        }
+    }
+}
+
+void ViewportRenderCache::renderTile(ViewportTile& tile) const
+{
+    const QRectF& area = tile.paperRect;
+    const int width = std::max(1, static_cast<int>(std::ceil(area.width() * m_pixelsPerUnit)));
+    const int height = std::max(1, static_cast<int>(std::ceil(area.height() * m_pixelsPerUnit)));
+    if (tile.image.width() != width || tile.image.height() != height) {
+        tile.image = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+    }
+    tile.image.fill(Qt::transparent);
+    std::vector<float> depth(static_cast<size_t>(width) * height, -std::numeric_limits<float>::max());
+
+    for (const auto& entry : m_meshes) {
+        const EntityMesh& mesh = entry.second;
+        if (!overlaps(mesh.rect, area)) {
+            continue;
+        }
+
+        const std::vector<float>& t = mesh.triangles;
+        for (size_t i = 0; i + 8 < t.size(); i += 9) {
+            // Orthographic, so the paper-space normal's depth component is the facing ratio
+            const gp_Vec normal = gp_Vec(t[i + 3] - t[i], t[i + 4] - t[i + 1], t[i + 5] - t[i + 2])
+                .Crossed(gp_Vec(t[i + 6] - t[i], t[i + 7] - t[i + 1], t[i + 8] - t[i + 2]));
+            const double length = normal.Magnitude();
+            if (length < gp::Resolution()) {
+                continue;
+            }
+            const double light = 0.25 + 0.75 * std::abs(normal.Z()) / length;
+            const QRgb color = qRgb(static_cast<int>(qRed(mesh.color) * light),
+                                    static_cast<int>(qGreen(mesh.color) * light),
+                                    static_cast<int>(qBlue(mesh.color) * light));
+
+            float x[3], y[3], z[3];
+            for (int corner = 0; corner < 3; ++corner) {
+                x[corner] = static_cast<float>((t[i + corner * 3] - area.left()) * m_pixelsPerUnit);
+                y[corner] = static_cast<float>((area.bottom() - t[i + corner * 3 + 1]) * m_pixelsPerUnit);
+                z[corner] = t[i + corner * 3 + 2];
+            }
+            fillTriangle(tile.image, depth, x, y, z, color);
+        }
+    }
+    tile.valid = true;
+}
+
+void ViewportRenderCache::clipSegments(const std::vector<float>& segments, std::vector<float>& output) const
+{
+    // Liang-Barsky against the viewport rectangle
+    const QRectF& clip = m_viewport.paperRect;
+    for (size_t i = 0; i + 3 < segments.size(); i += 4) {
+        const double x0 = segments[i], y0 = segments[i + 1];
+        const double dx = segments[i + 2] - x0, dy = segments[i + 3] - y0;
+        const double p[4] = {-dx, dx, -dy, dy};
+        const double q[4] = {x0 - clip.left(), clip.right() - x0, y0 - clip.top(), clip.bottom() - y0};
+
+        double t0 = 0.0, t1 = 1.0;
+        bool visible = true;
+        for (int k = 0; k < 4 && visible; ++k) {
+            if (p[k] == 0.0) {
+                visible = q[k] >= 0.0;
+            } else {
+                const double t = q[k] / p[k];
+                if (p[k] < 0.0) {
+                    t0 = std::max(t0, t);
+                } else {
+                    t1 = std::min(t1, t);
+                }
+                visible = t0 <= t1;
+            }
+        }
+        if (visible) {
+            output.insert(output.end(), {static_cast<float>(x0 + t0 * dx), static_cast<float>(y0 + t0 * dy),
+                                         static_cast<float>(x0 + t1 * dx), static_cast<float>(y0 + t1 * dy)});
+        }
+    }
+}
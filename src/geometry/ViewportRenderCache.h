@@ -0,0 +1,173 @@
+#pragma once
+
+#include <QImage>
+#include <QLoggingCategory>
+#include <QRectF>
+#include <QSet>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <Bnd_Box.hxx>
+#include <gp_Dir.hxx>
+#include <gp_Pnt.hxx>
+#include <gp_Trsf.hxx>
+
+class GeometryEngine;
+class HiddenLineRemoval;
+class LayerManager;
+struct CADEntity;
+
+Q_DECLARE_LOGGING_CATEGORY(cadLayoutCache)
+
+/**
+ * @brief Floating viewport on a paper-space layout
+ */
+struct LayoutViewport
+{
+    enum Style {
+        Wireframe,
+        Hidden,
+        Shaded
+    };
+
+    int id;
+    QRectF paperRect;           // Sheet area in paper units; also the clip region
+    gp_Pnt target;              // Model point shown at the centre of paperRect
+    gp_Dir viewDirection;       // From target towards the eye
+    gp_Dir upDirection;
+    double scale;               // Paper units per model unit
+    Style style;
+    QSet<QString> frozenLayers;
+
+    LayoutViewport()
+        : id(-1), viewDirection(0, 0, 1), upDirection(0, 1, 0), scale(1.0), style(Wireframe) {}
+};
+
+/**
+ * @brief Raster tile of a shaded viewport
+ */
+struct ViewportTile
+{
+    QRectF paperRect;
+    QImage image;
+    bool valid;
+
+    ViewportTile() : valid(false) {}
+};
+
+/**
+ * @brief Counters for one viewport cache, exposed for profiling
+ */
+struct ViewportCacheStats
+{
+    int entities;               // Entities inside the clip region
+    int entitiesRebuilt;        // Since the last reset
+    int tilesRendered;
+    int invalidationsIgnored;   // Changes outside the clip region
+
+    ViewportCacheStats() : entities(0), entitiesRebuilt(0), tilesRendered(0), invalidationsIgnored(0) {}
+};
+
+/**
+ * @brief Cached render of one layout viewport
+ *
+ * Keeps the viewport's model content in paper-space form so a layout can be
+ * shown again without touching model geometry:
+ * - Wireframe: projected line work per entity, concatenated on demand
+ * - Hidden: line work from the shared HLR cache for the entities in view
+ * - Shaded: raster tiles over the viewport, each rendered in software from
+ *   per-entity projected triangles
+ *
+ * Changes are tested against the viewport's clip region: an entity whose old
+ * and new bounds both project outside it leaves the cache untouched, and
+ * inside it only that entity's lines and the tiles it covers are rebuilt.
+ */
+class ViewportRenderCache
+{
+public:
+    static constexpr int TileSize = 256;
+
+    ViewportRenderCache(GeometryEngine* engine, HiddenLineRemoval* hiddenLines);
+    ~ViewportRenderCache();
+
+    // A view change discards everything; clip or layer changes too
+    void setViewport(const LayoutViewport& viewport);
+    const LayoutViewport& viewport() const { return m_viewport; }
+
+    // Layer colours for ByLayer entities; without one they shade white
+    void setLayerManager(const LayerManager* layers);
+
+    // Model-space bounds of an entity, void when it has no shape
+    static Bnd_Box entityBounds(GeometryEngine* engine, int entityId);
+
+    // Paper-space rectangle covered by model-space bounds
+    QRectF project(const Bnd_Box& bounds) const;
+
+    // Projection and clipping, shared with plotting; z is depth towards the eye
+    gp_Pnt toPaper(const gp_Pnt& point) const;
+    QPointF viewPlaneToPaper(double x, double y) const;     // HiddenLineRemoval coordinates
+    void clipSegments(const std::vector<float>& segments, std::vector<float>& output) const;
+
+    // Change notification; returns false when the change is outside the clip region
+    bool invalidateEntity(int entityId, const Bnd_Box& before, const Bnd_Box& after);
+    void invalidateAll();
+    bool isCurrent() const;
+
+    // Line work as x0, y0, x1, y1 in paper units, clipped to the viewport
+    const std::vector<float>& lineWork();
+
+    // Shaded tiles, row by row, at the given resolution
+    const std::vector<ViewportTile>& tiles(double pixelsPerUnit);
+
+    const ViewportCacheStats& stats() const { return m_stats; }
+    void resetStats();
+
+private:
+    struct EntityLines {
+        QRectF rect;
+        std::vector<float> segments;
+    };
+
+    struct EntityMesh {
+        QRectF rect;
+        QRgb color;
+        std::vector<float> triangles;   // x, y, depth per corner, in paper units
+    };
+
+    bool includes(int entityId, const Bnd_Box& bounds) const;
+    void collectEntities();
+    void rebuildLines(int entityId);
+    void rebuildMesh(int entityId);
+    QRgb shadeColor(const CADEntity& entity) const;
+    void rebuildHiddenLines();
+    void layoutTiles(double pixelsPerUnit);
+    void invalidateTiles(const QRectF& rect);
+    void renderTile(ViewportTile& tile) const;
+
+    GeometryEngine* m_geometryEngine;
+    HiddenLineRemoval* m_hiddenLines;
+    const LayerManager* m_layerManager;
+    LayoutViewport m_viewport;
+    gp_Trsf m_toView;                           // Model space -> view axes at the target
+    QPointF m_paperCenter;
+    double m_targetX;                           // Target in HLR view-plane coordinates
+    double m_targetY;
+    double m_deflection;
+
+    bool m_collected;
+    std::unordered_set<int> m_members;          // Entities inside the clip region
+    std::unordered_set<int> m_dirtyLines;       // Members whose line work must be rebuilt
+    std::unordered_set<int> m_dirtyMeshes;      // Members whose triangles must be rebuilt
+
+    std::unordered_map<int, EntityLines> m_lines;
+    std::vector<float> m_lineWork;
+    bool m_lineWorkValid;
+
+    std::unordered_map<int, EntityMesh> m_meshes;
+    std::vector<ViewportTile> m_tiles;
+    double m_pixelsPerUnit;
+    int m_tileColumns;
+
+    ViewportCacheStats m_stats;
+};
@@ -0,0 +1,1653 @@
+#include "DxfReader.h"
+#include "BlockManager.h"
+#include "GeometryEngine.h"
+#include "LayerManager.h"
+#include "Parallel.h"
+#include "PlotEngine.h"
+#include "Tracing.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <BRepBuilderAPI_GTransform.hxx>
+#include <BRepBuilderAPI_MakeEdge.hxx>
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepBuilderAPI_MakePolygon.hxx>
+#include <BRepBuilderAPI_MakeVertex.hxx>
+#include <BRepBuilderAPI_MakeWire.hxx>
+#include <GC_MakeArcOfCircle.hxx>
+#include <GeomAPI_Interpolate.hxx>
+#include <Geom_BSplineCurve.hxx>
+#include <Standard_Failure.hxx>
+#include <TColStd_Array1OfInteger.hxx>
+#include <TColStd_Array1OfReal.hxx>
+#include <TColgp_Array1OfPnt.hxx>
+#include <TColgp_HArray1OfPnt.hxx>
+#include <gp_GTrsf.hxx>
+#include <gp_Mat.hxx>
+
+Q_LOGGING_CATEGORY(cadDxf, "cad.dxf")
+
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+constexpr double Coincident = 1.0e-9;
+constexpr int MaxArrayCopies = 10000;     // Per INSERT array, against corrupt counts
+
+std::string_view trimmed(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+double toDouble(std::string_view text)
+{
+    text = trimmed(text);
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    double value = 0.0;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+int toInt(std::string_view text)
+{
+    text = trimmed(text);
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    long long value = 0;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return static_cast<int>(value);
+}
+
+bool equalsNoCase(std::string_view text, std::string_view upper)
+{
+    if (text.size() != upper.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char c = text[i] >= 'a' && text[i] <= 'z' ? static_cast<char>(text[i] - 'a' + 'A') : text[i];
+        if (c != upper[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Group code and value pairs as views into the file. Lines end in LF or
+ * CRLF; one group can be pushed back for parsers that read one too far.
+ */
+class Tokenizer
+{
+public:
+    Tokenizer(const char* begin, const char* end) : m_begin(begin), m_pos(begin), m_end(end) {}
+
+    // False at the end of the data or on a malformed group code
+    bool next(int& code, std::string_view& value)
+    {
+        if (m_pushedBack) {
+            m_pushedBack = false;
+            code = m_code;
+            value = m_value;
+            return true;
+        }
+        std::string_view codeLine;
+        if (!readLine(codeLine) || !readLine(m_value)) {
+            return false;
+        }
+        codeLine = trimmed(codeLine);
+        const auto parsed = std::from_chars(codeLine.data(), codeLine.data() + codeLine.size(), m_code);
+        if (parsed.ec != std::errc() || parsed.ptr != codeLine.data() + codeLine.size()) {
+            m_malformed = true;
+            return false;
+        }
+        code = m_code;
+        value = m_value;
+        return true;
+    }
+
+    void pushBack() { m_pushedBack = true; }
+    bool malformed() const { return m_malformed; }
+    qint64 offset() const { return m_pos - m_begin; }
+
+private:
+    bool readLine(std::string_view& line)
+    {
+        if (m_pos >= m_end) {
+            return false;
+        }
+        const char* eol = static_cast<const char*>(std::memchr(m_pos, '\n', static_cast<size_t>(m_end - m_pos)));
+        const char* last = eol ? eol : m_end;
+        if (last > m_pos && last[-1] == '\r') {
+            --last;
+        }
+        line = std::string_view(m_pos, static_cast<size_t>(last - m_pos));
+        m_pos = eol ? eol + 1 : m_end;
+        return true;
+    }
+
+    const char* m_begin;
+    const char* m_pos;
+    const char* m_end;
+    int m_code = 0;
+    std::string_view m_value;
+    bool m_pushedBack = false;
+    bool m_malformed = false;
+};
+
+enum class Kind : quint8 { Point, Line, Circle, Arc, Ellipse, Polyline, Spline, Text, Face, Insert };
+
+enum RecordFlag : quint8 {
+    Closed = 0x01,
+    WorldVertices = 0x02,       // 3D polyline: vertices in WCS rather than OCS
+    Multiline = 0x04,           // MTEXT
+    Planar = 0x08,              // SOLID: corners in OCS
+    FitPoints = 0x10,           // Spline given by fit points only
+    Rational = 0x20,
+    Hidden = 0x40
+};
+
+struct Vertex
+{
+    double x, y, z;
+    double w;                   // Bulge, or the weight of a spline control point
+};
+
+struct TextRef
+{
+    quint32 offset = 0;
+    quint32 length = 0;
+};
+
+/**
+ * One entity as read; geometry is built from it later. Numbers in
+ * Drawing::values, by kind:
+ *   Point     x y z
+ *   Line      x1 y1 z1 x2 y2 z2
+ *   Circle    cx cy cz r a0 a1 nx ny nz (angles unused)
+ *   Arc       cx cy cz r a0 a1 nx ny nz (degrees)
+ *   Ellipse   cx cy cz mx my mz nx ny nz ratio t0 t1
+ *   Polyline  elevation nx ny nz
+ *   Spline    degree knotCount knots...
+ *   Text      x y z height rotation nx ny nz
+ *   Face      4 corners, then nx ny nz
+ *   Insert    x y z sx sy sz rotation nx ny nz columns rows columnSpacing rowSpacing
+ */
+struct Record
+{
+    Kind kind;
+    quint8 flags;
+    qint16 color;               // ACI; 256 ByLayer, 0 ByBlock
+    int layer;                  // Into Drawing::layerNames
+    int lineType;               // Into Drawing::lineTypeNames; -1 ByLayer or ByBlock
+    qint16 lineWeight;          // 1/100 mm; 0 ByLayer
+    quint32 values;
+    quint32 vertices;
+    quint32 vertexCount;
+    quint32 attributes;
+    quint32 attributeCount;
+    TextRef text;               // Text content, or the block name of an insert
+};
+
+struct Attribute
+{
+    TextRef tag;
+    TextRef value;
+};
+
+struct AttributeDefinition
+{
+    TextRef tag;
+    TextRef prompt;
+    TextRef value;
+    double x, y, z;
+};
+
+struct LayerEntry
+{
+    int name = -1;
+    int color = 7;              // Negative: layer off
+    int trueColor = -1;
+    int lineType = -1;
+    int flags = 0;
+    int lineWeight = -3;        // 1/100 mm; negative: default
+    bool plottable = true;
+};
+
+struct BlockEntry
+{
+    TextRef name;
+    double base[3] = {0.0, 0.0, 0.0};
+    int flags = 0;
+    quint32 firstRecord = 0;
+    quint32 recordCount = 0;
+    quint32 firstDefinition = 0;
+    quint32 definitionCount = 0;
+};
+
+struct Drawing
+{
+    std::string_view version;
+    std::string_view currentLayer;
+    int units = 0;
+
+    std::vector<std::string_view> layerNames;
+    std::unordered_map<std::string_view, int> layerIds;
+    std::vector<std::string_view> lineTypeNames;
+    std::unordered_map<std::string_view, int> lineTypeIds;
+    std::vector<LayerEntry> layers;
+    std::vector<BlockEntry> blocks;
+
+    std::vector<Record> blockRecords;
+    std::vector<Record> records;
+    std::vector<double> values;
+    std::vector<Vertex> vertices;
+    std::vector<Attribute> attributes;
+    std::vector<AttributeDefinition> definitions;
+    std::string strings;
+    int skipped = 0;
+
+    int layerId(std::string_view name)
+    {
+        if (name.empty()) {
+            name = "0";
+        }
+        auto it = layerIds.find(name);
+        if (it != layerIds.end()) {
+            return it->second;
+        }
+        const int id = static_cast<int>(layerNames.size());
+        layerNames.push_back(name);
+        layerIds.emplace(name, id);
+        return id;
+    }
+
+    int lineTypeId(std::string_view name)
+    {
+        if (name.empty() || equalsNoCase(name, "BYLAYER") || equalsNoCase(name, "BYBLOCK")) {
+            return -1;
+        }
+        auto it = lineTypeIds.find(name);
+        if (it != lineTypeIds.end()) {
+            return it->second;
+        }
+        const int id = static_cast<int>(lineTypeNames.size());
+        lineTypeNames.push_back(name);
+        lineTypeIds.emplace(name, id);
+        return id;
+    }
+
+    TextRef store(std::string_view text)
+    {
+        TextRef ref;
+        ref.offset = static_cast<quint32>(strings.size());
+        ref.length = static_cast<quint32>(text.size());
+        strings.append(text);
+        return ref;
+    }
+
+    std::string_view text(const TextRef& ref) const { return std::string_view(strings).substr(ref.offset, ref.length); }
+};
+
+// Groups of the entity being read; reset per entity
+struct Scratch
+{
+    std::string_view layer;
+    std::string_view lineType;
+    std::string_view name;
+    std::string_view prompt;
+    int color;
+    int lineWeight;
+    int flags;
+    int count71;
+    int hAlign;
+    int vAlign;
+    bool paperSpace;
+    bool hidden;
+    bool hasAngle;
+    double point[4][3];
+    double real[10];            // 40-49
+    double angle[2];            // 50, 51
+    double normal[3];
+    double elevation;
+
+    void reset()
+    {
+        layer = lineType = name = prompt = std::string_view();
+        color = 256;
+        lineWeight = -1;
+        flags = count71 = hAlign = vAlign = 0;
+        paperSpace = hidden = hasAngle = false;
+        std::memset(point, 0, sizeof(point));
+        std::memset(real, 0, sizeof(real));
+        std::memset(angle, 0, sizeof(angle));
+        normal[0] = normal[1] = 0.0;
+        normal[2] = 1.0;
+        elevation = 0.0;
+    }
+};
+
+/**
+ * Single pass over the groups, from HEADER to the end of ENTITIES
+ */
+class Parser
+{
+public:
+    Parser(Tokenizer& tokens, Drawing& drawing) : m_tokens(tokens), m_drawing(drawing) {}
+
+    bool parse(QString* error)
+    {
+        int code;
+        std::string_view value;
+        bool complete = false;
+        while (m_tokens.next(code, value)) {
+            if (code != 0) {
+                continue;
+            }
+            value = trimmed(value);
+            if (value == "EOF") {
+                complete = true;
+                break;
+            }
+            if (value != "SECTION" || !m_tokens.next(code, value) || code != 2) {
+                continue;
+            }
+            value = trimmed(value);
+            if (value == "HEADER") {
+                parseHeader();
+            } else if (value == "TABLES") {
+                parseTables();
+            } else if (value == "BLOCKS") {
+                parseBlocks();
+            } else if (value == "ENTITIES") {
+                parseEntities(m_drawing.records, false, "ENDSEC");
+            }
+            // Other sections are skipped group by group by the loop above
+        }
+        if (m_tokens.malformed()) {
+            *error = QString("Malformed group code near byte %1").arg(m_tokens.offset());
+            return false;
+        }
+        // A file cut short would otherwise import as a partial drawing
+        if (!complete) {
+            *error = QStringLiteral("Unexpected end of file: no EOF marker");
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void parseHeader()
+    {
+        int code;
+        std::string_view value;
+        std::string_view variable;
+        while (m_tokens.next(code, value)) {
+            if (code == 0) {
+                if (trimmed(value) == "ENDSEC") {
+                    return;
+                }
+            } else if (code == 9) {
+                variable = trimmed(value);
+            } else if (variable == "$ACADVER" && code == 1) {
+                m_drawing.version = trimmed(value);
+            } else if (variable == "$INSUNITS" && code == 70) {
+                m_drawing.units = toInt(value);
+            } else if (variable == "$CLAYER" && code == 8) {
+                m_drawing.currentLayer = value;
+            }
+        }
+    }
+
+    void parseTables()
+    {
+        int code;
+        std::string_view value;
+        while (m_tokens.next(code, value)) {
+            if (code != 0) {
+                continue;
+            }
+            value = trimmed(value);
+            if (value == "ENDSEC") {
+                return;
+            }
+            if (value == "LAYER") {
+                parseLayer();
+            } else if (value == "LTYPE") {
+                // Only the names are kept; patterns come from the plot linetype table
+                while (m_tokens.next(code, value)) {
+                    if (code == 0) {
+                        m_tokens.pushBack();
+                        break;
+                    }
+                    if (code == 2) {
+                        m_drawing.lineTypeId(value);
+                    }
+                }
+            }
+        }
+    }
+
+    void parseLayer()
+    {
+        LayerEntry layer;
+        int code;
+        std::string_view value;
+        while (m_tokens.next(code, value)) {
+            switch (code) {
+            case 0: m_tokens.pushBack(); break;
+            case 2: layer.name = m_drawing.layerId(value); break;
+            case 6: layer.lineType = m_drawing.lineTypeId(value); break;
+            case 62: layer.color = toInt(value); break;
+            case 70: layer.flags = toInt(value); break;
+            case 290: layer.plottable = toInt(value) != 0; break;
+            case 370: layer.lineWeight = toInt(value); break;
+            case 420: layer.trueColor = toInt(value) & 0xffffff; break;
+            default: break;
+            }
+            if (code == 0) {
+                break;
+            }
+        }
+        if (layer.name >= 0) {
+            m_drawing.layers.push_back(layer);
+        }
+    }
+
+    void parseBlocks()
+    {
+        int code;
+        std::string_view value;
+        while (m_tokens.next(code, value)) {
+            if (code != 0) {
+                continue;
+            }
+            value = trimmed(value);
+            if (value == "ENDSEC") {
+                return;
+            }
+            if (value != "BLOCK") {
+                continue;
+            }
+
+            BlockEntry block;
+            while (m_tokens.next(code, value)) {
+                if (code == 0) {
+                    m_tokens.pushBack();
+                    break;
+                }
+                switch (code) {
+                case 2: block.name = m_drawing.store(value); break;
+                case 10: block.base[0] = toDouble(value); break;
+                case 20: block.base[1] = toDouble(value); break;
+                case 30: block.base[2] = toDouble(value); break;
+                case 70: block.flags = toInt(value); break;
+                default: break;
+                }
+            }
+            block.firstRecord = static_cast<quint32>(m_drawing.blockRecords.size());
+            block.firstDefinition = static_cast<quint32>(m_drawing.definitions.size());
+            parseEntities(m_drawing.blockRecords, true, "ENDBLK");
+            block.recordCount = static_cast<quint32>(m_drawing.blockRecords.size()) - block.firstRecord;
+            block.definitionCount = static_cast<quint32>(m_drawing.definitions.size()) - block.firstDefinition;
+            m_drawing.blocks.push_back(block);
+        }
+    }
+
+    void parseEntities(std::vector<Record>& records, bool inBlock, std::string_view terminator)
+    {
+        int code;
+        std::string_view value;
+        while (m_tokens.next(code, value)) {
+            if (code != 0) {
+                continue;
+            }
+            value = trimmed(value);
+            if (value == terminator) {
+                return;
+            }
+            if (value == "ENDSEC") {
+                m_tokens.pushBack();    // Unterminated block; let the caller see the section end
+                return;
+            }
+            parseEntity(value, records, inBlock);
+        }
+    }
+
+    void parseEntity(std::string_view type, std::vector<Record>& records, bool inBlock)
+    {
+        Kind kind;
+        quint8 flags = 0;
+        if (type == "LINE") {
+            kind = Kind::Line;
+        } else if (type == "POINT") {
+            kind = Kind::Point;
+        } else if (type == "CIRCLE") {
+            kind = Kind::Circle;
+        } else if (type == "ARC") {
+            kind = Kind::Arc;
+        } else if (type == "ELLIPSE") {
+            kind = Kind::Ellipse;
+        } else if (type == "LWPOLYLINE" || type == "POLYLINE") {
+            kind = Kind::Polyline;
+        } else if (type == "SPLINE") {
+            kind = Kind::Spline;
+        } else if (type == "TEXT") {
+            kind = Kind::Text;
+        } else if (type == "MTEXT") {
+            kind = Kind::Text;
+            flags |= Multiline;
+        } else if (type == "3DFACE") {
+            kind = Kind::Face;
+        } else if (type == "SOLID") {
+            kind = Kind::Face;
+            flags |= Planar;
+        } else if (type == "INSERT" || type == "DIMENSION") {
+            kind = Kind::Insert;
+        } else if (type == "ATTDEF" && inBlock) {
+            parseAttributeDefinition();
+            return;
+        } else {
+            skipGroups();
+            if (type != "VERTEX" && type != "SEQEND" && type != "ATTRIB") {
+                ++m_drawing.skipped;
+            }
+            return;
+        }
+
+        const size_t firstVertex = m_drawing.vertices.size();
+        const bool lightweight = type == "LWPOLYLINE";
+        readGroups(kind, flags, lightweight);
+        Scratch& s = m_scratch;
+
+        Record record;
+        record.kind = kind;
+        record.flags = flags;
+        record.color = static_cast<qint16>(std::clamp(std::abs(s.color), 0, 256));
+        record.layer = m_drawing.layerId(s.layer);
+        record.lineType = m_drawing.lineTypeId(s.lineType);
+        record.lineWeight = static_cast<qint16>(std::clamp(s.lineWeight, 0, 211));
+        record.values = static_cast<quint32>(m_drawing.values.size());
+        record.vertices = static_cast<quint32>(firstVertex);
+        record.vertexCount = 0;
+        record.attributes = static_cast<quint32>(m_drawing.attributes.size());
+        record.attributeCount = 0;
+        if (s.hidden) {
+            record.flags |= Hidden;
+        }
+
+        std::vector<double>& v = m_drawing.values;
+        auto push = [&v](std::initializer_list<double> numbers) { v.insert(v.end(), numbers); };
+        bool valid = true;
+        switch (kind) {
+        case Kind::Point:
+            push({s.point[0][0], s.point[0][1], s.point[0][2]});
+            break;
+        case Kind::Line:
+            push({s.point[0][0], s.point[0][1], s.point[0][2], s.point[1][0], s.point[1][1], s.point[1][2]});
+            break;
+        case Kind::Circle:
+        case Kind::Arc:
+            push({s.point[0][0], s.point[0][1], s.point[0][2], s.real[0], s.angle[0], s.angle[1],
+                  s.normal[0], s.normal[1], s.normal[2]});
+            valid = s.real[0] > 0.0;
+            break;
+        case Kind::Ellipse:
+            push({s.point[0][0], s.point[0][1], s.point[0][2], s.point[1][0], s.point[1][1], s.point[1][2],
+                  s.normal[0], s.normal[1], s.normal[2], s.real[0], s.real[1], s.real[2]});
+            valid = s.real[0] > 0.0 && s.real[0] <= 1.0;
+            break;
+        case Kind::Polyline:
+            if (lightweight) {
+                record.flags |= s.flags & 1 ? Closed : 0;
+                push({s.elevation, s.normal[0], s.normal[1], s.normal[2]});
+            } else {
+                // Header point carries the elevation; vertices follow as VERTEX entities
+                record.flags |= (s.flags & 1 ? Closed : 0) | (s.flags & 8 ? WorldVertices : 0);
+                push({s.point[0][2], s.normal[0], s.normal[1], s.normal[2]});
+                valid = (s.flags & (16 | 64)) == 0;     // Polygon and polyface meshes are not read
+                readPolylineVertices();
+            }
+            break;
+        case Kind::Spline:
+            record.flags |= (s.flags & 1 ? Closed : 0);
+            if (m_drawing.vertices.size() == firstVertex) {
+                m_drawing.vertices.insert(m_drawing.vertices.end(), m_fitPoints.begin(), m_fitPoints.end());
+                record.flags |= FitPoints;
+            } else if (m_weights.size() == m_drawing.vertices.size() - firstVertex) {
+                for (size_t i = 0; i < m_weights.size(); ++i) {
+                    m_drawing.vertices[firstVertex + i].w = m_weights[i];
+                }
+                record.flags |= Rational;
+            }
+            v.push_back(s.count71);
+            v.push_back(static_cast<double>(m_knots.size()));
+            v.insert(v.end(), m_knots.begin(), m_knots.end());
+            break;
+        case Kind::Text:
+            if (flags & Multiline) {
+                // MTEXT: WCS point, direction from the x-axis vector unless a rotation is given
+                const double rotation = s.hasAngle ? s.angle[0]
+                                                   : std::atan2(s.point[1][1], s.point[1][0]) * 180.0 / Pi;
+                push({s.point[0][0], s.point[0][1], s.point[0][2], s.real[0], rotation, 0.0, 0.0, 1.0});
+            } else {
+                // TEXT: the alignment point is the anchor unless left/baseline aligned
+                const int anchor = (s.hAlign != 0 || s.vAlign != 0) ? 1 : 0;
+                push({s.point[anchor][0], s.point[anchor][1], s.point[anchor][2], s.real[0], s.angle[0],
+                      s.normal[0], s.normal[1], s.normal[2]});
+            }
+            record.text = m_drawing.store(m_text);
+            break;
+        case Kind::Face:
+            if (flags & Planar) {
+                // SOLID corners run 1-2-4-3
+                push({s.point[0][0], s.point[0][1], s.point[0][2], s.point[1][0], s.point[1][1], s.point[1][2],
+                      s.point[3][0], s.point[3][1], s.point[3][2], s.point[2][0], s.point[2][1], s.point[2][2]});
+            } else {
+                push({s.point[0][0], s.point[0][1], s.point[0][2], s.point[1][0], s.point[1][1], s.point[1][2],
+                      s.point[2][0], s.point[2][1], s.point[2][2], s.point[3][0], s.point[3][1], s.point[3][2]});
+            }
+            push({s.normal[0], s.normal[1], s.normal[2]});
+            break;
+        case Kind::Insert:
+            if (type == "DIMENSION") {
+                // The dimension's block is drawn in place
+                push({0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 0.0, 0.0});
+            } else {
+                push({s.point[0][0], s.point[0][1], s.point[0][2], s.real[1], s.real[2], s.real[3], s.angle[0],
+                      s.normal[0], s.normal[1], s.normal[2], static_cast<double>(std::max(s.flags, 1)),
+                      static_cast<double>(std::max(s.count71, 1)), s.real[4], s.real[5]});
+                readAttributes();
+                record.attributeCount = static_cast<quint32>(m_drawing.attributes.size()) - record.attributes;
+            }
+            record.text = m_drawing.store(s.name);
+            valid = !s.name.empty();
+            break;
+        }
+        record.vertexCount = static_cast<quint32>(m_drawing.vertices.size() - firstVertex);
+
+        if (kind == Kind::Polyline && record.vertexCount == 0) {
+            valid = false;
+        }
+        if (!valid || s.paperSpace) {
+            m_drawing.values.resize(record.values);
+            m_drawing.vertices.resize(firstVertex);
+            m_drawing.attributes.resize(record.attributes);
+            ++m_drawing.skipped;
+            return;
+        }
+        records.push_back(record);
+    }
+
+    void readGroups(Kind kind, quint8 flags, bool lightweight)
+    {
+        Scratch& s = m_scratch;
+        s.reset();
+        m_text.clear();
+        m_fitPoints.clear();
+        m_knots.clear();
+        m_weights.clear();
+        if (kind == Kind::Insert) {
+            s.real[1] = s.real[2] = s.real[3] = 1.0;   // Scale defaults
+        } else if (kind == Kind::Ellipse) {
+            s.real[2] = 2.0 * Pi;
+        }
+
+        std::vector<Vertex>& vertices = m_drawing.vertices;
+        int code;
+        std::string_view value;
+        while (m_tokens.next(code, value)) {
+            if (code == 0) {
+                m_tokens.pushBack();
+                return;
+            }
+
+            // Repeating groups first
+            if (lightweight) {
+                if (code == 10) {
+                    vertices.push_back(Vertex{toDouble(value), 0.0, 0.0, 0.0});
+                    continue;
+                }
+                if (code == 20 || code == 42) {
+                    if (!vertices.empty()) {
+                        (code == 20 ? vertices.back().y : vertices.back().w) = toDouble(value);
+                    }
+                    continue;
+                }
+            } else if (kind == Kind::Spline) {
+                switch (code) {
+                case 10: vertices.push_back(Vertex{toDouble(value), 0.0, 0.0, 1.0}); continue;
+                case 20: if (!vertices.empty()) vertices.back().y = toDouble(value); continue;
+                case 30: if (!vertices.empty()) vertices.back().z = toDouble(value); continue;
+                case 11: m_fitPoints.push_back(Vertex{toDouble(value), 0.0, 0.0, 1.0}); continue;
+                case 21: if (!m_fitPoints.empty()) m_fitPoints.back().y = toDouble(value); continue;
+                case 31: if (!m_fitPoints.empty()) m_fitPoints.back().z = toDouble(value); continue;
+                case 40: m_knots.push_back(toDouble(value)); continue;
+                case 41: m_weights.push_back(toDouble(value)); continue;
+                default: break;
+                }
+            }
+
+            switch (code) {
+            case 1:
+                if (flags & Multiline) {
+                    m_text.append(value);
+                } else {
+                    m_text.assign(value);
+                }
+                break;
+            case 3:
+                if (flags & Multiline) {
+                    m_text.append(value);
+                } else {
+                    s.prompt = value;
+                }
+                break;
+            case 2: s.name = value; break;
+            case 6: s.lineType = value; break;
+            case 8: s.layer = value; break;
+            case 38: s.elevation = toDouble(value); break;
+            case 60: s.hidden = toInt(value) != 0; break;
+            case 62: s.color = toInt(value); break;
+            case 67: s.paperSpace = toInt(value) != 0; break;
+            case 70: s.flags = toInt(value); break;
+            case 71: s.count71 = toInt(value); break;
+            case 72: s.hAlign = toInt(value); break;
+            case 73: s.vAlign = toInt(value); break;
+            case 210: s.normal[0] = toDouble(value); break;
+            case 220: s.normal[1] = toDouble(value); break;
+            case 230: s.normal[2] = toDouble(value); break;
+            case 370: s.lineWeight = toInt(value); break;
+            default:
+                if (code >= 10 && code <= 13) {
+                    s.point[code - 10][0] = toDouble(value);
+                } else if (code >= 20 && code <= 23) {
+                    s.point[code - 20][1] = toDouble(value);
+                } else if (code >= 30 && code <= 33) {
+                    s.point[code - 30][2] = toDouble(value);
+                } else if (code >= 40 && code <= 49) {
+                    s.real[code - 40] = toDouble(value);
+                } else if (code == 50 || code == 51) {
+                    s.angle[code - 50] = toDouble(value);
+                    s.hasAngle = true;
+                }
+                break;
+            }
+        }
+    }
+
+    // VERTEX entities up to SEQEND
+    void readPolylineVertices()
+    {
+        int code;
+        std::string_view value;
+        while (m_tokens.next(code, value)) {
+            if (code != 0) {
+                continue;
+            }
+            value = trimmed(value);
+            if (value == "SEQEND") {
+                skipGroups();
+                return;
+            }
+            if (value != "VERTEX") {
+                m_tokens.pushBack();
+                return;
+            }
+            Vertex vertex{0.0, 0.0, 0.0, 0.0};
+            int vertexFlags = 0;
+            while (m_tokens.next(code, value)) {
+                if (code == 0) {
+                    m_tokens.pushBack();
+                    break;
+                }
+                switch (code) {
+                case 10: vertex.x = toDouble(value); break;
+                case 20: vertex.y = toDouble(value); break;
+                case 30: vertex.z = toDouble(value); break;
+                case 42: vertex.w = toDouble(value); break;
+                case 70: vertexFlags = toInt(value); break;
+                default: break;
+                }
+            }
+            // Spline frame control points are not part of the curve
+            if ((vertexFlags & 16) == 0) {
+                m_drawing.vertices.push_back(vertex);
+            }
+        }
+    }
+
+    // ATTRIB entities of an insert, up to SEQEND
+    void readAttributes()
+    {
+        int code;
+        std::string_view value;
+        while (m_tokens.next(code, value)) {
+            if (code != 0) {
+                continue;
+            }
+            value = trimmed(value);
+            if (value == "SEQEND") {
+                skipGroups();
+                return;
+            }
+            if (value != "ATTRIB") {
+                m_tokens.pushBack();
+                return;
+            }
+            std::string_view tag;
+            std::string_view text;
+            while (m_tokens.next(code, value)) {
+                if (code == 0) {
+                    m_tokens.pushBack();
+                    break;
+                }
+                if (code == 2) {
+                    tag = value;
+                } else if (code == 1) {
+                    text = value;
+                }
+            }
+            if (!tag.empty()) {
+                m_drawing.attributes.push_back(Attribute{m_drawing.store(tag), m_drawing.store(text)});
+            }
+        }
+    }
+
+    void parseAttributeDefinition()
+    {
+        readGroups(Kind::Text, 0, false);
+        const Scratch& s = m_scratch;
+        if (s.name.empty()) {
+            return;
+        }
+        AttributeDefinition definition;
+        definition.tag = m_drawing.store(s.name);
+        definition.prompt = m_drawing.store(s.prompt);
+        definition.value = m_drawing.store(m_text);
+        definition.x = s.point[0][0];
+        definition.y = s.point[0][1];
+        definition.z = s.point[0][2];
+        m_drawing.definitions.push_back(definition);
+    }
+
+    void skipGroups()
+    {
+        int code;
+        std::string_view value;
+        while (m_tokens.next(code, value)) {
+            if (code == 0) {
+                m_tokens.pushBack();
+                return;
+            }
+        }
+    }
+
+    Tokenizer& m_tokens;
+    Drawing& m_drawing;
+    Scratch m_scratch;
+    std::string m_text;
+    std::vector<Vertex> m_fitPoints;
+    std::vector<double> m_knots;
+    std::vector<double> m_weights;
+};
+
+// Object coordinate system of an extrusion direction (arbitrary axis algorithm)
+struct Ocs
+{
+    gp_Dir x, y, z;
+    bool world;
+
+    Ocs(double nx, double ny, double nz) : x(1, 0, 0), y(0, 1, 0), z(0, 0, 1), world(true)
+    {
+        const gp_Vec normal(nx, ny, nz);
+        if (normal.Magnitude() < Coincident || (std::abs(nx) < Coincident && std::abs(ny) < Coincident && nz > 0.0)) {
+            return;
+        }
+        world = false;
+        z = gp_Dir(normal);
+        const gp_Vec axis = std::abs(z.X()) < 1.0 / 64.0 && std::abs(z.Y()) < 1.0 / 64.0
+                                ? gp_Vec(0, 1, 0).Crossed(gp_Vec(z))
+                                : gp_Vec(0, 0, 1).Crossed(gp_Vec(z));
+        x = gp_Dir(axis);
+        y = z.Crossed(x);
+    }
+
+    gp_Pnt point(double px, double py, double pz) const
+    {
+        if (world) {
+            return gp_Pnt(px, py, pz);
+        }
+        return gp_Pnt(x.XYZ() * px + y.XYZ() * py + z.XYZ() * pz);
+    }
+};
+
+QString decode(std::string_view text, bool utf8)
+{
+    QString result = utf8 ? QString::fromUtf8(text.data(), static_cast<qsizetype>(text.size()))
+                          : QString::fromLatin1(text.data(), static_cast<qsizetype>(text.size()));
+
+    // Characters outside the code page are written as \U+XXXX
+    qsizetype index = result.indexOf(QLatin1String("\\U+"));
+    while (index >= 0) {
+        bool ok = false;
+        const uint codePoint = result.mid(index + 3, 4).toUInt(&ok, 16);
+        if (ok && index + 7 <= result.size()) {
+            result.replace(index, 7, QString(QChar::fromUcs4(codePoint)));
+        }
+        index = result.indexOf(QLatin1String("\\U+"), index + 1);
+    }
+    return result;
+}
+
+TopoDS_Shape buildPolyline(const Drawing& drawing, const Record& record, CADEntity::Type& type)
+{
+    const double* v = &drawing.values[record.values];
+    const Vertex* vertices = &drawing.vertices[record.vertices];
+    const int count = static_cast<int>(record.vertexCount);
+    const bool world = (record.flags & WorldVertices) != 0;
+    const bool closed = (record.flags & Closed) != 0;
+    const Ocs ocs(v[1], v[2], v[3]);
+    auto point = [&](const Vertex& vertex) {
+        return world ? gp_Pnt(vertex.x, vertex.y, vertex.z) : ocs.point(vertex.x, vertex.y, v[0]);
+    };
+
+    bool bulged = false;
+    for (int i = 0; i < count && !world; ++i) {
+        bulged = bulged || std::abs(vertices[i].w) > Coincident;
+    }
+
+    type = CADEntity::Polyline;
+    if (count == 1) {
+        type = CADEntity::Point;
+        return BRepBuilderAPI_MakeVertex(point(vertices[0])).Vertex();
+    }
+
+    if (!bulged) {
+        BRepBuilderAPI_MakePolygon polygon;
+        for (int i = 0; i < count; ++i) {
+            polygon.Add(point(vertices[i]));
+        }
+        if (closed && count > 2) {
+            polygon.Close();
+        }
+        return polygon.IsDone() ? TopoDS_Shape(polygon.Wire()) : TopoDS_Shape();
+    }
+
+    // Bulge: tangent of a quarter of the included angle, positive counterclockwise
+    BRepBuilderAPI_MakeWire wire;
+    const int segments = closed ? count : count - 1;
+    for (int i = 0; i < segments; ++i) {
+        const Vertex& a = vertices[i];
+        const Vertex& b = vertices[(i + 1) % count];
+        const double dx = b.x - a.x, dy = b.y - a.y;
+        const double length = std::sqrt(dx * dx + dy * dy);
+        if (length < Coincident) {
+            continue;
+        }
+        if (std::abs(a.w) <= Coincident) {
+            wire.Add(BRepBuilderAPI_MakeEdge(point(a), point(b)).Edge());
+            continue;
+        }
+        const double sagitta = a.w * length / 2.0;
+        const Vertex middle{(a.x + b.x) / 2.0 + dy / length * sagitta, (a.y + b.y) / 2.0 - dx / length * sagitta, 0.0, 0.0};
+        GC_MakeArcOfCircle arc(point(a), point(middle), point(b));
+        if (arc.IsDone()) {
+            wire.Add(BRepBuilderAPI_MakeEdge(arc.Value()).Edge());
+        }
+    }
+    return wire.IsDone() ? TopoDS_Shape(wire.Wire()) : TopoDS_Shape();
+}
+
+TopoDS_Shape buildSpline(const Drawing& drawing, const Record& record)
+{
+    const double* v = &drawing.values[record.values];
+    const Vertex* vertices = &drawing.vertices[record.vertices];
+    const int count = static_cast<int>(record.vertexCount);
+    const int degree = static_cast<int>(v[0]);
+    const int knotCount = static_cast<int>(v[1]);
+    const double* knots = v + 2;
+
+    if (record.flags & FitPoints) {
+        if (count < 2) {
+            return TopoDS_Shape();
+        }
+        Handle(TColgp_HArray1OfPnt) points = new TColgp_HArray1OfPnt(1, count);
+        for (int i = 0; i < count; ++i) {
+            points->SetValue(i + 1, gp_Pnt(vertices[i].x, vertices[i].y, vertices[i].z));
+        }
+        GeomAPI_Interpolate interpolate(points, (record.flags & Closed) != 0, Coincident);
+        interpolate.Perform();
+        return interpolate.IsDone() ? TopoDS_Shape(BRepBuilderAPI_MakeEdge(interpolate.Curve()).Edge())
+                                    : TopoDS_Shape();
+    }
+
+    if (degree < 1 || count < degree + 1 || knotCount != count + degree + 1) {
+        return TopoDS_Shape();
+    }
+
+    // Flat knot vector to distinct knots and multiplicities
+    std::vector<double> distinct;
+    std::vector<int> multiplicities;
+    for (int i = 0; i < knotCount; ++i) {
+        if (!distinct.empty() && std::abs(knots[i] - distinct.back()) <= Coincident * std::max(1.0, std::abs(knots[i]))) {
+            ++multiplicities.back();
+        } else {
+            distinct.push_back(knots[i]);
+            multiplicities.push_back(1);
+        }
+    }
+
+    TColgp_Array1OfPnt poles(1, count);
+    TColStd_Array1OfReal weights(1, count);
+    for (int i = 0; i < count; ++i) {
+        poles.SetValue(i + 1, gp_Pnt(vertices[i].x, vertices[i].y, vertices[i].z));
+        weights.SetValue(i + 1, vertices[i].w > 0.0 ? vertices[i].w : 1.0);
+    }
+    TColStd_Array1OfReal knotArray(1, static_cast<int>(distinct.size()));
+    TColStd_Array1OfInteger multiplicityArray(1, static_cast<int>(distinct.size()));
+    for (size_t i = 0; i < distinct.size(); ++i) {
+        knotArray.SetValue(static_cast<int>(i) + 1, distinct[i]);
+        multiplicityArray.SetValue(static_cast<int>(i) + 1, std::min(multiplicities[i], degree + 1));
+    }
+
+    Handle(Geom_BSplineCurve) curve = (record.flags & Rational)
+        ? new Geom_BSplineCurve(poles, weights, knotArray, multiplicityArray, degree)
+        : new Geom_BSplineCurve(poles, knotArray, multiplicityArray, degree);
+    return BRepBuilderAPI_MakeEdge(curve).Edge();
+}
+
+TopoDS_Shape buildFace(const Drawing& drawing, const Record& record, CADEntity::Type& type)
+{
+    const double* v = &drawing.values[record.values];
+    const Ocs ocs = (record.flags & Planar) ? Ocs(v[12], v[13], v[14]) : Ocs(0.0, 0.0, 1.0);
+
+    std::vector<gp_Pnt> corners;
+    for (int i = 0; i < 4; ++i) {
+        const gp_Pnt corner = ocs.point(v[i * 3], v[i * 3 + 1], v[i * 3 + 2]);
+        if (corners.empty() || !corner.IsEqual(corners.back(), Coincident)) {
+            corners.push_back(corner);
+        }
+    }
+    if (corners.size() > 2 && corners.front().IsEqual(corners.back(), Coincident)) {
+        corners.pop_back();
+    }
+    if (corners.size() < 3) {
+        return TopoDS_Shape();
+    }
+
+    BRepBuilderAPI_MakePolygon polygon;
+    for (const gp_Pnt& corner : corners) {
+        polygon.Add(corner);
+    }
+    polygon.Close();
+    if (!polygon.IsDone()) {
+        return TopoDS_Shape();
+    }
+    BRepBuilderAPI_MakeFace face(polygon.Wire(), Standard_True);
+    if (face.IsDone()) {
+        type = CADEntity::Surface;
+        return face.Face();
+    }
+    type = CADEntity::Polygon;      // Non-planar quad
+    return polygon.Wire();
+}
+
+// Shape of any record but an insert; null when it cannot be built
+TopoDS_Shape buildShape(const Drawing& drawing, const Record& record, CADEntity::Type& type)
+{
+    const double* v = &drawing.values[record.values];
+    switch (record.kind) {
+    case Kind::Point:
+        type = CADEntity::Point;
+        return BRepBuilderAPI_MakeVertex(gp_Pnt(v[0], v[1], v[2])).Vertex();
+    case Kind::Line: {
+        const gp_Pnt start(v[0], v[1], v[2]), end(v[3], v[4], v[5]);
+        if (start.IsEqual(end, Coincident)) {
+            type = CADEntity::Point;
+            return BRepBuilderAPI_MakeVertex(start).Vertex();
+        }
+        type = CADEntity::Line;
+        return BRepBuilderAPI_MakeEdge(start, end).Edge();
+    }
+    case Kind::Circle:
+    case Kind::Arc: {
+        const Ocs ocs(v[6], v[7], v[8]);
+        const gp_Circ circle(gp_Ax2(ocs.point(v[0], v[1], v[2]), ocs.z, ocs.x), v[3]);
+        if (record.kind == Kind::Circle) {
+            type = CADEntity::Circle;
+            return BRepBuilderAPI_MakeEdge(circle).Edge();
+        }
+        double start = v[4] * Pi / 180.0, end = v[5] * Pi / 180.0;
+        while (end <= start) {
+            end += 2.0 * Pi;
+        }
+        type = CADEntity::Arc;
+        return BRepBuilderAPI_MakeEdge(circle, start, end).Edge();
+    }
+    case Kind::Ellipse: {
+        const gp_Vec major(v[3], v[4], v[5]);
+        const gp_Vec normal(v[6], v[7], v[8]);
+        if (major.Magnitude() < Coincident || normal.Magnitude() < Coincident) {
+            return TopoDS_Shape();
+        }
+        const double radius = major.Magnitude();
+        const gp_Elips ellipse(gp_Ax2(gp_Pnt(v[0], v[1], v[2]), gp_Dir(normal), gp_Dir(major)), radius, radius * v[9]);
+        type = CADEntity::Ellipse;
+        double start = v[10], end = v[11];
+        if (std::abs(end - start) >= 2.0 * Pi - Coincident || std::abs(end - start) < Coincident) {
+            return BRepBuilderAPI_MakeEdge(ellipse).Edge();
+        }
+        while (end <= start) {
+            end += 2.0 * Pi;
+        }
+        return BRepBuilderAPI_MakeEdge(ellipse, start, end).Edge();
+    }
+    case Kind::Polyline:
+        return buildPolyline(drawing, record, type);
+    case Kind::Spline:
+        type = CADEntity::Spline;
+        return buildSpline(drawing, record);
+    case Kind::Text: {
+        const Ocs ocs(v[5], v[6], v[7]);
+        type = CADEntity::Text;
+        return BRepBuilderAPI_MakeVertex(ocs.point(v[0], v[1], v[2])).Vertex();
+    }
+    case Kind::Face:
+        return buildFace(drawing, record, type);
+    case Kind::Insert:
+        break;
+    }
+    return TopoDS_Shape();
+}
+
+// Insert placement of one copy of an array: block space (base at the origin) to WCS
+struct Placement
+{
+    gp_Mat matrix;
+    gp_XYZ translation;
+};
+
+Placement insertPlacement(const double* v, int column, int row)
+{
+    const Ocs ocs(v[7], v[8], v[9]);
+    const double angle = v[6] * Pi / 180.0;
+    const double c = std::cos(angle), s = std::sin(angle);
+    const double offsetX = column * v[12], offsetY = row * v[13];
+
+    Placement placement;
+    placement.matrix = gp_Mat(ocs.x.XYZ(), ocs.y.XYZ(), ocs.z.XYZ()) * gp_Mat(c, -s, 0.0, s, c, 0.0, 0.0, 0.0, 1.0)
+                       * gp_Mat(v[3], 0.0, 0.0, 0.0, v[4], 0.0, 0.0, 0.0, v[5]);
+    placement.translation = ocs.point(v[0] + c * offsetX - s * offsetY, v[1] + s * offsetX + c * offsetY, v[2]).XYZ();
+    return placement;
+}
+
+// Scale of a placement that is a similarity, 0 otherwise; negative when mirrored
+double uniformScale(const double* v)
+{
+    const double sx = std::abs(v[3]), sy = std::abs(v[4]), sz = std::abs(v[5]);
+    const double tolerance = Coincident * std::max(1.0, sx);
+    if (sx < Coincident || std::abs(sx - sy) > tolerance || std::abs(sx - sz) > tolerance) {
+        return 0.0;
+    }
+    return v[3] * v[4] * v[5] < 0.0 ? -sx : sx;
+}
+
+gp_Trsf toTrsf(const Placement& placement)
+{
+    const gp_Mat& m = placement.matrix;
+    const gp_XYZ& t = placement.translation;
+    gp_Trsf trsf;
+    trsf.SetValues(m(1, 1), m(1, 2), m(1, 3), t.X(), m(2, 1), m(2, 2), m(2, 3), t.Y(), m(3, 1), m(3, 2), m(3, 3), t.Z());
+    return trsf;
+}
+
+// Non-uniformly scaled placement, which only a general transform can apply
+TopoDS_Shape generalTransform(const TopoDS_Shape& shape, const Placement& placement)
+{
+    gp_GTrsf general;
+    general.SetVectorialPart(placement.matrix);
+    general.SetTranslationPart(placement.translation);
+    return BRepBuilderAPI_GTransform(shape, general, Standard_True).Shape();
+}
+
+/**
+ * Insert of a resolved block. Similarities, mirrored ones included, stay
+ * inserts placed by BlockManager; non-uniformly scaled inserts, which no
+ * gp_Trsf can carry, become plain transformed copies. Returns true for an
+ * insert.
+ */
+bool buildInsert(const TopoDS_Shape& block, const double* v, int column, int row, CADEntity& entity)
+{
+    const Placement placement = insertPlacement(v, column, row);
+    if (uniformScale(v) != 0.0) {
+        BlockManager::placeInsert(entity, block, toTrsf(placement));
+        entity.type = CADEntity::Block;
+        return true;
+    }
+    entity.shape = generalTransform(block, placement);
+    entity.type = CADEntity::Solid;
+    return false;
+}
+
+bool isLayoutBlock(std::string_view name)
+{
+    auto startsWith = [name](std::string_view prefix) {
+        return name.size() >= prefix.size() && equalsNoCase(name.substr(0, prefix.size()), prefix);
+    };
+    return startsWith("*MODEL_SPACE") || startsWith("*PAPER_SPACE");
+}
+
+} // namespace
+
+DxfReader::DxfReader(GeometryEngine* engine, LayerManager* layers, BlockManager* blocks)
+    : m_geometryEngine(engine)
+    , m_layerManager(layers)
+    , m_blockManager(blocks)
+{
+}
+
+DxfReader::~DxfReader() = default;
+
+QColor DxfReader::aciColor(int color)
+{
+    static const QRgb standard[] = {
+        qRgb(255, 255, 255), qRgb(255, 0, 0), qRgb(255, 255, 0), qRgb(0, 255, 0), qRgb(0, 255, 255),
+        qRgb(0, 0, 255), qRgb(255, 0, 255), qRgb(255, 255, 255), qRgb(128, 128, 128), qRgb(192, 192, 192)
+    };
+    color = std::abs(color);
+    if (color <= 9) {
+        return QColor(standard[color]);
+    }
+    if (color >= 250 && color <= 255) {
+        const int level = static_cast<int>(51 + (color - 250) * 40.8);
+        return QColor(level, level, level);
+    }
+    if (color > 255) {
+        return QColor(Qt::white);
+    }
+
+    // 10-249: 24 hues of 15 degrees, each in five shades of full and half saturation
+    static const double shades[] = {255.0, 204.0, 153.0, 127.0, 76.0};
+    const double hue = (color / 10 - 1) * 15.0;
+    const double value = shades[(color % 10) / 2];
+    const double saturation = color % 2 ? 0.5 : 1.0;
+    const int sector = static_cast<int>(hue / 60.0);
+    const double fraction = hue / 60.0 - sector;
+    const int p = static_cast<int>(value * (1.0 - saturation));
+    const int q = static_cast<int>(value * (1.0 - saturation * fraction));
+    const int t = static_cast<int>(value * (1.0 - saturation * (1.0 - fraction)));
+    const int v = static_cast<int>(value);
+    switch (sector) {
+    case 0: return QColor(v, t, p);
+    case 1: return QColor(q, v, p);
+    case 2: return QColor(p, v, t);
+    case 3: return QColor(p, q, v);
+    case 4: return QColor(t, p, v);
+    default: return QColor(v, p, q);
+    }
+}
+
+DxfReadResult DxfReader::read(const QString& path, const std::function<void()>& beforeImport)
+{
+    CAD_TRACE_SCOPE("dxf", "read");
+
+    DxfReadResult result;
+    if (!m_geometryEngine) {
+        result.error = QStringLiteral("No drawing to import into");
+        return result;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = QString("Cannot open %1: %2").arg(path, file.errorString());
+        return result;
+    }
+    result.bytes = file.size();
+
+    // Mapped when possible; pipes and some network files are read instead
+    QByteArray contents;
+    const char* begin = reinterpret_cast<const char*>(file.map(0, file.size()));
+    if (!begin) {
+        contents = file.readAll();
+        begin = contents.constData();
+    }
+    const char* end = begin + result.bytes;
+    if (result.bytes >= 3 && std::memcmp(begin, "\xef\xbb\xbf", 3) == 0) {
+        begin += 3;
+    }
+    if (end - begin >= 18 && std::memcmp(begin, "AutoCAD Binary DXF", 18) == 0) {
+        result.error = QStringLiteral("Binary DXF is not supported");
+        return result;
+    }
+
+    // Parse
+    QElapsedTimer timer;
+    timer.start();
+    Drawing drawing;
+    {
+        CAD_TRACE_SCOPE("dxf", "parse");
+        drawing.records.reserve(static_cast<size_t>(result.bytes / 200));
+        drawing.values.reserve(static_cast<size_t>(result.bytes / 40));
+        Tokenizer tokens(begin, end);
+        Parser parser(tokens, drawing);
+        if (!parser.parse(&result.error)) {
+            return result;
+        }
+    }
+    const bool utf8 = drawing.version >= std::string_view("AC1021");
+    result.version = QString::fromLatin1(drawing.version.data(), static_cast<qsizetype>(drawing.version.size()));
+    result.units = drawing.units;
+    result.skipped = drawing.skipped;
+    result.parseTimeMs = timer.restart();
+
+    if (beforeImport) {
+        beforeImport();
+    }
+
+    std::vector<QString> layerNames;
+    layerNames.reserve(drawing.layerNames.size());
+    for (std::string_view name : drawing.layerNames) {
+        layerNames.push_back(decode(name, utf8));
+    }
+    std::vector<int> lineTypes;
+    std::vector<QString> lineTypeNames;
+    for (std::string_view name : drawing.lineTypeNames) {
+        lineTypeNames.push_back(decode(name, utf8));
+        lineTypes.push_back(PlotEngine::lineTypeIndex(lineTypeNames.back()));
+    }
+
+    // Layers, as one undo step
+    if (m_layerManager) {
+        CAD_TRACE_SCOPE("dxf", "layers");
+        std::vector<bool> defined(layerNames.size(), false);
+        m_layerManager->beginUndoGroup(QStringLiteral("Import DXF layers"));
+        for (const LayerEntry& entry : drawing.layers) {
+            const QString& name = layerNames[entry.name];
+            LayerProperties properties(name);
+            properties.color = entry.trueColor >= 0 ? QColor(QRgb(entry.trueColor)) : aciColor(entry.color);
+            properties.lineType = entry.lineType >= 0 ? lineTypeNames[entry.lineType] : QStringLiteral("Continuous");
+            properties.lineWeight = entry.lineWeight >= 0 ? entry.lineWeight / 100.0 : 0.25;
+            properties.visible = entry.color >= 0;
+            properties.frozen = (entry.flags & 1) != 0 && name != m_layerManager->getCurrentLayer();
+            properties.locked = (entry.flags & 4) != 0;
+            properties.plottable = entry.plottable;
+            const bool applied = m_layerManager->layerExists(name) ? m_layerManager->setLayerProperties(name, properties)
+                                                                   : m_layerManager->createLayer(name, properties);
+            defined[entry.name] = true;
+            result.layers += applied ? 1 : 0;
+        }
+        // Layers that objects use without a table entry
+        for (size_t i = 0; i < layerNames.size(); ++i) {
+            if (!defined[i] && !m_layerManager->layerExists(layerNames[i]) && m_layerManager->createLayer(layerNames[i])) {
+                ++result.layers;
+            }
+        }
+        const QString current = decode(drawing.currentLayer, utf8);
+        if (m_layerManager->layerExists(current)) {
+            m_layerManager->setCurrentLayer(current);
+        }
+        m_layerManager->endUndoGroup();
+    }
+
+    auto applyCommon = [&](const Record& record, CADEntity& entity) {
+        entity.layer = layerNames[record.layer];
+        entity.color = record.color;
+        entity.lineType = record.lineType >= 0 ? lineTypes[record.lineType] : 0;
+        entity.lineWeight = record.lineWeight / 100.0;
+        entity.visible = (record.flags & Hidden) == 0;
+    };
+    auto textProperties = [&](const Record& record, CADEntity& entity) {
+        const double* v = &drawing.values[record.values];
+        entity.properties[QStringLiteral("text")] = decode(drawing.text(record.text), utf8);
+        entity.properties[QStringLiteral("height")] = v[3];
+        entity.properties[QStringLiteral("rotation")] = v[4];
+        if (record.flags & Multiline) {
+            entity.properties[QStringLiteral("multiline")] = true;
+        }
+    };
+
+    // Block contents, built in parallel, then defined in file order
+    std::unordered_map<std::string_view, int> blockIds;
+    std::vector<QString> blockNames(drawing.blocks.size());
+    std::vector<TopoDS_Shape> resolved(drawing.blocks.size());
+    for (size_t i = 0; i < drawing.blocks.size(); ++i) {
+        blockIds.emplace(drawing.text(drawing.blocks[i].name), static_cast<int>(i));
+        blockNames[i] = decode(drawing.text(drawing.blocks[i].name), utf8);
+    }
+    if (m_blockManager) {
+        CAD_TRACE_SCOPE("dxf", "blocks");
+        // Nested references no gp_Trsf can carry, baked into their parent's geometry below
+        struct BakedReference {
+            size_t block;
+            Placement placement;
+        };
+        std::vector<std::vector<BakedReference>> baked(drawing.blocks.size());
+        std::vector<std::vector<size_t>> children(drawing.blocks.size());
+        std::vector<BlockDefinition> definitions(drawing.blocks.size());
+        std::vector<TopoDS_Shape> contents(drawing.blockRecords.size());
+        Parallel::forEach(static_cast<int>(drawing.blockRecords.size()), [&](int i) {
+            const Record& record = drawing.blockRecords[i];
+            if (record.kind == Kind::Insert || record.kind == Kind::Text) {
+                return;
+            }
+            try {
+                CADEntity::Type type;
+                contents[i] = buildShape(drawing, record, type);
+            } catch (const Standard_Failure&) {
+                contents[i].Nullify();
+            }
+        });
+
+        for (size_t b = 0; b < drawing.blocks.size(); ++b) {
+            const BlockEntry& entry = drawing.blocks[b];
+            if (isLayoutBlock(drawing.text(entry.name)) || (entry.flags & (4 | 8)) != 0 || blockNames[b].isEmpty()) {
+                continue;   // Layout containers and external references
+            }
+            BlockDefinition& definition = definitions[b];
+            definition.name = blockNames[b];
+            definition.basePoint = gp_Pnt(entry.base[0], entry.base[1], entry.base[2]);
+            for (quint32 i = entry.firstRecord; i < entry.firstRecord + entry.recordCount; ++i) {
+                const Record& record = drawing.blockRecords[i];
+                if (record.kind != Kind::Insert) {
+                    if (!contents[i].IsNull()) {
+                        definition.geometry.push_back(contents[i]);
+                    }
+                    continue;
+                }
+                auto nested = blockIds.find(drawing.text(record.text));
+                if (nested == blockIds.end()) {
+                    ++result.skipped;
+                    continue;
+                }
+                children[b].push_back(static_cast<size_t>(nested->second));
+                const double* v = &drawing.values[record.values];
+                const bool similar = uniformScale(v) != 0.0;
+                const int columns = std::clamp(static_cast<int>(v[10]), 1, MaxArrayCopies);
+                const int rows = std::clamp(static_cast<int>(v[11]), 1, MaxArrayCopies / columns);
+                for (int row = 0; row < rows; ++row) {
+                    for (int column = 0; column < columns; ++column) {
+                        const Placement placement = insertPlacement(v, column, row);
+                        if (similar) {
+                            definition.nestedBlocks.push_back(NestedBlockReference{blockNames[nested->second], toTrsf(placement)});
+                        } else {
+                            baked[b].push_back(BakedReference{static_cast<size_t>(nested->second), placement});
+                        }
+                    }
+                }
+            }
+            for (quint32 i = entry.firstDefinition; i < entry.firstDefinition + entry.definitionCount; ++i) {
+                const AttributeDefinition& source = drawing.definitions[i];
+                BlockAttribute attribute;
+                attribute.tag = decode(drawing.text(source.tag), utf8);
+                attribute.prompt = decode(drawing.text(source.prompt), utf8);
+                attribute.defaultValue = decode(drawing.text(source.value), utf8);
+                attribute.position = gp_Pnt(source.x, source.y, source.z);
+                definition.attributes.push_back(attribute);
+            }
+            if (m_blockManager->defineBlock(definition)) {
+                ++result.blocks;
+            }
+        }
+
+        // Children bake first, so a parent takes their geometry complete
+        std::vector<char> visited(drawing.blocks.size(), 0);
+        std::function<void(size_t)> bake = [&](size_t b) {
+            if (visited[b]) {
+                return;
+            }
+            visited[b] = 1;
+            for (size_t child : children[b]) {
+                bake(child);
+            }
+            if (baked[b].empty() || !m_blockManager->hasBlock(blockNames[b])) {
+                return;
+            }
+            BlockDefinition& definition = definitions[b];
+            for (const BakedReference& reference : baked[b]) {
+                try {
+                    const TopoDS_Shape child = m_blockManager->resolvedShape(blockNames[reference.block]);
+                    if (child.IsNull()) {
+                        ++result.skipped;
+                        continue;
+                    }
+                    definition.geometry.push_back(generalTransform(child, reference.placement));
+                } catch (const Standard_Failure&) {
+                    ++result.skipped;
+                }
+            }
+            m_blockManager->defineBlock(definition);
+        };
+        for (size_t b = 0; b < drawing.blocks.size(); ++b) {
+            bake(b);
+        }
+
+        // Resolved once here; inserts only read them
+        for (size_t b = 0; b < drawing.blocks.size(); ++b) {
+            if (!m_blockManager->hasBlock(blockNames[b])) {
+                continue;
+            }
+            try {
+                resolved[b] = m_blockManager->resolvedShape(blockNames[b]);
+            } catch (const Standard_Failure&) {
+                resolved[b].Nullify();
+            }
+        }
+
+    }
+
+    // Model space: one slot per entity, arrays expanded
+    std::vector<size_t> slots(drawing.records.size() + 1, 0);
+    for (size_t i = 0; i < drawing.records.size(); ++i) {
+        const Record& record = drawing.records[i];
+        size_t copies = 1;
+        if (record.kind == Kind::Insert) {
+            const double* v = &drawing.values[record.values];
+            const int columns = std::clamp(static_cast<int>(v[10]), 1, MaxArrayCopies);
+            copies = static_cast<size_t>(columns) * std::clamp(static_cast<int>(v[11]), 1, MaxArrayCopies / columns);
+        }
+        slots[i + 1] = slots[i] + copies;
+    }
+
+    std::vector<CADEntity> entities(slots.back());
+    std::atomic<int> inserts(0);
+    {
+        CAD_TRACE_SCOPE("dxf", "build");
+        Parallel::forEach(static_cast<int>(drawing.records.size()), [&](int i) {
+            const Record& record = drawing.records[i];
+            CADEntity& first = entities[slots[i]];
+            try {
+                if (record.kind != Kind::Insert) {
+                    CADEntity::Type type = CADEntity::Point;
+                    first.shape = buildShape(drawing, record, type);
+                    first.type = type;
+                    applyCommon(record, first);
+                    if (record.kind == Kind::Text) {
+                        textProperties(record, first);
+                    }
+                    return;
+                }
+
+                auto block = blockIds.find(drawing.text(record.text));
+                if (block == blockIds.end() || resolved[block->second].IsNull()) {
+                    return;
+                }
+                const double* v = &drawing.values[record.values];
+                const int columns = std::clamp(static_cast<int>(v[10]), 1, MaxArrayCopies);
+                const BlockEntry& entry = drawing.blocks[block->second];
+
+                // Only attribute values that differ from the definition are kept
+                QVariantMap overrides;
+                for (quint32 a = record.attributes; a < record.attributes + record.attributeCount; ++a) {
+                    const Attribute& attribute = drawing.attributes[a];
+                    const std::string_view tag = drawing.text(attribute.tag);
+                    const std::string_view value = drawing.text(attribute.value);
+                    bool isDefault = false;
+                    for (quint32 d = entry.firstDefinition; d < entry.firstDefinition + entry.definitionCount; ++d) {
+                        if (drawing.text(drawing.definitions[d].tag) == tag) {
+                            isDefault = drawing.text(drawing.definitions[d].value) == value;
+                            break;
+                        }
+                    }
+                    if (!isDefault) {
+                        overrides[decode(tag, utf8)] = decode(value, utf8);
+                    }
+                }
+
+                for (size_t slot = slots[i]; slot < slots[i + 1]; ++slot) {
+                    const int copy = static_cast<int>(slot - slots[i]);
+                    CADEntity& entity = entities[slot];
+                    const bool isInsert = buildInsert(resolved[block->second], v, copy % columns, copy / columns, entity);
+                    applyCommon(record, entity);
+                    if (isInsert) {
+                        entity.properties[QStringLiteral("blockName")] = blockNames[block->second];
+                        if (!overrides.isEmpty()) {
+                            entity.properties[QStringLiteral("attributes")] = overrides;
+                        }
+                        ++inserts;
+                    }
+                }
+            } catch (const Standard_Failure&) {
+                for (size_t slot = slots[i]; slot < slots[i + 1]; ++slot) {
+                    entities[slot].shape.Nullify();
+                }
+            }
+        });
+    }
+
+    const size_t built = entities.size();
+    entities.erase(std::remove_if(entities.begin(), entities.end(),
+                                  [](const CADEntity& entity) { return entity.shape.IsNull(); }),
+                   entities.end());
+    result.skipped += static_cast<int>(built - entities.size());
+    result.entities = static_cast<int>(entities.size());
+    result.inserts = inserts.load();
+    result.buildTimeMs = timer.restart();
+
+    m_geometryEngine->addEntities(std::move(entities));
+    result.insertTimeMs = timer.elapsed();
+    result.success = true;
+
+    qCDebug(cadDxf) << "Read" << path << "(" << result.version << "):" << result.entities << "entities,"
+                    << result.inserts << "inserts," << result.blocks << "blocks," << result.layers << "layers,"
+                    << result.skipped << "skipped in" << result.parseTimeMs << "+" << result.buildTimeMs << "+"
+                    << result.insertTimeMs << "ms";
+    return result;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QColor>
+#include <QLoggingCategory>
+#include <QString>
+#include <functional>
+
+class BlockManager;
+class GeometryEngine;
+class LayerManager;
+
+Q_DECLARE_LOGGING_CATEGORY(cadDxf)
+
+/**
+ * @brief Counters and timings of one DXF import
+ */
+struct DxfReadResult
+{
+    bool success;
+    QString error;
+    QString version;            // $ACADVER, e.g. "AC1027"
+    int units;                  // $INSUNITS: 0 unitless, 1 inches, 2 feet, 4 mm, 5 cm, 6 m
+    int entities;               // Added to the drawing, inserts included
+    int inserts;
+    int skipped;                // Unsupported or paper-space objects, and geometry that failed to build
+    int layers;
+    int blocks;
+    qint64 bytes;
+    qint64 parseTimeMs;
+    qint64 buildTimeMs;
+    qint64 insertTimeMs;
+
+    DxfReadResult()
+        : success(false), units(0), entities(0), inserts(0), skipped(0), layers(0), blocks(0), bytes(0),
+          parseTimeMs(0), buildTimeMs(0), insertTimeMs(0) {}
+};
+
+/**
+ * @brief ASCII DXF importer
+ *
+ * The file is memory-mapped and read in a single pass by a tokenizer that
+ * hands out group codes and values as views into the mapping: numbers are
+ * parsed in place, layer and linetype names are interned once, and nothing
+ * is allocated per group. The pass only records entities, as compact
+ * records of numbers and vertices, and fails on a malformed group code or
+ * a missing EOF marker without touching the drawing.
+ *
+ * Geometry is built afterwards on all cores, each record turning into its
+ * TopoDS shape independently: block contents first, then model space. The
+ * drawing receives the result in one step: layers (colour, linetype,
+ * lineweight, on, frozen, locked, plot) as one layer undo group, block
+ * definitions through BlockManager, and every entity through
+ * GeometryEngine::addEntities().
+ *
+ * Read: LINE, POINT, CIRCLE, ARC, ELLIPSE, LWPOLYLINE, POLYLINE (2D with
+ * bulges, and 3D), SPLINE, TEXT, MTEXT, 3DFACE, SOLID, INSERT (attributes
+ * and arrays) and DIMENSION, as an insert of its block. Inserts with a
+ * uniform scale, mirrored or not, stay inserts of their block; those with
+ * a non-uniform scale become transformed copies, and nested references of
+ * that kind are baked into their parent block's geometry. Paper space,
+ * other object types and binary DXF are not read. Without a BlockManager,
+ * inserts are skipped.
+ */
+class DxfReader
+{
+public:
+    DxfReader(GeometryEngine* engine, LayerManager* layers = nullptr, BlockManager* blocks = nullptr);
+    ~DxfReader();
+
+    // beforeImport runs once the whole file has parsed, before anything is added to the
+    // drawing; a caller replacing its drawing clears it there, so a file that cannot be
+    // read leaves the current one intact
+    DxfReadResult read(const QString& path, const std::function<void()>& beforeImport = {});
+
+    // AutoCAD colour index to RGB; 7 is white
+    static QColor aciColor(int color);
+
+private:
+    GeometryEngine* m_geometryEngine;
+    LayerManager* m_layerManager;
+    BlockManager* m_blockManager;
+};
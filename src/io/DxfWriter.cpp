@@ -0,0 +1,1120 @@
+#include "DxfWriter.h"
+#include "BlockManager.h"
+#include "DxfReader.h"
+#include "GeometryEngine.h"
+#include "LayerManager.h"
+#include "Parallel.h"
+#include "PlotEngine.h"
+#include "Tracing.h"
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QHash>
+#include <QSet>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include <BRepAdaptor_Curve.hxx>
+#include <BRepAdaptor_Surface.hxx>
+#include <BRepTools.hxx>
+#include <BRepTools_WireExplorer.hxx>
+#include <BRep_Tool.hxx>
+#include <GeomConvert.hxx>
+#include <Geom_BSplineCurve.hxx>
+#include <Geom_TrimmedCurve.hxx>
+#include <Standard_Failure.hxx>
+#include <TColStd_Array1OfReal.hxx>
+#include <TopExp.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Wire.hxx>
+#include <gp_Mat.hxx>
+
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+constexpr double Coincident = 1.0e-9;
+constexpr size_t BytesPerEntity = 192;      // Reserve estimate for one formatted entity
+constexpr int ChunksPerThread = 4;          // Keeps threads busy when entity sizes differ
+constexpr int SplineSamples = 64;           // Curves that cannot become a B-spline are written as 3D polylines
+constexpr double AttributeHeight = 2.5;     // Block attributes carry no text height
+
+// Object coordinate system of an extrusion direction (arbitrary axis algorithm)
+struct Ocs
+{
+    gp_XYZ x, y, z;
+
+    explicit Ocs(const gp_Dir& normal) : z(normal.XYZ())
+    {
+        const gp_XYZ axis = std::abs(z.X()) < 1.0 / 64.0 && std::abs(z.Y()) < 1.0 / 64.0
+                                ? gp_XYZ(0, 1, 0).Crossed(z)
+                                : gp_XYZ(0, 0, 1).Crossed(z);
+        x = axis.Normalized();
+        y = z.Crossed(x);
+    }
+
+    gp_XYZ toOcs(const gp_XYZ& point) const { return gp_XYZ(point.Dot(x), point.Dot(y), point.Dot(z)); }
+    bool isWorld() const { return z.Z() > 1.0 - Coincident; }
+};
+
+// Latin-1 for R2000 (ANSI_1252), other characters as \U+XXXX
+std::string encode(const QString& text)
+{
+    std::string result;
+    result.reserve(static_cast<size_t>(text.size()));
+    for (const QChar c : text) {
+        const char16_t unit = c.unicode();
+        if (unit == '\n' || unit == '\r') {
+            result.push_back(' ');
+        } else if (unit < 0x100) {
+            result.push_back(static_cast<char>(unit));
+        } else {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\U+%04X", static_cast<unsigned>(unit));
+            result.append(buffer);
+        }
+    }
+    return result;
+}
+
+// Handles are upper-case hexadecimal without leading zeros, as AutoCAD writes them
+void appendHex(std::string& out, quint64 value)
+{
+    char buffer[24];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, 16);
+    for (char* c = buffer; c != result.ptr; ++c) {
+        *c = static_cast<char>(std::toupper(static_cast<unsigned char>(*c)));
+    }
+    out.append(buffer, result.ptr);
+}
+
+/**
+ * Appends group code and value lines to a buffer; codes are right-aligned
+ * to three characters as AutoCAD writes them
+ */
+class GroupWriter
+{
+public:
+    explicit GroupWriter(std::string& out) : m_out(out) {}
+
+    void text(int code, std::string_view value)
+    {
+        groupCode(code);
+        m_out.append(value);
+        m_out.push_back('\n');
+    }
+
+    void integer(int code, long long value)
+    {
+        groupCode(code);
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        m_out.append(buffer, result.ptr);
+        m_out.push_back('\n');
+    }
+
+    // Shortest representation that reads back to the same double
+    void real(int code, double value)
+    {
+        groupCode(code);
+        if (!std::isfinite(value)) {
+            value = 0.0;
+        }
+        char buffer[32];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value + 0.0);
+        m_out.append(buffer, result.ptr);
+        m_out.push_back('\n');
+    }
+
+    // Returns the offset of the value in the buffer
+    size_t handle(int code, quint64 value)
+    {
+        groupCode(code);
+        const size_t offset = m_out.size();
+        appendHex(m_out, value);
+        m_out.push_back('\n');
+        return offset;
+    }
+
+    void point(int code, const gp_XYZ& p)
+    {
+        real(code, p.X());
+        real(code + 10, p.Y());
+        real(code + 20, p.Z());
+    }
+
+    void normal(const gp_XYZ& n)
+    {
+        if (n.Z() < 1.0 - Coincident) {
+            point(210, n);
+        }
+    }
+
+private:
+    void groupCode(int code)
+    {
+        char buffer[8];
+        char* first = buffer;
+        if (code < 100) {
+            *first++ = ' ';
+        }
+        if (code < 10) {
+            *first++ = ' ';
+        }
+        const auto result = std::to_chars(first, buffer + sizeof(buffer), code);
+        *result.ptr = '\n';
+        m_out.append(buffer, result.ptr + 1);
+    }
+
+    std::string& m_out;
+};
+
+// Read-only during formatting; shared by all threads
+struct Context
+{
+    const BlockManager* blocks = nullptr;
+    QHash<QString, std::string> layers;
+    QHash<QString, std::string> blockNames;
+    std::vector<std::string> lineTypes;
+    quint64 modelSpace = 0;                 // BLOCK_RECORD handle owning the ENTITIES section
+};
+
+// Rebases handles a formatter numbered from zero onto the range the buffer got in the file
+std::string relocate(const std::string& buffer, const std::vector<size_t>& handles, quint64 base)
+{
+    std::string result;
+    result.reserve(buffer.size() + handles.size() * 4);
+    size_t position = 0;
+    for (size_t offset : handles) {
+        quint64 local = 0;
+        const auto parsed = std::from_chars(buffer.data() + offset, buffer.data() + buffer.size(), local, 16);
+        result.append(buffer, position, offset - position);
+        appendHex(result, base + local);
+        position = static_cast<size_t>(parsed.ptr - buffer.data());
+    }
+    result.append(buffer, position, std::string::npos);
+    return result;
+}
+
+/**
+ * Writes drawing entities as DXF entities into one buffer
+ *
+ * Handles come from the given counter. A chunk formatter numbers them from
+ * zero and lists their offsets in localHandles, so relocate() can move
+ * them once the handles of the chunks before it are known.
+ */
+class EntityFormatter
+{
+public:
+    EntityFormatter(std::string& out, const Context& context, quint64& handles,
+                    std::vector<size_t>* localHandles = nullptr)
+        : m_groups(out), m_context(context), m_handles(handles), m_localHandles(localHandles),
+          m_owner(context.modelSpace)
+    {
+    }
+
+    int records() const { return m_records; }
+
+    // BLOCK_RECORD of the block the entities that follow belong to
+    void setOwner(quint64 blockRecord) { m_owner = blockRecord; }
+
+    // Layer and properties of the entities that follow; block contents use layer 0 and ByLayer
+    void setProperties(const CADEntity* entity)
+    {
+        static const std::string layerZero = "0";
+        m_layer = &layerZero;
+        m_color = 256;
+        m_lineType = nullptr;
+        m_lineWeight = -1;
+        m_hidden = false;
+        if (!entity) {
+            return;
+        }
+        auto layer = m_context.layers.constFind(entity->layer.isEmpty() ? QStringLiteral("0") : entity->layer);
+        if (layer != m_context.layers.constEnd()) {
+            m_layer = &layer.value();
+        }
+        m_color = std::clamp(entity->color, 0, 256);
+        if (entity->lineType > 0 && entity->lineType < static_cast<int>(m_context.lineTypes.size())) {
+            m_lineType = &m_context.lineTypes[entity->lineType];
+        }
+        if (entity->lineWeight > 0.0) {
+            m_lineWeight = static_cast<int>(std::lround(entity->lineWeight * 100.0));
+        }
+        m_hidden = !entity->visible;
+    }
+
+    // Returns true for an insert
+    bool entity(const CADEntity& entity)
+    {
+        setProperties(&entity);
+        const QString blockName = entity.type == CADEntity::Block
+                                      ? entity.properties.value(QStringLiteral("blockName")).toString() : QString();
+        if (!blockName.isEmpty() && m_context.blockNames.contains(blockName)) {
+            insert(blockName, BlockManager::insertTransform(entity),
+                   entity.properties.value(QStringLiteral("attributes")).toMap(), true);
+            return true;
+        }
+        if (entity.type == CADEntity::Text && !entity.shape.IsNull() && entity.shape.ShapeType() == TopAbs_VERTEX) {
+            text(entity);
+            return false;
+        }
+        shape(entity.shape);
+        return false;
+    }
+
+    void shape(const TopoDS_Shape& shape)
+    {
+        if (shape.IsNull()) {
+            return;
+        }
+
+        // Faces: planar triangles and quads as 3DFACE, the rest as their edges
+        TopTools_IndexedMapOfShape faceEdges;
+        for (TopExp_Explorer faces(shape, TopAbs_FACE); faces.More(); faces.Next()) {
+            const TopoDS_Face& face = TopoDS::Face(faces.Current());
+            if (!face3d(face)) {
+                TopExp::MapShapes(face, TopAbs_EDGE, faceEdges);
+            }
+        }
+        for (int i = 1; i <= faceEdges.Extent(); ++i) {
+            edge(TopoDS::Edge(faceEdges(i)));
+        }
+
+        // Free wires, edges and vertices
+        for (TopExp_Explorer wires(shape, TopAbs_WIRE, TopAbs_FACE); wires.More(); wires.Next()) {
+            const TopoDS_Wire& wire = TopoDS::Wire(wires.Current());
+            if (!polyline(wire)) {
+                for (TopExp_Explorer edges(wire, TopAbs_EDGE); edges.More(); edges.Next()) {
+                    edge(TopoDS::Edge(edges.Current()));
+                }
+            }
+        }
+        for (TopExp_Explorer edges(shape, TopAbs_EDGE, TopAbs_WIRE); edges.More(); edges.Next()) {
+            edge(TopoDS::Edge(edges.Current()));
+        }
+        for (TopExp_Explorer vertices(shape, TopAbs_VERTEX, TopAbs_EDGE); vertices.More(); vertices.Next()) {
+            begin("POINT", "AcDbPoint");
+            m_groups.point(10, BRep_Tool::Pnt(TopoDS::Vertex(vertices.Current())).XYZ());
+        }
+    }
+
+    void insert(const QString& blockName, const gp_Trsf& trsf, const QVariantMap& overrides, bool withAttributes)
+    {
+        // Matrix columns are the scaled block axes; a mirror is folded into X
+        const gp_Mat matrix = trsf.VectorialPart();
+        gp_XYZ xAxis = matrix.Column(1);
+        double sx = xAxis.Modulus();
+        const double sy = matrix.Column(2).Modulus();
+        const double sz = matrix.Column(3).Modulus();
+        if (matrix.Determinant() < 0.0) {
+            sx = -sx;
+            xAxis.Reverse();
+        }
+        const Ocs ocs(gp_Dir(matrix.Column(3)));
+        const double rotation = std::atan2(xAxis.Dot(ocs.y), xAxis.Dot(ocs.x)) * 180.0 / Pi;
+
+        const BlockDefinition* definition = m_context.blocks ? m_context.blocks->getBlockDefinition(blockName) : nullptr;
+        const bool attributes = withAttributes && definition && !definition->attributes.empty();
+
+        begin("INSERT", "AcDbBlockReference");
+        if (attributes) {
+            m_groups.integer(66, 1);
+        }
+        m_groups.text(2, m_context.blockNames.value(blockName));
+        m_groups.point(10, ocs.toOcs(trsf.TranslationPart()));
+        if (std::abs(sx - 1.0) > Coincident || std::abs(sy - 1.0) > Coincident || std::abs(sz - 1.0) > Coincident) {
+            m_groups.real(41, sx);
+            m_groups.real(42, sy);
+            m_groups.real(43, sz);
+        }
+        if (std::abs(rotation) > Coincident) {
+            m_groups.real(50, rotation);
+        }
+        m_groups.normal(ocs.z);
+        if (!attributes) {
+            return;
+        }
+
+        // Every attribute, with the insert's value where it differs from the default
+        const gp_XYZ base = definition->basePoint.XYZ();
+        for (const BlockAttribute& attribute : definition->attributes) {
+            gp_XYZ position = attribute.position.XYZ() - base;
+            trsf.Transforms(position);
+            const QString value = overrides.value(attribute.tag, attribute.defaultValue).toString();
+            begin("ATTRIB", "AcDbText", false);
+            m_groups.point(10, position);
+            m_groups.real(40, AttributeHeight);
+            m_groups.text(1, encode(value));
+            m_groups.text(100, "AcDbAttribute");
+            m_groups.text(2, encode(attribute.tag));
+            m_groups.integer(70, 0);
+        }
+        begin("SEQEND", nullptr, false);
+    }
+
+    void attributeDefinition(const BlockAttribute& attribute)
+    {
+        begin("ATTDEF", "AcDbText");
+        m_groups.point(10, attribute.position.XYZ());
+        m_groups.real(40, AttributeHeight);
+        m_groups.text(1, encode(attribute.defaultValue));
+        m_groups.text(100, "AcDbAttributeDefinition");
+        m_groups.text(3, encode(attribute.prompt));
+        m_groups.text(2, encode(attribute.tag));
+        m_groups.integer(70, 0);
+    }
+
+private:
+    // Entities that belong to another one (attributes, vertices, SEQEND) are not counted;
+    // they are owned by the entity before them instead of the block record
+    void begin(const char* type, const char* subclass, bool counted = true)
+    {
+        m_groups.text(0, type);
+        const quint64 handle = m_handles++;
+        localHandle(m_groups.handle(5, handle));
+        if (counted) {
+            m_groups.handle(330, m_owner);
+            m_parent = handle;
+        } else {
+            localHandle(m_groups.handle(330, m_parent));
+        }
+        m_groups.text(100, "AcDbEntity");
+        m_groups.text(8, *m_layer);
+        if (m_lineType) {
+            m_groups.text(6, *m_lineType);
+        }
+        if (m_color != 256) {
+            m_groups.integer(62, m_color);
+        }
+        if (m_lineWeight > 0) {
+            m_groups.integer(370, m_lineWeight);
+        }
+        if (m_hidden) {
+            m_groups.integer(60, 1);
+        }
+        if (subclass) {
+            m_groups.text(100, subclass);
+        }
+        m_records += counted ? 1 : 0;
+    }
+
+    void localHandle(size_t offset)
+    {
+        if (m_localHandles) {
+            m_localHandles->push_back(offset);
+        }
+    }
+
+    void text(const CADEntity& entity)
+    {
+        const gp_XYZ position = BRep_Tool::Pnt(TopoDS::Vertex(entity.shape)).XYZ();
+        const QString content = entity.properties.value(QStringLiteral("text")).toString();
+        const double height = entity.properties.value(QStringLiteral("height"), AttributeHeight).toDouble();
+        const double rotation = entity.properties.value(QStringLiteral("rotation")).toDouble();
+        if (entity.properties.value(QStringLiteral("multiline")).toBool()) {
+            begin("MTEXT", "AcDbMText");
+            m_groups.point(10, position);
+            m_groups.real(40, height);
+            // Text beyond 250 characters goes into leading 3 groups
+            const std::string encoded = encode(content);
+            std::string_view rest(encoded);
+            while (rest.size() > 250) {
+                m_groups.text(3, rest.substr(0, 250));
+                rest.remove_prefix(250);
+            }
+            m_groups.text(1, rest);
+            if (std::abs(rotation) > Coincident) {
+                m_groups.real(50, rotation);
+            }
+            return;
+        }
+        begin("TEXT", "AcDbText");
+        m_groups.point(10, position);
+        m_groups.real(40, height);
+        m_groups.text(1, encode(content));
+        if (std::abs(rotation) > Coincident) {
+            m_groups.real(50, rotation);
+        }
+        m_groups.text(100, "AcDbText");
+    }
+
+    bool face3d(const TopoDS_Face& face)
+    {
+        BRepAdaptor_Surface surface(face, Standard_False);
+        if (surface.GetType() != GeomAbs_Plane) {
+            return false;
+        }
+        const TopoDS_Wire outer = BRepTools::OuterWire(face);
+        int wires = 0;
+        for (TopExp_Explorer explorer(face, TopAbs_WIRE); explorer.More(); explorer.Next()) {
+            ++wires;
+        }
+        if (outer.IsNull() || wires != 1) {
+            return false;
+        }
+
+        gp_XYZ corners[4];
+        int count = 0;
+        for (BRepTools_WireExplorer explorer(outer, face); explorer.More(); explorer.Next()) {
+            if (count == 4 || BRepAdaptor_Curve(explorer.Current()).GetType() != GeomAbs_Line) {
+                return false;
+            }
+            corners[count++] = BRep_Tool::Pnt(explorer.CurrentVertex()).XYZ();
+        }
+        if (count < 3) {
+            return false;
+        }
+        if (count == 3) {
+            corners[3] = corners[2];
+        }
+        begin("3DFACE", "AcDbFace");
+        for (int i = 0; i < 4; ++i) {
+            m_groups.point(10 + i, corners[i]);
+        }
+        return true;
+    }
+
+    // LWPOLYLINE for planar line-and-arc wires, 3D POLYLINE for other line wires
+    bool polyline(const TopoDS_Wire& wire)
+    {
+        struct Vertex { gp_XYZ point; double bulge; };
+        std::vector<Vertex> vertices;
+        gp_XYZ last;
+        bool arcs = false;
+        for (BRepTools_WireExplorer explorer(wire); explorer.More(); explorer.Next()) {
+            const TopoDS_Edge& current = explorer.Current();
+            BRepAdaptor_Curve curve(current);
+            const gp_XYZ start = BRep_Tool::Pnt(explorer.CurrentVertex()).XYZ();
+            last = BRep_Tool::Pnt(TopExp::LastVertex(current, Standard_True)).XYZ();
+            double bulge = 0.0;
+            if (curve.GetType() == GeomAbs_Circle) {
+                if (std::abs(curve.Circle().Axis().Direction().Z()) < 1.0 - Coincident) {
+                    return false;
+                }
+                const gp_XYZ middle = curve.Value((curve.FirstParameter() + curve.LastParameter()) / 2.0).XYZ();
+                const double dx = last.X() - start.X(), dy = last.Y() - start.Y();
+                const double chord = std::sqrt(dx * dx + dy * dy);
+                if (chord < Coincident) {
+                    return false;           // Full circle
+                }
+                // Sagitta signed positive to the right of the chord: counterclockwise
+                const double side = (dx * (middle.Y() - start.Y()) - dy * (middle.X() - start.X())) / chord;
+                bulge = -2.0 * side / chord;
+                arcs = true;
+            } else if (curve.GetType() != GeomAbs_Line) {
+                return false;
+            }
+            vertices.push_back(Vertex{start, bulge});
+        }
+        if (vertices.empty()) {
+            return false;
+        }
+        const bool closed = last.IsEqual(vertices.front().point, Coincident);
+        if (!closed) {
+            vertices.push_back(Vertex{last, 0.0});
+        }
+
+        const double elevation = vertices.front().point.Z();
+        bool planar = true;
+        for (const Vertex& vertex : vertices) {
+            planar = planar && std::abs(vertex.point.Z() - elevation) <= Coincident * std::max(1.0, std::abs(elevation));
+        }
+        if (!planar && arcs) {
+            return false;
+        }
+
+        if (planar) {
+            begin("LWPOLYLINE", "AcDbPolyline");
+            m_groups.integer(90, static_cast<long long>(vertices.size()));
+            m_groups.integer(70, closed ? 1 : 0);
+            if (std::abs(elevation) > 0.0) {
+                m_groups.real(38, elevation);
+            }
+            for (const Vertex& vertex : vertices) {
+                m_groups.real(10, vertex.point.X());
+                m_groups.real(20, vertex.point.Y());
+                if (vertex.bulge != 0.0) {
+                    m_groups.real(42, vertex.bulge);
+                }
+            }
+            return true;
+        }
+
+        std::vector<gp_XYZ> points;
+        points.reserve(vertices.size());
+        for (const Vertex& vertex : vertices) {
+            points.push_back(vertex.point);
+        }
+        polyline3d(points, closed);
+        return true;
+    }
+
+    void polyline3d(const std::vector<gp_XYZ>& points, bool closed)
+    {
+        begin("POLYLINE", "AcDb3dPolyline");
+        m_groups.integer(66, 1);
+        m_groups.point(10, gp_XYZ(0.0, 0.0, 0.0));
+        m_groups.integer(70, 8 | (closed ? 1 : 0));
+        for (const gp_XYZ& point : points) {
+            begin("VERTEX", "AcDbVertex", false);
+            m_groups.text(100, "AcDb3dPolylineVertex");
+            m_groups.point(10, point);
+            m_groups.integer(70, 32);
+        }
+        begin("SEQEND", nullptr, false);
+    }
+
+    void edge(const TopoDS_Edge& edge)
+    {
+        if (BRep_Tool::Degenerated(edge)) {
+            return;
+        }
+        BRepAdaptor_Curve curve(edge);
+        const double first = curve.FirstParameter(), last = curve.LastParameter();
+        switch (curve.GetType()) {
+        case GeomAbs_Line:
+            // Vertex points, exact where the curve parameterisation is not
+            begin("LINE", "AcDbLine");
+            m_groups.point(10, BRep_Tool::Pnt(TopExp::FirstVertex(edge, Standard_True)).XYZ());
+            m_groups.point(11, BRep_Tool::Pnt(TopExp::LastVertex(edge, Standard_True)).XYZ());
+            return;
+        case GeomAbs_Circle: {
+            const gp_Circ circle = curve.Circle();
+            const Ocs ocs(circle.Axis().Direction());
+            const gp_XYZ center = ocs.isWorld() ? circle.Location().XYZ() : ocs.toOcs(circle.Location().XYZ());
+            const gp_XYZ xAxis = circle.XAxis().Direction().XYZ();
+            const double offset = std::atan2(xAxis.Dot(ocs.y), xAxis.Dot(ocs.x));
+            const bool full = last - first >= 2.0 * Pi - Coincident;
+            begin(full ? "CIRCLE" : "ARC", "AcDbCircle");
+            m_groups.point(10, center);
+            m_groups.real(40, circle.Radius());
+            m_groups.normal(ocs.z);
+            if (!full) {
+                m_groups.text(100, "AcDbArc");
+                m_groups.real(50, (first + offset) * 180.0 / Pi);
+                m_groups.real(51, (last + offset) * 180.0 / Pi);
+            }
+            return;
+        }
+        case GeomAbs_Ellipse: {
+            const gp_Elips ellipse = curve.Ellipse();
+            begin("ELLIPSE", "AcDbEllipse");
+            m_groups.point(10, ellipse.Location().XYZ());
+            m_groups.point(11, ellipse.XAxis().Direction().XYZ() * ellipse.MajorRadius());
+            m_groups.point(210, ellipse.Axis().Direction().XYZ());
+            m_groups.real(40, ellipse.MinorRadius() / ellipse.MajorRadius());
+            m_groups.real(41, first);
+            m_groups.real(42, last);
+            return;
+        }
+        default:
+            spline(edge);
+            return;
+        }
+    }
+
+    void spline(const TopoDS_Edge& edge)
+    {
+        double first = 0.0, last = 0.0;
+        const Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, first, last);
+        if (curve.IsNull()) {
+            return;
+        }
+
+        Handle(Geom_BSplineCurve) bspline;
+        try {
+            bspline = GeomConvert::CurveToBSplineCurve(new Geom_TrimmedCurve(curve, first, last));
+            if (bspline->IsPeriodic()) {
+                bspline->SetNotPeriodic();
+            }
+        } catch (const Standard_Failure&) {
+            bspline.Nullify();
+        }
+        if (bspline.IsNull()) {
+            std::vector<gp_XYZ> points;
+            for (int i = 0; i <= SplineSamples; ++i) {
+                points.push_back(curve->Value(first + (last - first) * i / SplineSamples).XYZ());
+            }
+            polyline3d(points, false);
+            return;
+        }
+
+        const int poles = bspline->NbPoles();
+        TColStd_Array1OfReal knots(1, poles + bspline->Degree() + 1);
+        bspline->KnotSequence(knots);
+        const bool rational = bspline->IsRational();
+
+        begin("SPLINE", "AcDbSpline");
+        m_groups.integer(70, (bspline->IsClosed() ? 1 : 0) | (rational ? 4 : 0));
+        m_groups.integer(71, bspline->Degree());
+        m_groups.integer(72, knots.Length());
+        m_groups.integer(73, poles);
+        m_groups.integer(74, 0);
+        for (int i = knots.Lower(); i <= knots.Upper(); ++i) {
+            m_groups.real(40, knots(i));
+        }
+        if (rational) {
+            for (int i = 1; i <= poles; ++i) {
+                m_groups.real(41, bspline->Weight(i));
+            }
+        }
+        for (int i = 1; i <= poles; ++i) {
+            m_groups.point(10, bspline->Pole(i).XYZ());
+        }
+    }
+
+    GroupWriter m_groups;
+    const Context& m_context;
+    quint64& m_handles;
+    std::vector<size_t>* m_localHandles;
+    quint64 m_owner;
+    quint64 m_parent = 0;
+    const std::string* m_layer = nullptr;
+    const std::string* m_lineType = nullptr;
+    int m_color = 256;
+    int m_lineWeight = -1;
+    bool m_hidden = false;
+    int m_records = 0;
+};
+
+} // namespace
+
+DxfWriter::DxfWriter(GeometryEngine* engine, LayerManager* layers, BlockManager* blocks)
+    : m_geometryEngine(engine)
+    , m_layerManager(layers)
+    , m_blockManager(blocks)
+    , m_units(4)
+{
+}
+
+DxfWriter::~DxfWriter() = default;
+
+int DxfWriter::nearestAci(const QColor& color)
+{
+    int best = 7;
+    int bestDistance = std::numeric_limits<int>::max();
+    for (int index = 1; index <= 255; ++index) {
+        const QColor candidate = DxfReader::aciColor(index);
+        const int dr = candidate.red() - color.red();
+        const int dg = candidate.green() - color.green();
+        const int db = candidate.blue() - color.blue();
+        const int distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance) {
+            best = index;
+            bestDistance = distance;
+            if (distance == 0) {
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+DxfWriteResult DxfWriter::write(const QString& path, const std::vector<int>& entityIds)
+{
+    CAD_TRACE_SCOPE("dxf", "write");
+
+    DxfWriteResult result;
+    if (!m_geometryEngine) {
+        result.error = QStringLiteral("No drawing to export");
+        return result;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Xref entities and their "xref|layer" layers belong to the referenced file
+    const QString xrefKey = QStringLiteral("xref");
+    std::vector<const CADEntity*> entities;
+    for (int id : entityIds.empty() ? m_geometryEngine->getAllEntityIds() : entityIds) {
+        const CADEntity* entity = m_geometryEngine->findEntity(id);
+        if (entity && !entity->properties.contains(xrefKey)) {
+            entities.push_back(entity);
+        }
+    }
+
+    // Names are encoded once; workers only look them up
+    Context context;
+    context.blocks = m_blockManager;
+    QStringList layerNames;
+    if (m_layerManager) {
+        for (const QString& name : m_layerManager->getLayerNames()) {
+            if (!name.contains(QLatin1Char('|'))) {
+                layerNames.append(name);
+            }
+        }
+    }
+    if (!layerNames.contains(QStringLiteral("0"))) {
+        layerNames.prepend(QStringLiteral("0"));
+    }
+    for (const QString& name : layerNames) {
+        context.layers.insert(name, encode(name));
+    }
+    for (const CADEntity* entity : entities) {
+        if (!entity->layer.isEmpty() && !context.layers.contains(entity->layer)) {
+            layerNames.append(entity->layer);
+            context.layers.insert(entity->layer, encode(entity->layer));
+        }
+    }
+    const QStringList blockNames = m_blockManager ? m_blockManager->getBlockNames() : QStringList();
+    for (const QString& name : blockNames) {
+        context.blockNames.insert(name, encode(name));
+    }
+    for (const QString& name : PlotEngine::lineTypeNames()) {
+        context.lineTypes.push_back(encode(name));
+    }
+
+    // Handles of the objects entities refer to are fixed before formatting starts; table
+    // records and blocks follow, then the entity chunks in order
+    quint64 nextHandle = 1;
+    const quint64 rootDictionary = nextHandle++;
+    const quint64 groupDictionary = nextHandle++;
+    const quint64 modelSpace = nextHandle++;
+    const quint64 paperSpace = nextHandle++;
+    context.modelSpace = modelSpace;
+
+    // Entities: chunks formatted on the pool while this thread does the rest
+    const int threads = Parallel::maxThreads();
+    const int chunkCount = std::min(static_cast<int>(entities.size()), threads * ChunksPerThread);
+    const size_t chunkSize = chunkCount > 0 ? (entities.size() + chunkCount - 1) / chunkCount : 0;
+    std::vector<std::string> chunks(chunkCount);
+    std::vector<quint64> chunkHandles(chunkCount, 0);
+    std::vector<std::vector<size_t>> chunkHandleOffsets(chunkCount);
+    std::atomic<int> records(0);
+    std::atomic<int> inserts(0);
+
+    Parallel::Loop formatting(chunkCount, [&](int c) {
+        const size_t begin = c * chunkSize;
+        const size_t end = std::min(entities.size(), begin + chunkSize);
+        std::string& buffer = chunks[c];
+        buffer.reserve((end - begin) * BytesPerEntity);
+        EntityFormatter formatter(buffer, context, chunkHandles[c], &chunkHandleOffsets[c]);
+        int chunkInserts = 0;
+        for (size_t i = begin; i < end; ++i) {
+            try {
+                chunkInserts += formatter.entity(*entities[i]) ? 1 : 0;
+            } catch (const Standard_Failure& failure) {
+                qCWarning(cadDxf) << "Cannot write entity:" << failure.GetMessageString();
+            }
+        }
+        records += formatter.records();
+        inserts += chunkInserts;
+    });
+
+    // Classes, tables and blocks; the header needs the final handle count and is written last
+    std::string head;
+    head.reserve(64 * 1024);
+    GroupWriter groups(head);
+    groups.text(0, "SECTION");
+    groups.text(2, "CLASSES");
+    groups.text(0, "ENDSEC");
+
+    groups.text(0, "SECTION");
+    groups.text(2, "TABLES");
+
+    auto beginTable = [&](const char* name, int count) {
+        const quint64 handle = nextHandle++;
+        groups.text(0, "TABLE");
+        groups.text(2, name);
+        groups.handle(5, handle);
+        groups.handle(330, 0);
+        groups.text(100, "AcDbSymbolTable");
+        groups.integer(70, count);
+        return handle;
+    };
+    auto beginRecord = [&](const char* type, const char* subclass, quint64 table, quint64 handle) {
+        groups.text(0, type);
+        groups.handle(5, handle);
+        groups.handle(330, table);
+        groups.text(100, "AcDbSymbolTableRecord");
+        groups.text(100, subclass);
+    };
+
+    beginTable("VPORT", 0);
+    groups.text(0, "ENDTAB");
+
+    // Built-in linetypes plus any other name a layer uses
+    QStringList lineTypes = PlotEngine::lineTypeNames();
+    QList<LayerProperties> layers;
+    for (const QString& name : layerNames) {
+        layers.append(m_layerManager && m_layerManager->layerExists(name) ? m_layerManager->getLayerProperties(name)
+                                                                           : LayerProperties(name));
+        if (!lineTypes.contains(layers.last().lineType, Qt::CaseInsensitive)) {
+            lineTypes.append(layers.last().lineType);
+        }
+    }
+    const quint64 lineTypeTable = beginTable("LTYPE", lineTypes.size() + 2);
+    for (const char* name : {"ByBlock", "ByLayer"}) {
+        beginRecord("LTYPE", "AcDbLinetypeTableRecord", lineTypeTable, nextHandle++);
+        groups.text(2, name);
+        groups.integer(70, 0);
+        groups.text(3, "");
+        groups.integer(72, 65);
+        groups.integer(73, 0);
+        groups.real(40, 0.0);
+    }
+    for (int i = 0; i < lineTypes.size(); ++i) {
+        const std::vector<double>& dashes = i < PlotEngine::lineTypeNames().size() ? PlotEngine::dashLengths(i)
+                                                                                    : std::vector<double>();
+        beginRecord("LTYPE", "AcDbLinetypeTableRecord", lineTypeTable, nextHandle++);
+        groups.text(2, encode(lineTypes[i]));
+        groups.integer(70, 0);
+        groups.text(3, "");
+        groups.integer(72, 65);
+        groups.integer(73, static_cast<long long>(dashes.size()));
+        double length = 0.0;
+        for (double dash : dashes) {
+            length += dash;
+        }
+        groups.real(40, length);
+        // Dashes positive, gaps negative
+        for (size_t d = 0; d < dashes.size(); ++d) {
+            groups.real(49, d % 2 == 0 ? dashes[d] : -dashes[d]);
+            groups.integer(74, 0);
+        }
+    }
+    groups.text(0, "ENDTAB");
+
+    const quint64 layerTable = beginTable("LAYER", layers.size());
+    for (const LayerProperties& layer : layers) {
+        const int aci = nearestAci(layer.color);
+        beginRecord("LAYER", "AcDbLayerTableRecord", layerTable, nextHandle++);
+        groups.text(2, context.layers.value(layer.name));
+        groups.integer(70, (layer.frozen ? 1 : 0) | (layer.locked ? 4 : 0));
+        groups.integer(62, layer.visible ? aci : -aci);
+        if (DxfReader::aciColor(aci).rgb() != layer.color.rgb()) {
+            groups.integer(420, static_cast<long long>(layer.color.rgb() & 0xffffff));
+        }
+        groups.text(6, encode(layer.lineType));
+        groups.integer(290, layer.plottable ? 1 : 0);
+        groups.integer(370, static_cast<long long>(std::lround(layer.lineWeight * 100.0)));
+    }
+    groups.text(0, "ENDTAB");
+    result.layers = layers.size();
+
+    const quint64 styleTable = beginTable("STYLE", 1);
+    beginRecord("STYLE", "AcDbTextStyleTableRecord", styleTable, nextHandle++);
+    groups.text(2, "Standard");
+    groups.integer(70, 0);
+    groups.real(40, 0.0);
+    groups.real(41, 1.0);
+    groups.real(50, 0.0);
+    groups.integer(71, 0);
+    groups.real(42, AttributeHeight);
+    groups.text(3, "txt");
+    groups.text(4, "");
+    groups.text(0, "ENDTAB");
+
+    beginTable("VIEW", 0);
+    groups.text(0, "ENDTAB");
+    beginTable("UCS", 0);
+    groups.text(0, "ENDTAB");
+
+    const quint64 appTable = beginTable("APPID", 1);
+    beginRecord("APPID", "AcDbRegAppTableRecord", appTable, nextHandle++);
+    groups.text(2, "ACAD");
+    groups.integer(70, 0);
+    groups.text(0, "ENDTAB");
+
+    // Dimension styles carry their handle in group 105
+    const quint64 dimStyleTable = beginTable("DIMSTYLE", 1);
+    groups.text(100, "AcDbDimStyleTable");
+    groups.text(0, "DIMSTYLE");
+    groups.handle(105, nextHandle++);
+    groups.handle(330, dimStyleTable);
+    groups.text(100, "AcDbSymbolTableRecord");
+    groups.text(100, "AcDbDimStyleTableRecord");
+    groups.text(2, "Standard");
+    groups.integer(70, 0);
+    groups.text(0, "ENDTAB");
+
+    // One record per block, layouts included; blocks and their contents name it as owner
+    std::vector<const BlockDefinition*> definitions;
+    for (const QString& name : blockNames) {
+        if (const BlockDefinition* definition = m_blockManager->getBlockDefinition(name)) {
+            definitions.push_back(definition);
+        }
+    }
+    std::vector<quint64> blockRecords;
+    const quint64 blockRecordTable = beginTable("BLOCK_RECORD", static_cast<int>(definitions.size()) + 2);
+    beginRecord("BLOCK_RECORD", "AcDbBlockTableRecord", blockRecordTable, modelSpace);
+    groups.text(2, "*Model_Space");
+    beginRecord("BLOCK_RECORD", "AcDbBlockTableRecord", blockRecordTable, paperSpace);
+    groups.text(2, "*Paper_Space");
+    for (const BlockDefinition* definition : definitions) {
+        blockRecords.push_back(nextHandle++);
+        beginRecord("BLOCK_RECORD", "AcDbBlockTableRecord", blockRecordTable, blockRecords.back());
+        groups.text(2, context.blockNames.value(definition->name));
+    }
+    groups.text(0, "ENDTAB");
+    groups.text(0, "ENDSEC");
+
+    groups.text(0, "SECTION");
+    groups.text(2, "BLOCKS");
+    auto beginBlock = [&](const std::string& name, quint64 record, int flags, const gp_XYZ& base, bool paper) {
+        groups.text(0, "BLOCK");
+        groups.handle(5, nextHandle++);
+        groups.handle(330, record);
+        groups.text(100, "AcDbEntity");
+        if (paper) {
+            groups.integer(67, 1);
+        }
+        groups.text(8, "0");
+        groups.text(100, "AcDbBlockBegin");
+        groups.text(2, name);
+        groups.integer(70, flags);
+        groups.point(10, base);
+        groups.text(3, name);
+        groups.text(1, "");
+    };
+    auto endBlock = [&](quint64 record, bool paper) {
+        groups.text(0, "ENDBLK");
+        groups.handle(5, nextHandle++);
+        groups.handle(330, record);
+        groups.text(100, "AcDbEntity");
+        if (paper) {
+            groups.integer(67, 1);
+        }
+        groups.text(8, "0");
+        groups.text(100, "AcDbBlockEnd");
+    };
+    beginBlock("*Model_Space", modelSpace, 0, gp_XYZ(0.0, 0.0, 0.0), false);
+    endBlock(modelSpace, false);
+    beginBlock("*Paper_Space", paperSpace, 0, gp_XYZ(0.0, 0.0, 0.0), true);
+    endBlock(paperSpace, true);
+
+    EntityFormatter blockFormatter(head, context, nextHandle);
+    for (size_t b = 0; b < definitions.size(); ++b) {
+        const BlockDefinition* definition = definitions[b];
+        beginBlock(context.blockNames.value(definition->name), blockRecords[b],
+                   definition->attributes.empty() ? 0 : 2, definition->basePoint.XYZ(), false);
+
+        blockFormatter.setProperties(nullptr);
+        blockFormatter.setOwner(blockRecords[b]);
+        try {
+            for (const TopoDS_Shape& shape : definition->geometry) {
+                blockFormatter.shape(shape);
+            }
+            for (const NestedBlockReference& nested : definition->nestedBlocks) {
+                if (context.blockNames.contains(nested.blockName)) {
+                    blockFormatter.insert(nested.blockName, nested.transform, QVariantMap(), false);
+                }
+            }
+        } catch (const Standard_Failure& failure) {
+            qCWarning(cadDxf) << "Cannot write block" << definition->name << ":" << failure.GetMessageString();
+        }
+        for (const BlockAttribute& attribute : definition->attributes) {
+            blockFormatter.attributeDefinition(attribute);
+        }
+
+        endBlock(blockRecords[b], false);
+        ++result.blocks;
+    }
+    groups.text(0, "ENDSEC");
+    groups.text(0, "SECTION");
+    groups.text(2, "ENTITIES");
+
+    {
+        CAD_TRACE_SCOPE("dxf", "formatEntities");
+        formatting.wait();
+    }
+
+    // Chunk handles follow the blocks in chunk order
+    std::vector<quint64> chunkBases(chunkCount);
+    for (int c = 0; c < chunkCount; ++c) {
+        chunkBases[c] = nextHandle;
+        nextHandle += chunkHandles[c];
+    }
+    Parallel::forEach(chunkCount, [&](int c) {
+        chunks[c] = relocate(chunks[c], chunkHandleOffsets[c], chunkBases[c]);
+    });
+
+    // $HANDSEED lies above every handle in the file
+    std::string header;
+    GroupWriter headerGroups(header);
+    headerGroups.text(0, "SECTION");
+    headerGroups.text(2, "HEADER");
+    headerGroups.text(9, "$ACADVER");
+    headerGroups.text(1, "AC1015");
+    headerGroups.text(9, "$DWGCODEPAGE");
+    headerGroups.text(3, "ANSI_1252");
+    headerGroups.text(9, "$HANDSEED");
+    headerGroups.handle(5, nextHandle);
+    headerGroups.text(9, "$INSUNITS");
+    headerGroups.integer(70, m_units);
+    if (m_layerManager) {
+        headerGroups.text(9, "$CLAYER");
+        headerGroups.text(8, encode(m_layerManager->getCurrentLayer()));
+    }
+    headerGroups.text(0, "ENDSEC");
+
+    // Root dictionary with the group dictionary every R2000 drawing has
+    std::string tail;
+    GroupWriter tailGroups(tail);
+    tailGroups.text(0, "ENDSEC");
+    tailGroups.text(0, "SECTION");
+    tailGroups.text(2, "OBJECTS");
+    tailGroups.text(0, "DICTIONARY");
+    tailGroups.handle(5, rootDictionary);
+    tailGroups.handle(330, 0);
+    tailGroups.text(100, "AcDbDictionary");
+    tailGroups.integer(281, 1);
+    tailGroups.text(3, "ACAD_GROUP");
+    tailGroups.handle(350, groupDictionary);
+    tailGroups.text(0, "DICTIONARY");
+    tailGroups.handle(5, groupDictionary);
+    tailGroups.handle(330, rootDictionary);
+    tailGroups.text(100, "AcDbDictionary");
+    tailGroups.integer(281, 1);
+    tailGroups.text(0, "ENDSEC");
+    tailGroups.text(0, "EOF");
+    result.formatTimeMs = timer.restart();
+
+    // One write per buffer, into a temporary file that replaces the target only once complete
+    {
+        CAD_TRACE_SCOPE("dxf", "writeFile");
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            result.error = QString("Cannot write %1: %2").arg(path, file.errorString());
+            return result;
+        }
+        auto writeBuffer = [&](const std::string& buffer) {
+            const qint64 size = static_cast<qint64>(buffer.size());
+            if (size > 0 && file.write(buffer.data(), size) != size) {
+                return false;
+            }
+            result.bytes += size;
+            return true;
+        };
+        bool ok = writeBuffer(header) && writeBuffer(head);
+        for (const std::string& chunk : chunks) {
+            ok = ok && writeBuffer(chunk);
+        }
+        ok = ok && writeBuffer(tail);
+        // On failure the existing file is untouched; the uncommitted temporary file is removed
+        if (!ok || !file.commit()) {
+            result.error = QString("Cannot write %1: %2").arg(path, file.errorString());
+            result.bytes = 0;
+            return result;
+        }
+    }
+    result.writeTimeMs = timer.elapsed();
+
+    result.entities = static_cast<int>(entities.size());
+    result.inserts = inserts.load();
+    result.records = records.load();
+    result.success = true;
+
+    qCDebug(cadDxf) << "Wrote" << path << ":" << result.entities << "entities as" << result.records << "records,"
+                    << result.blocks << "blocks," << result.layers << "layers," << result.bytes << "bytes in"
+                    << result.formatTimeMs << "+" << result.writeTimeMs << "ms";
+    return result;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QColor>
+#include <QString>
+#include <vector>
+
+class BlockManager;
+class GeometryEngine;
+class LayerManager;
+
+/**
+ * @brief Counters and timings of one DXF export
+ */
+struct DxfWriteResult
+{
+    bool success;
+    QString error;
+    int entities;               // Drawing entities written, inserts included
+    int inserts;
+    int records;                // DXF entities in the ENTITIES section
+    int layers;
+    int blocks;
+    qint64 bytes;
+    qint64 formatTimeMs;
+    qint64 writeTimeMs;
+
+    DxfWriteResult()
+        : success(false), entities(0), inserts(0), records(0), layers(0), blocks(0), bytes(0), formatTimeMs(0),
+          writeTimeMs(0) {}
+};
+
+/**
+ * @brief ASCII DXF (R2000) exporter
+ *
+ * The ENTITIES section is cut into chunks of entities that are formatted
+ * in parallel, each into its own buffer reserved up front; numbers go
+ * through std::to_chars, so coordinates round-trip exactly without locale
+ * or stream overhead. Header, tables and blocks are formatted on the
+ * calling thread meanwhile, and the file is then written with one large
+ * write per buffer.
+ *
+ * The file carries the structure R2000 readers require: every table,
+ * record, block and entity has a handle and an owner, blocks have
+ * BLOCK_RECORD entries, $HANDSEED lies above the last handle and the
+ * OBJECTS section holds the root dictionary. Chunks number their handles
+ * from zero and are rebased once the chunks before them are done.
+ *
+ * Layers (colour as the nearest ACI plus the exact true colour, linetype,
+ * lineweight, on, frozen, locked, plot) come from LayerManager, block
+ * definitions with nested blocks and attribute definitions from
+ * BlockManager. Inserts are written as INSERT with their attribute
+ * values; other entities are written from their geometry: edges as LINE,
+ * CIRCLE, ARC, ELLIPSE or SPLINE, planar line-and-arc wires as
+ * LWPOLYLINE, triangular and quadrilateral planar faces as 3DFACE, other
+ * faces and solids as their edges, and text as TEXT or MTEXT. Xref
+ * entities and their "xref|layer" layers are left out, as they belong to
+ * the referenced file.
+ */
+class DxfWriter
+{
+public:
+    DxfWriter(GeometryEngine* engine, LayerManager* layers = nullptr, BlockManager* blocks = nullptr);
+    ~DxfWriter();
+
+    // $INSUNITS: 0 unitless, 1 inches, 2 feet, 4 mm, 5 cm, 6 m
+    void setUnits(int units) { m_units = units; }
+    int units() const { return m_units; }
+
+    // All entities when entityIds is empty
+    DxfWriteResult write(const QString& path, const std::vector<int>& entityIds = {});
+
+    // Closest AutoCAD colour index (1-255) to an RGB colour
+    static int nearestAci(const QColor& color);
+
+private:
+    GeometryEngine* m_geometryEngine;
+    LayerManager* m_layerManager;
+    BlockManager* m_blockManager;
+    int m_units;
+};
@@ -6,28 +6,62 @@
 #include <QSurfaceFormat>
 #include "CADApplication.h"
 #include "MainWindow.h"
+#include "StartupTimeline.h"
+#include "Tracing.h"
 
 Q_LOGGING_CATEGORY(cadMain, "cad.main")
 
 void setupOpenGL()
 {
-    // Configure OpenGL format for high-performance rendering
+    // Configure OpenGL format for high-performance rendering.
+    // Viewports repaint on demand (see RenderScheduler), so VSync only paces
+    // frames that were actually requested. MSAA and VSync can be overridden
+    // for remote desktop sessions where every presented frame is costly.
+    int samples = qEnvironmentVariableIsSet("CAD_GL_SAMPLES") ? qEnvironmentVariableIntValue("CAD_GL_SAMPLES") : 4;
+    int swapInterval = qEnvironmentVariableIsSet("CAD_GL_VSYNC") ? qEnvironmentVariableIntValue("CAD_GL_VSYNC") : 1;
+
     QSurfaceFormat format;
     format.setDepthBufferSize(24);
     format.setStencilBufferSize(8);
     format.setVersion(4, 5);
     format.setProfile(QSurfaceFormat::CoreProfile);
-    format.setSamples(4); // 4x MSAA
+    format.setSamples(samples); // 4x MSAA by default
     format.setSwapBehavior(QSurfaceFormat::DoubleBuffer);
-    format.setSwapInterval(1); // VSync
+    format.setSwapInterval(swapInterval); // VSync by default
     QSurfaceFormat::setDefaultFormat(format);
 }
 
 void setupLogging()
 {
-    // Enable comprehensive debugging output
-    QLoggingCategory::setFilterRules("cad.*=true");
-    qCDebug(cadMain) << "CAD Application starting with comprehensive debugging enabled";
+    // Debug output formats per entity and command; keep it off unless asked for.
+    // CAD_DEBUG=1 restores full output, QT_LOGGING_RULES still overrides either way.
+    if (qEnvironmentVariableIntValue("CAD_DEBUG") > 0) {
+        QLoggingCategory::setFilterRules("cad.*=true");
+        qCDebug(cadMain) << "CAD Application starting with comprehensive debugging enabled";
+    } else {
+        QLoggingCategory::setFilterRules("cad.*.debug=false");
+    }
+}
+
+void setupTracing()
+{
+    // CAD_TRACE=<file> records from startup and writes a Chrome trace on exit
+    const QString tracePath = qEnvironmentVariable("CAD_TRACE");
+    if (tracePath.isEmpty()) {
+        return;
+    }
+    if (!Tracing::isCompiledIn()) {
+        qCWarning(cadMain) << "CAD_TRACE ignored: build without CAD_ENABLE_TRACING";
+        return;
+    }
+
+    Tracing::start();
+    QObject::connect(qApp, &QCoreApplication::aboutToQuit, [tracePath]() {
+        Tracing::stop();
+        if (!Tracing::exportChromeTrace(tracePath)) {
+            qCWarning(cadMain) << "Cannot write trace:" << tracePath;
+        }
+    });
 }
 
 void setupApplicationProperties(QApplication& app)
@@ -76,19 +110,27 @@ void createApplicationDirectories()
 
 int main(int argc, char *argv[])
 {
+    StartupTimeline::start();
+    
     // Enable high DPI scaling
     QApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
     QApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
     
+    // All viewports share one GL share group so mesh buffers and shaders
+    // are uploaded once (see SharedRenderResources)
+    QApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+    
     // Setup OpenGL before creating QApplication
     setupOpenGL();
     
     // Create application
     CADApplication app(argc, argv);
+    StartupTimeline::mark("applicationCreated");
     
     // Setup application properties and styling
     setupApplicationProperties(app);
     setupLogging();
+    setupTracing();
     createApplicationDirectories();
     
     // Initialize OpenCASCADE and other systems
@@ -96,10 +138,13 @@ int main(int argc, char *argv[])
         qCCritical(cadMain) << "Failed to initialize CAD application";
         return -1;
     }
+    StartupTimeline::mark("initialized");
     
     // Create and show main window
     MainWindow window;
+    StartupTimeline::mark("mainWindowCreated");
     window.show();
+    StartupTimeline::mark("shown");
     
     qCDebug(cadMain) << "CAD Application started successfully";
     qCDebug(cadMain) << "OpenGL Version:" << QOpenGLContext::currentContext()->format().version();
@@ -0,0 +1,648 @@
+#include "PlotEngine.h"
+#include "GeometryEngine.h"
+#include "HiddenLineRemoval.h"
+#include "LayerManager.h"
+#include "LayoutManager.h"
+#include "Parallel.h"
+#include "Tracing.h"
+#include "VectorPlotWriter.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImage>
+#include <QPainter>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include <BRepAdaptor_Curve.hxx>
+#include <GCPnts_TangentialDeflection.hxx>
+#include <Standard_Failure.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <gp.hxx>
+#include <gp_Mat.hxx>
+
+Q_LOGGING_CATEGORY(cadPlot, "cad.plot")
+
+namespace {
+
+constexpr double MillimetresPerInch = 25.4;
+constexpr int ByBlock = 0;
+constexpr int ByLayer = 256;
+
+// Dash lengths in mm on the sheet, on/off alternating; indexed like lineTypeNames()
+const std::vector<std::vector<double>>& lineTypePatterns()
+{
+    static const std::vector<std::vector<double>> patterns = {
+        {},                                     // Continuous
+        {6.0, 3.0},                             // Dashed
+        {3.0, 1.5},                             // Hidden
+        {12.0, 3.0, 3.0, 3.0},                  // Center
+        {12.0, 3.0, 3.0, 3.0, 3.0, 3.0},        // Phantom
+        {0.2, 1.5},                             // Dot
+        {6.0, 3.0, 0.2, 3.0},                   // DashDot
+        {6.0, 3.0, 0.2, 3.0, 0.2, 3.0},         // Divide
+        {6.0, 3.0, 6.0, 3.0, 0.2, 3.0},         // Border
+    };
+    return patterns;
+}
+
+QRectF segmentBounds(const std::vector<float>& segments)
+{
+    if (segments.empty()) {
+        return QRectF();
+    }
+    float left = segments[0], right = segments[0], bottom = segments[1], top = segments[1];
+    for (size_t i = 0; i + 1 < segments.size(); i += 2) {
+        left = std::min(left, segments[i]);
+        right = std::max(right, segments[i]);
+        bottom = std::min(bottom, segments[i + 1]);
+        top = std::max(top, segments[i + 1]);
+    }
+    return QRectF(QPointF(left, bottom), QPointF(right, top));
+}
+
+// Edges of a shape as sheet segments, relative to a sheet-space origin
+void tessellate(const TopoDS_Shape& shape, double deflection, const ViewportRenderCache& projection,
+                const gp_XYZ& origin, std::vector<float>& segments)
+{
+    for (TopExp_Explorer exp(shape, TopAbs_EDGE); exp.More(); exp.Next()) {
+        try {
+            BRepAdaptor_Curve curve(TopoDS::Edge(exp.Current()));
+            GCPnts_TangentialDeflection points(curve, 0.1, deflection);
+            for (int p = 1; p < points.NbPoints(); ++p) {
+                const gp_XYZ a = projection.toPaper(points.Value(p)).XYZ() - origin;
+                const gp_XYZ b = projection.toPaper(points.Value(p + 1)).XYZ() - origin;
+                segments.insert(segments.end(), {static_cast<float>(a.X()), static_cast<float>(a.Y()),
+                                                 static_cast<float>(b.X()), static_cast<float>(b.Y())});
+            }
+        } catch (const Standard_Failure&) {
+            // Degenerate edge, nothing to plot
+        }
+    }
+}
+
+// Closed-interval overlap; projected lines have zero width or height
+inline bool overlaps(const QRectF& a, const QRectF& b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+} // namespace
+
+QSizeF PlotSettings::isoPaperSize(const QString& name)
+{
+    static const QSizeF sizes[] = {
+        QSizeF(1189.0, 841.0), QSizeF(841.0, 594.0), QSizeF(594.0, 420.0), QSizeF(420.0, 297.0), QSizeF(297.0, 210.0)
+    };
+    const QString upper = name.trimmed().toUpper();
+    if (upper.size() == 2 && upper[0] == QLatin1Char('A') && upper[1] >= QLatin1Char('0') && upper[1] <= QLatin1Char('4')) {
+        return sizes[upper[1].digitValue()];
+    }
+    return QSizeF();
+}
+
+size_t PlotSheet::segmentCount() const
+{
+    size_t count = 0;
+    for (const PlotBatch& batch : batches) {
+        count += batch.segments.size() / 4;
+    }
+    for (const PlotSymbol& symbol : symbols) {
+        count += symbol.segments.size() / 4;
+    }
+    return count;
+}
+
+PlotEngine::PlotEngine(GeometryEngine* engine, LayerManager* layers, LayoutManager* layouts)
+    : m_geometryEngine(engine)
+    , m_layerManager(layers)
+    , m_layoutManager(layouts)
+    , m_pixelSize(MillimetresPerInch / 600.0)
+    , m_exactHiddenLines(false)
+    , m_instanceBlocks(false)
+{
+}
+
+PlotEngine::~PlotEngine() = default;
+
+// Pens and line types
+const QStringList& PlotEngine::lineTypeNames()
+{
+    static const QStringList names = {
+        "Continuous", "Dashed", "Hidden", "Center", "Phantom", "Dot", "DashDot", "Divide", "Border"
+    };
+    return names;
+}
+
+int PlotEngine::lineTypeIndex(const QString& name)
+{
+    const int index = lineTypeNames().indexOf(name, 0, Qt::CaseInsensitive);
+    return index >= 0 ? index : 0;
+}
+
+const std::vector<double>& PlotEngine::dashLengths(int lineType)
+{
+    const auto& patterns = lineTypePatterns();
+    return lineType > 0 && lineType < static_cast<int>(patterns.size()) ? patterns[lineType] : patterns[0];
+}
+
+QVector<qreal> PlotEngine::dashPattern(int lineType, double penWidth)
+{
+    // QPen measures dashes in pen widths
+    QVector<qreal> pattern;
+    const double width = std::max(penWidth, 0.01);
+    for (double length : dashLengths(lineType)) {
+        pattern.append(length / width);
+    }
+    return pattern;
+}
+
+QRgb PlotEngine::aciColor(int color)
+{
+    // Standard colours; 7 (white on screen) plots black
+    static const QRgb standard[] = {
+        qRgb(0, 0, 0), qRgb(255, 0, 0), qRgb(255, 255, 0), qRgb(0, 255, 0), qRgb(0, 255, 255),
+        qRgb(0, 0, 255), qRgb(255, 0, 255), qRgb(0, 0, 0), qRgb(128, 128, 128), qRgb(192, 192, 192)
+    };
+    if (color >= 0 && color <= 9) {
+        return standard[color];
+    }
+    if (color >= 250 && color <= 255) {
+        const int level = 51 + (color - 250) * 40;
+        return qRgb(level, level, level);
+    }
+    return qRgb(0, 0, 0);
+}
+
+const LayerProperties& PlotEngine::layerProperties(const QString& layer) const
+{
+    auto it = m_layerCache.find(layer);
+    if (it == m_layerCache.end()) {
+        it = m_layerCache.insert(layer, m_layerManager ? m_layerManager->getLayerProperties(layer) : LayerProperties(layer));
+    }
+    return it.value();
+}
+
+PlotPen PlotEngine::resolvePen(const CADEntity& entity) const
+{
+    const LayerProperties& layer = layerProperties(entity.layer);
+
+    PlotPen pen;
+    if (entity.color == ByLayer || entity.color == ByBlock) {
+        const QRgb rgb = layer.color.rgb();
+        pen.color = (rgb & 0xffffff) == 0xffffff ? qRgb(0, 0, 0) : rgb;
+    } else {
+        pen.color = aciColor(entity.color);
+    }
+    pen.width = entity.lineWeight > 0.0 ? entity.lineWeight : layer.lineWeight;
+    pen.lineType = entity.lineType > 0 ? entity.lineType : lineTypeIndex(layer.lineType);
+    return pen;
+}
+
+bool PlotEngine::isPlottable(const CADEntity& entity) const
+{
+    if (!entity.visible || entity.shape.IsNull()) {
+        return false;
+    }
+    const LayerProperties& layer = layerProperties(entity.layer);
+    return layer.visible && !layer.frozen && layer.plottable;
+}
+
+// Collection
+PlotSheet PlotEngine::collect(const PlotSettings& settings, QString* error)
+{
+    CAD_TRACE_SCOPE("plot", "collect");
+
+    PlotSheet sheet;
+    m_layerCache.clear();
+    m_pixelSize = MillimetresPerInch / std::max(settings.dpi, 1.0);
+    m_exactHiddenLines = settings.exactHiddenLines;
+    m_instanceBlocks = settings.instanceBlocks;
+    if (!m_geometryEngine) {
+        if (error) {
+            *error = QStringLiteral("No drawing to plot");
+        }
+        return sheet;
+    }
+
+    if (settings.layout.isEmpty()) {
+        const LayoutViewport viewport = extentsViewport(settings, sheet.paperSize);
+        collectViewport(viewport, sheet);
+        return sheet;
+    }
+
+    if (!m_layoutManager || !m_layoutManager->hasLayout(settings.layout)) {
+        if (error) {
+            *error = QString("No layout named %1").arg(settings.layout);
+        }
+        return sheet;
+    }
+    sheet.paperSize = m_layoutManager->getPaperSize(settings.layout);
+    for (const LayoutViewport& viewport : m_layoutManager->getViewports(settings.layout)) {
+        collectViewport(viewport, sheet);
+    }
+    return sheet;
+}
+
+LayoutViewport PlotEngine::extentsViewport(const PlotSettings& settings, QSizeF& paperSize) const
+{
+    paperSize = settings.paperSize;
+
+    Bnd_Box extents;
+    for (int entityId : m_geometryEngine->getAllEntityIds()) {
+        const CADEntity* entity = m_geometryEngine->findEntity(entityId);
+        if (entity && isPlottable(*entity)) {
+            extents.Add(ViewportRenderCache::entityBounds(m_geometryEngine, entityId));
+        }
+    }
+
+    // Plan view of the extents, fitted inside the margins
+    LayoutViewport viewport;
+    viewport.paperRect = QRectF(0.0, 0.0, paperSize.width(), paperSize.height());
+    if (extents.IsVoid()) {
+        return viewport;
+    }
+    double xmin, ymin, zmin, xmax, ymax, zmax;
+    extents.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+    const double usableWidth = std::max(paperSize.width() - 2.0 * settings.margin, 1.0);
+    const double usableHeight = std::max(paperSize.height() - 2.0 * settings.margin, 1.0);
+    const double modelWidth = std::max(xmax - xmin, 1.0e-9);
+    const double modelHeight = std::max(ymax - ymin, 1.0e-9);
+    viewport.target = gp_Pnt((xmin + xmax) / 2.0, (ymin + ymax) / 2.0, (zmin + zmax) / 2.0);
+    viewport.scale = std::min(usableWidth / modelWidth, usableHeight / modelHeight);
+    return viewport;
+}
+
+void PlotEngine::collectViewport(const LayoutViewport& viewport, PlotSheet& sheet)
+{
+    ViewportRenderCache projection(m_geometryEngine, nullptr);
+    projection.setViewport(viewport);
+
+    const bool instancing = m_instanceBlocks && viewport.style != LayoutViewport::Hidden;
+    std::vector<int> entityIds;
+    std::vector<int> insertIds;
+    for (int entityId : m_geometryEngine->getAllEntityIds()) {
+        const CADEntity* entity = m_geometryEngine->findEntity(entityId);
+        if (!entity || !isPlottable(*entity) || viewport.frozenLayers.contains(entity->layer)) {
+            continue;
+        }
+        const QRectF rect = projection.project(ViewportRenderCache::entityBounds(m_geometryEngine, entityId));
+        if (!overlaps(rect, viewport.paperRect)) {
+            continue;
+        }
+        // Symbols are not clipped, so only inserts wholly inside the viewport are instanced
+        if (instancing && entity->type == CADEntity::Block && viewport.paperRect.contains(rect)) {
+            insertIds.push_back(entityId);
+        } else {
+            entityIds.push_back(entityId);
+        }
+    }
+
+    if (viewport.style == LayoutViewport::Hidden) {
+        collectHiddenViewport(viewport, entityIds, sheet);
+        return;
+    }
+
+    // Half a device pixel on the sheet
+    const double deflection = 0.5 * m_pixelSize / std::max(viewport.scale, 1.0e-12);
+    const size_t firstInstance = sheet.instances.size();
+    collectInstances(projection, deflection, insertIds, entityIds, sheet);
+
+    const size_t first = sheet.batches.size();
+    sheet.batches.resize(first + entityIds.size());
+    for (size_t i = 0; i < entityIds.size(); ++i) {
+        const CADEntity* entity = m_geometryEngine->findEntity(entityIds[i]);
+        PlotBatch& batch = sheet.batches[first + i];
+        batch.entityId = entityIds[i];
+        batch.layer = entity->layer;
+        batch.pen = resolvePen(*entity);
+    }
+
+    // Shapes are only read while tessellating
+    Parallel::forEach(static_cast<int>(entityIds.size()), [&](int i) {
+        PlotBatch& batch = sheet.batches[first + i];
+        std::vector<float> projected;
+        tessellate(m_geometryEngine->findEntity(batch.entityId)->shape, deflection, projection, gp_XYZ(), projected);
+        projection.clipSegments(projected, batch.segments);
+        batch.bounds = segmentBounds(batch.segments);
+    });
+
+    qCDebug(cadPlot) << "Viewport" << viewport.id << "collected" << entityIds.size() << "entities and"
+                     << sheet.instances.size() - firstInstance << "block instances";
+}
+
+void PlotEngine::collectInstances(const ViewportRenderCache& projection, double deflection,
+                                  const std::vector<int>& insertIds, std::vector<int>& flattened, PlotSheet& sheet)
+{
+    if (insertIds.empty()) {
+        return;
+    }
+
+    // The projection as a linear map: columns are the sheet images of the model axes
+    const gp_XYZ origin = projection.toPaper(gp::Origin()).XYZ();
+    gp_Mat toSheet;
+    for (int column = 1; column <= 3; ++column) {
+        const gp_Pnt axis(column == 1 ? 1.0 : 0.0, column == 2 ? 1.0 : 0.0, column == 3 ? 1.0 : 0.0);
+        toSheet.SetCol(column, projection.toPaper(axis).XYZ() - origin);
+    }
+    if (std::abs(toSheet.Determinant()) < gp::Resolution()) {
+        flattened.insert(flattened.end(), insertIds.begin(), insertIds.end());
+        return;
+    }
+    const gp_Mat fromSheet = toSheet.Inverted();
+
+    // One symbol per definition in this viewport, keyed like the engine's block prototypes
+    QHash<const void*, int> symbolIndex;
+    std::vector<TopoDS_Shape> definitions;
+    const size_t firstSymbol = sheet.symbols.size();
+    const size_t firstInstance = sheet.instances.size();
+    for (int entityId : insertIds) {
+        const CADEntity* entity = m_geometryEngine->findEntity(entityId);
+        const gp_Trsf transform = entity->shape.Location().Transformation();
+
+        // The insert in sheet axes; it is a 2D placement only if sheet x and y do not depend on depth
+        const gp_Mat placement = toSheet * transform.VectorialPart() * fromSheet;
+        const double tolerance = 1.0e-9 * std::max({std::abs(placement(1, 1)), std::abs(placement(1, 2)),
+                                                    std::abs(placement(2, 1)), std::abs(placement(2, 2)), 1.0});
+        if (std::abs(placement(1, 3)) > tolerance || std::abs(placement(2, 3)) > tolerance) {
+            flattened.push_back(entityId);
+            continue;
+        }
+
+        const TopoDS_Shape definition = entity->shape.Located(TopLoc_Location());
+        auto found = symbolIndex.constFind(definition.TShape().get());
+        if (found == symbolIndex.constEnd()) {
+            found = symbolIndex.insert(definition.TShape().get(), static_cast<int>(firstSymbol + definitions.size()));
+            definitions.push_back(definition);
+        }
+
+        const gp_Pnt position = projection.toPaper(gp_Pnt(transform.TranslationPart()));
+        PlotInstance instance;
+        instance.entityId = entityId;
+        instance.symbol = found.value();
+        instance.layer = entity->layer;
+        instance.pen = resolvePen(*entity);
+        instance.transform = QTransform(placement(1, 1), placement(2, 1), placement(1, 2), placement(2, 2),
+                                        position.X(), position.Y());
+        sheet.instances.push_back(std::move(instance));
+    }
+
+    sheet.symbols.resize(firstSymbol + definitions.size());
+    Parallel::forEach(static_cast<int>(definitions.size()), [&](int i) {
+        PlotSymbol& symbol = sheet.symbols[firstSymbol + i];
+        tessellate(definitions[i], deflection, projection, origin, symbol.segments);
+        symbol.bounds = segmentBounds(symbol.segments);
+    });
+    for (size_t i = firstInstance; i < sheet.instances.size(); ++i) {
+        PlotInstance& instance = sheet.instances[i];
+        instance.bounds = instance.transform.mapRect(sheet.symbols[instance.symbol].bounds);
+    }
+}
+
+void PlotEngine::collectHiddenViewport(const LayoutViewport& viewport, const std::vector<int>& entityIds,
+                                       PlotSheet& sheet)
+{
+    if (entityIds.empty()) {
+        return;
+    }
+
+    ViewportRenderCache projection(m_geometryEngine, nullptr);
+    projection.setViewport(viewport);
+
+    HiddenLineRemoval hiddenLines(m_geometryEngine);
+    hiddenLines.setExact(m_exactHiddenLines);
+    hiddenLines.setDeflection(0.5 * m_pixelSize / std::max(viewport.scale, 1.0e-12));
+
+    HLRView view;
+    view.viewDirection = viewport.viewDirection;
+    view.upDirection = viewport.upDirection;
+    const HLRResult result = hiddenLines.compute(view, entityIds);
+
+    // A cluster is drawn with the pen of its first entity
+    for (const auto& cluster : result.clusters) {
+        if (cluster->entityIds.empty() || cluster->visibleSegments.empty()) {
+            continue;
+        }
+        const CADEntity* entity = m_geometryEngine->findEntity(cluster->entityIds.front());
+        if (!entity) {
+            continue;
+        }
+
+        std::vector<float> projected;
+        projected.reserve(cluster->visibleSegments.size());
+        for (size_t i = 0; i + 1 < cluster->visibleSegments.size(); i += 2) {
+            const QPointF p = projection.viewPlaneToPaper(cluster->visibleSegments[i], cluster->visibleSegments[i + 1]);
+            projected.push_back(static_cast<float>(p.x()));
+            projected.push_back(static_cast<float>(p.y()));
+        }
+
+        PlotBatch batch;
+        batch.entityId = cluster->entityIds.front();
+        batch.layer = entity->layer;
+        batch.pen = resolvePen(*entity);
+        projection.clipSegments(projected, batch.segments);
+        batch.bounds = segmentBounds(batch.segments);
+        sheet.batches.push_back(std::move(batch));
+    }
+}
+
+// Raster output
+PlotResult PlotEngine::plotRaster(const QString& path, const PlotSettings& settings)
+{
+    CAD_TRACE_SCOPE("plot", "plotRaster");
+
+    PlotResult result;
+    PlotImageWriter::Format format;
+    if (!PlotImageWriter::formatFromSuffix(QFileInfo(path).suffix(), format)) {
+        result.error = QString("Unsupported plot format: %1").arg(QFileInfo(path).suffix());
+        return result;
+    }
+    if (settings.dpi <= 0.0 || settings.tileSize <= 0) {
+        result.error = QStringLiteral("Invalid plot resolution");
+        return result;
+    }
+
+    // Tiles paint flattened line work only
+    PlotSettings flattened = settings;
+    flattened.instanceBlocks = false;
+
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    const PlotSheet sheet = collect(flattened, &error);
+    if (!error.isEmpty()) {
+        result.error = error;
+        return result;
+    }
+    result.collectTimeMs = timer.restart();
+    result.entities = static_cast<int>(sheet.batches.size());
+    result.segments = sheet.segmentCount();
+
+    const double pixelsPerMm = settings.dpi / MillimetresPerInch;
+    const double paperHeight = sheet.paperSize.height();
+    result.width = static_cast<int>(std::ceil(sheet.paperSize.width() * pixelsPerMm));
+    result.height = static_cast<int>(std::ceil(paperHeight * pixelsPerMm));
+
+    PlotImageWriter writer;
+    if (!writer.open(path, format, result.width, result.height, settings.dpi)) {
+        result.error = writer.errorString();
+        return result;
+    }
+
+    // Bin batches into rows of tiles by their pixel extent, pen included
+    const int tileSize = settings.tileSize;
+    const int columns = (result.width + tileSize - 1) / tileSize;
+    const int rows = (result.height + tileSize - 1) / tileSize;
+    std::vector<std::vector<int>> rowBatches(rows);
+    std::vector<QRectF> pixelBounds(sheet.batches.size());
+    for (size_t i = 0; i < sheet.batches.size(); ++i) {
+        const PlotBatch& batch = sheet.batches[i];
+        if (batch.segments.empty()) {
+            continue;
+        }
+        const double pad = batch.pen.width * pixelsPerMm / 2.0 + 1.0;
+        pixelBounds[i] = QRectF(QPointF(batch.bounds.left() * pixelsPerMm - pad, (paperHeight - batch.bounds.bottom()) * pixelsPerMm - pad),
+                                QPointF(batch.bounds.right() * pixelsPerMm + pad, (paperHeight - batch.bounds.top()) * pixelsPerMm + pad));
+        const int firstRow = std::max(0, static_cast<int>(std::floor(pixelBounds[i].top() / tileSize)));
+        const int lastRow = std::min(rows - 1, static_cast<int>(std::floor(pixelBounds[i].bottom() / tileSize)));
+        for (int row = firstRow; row <= lastRow; ++row) {
+            rowBatches[row].push_back(static_cast<int>(i));
+        }
+    }
+
+    // Double-buffered rows: one renders while the previous one is compressed
+    const size_t stride = static_cast<size_t>(result.width) * 3;
+    std::vector<uchar> bands[2];
+    QThreadPool writerPool;
+    writerPool.setMaxThreadCount(1);
+    std::atomic<bool> writeOk(true);
+
+    for (int row = 0; row < rows && writeOk; ++row) {
+        CAD_TRACE_SCOPE("plot", "tileRow");
+        const int top = row * tileSize;
+        const int height = std::min(tileSize, result.height - top);
+        std::vector<uchar>& band = bands[row & 1];
+        band.resize(stride * height);
+
+        Parallel::forEach(columns, [&](int column) {
+            const int left = column * tileSize;
+            const int width = std::min(tileSize, result.width - left);
+            const QRectF tileRect(left, top, width, height);
+
+            QImage tile(width, height, QImage::Format_RGB32);
+            tile.fill(Qt::white);
+            {
+                QPainter painter(&tile);
+                painter.setRenderHint(QPainter::Antialiasing, settings.antialiasing);
+                painter.translate(-left, -top);
+
+                QVector<QLineF> lines;
+                for (int index : rowBatches[row]) {
+                    if (!overlaps(pixelBounds[index], tileRect)) {
+                        continue;
+                    }
+                    const PlotBatch& batch = sheet.batches[index];
+                    lines.clear();
+                    lines.reserve(static_cast<int>(batch.segments.size() / 4));
+                    const std::vector<float>& s = batch.segments;
+                    for (size_t i = 0; i + 3 < s.size(); i += 4) {
+                        lines.append(QLineF(s[i] * pixelsPerMm, (paperHeight - s[i + 1]) * pixelsPerMm,
+                                            s[i + 2] * pixelsPerMm, (paperHeight - s[i + 3]) * pixelsPerMm));
+                    }
+
+                    QPen pen(QColor::fromRgb(batch.pen.color), std::max(batch.pen.width * pixelsPerMm, 1.0));
+                    const QVector<qreal> dashes = dashPattern(batch.pen.lineType, batch.pen.width);
+                    if (dashes.isEmpty()) {
+                        pen.setCapStyle(Qt::RoundCap);
+                    } else {
+                        pen.setCapStyle(Qt::FlatCap);
+                        pen.setDashPattern(dashes);
+                    }
+                    painter.setPen(pen);
+                    painter.drawLines(lines);
+                }
+            }
+
+            for (int y = 0; y < height; ++y) {
+                const QRgb* source = reinterpret_cast<const QRgb*>(tile.constScanLine(y));
+                uchar* target = band.data() + y * stride + static_cast<size_t>(left) * 3;
+                for (int x = 0; x < width; ++x) {
+                    target[x * 3] = static_cast<uchar>(qRed(source[x]));
+                    target[x * 3 + 1] = static_cast<uchar>(qGreen(source[x]));
+                    target[x * 3 + 2] = static_cast<uchar>(qBlue(source[x]));
+                }
+            }
+        });
+
+        writerPool.waitForDone();
+        writerPool.start([&writer, &writeOk, &band, height]() {
+            if (!writer.writeRows(band.data(), height)) {
+                writeOk = false;
+            }
+        });
+    }
+    writerPool.waitForDone();
+
+    result.tiles = columns * rows;
+    result.success = writer.close();
+    result.bytes = writer.bytesWritten();
+    result.renderTimeMs = timer.elapsed();
+    if (!result.success) {
+        result.error = writer.errorString();
+    }
+
+    qCDebug(cadPlot) << "Plotted" << result.entities << "entities," << result.segments << "segments to" << path
+                     << result.width << "x" << result.height << "in" << result.collectTimeMs << "+"
+                     << result.renderTimeMs << "ms";
+    return result;
+}
+
+// Vector output
+PlotResult PlotEngine::plotVector(const QString& path, const PlotSettings& settings)
+{
+    CAD_TRACE_SCOPE("plot", "plotVector");
+
+    PlotResult result;
+    VectorPlotWriter::Format format;
+    if (!VectorPlotWriter::formatFromSuffix(QFileInfo(path).suffix(), format)) {
+        result.error = QString("Unsupported plot format: %1").arg(QFileInfo(path).suffix());
+        return result;
+    }
+
+    if (settings.dpi <= 0.0) {
+        result.error = QStringLiteral("Invalid plot resolution");
+        return result;
+    }
+
+    PlotSettings instanced = settings;
+    instanced.instanceBlocks = true;
+
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    const PlotSheet sheet = collect(instanced, &error);
+    if (!error.isEmpty()) {
+        result.error = error;
+        return result;
+    }
+    result.collectTimeMs = timer.restart();
+    result.entities = static_cast<int>(sheet.batches.size() + sheet.instances.size());
+    result.segments = sheet.segmentCount();
+
+    VectorPlotWriter writer;
+    result.success = writer.write(path, format, sheet);
+    result.bytes = writer.bytesWritten();
+    result.renderTimeMs = timer.elapsed();
+    if (!result.success) {
+        result.error = writer.errorString();
+    }
+
+    const VectorPlotStats& stats = writer.stats();
+    qCDebug(cadPlot) << "Plotted" << result.entities << "entities on" << stats.layers << "layers to" << path << ":"
+                     << stats.segmentsIn << "segments as" << stats.verticesOut << "vertices," << stats.symbols
+                     << "symbols for" << stats.instances << "inserts in" << result.collectTimeMs << "+"
+                     << result.renderTimeMs << "ms";
+    return result;
+}
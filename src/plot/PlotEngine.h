@@ -0,0 +1,198 @@
+#pragma once
+
+#include <QHash>
+#include <QLoggingCategory>
+#include <QRectF>
+#include <QRgb>
+#include <QSizeF>
+#include <QString>
+#include <QStringList>
+#include <QTransform>
+#include <QVector>
+#include <vector>
+
+#include "LayerManager.h"
+#include "PlotImageWriter.h"
+
+class GeometryEngine;
+class LayoutManager;
+class ViewportRenderCache;
+struct CADEntity;
+struct LayoutViewport;
+
+Q_DECLARE_LOGGING_CATEGORY(cadPlot)
+
+/**
+ * @brief What to plot and at which resolution
+ */
+struct PlotSettings
+{
+    QString layout;             // Empty: model extents fitted to paperSize
+    QSizeF paperSize;           // mm; a layout's own size is used when plotting a layout
+    double margin;              // mm around model extents
+    double dpi;
+    int tileSize;               // Pixels; one row of tiles is rendered at a time
+    bool antialiasing;
+    bool exactHiddenLines;      // Exact HLR for Hidden viewports instead of the polygonal one
+    bool instanceBlocks;        // Keep block inserts as placements of shared symbols (vector output)
+
+    PlotSettings()
+        : paperSize(1189.0, 841.0), margin(10.0), dpi(600.0), tileSize(512), antialiasing(true),
+          exactHiddenLines(false), instanceBlocks(false) {}
+
+    static QSizeF isoPaperSize(const QString& name);   // "A0" .. "A4", landscape; invalid if unknown
+};
+
+/**
+ * @brief Resolved plot pen of one entity
+ */
+struct PlotPen
+{
+    QRgb color;
+    double width;               // mm on the sheet
+    int lineType;               // Index into PlotEngine::lineTypeNames()
+
+    PlotPen() : color(qRgb(0, 0, 0)), width(0.25), lineType(0) {}
+
+    bool operator==(const PlotPen& other) const
+    {
+        return color == other.color && width == other.width && lineType == other.lineType;
+    }
+    bool operator!=(const PlotPen& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Paper-space line work of one entity (or one hidden-line cluster)
+ */
+struct PlotBatch
+{
+    int entityId;
+    QString layer;
+    PlotPen pen;
+    QRectF bounds;              // Of the segments, in mm
+    std::vector<float> segments;    // x0, y0, x1, y1 in mm, y up from the bottom of the sheet
+
+    PlotBatch() : entityId(-1) {}
+};
+
+/**
+ * @brief Line work of one block definition as seen in one viewport
+ *
+ * Segments are in sheet millimetres relative to the insertion point of an
+ * untransformed insert.
+ */
+struct PlotSymbol
+{
+    QRectF bounds;
+    std::vector<float> segments;
+};
+
+/**
+ * @brief Block insert plotted as a placement of a shared symbol
+ */
+struct PlotInstance
+{
+    int entityId;
+    int symbol;                 // Index into PlotSheet::symbols
+    QString layer;
+    PlotPen pen;
+    QTransform transform;       // Symbol space -> sheet
+    QRectF bounds;              // On the sheet, in mm
+
+    PlotInstance() : entityId(-1), symbol(-1) {}
+};
+
+/**
+ * @brief Everything that goes on one sheet
+ */
+struct PlotSheet
+{
+    QSizeF paperSize;
+    std::vector<PlotBatch> batches;
+    std::vector<PlotSymbol> symbols;
+    std::vector<PlotInstance> instances;
+
+    size_t segmentCount() const;    // Each symbol counted once
+};
+
+/**
+ * @brief Timings and counters of one plot
+ */
+struct PlotResult
+{
+    bool success;
+    QString error;
+    int width;                  // Raster only
+    int height;
+    int tiles;
+    int entities;
+    size_t segments;
+    qint64 bytes;
+    qint64 collectTimeMs;
+    qint64 renderTimeMs;
+
+    PlotResult()
+        : success(false), width(0), height(0), tiles(0), entities(0), segments(0), bytes(0),
+          collectTimeMs(0), renderTimeMs(0) {}
+};
+
+/**
+ * @brief CPU plot pipeline for layouts and model extents
+ *
+ * Collection projects every plottable entity into sheet millimetres:
+ * visible entities on layers that are on, thawed and plottable (and not
+ * frozen in the viewport) are tessellated in parallel at half a device
+ * pixel. Hidden viewports go through HiddenLineRemoval; shaded viewports
+ * are plotted as their edges.
+ *
+ * Raster output needs no GPU or GUI: the sheet is cut into square tiles,
+ * each row of tiles is painted in parallel with QPainter into tile images
+ * and handed to a PlotImageWriter while the next row renders. At most two
+ * rows of tiles are in memory, never the whole sheet.
+ *
+ * Vector output (PDF or SVG, see VectorPlotWriter) collects with
+ * instanceBlocks set: a block insert whose transform keeps the view plane
+ * (moves, rotations about the view direction, uniform or in-plane scales)
+ * and which lies wholly inside its viewport becomes a PlotInstance of a
+ * symbol tessellated once per definition and viewport. Other inserts are
+ * flattened like any entity.
+ */
+class PlotEngine
+{
+public:
+    PlotEngine(GeometryEngine* engine, LayerManager* layers = nullptr, LayoutManager* layouts = nullptr);
+    ~PlotEngine();
+
+    PlotSheet collect(const PlotSettings& settings, QString* error = nullptr);
+
+    // Format from the file suffix: png, tif or tiff
+    PlotResult plotRaster(const QString& path, const PlotSettings& settings);
+
+    // Format from the file suffix: pdf or svg
+    PlotResult plotVector(const QString& path, const PlotSettings& settings);
+
+    PlotPen resolvePen(const CADEntity& entity) const;
+    bool isPlottable(const CADEntity& entity) const;
+
+    static const QStringList& lineTypeNames();
+    static int lineTypeIndex(const QString& name);
+    static const std::vector<double>& dashLengths(int lineType);        // mm on the sheet; empty for continuous
+    static QVector<qreal> dashPattern(int lineType, double penWidth);    // In pen widths, for QPen
+    static QRgb aciColor(int color);
+
+private:
+    void collectViewport(const LayoutViewport& viewport, PlotSheet& sheet);
+    void collectHiddenViewport(const LayoutViewport& viewport, const std::vector<int>& entityIds, PlotSheet& sheet);
+    void collectInstances(const ViewportRenderCache& projection, double deflection, const std::vector<int>& insertIds,
+                          std::vector<int>& flattened, PlotSheet& sheet);
+    LayoutViewport extentsViewport(const PlotSettings& settings, QSizeF& paperSize) const;
+    const LayerProperties& layerProperties(const QString& layer) const;
+
+    GeometryEngine* m_geometryEngine;
+    LayerManager* m_layerManager;
+    LayoutManager* m_layoutManager;
+    double m_pixelSize;         // mm per device pixel of the plot being collected
+    bool m_exactHiddenLines;
+    bool m_instanceBlocks;
+    mutable QHash<QString, LayerProperties> m_layerCache;   // Per collection
+};
@@ -0,0 +1,366 @@
+#include "PlotImageWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <zlib.h>
+
+namespace {
+
+// Plots are mostly paper white; the fastest level already compresses them well
+constexpr int CompressionLevel = Z_BEST_SPEED;
+constexpr size_t IdatChunkSize = 1 << 20;
+constexpr int TiffRowsPerStrip = 64;
+
+void putBig32(std::vector<uchar>& out, quint32 value)
+{
+    out.insert(out.end(), {static_cast<uchar>(value >> 24), static_cast<uchar>(value >> 16),
+                           static_cast<uchar>(value >> 8), static_cast<uchar>(value)});
+}
+
+void putLittle16(std::vector<uchar>& out, quint16 value)
+{
+    out.insert(out.end(), {static_cast<uchar>(value), static_cast<uchar>(value >> 8)});
+}
+
+void putLittle32(std::vector<uchar>& out, quint32 value)
+{
+    out.insert(out.end(), {static_cast<uchar>(value), static_cast<uchar>(value >> 8),
+                           static_cast<uchar>(value >> 16), static_cast<uchar>(value >> 24)});
+}
+
+// TIFF field types
+enum : quint16 { TiffShort = 3, TiffLong = 4, TiffRational = 5 };
+
+void putTiffEntry(std::vector<uchar>& out, quint16 tag, quint16 type, quint32 count, quint32 value)
+{
+    putLittle16(out, tag);
+    putLittle16(out, type);
+    putLittle32(out, count);
+    putLittle32(out, value);    // Little-endian, so a SHORT is already left-justified
+}
+
+} // namespace
+
+struct PlotImageWriter::Deflater
+{
+    z_stream stream;
+    bool initialized;
+
+    Deflater() : initialized(false) { std::memset(&stream, 0, sizeof(stream)); }
+    ~Deflater()
+    {
+        if (initialized) {
+            deflateEnd(&stream);
+        }
+    }
+};
+
+PlotImageWriter::PlotImageWriter()
+    : m_format(Png)
+    , m_width(0)
+    , m_height(0)
+    , m_dpi(0.0)
+    , m_rowsWritten(0)
+    , m_bytesWritten(0)
+    , m_rowsPerStrip(TiffRowsPerStrip)
+{
+}
+
+PlotImageWriter::~PlotImageWriter() = default;
+
+bool PlotImageWriter::formatFromSuffix(const QString& suffix, Format& format)
+{
+    const QString lower = suffix.toLower();
+    if (lower == QLatin1String("png")) {
+        format = Png;
+        return true;
+    }
+    if (lower == QLatin1String("tif") || lower == QLatin1String("tiff")) {
+        format = Tiff;
+        return true;
+    }
+    return false;
+}
+
+bool PlotImageWriter::open(const QString& path, Format format, int width, int height, double dpi)
+{
+    if (width <= 0 || height <= 0) {
+        return fail(QString("Invalid raster size %1 x %2").arg(width).arg(height));
+    }
+
+    m_format = format;
+    m_width = width;
+    m_height = height;
+    m_dpi = dpi;
+    m_rowsWritten = 0;
+    m_bytesWritten = 0;
+    m_error.clear();
+    m_pending.clear();
+    m_compressed.clear();
+    m_stripOffsets.clear();
+    m_stripSizes.clear();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return fail(QString("Cannot write %1: %2").arg(path, m_file.errorString()));
+    }
+
+    m_deflater = std::make_unique<Deflater>();
+    if (deflateInit(&m_deflater->stream, CompressionLevel) != Z_OK) {
+        return fail(QStringLiteral("Cannot initialize zlib"));
+    }
+    m_deflater->initialized = true;
+
+    if (m_format == Png) {
+        return writePngHeader();
+    }
+
+    // Header now, directory offset patched in close()
+    std::vector<uchar> header = {'I', 'I', 42, 0};
+    putLittle32(header, 0);
+    return writeRaw(header.data(), static_cast<qint64>(header.size()));
+}
+
+bool PlotImageWriter::writeRows(const uchar* rgb, int rows)
+{
+    if (!m_file.isOpen() || !m_error.isEmpty()) {
+        return false;
+    }
+    rows = std::min(rows, m_height - m_rowsWritten);
+    const size_t stride = static_cast<size_t>(m_width) * 3;
+
+    if (m_format == Png) {
+        // Filter type 0 (None) per row
+        m_pending.clear();
+        m_pending.reserve((stride + 1) * rows);
+        for (int row = 0; row < rows; ++row) {
+            m_pending.push_back(0);
+            m_pending.insert(m_pending.end(), rgb + row * stride, rgb + (row + 1) * stride);
+        }
+        m_rowsWritten += rows;
+        if (!deflateInto(m_pending.data(), m_pending.size(), false, m_compressed)) {
+            return false;
+        }
+        return flushPngData(false);
+    }
+
+    for (int row = 0; row < rows; ++row) {
+        m_pending.insert(m_pending.end(), rgb + row * stride, rgb + (row + 1) * stride);
+        ++m_rowsWritten;
+        if (m_pending.size() == stride * m_rowsPerStrip && !flushTiffStrip()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PlotImageWriter::close()
+{
+    if (!m_file.isOpen()) {
+        return false;
+    }
+
+    bool ok = m_error.isEmpty();
+    if (ok && m_rowsWritten != m_height) {
+        ok = fail(QString("Only %1 of %2 rows written").arg(m_rowsWritten).arg(m_height));
+    }
+
+    if (ok && m_format == Png) {
+        ok = deflateInto(nullptr, 0, true, m_compressed) && flushPngData(true)
+             && writePngChunk("IEND", nullptr, 0);
+    } else if (ok) {
+        ok = (m_pending.empty() || flushTiffStrip()) && writeTiffDirectory();
+    }
+
+    if (ok && !m_file.flush()) {
+        ok = fail(m_file.errorString());
+    }
+    m_file.close();
+    m_deflater.reset();
+    m_pending = std::vector<uchar>();
+    m_compressed = std::vector<uchar>();
+    if (!ok) {
+        m_file.remove();
+    }
+    return ok;
+}
+
+bool PlotImageWriter::writePngHeader()
+{
+    static const uchar signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    if (!writeRaw(signature, sizeof(signature))) {
+        return false;
+    }
+
+    std::vector<uchar> ihdr;
+    putBig32(ihdr, static_cast<quint32>(m_width));
+    putBig32(ihdr, static_cast<quint32>(m_height));
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0});       // 8-bit RGB, deflate, no filter set, no interlace
+    if (!writePngChunk("IHDR", ihdr.data(), static_cast<int>(ihdr.size()))) {
+        return false;
+    }
+
+    std::vector<uchar> phys;
+    const quint32 pixelsPerMetre = static_cast<quint32>(m_dpi / 0.0254 + 0.5);
+    putBig32(phys, pixelsPerMetre);
+    putBig32(phys, pixelsPerMetre);
+    phys.push_back(1);
+    return writePngChunk("pHYs", phys.data(), static_cast<int>(phys.size()));
+}
+
+bool PlotImageWriter::writePngChunk(const char* type, const uchar* data, int size)
+{
+    std::vector<uchar> head;
+    putBig32(head, static_cast<quint32>(size));
+    head.insert(head.end(), type, type + 4);
+
+    uLong crc = crc32(0L, head.data() + 4, 4);
+    if (size > 0) {
+        crc = crc32(crc, data, static_cast<uInt>(size));
+    }
+    std::vector<uchar> tail;
+    putBig32(tail, static_cast<quint32>(crc));
+
+    return writeRaw(head.data(), static_cast<qint64>(head.size()))
+        && (size == 0 || writeRaw(data, size))
+        && writeRaw(tail.data(), static_cast<qint64>(tail.size()));
+}
+
+bool PlotImageWriter::deflateInto(const uchar* data, size_t size, bool finish, std::vector<uchar>& output)
+{
+    z_stream& stream = m_deflater->stream;
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = static_cast<uInt>(size);
+
+    for (;;) {
+        const size_t used = output.size();
+        const size_t room = std::max<size_t>(deflateBound(&stream, stream.avail_in), 64 * 1024);
+        output.resize(used + room);
+        stream.next_out = output.data() + used;
+        stream.avail_out = static_cast<uInt>(room);
+
+        const int status = deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH);
+        output.resize(used + room - stream.avail_out);
+        if (status == Z_STREAM_ERROR) {
+            return fail(QStringLiteral("zlib compression failed"));
+        }
+        if (finish ? status == Z_STREAM_END : (stream.avail_in == 0 && stream.avail_out != 0)) {
+            return true;
+        }
+    }
+}
+
+bool PlotImageWriter::flushPngData(bool finish)
+{
+    size_t offset = 0;
+    while (m_compressed.size() - offset >= IdatChunkSize || (finish && offset < m_compressed.size())) {
+        const size_t size = std::min(IdatChunkSize, m_compressed.size() - offset);
+        if (!writePngChunk("IDAT", m_compressed.data() + offset, static_cast<int>(size))) {
+            return false;
+        }
+        offset += size;
+    }
+    m_compressed.erase(m_compressed.begin(), m_compressed.begin() + static_cast<std::ptrdiff_t>(offset));
+    return true;
+}
+
+bool PlotImageWriter::flushTiffStrip()
+{
+    // Every strip is its own zlib stream
+    deflateReset(&m_deflater->stream);
+    m_compressed.clear();
+    if (!deflateInto(m_pending.data(), m_pending.size(), true, m_compressed)) {
+        return false;
+    }
+    m_pending.clear();
+
+    if (m_bytesWritten + static_cast<qint64>(m_compressed.size()) > std::numeric_limits<quint32>::max()) {
+        return fail(QStringLiteral("TIFF output exceeds 4 GB"));
+    }
+    m_stripOffsets.push_back(static_cast<quint32>(m_bytesWritten));
+    m_stripSizes.push_back(static_cast<quint32>(m_compressed.size()));
+    return writeRaw(m_compressed.data(), static_cast<qint64>(m_compressed.size()));
+}
+
+bool PlotImageWriter::writeTiffDirectory()
+{
+    constexpr quint16 EntryCount = 13;
+    const quint32 strips = static_cast<quint32>(m_stripOffsets.size());
+
+    // Directory on a word boundary, then the values that do not fit in an entry
+    if ((m_bytesWritten & 1) != 0) {
+        const uchar pad = 0;
+        if (!writeRaw(&pad, 1)) {
+            return false;
+        }
+    }
+    const quint32 directory = static_cast<quint32>(m_bytesWritten);
+    const quint32 bitsOffset = directory + 2 + EntryCount * 12 + 4;
+    const quint32 xResOffset = bitsOffset + 6 + 2;
+    const quint32 yResOffset = xResOffset + 8;
+    const quint32 offsetsOffset = yResOffset + 8;
+    const quint32 sizesOffset = offsetsOffset + strips * 4;
+
+    std::vector<uchar> ifd;
+    putLittle16(ifd, EntryCount);
+    putTiffEntry(ifd, 256, TiffLong, 1, static_cast<quint32>(m_width));
+    putTiffEntry(ifd, 257, TiffLong, 1, static_cast<quint32>(m_height));
+    putTiffEntry(ifd, 258, TiffShort, 3, bitsOffset);
+    putTiffEntry(ifd, 259, TiffShort, 1, 8);                // Deflate
+    putTiffEntry(ifd, 262, TiffShort, 1, 2);                // RGB
+    putTiffEntry(ifd, 273, TiffLong, strips, strips == 1 ? m_stripOffsets[0] : offsetsOffset);
+    putTiffEntry(ifd, 277, TiffShort, 1, 3);
+    putTiffEntry(ifd, 278, TiffLong, 1, static_cast<quint32>(m_rowsPerStrip));
+    putTiffEntry(ifd, 279, TiffLong, strips, strips == 1 ? m_stripSizes[0] : sizesOffset);
+    putTiffEntry(ifd, 282, TiffRational, 1, xResOffset);
+    putTiffEntry(ifd, 283, TiffRational, 1, yResOffset);
+    putTiffEntry(ifd, 284, TiffShort, 1, 1);                // Chunky
+    putTiffEntry(ifd, 296, TiffShort, 1, 2);                // Inch
+    putLittle32(ifd, 0);                                    // No further directories
+
+    for (int i = 0; i < 3; ++i) {
+        putLittle16(ifd, 8);
+    }
+    putLittle16(ifd, 0);
+    const quint32 resolution = static_cast<quint32>(m_dpi * 100.0 + 0.5);
+    for (int i = 0; i < 2; ++i) {
+        putLittle32(ifd, resolution);
+        putLittle32(ifd, 100);
+    }
+    if (strips > 1) {
+        for (quint32 offset : m_stripOffsets) {
+            putLittle32(ifd, offset);
+        }
+        for (quint32 size : m_stripSizes) {
+            putLittle32(ifd, size);
+        }
+    }
+    if (!writeRaw(ifd.data(), static_cast<qint64>(ifd.size()))) {
+        return false;
+    }
+
+    std::vector<uchar> pointer;
+    putLittle32(pointer, directory);
+    if (!m_file.seek(4) || m_file.write(reinterpret_cast<const char*>(pointer.data()), 4) != 4) {
+        return fail(m_file.errorString());
+    }
+    return true;
+}
+
+bool PlotImageWriter::writeRaw(const void* data, qint64 size)
+{
+    if (m_file.write(static_cast<const char*>(data), size) != size) {
+        return fail(m_file.errorString());
+    }
+    m_bytesWritten += size;
+    return true;
+}
+
+bool PlotImageWriter::fail(const QString& error)
+{
+    if (m_error.isEmpty()) {
+        m_error = error;
+    }
+    return false;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Streaming PNG/TIFF encoder for plot rasters
+ *
+ * Rows are appended top to bottom as 8-bit RGB and compressed as they
+ * arrive, so only the rows of one call (plus one TIFF strip) are held in
+ * memory however large the sheet is.
+ * - PNG: one zlib stream split into IDAT chunks as it fills
+ * - TIFF: baseline RGB with Deflate-compressed strips; the IFD is written
+ *   after the last strip and the header patched to point at it
+ */
+class PlotImageWriter
+{
+public:
+    enum Format {
+        Png,
+        Tiff
+    };
+
+    PlotImageWriter();
+    ~PlotImageWriter();
+
+    static bool formatFromSuffix(const QString& suffix, Format& format);
+
+    bool open(const QString& path, Format format, int width, int height, double dpi);
+    bool writeRows(const uchar* rgb, int rows);     // rows * width * 3 bytes
+    bool close();                                   // Fails unless every row was written
+
+    int rowsWritten() const { return m_rowsWritten; }
+    qint64 bytesWritten() const { return m_bytesWritten; }
+    QString errorString() const { return m_error; }
+
+private:
+    struct Deflater;
+
+    bool writePngHeader();
+    bool writePngChunk(const char* type, const uchar* data, int size);
+    bool deflateInto(const uchar* data, size_t size, bool finish, std::vector<uchar>& output);
+    bool flushPngData(bool finish);
+    bool flushTiffStrip();
+    bool writeTiffDirectory();
+    bool writeRaw(const void* data, qint64 size);
+    bool fail(const QString& error);
+
+    QFile m_file;
+    Format m_format;
+    int m_width;
+    int m_height;
+    double m_dpi;
+    int m_rowsWritten;
+    qint64 m_bytesWritten;
+    QString m_error;
+
+    std::unique_ptr<Deflater> m_deflater;
+    std::vector<uchar> m_pending;           // Filtered PNG rows or raw TIFF strip rows
+    std::vector<uchar> m_compressed;
+
+    // TIFF strips
+    int m_rowsPerStrip;
+    std::vector<quint32> m_stripOffsets;
+    std::vector<quint32> m_stripSizes;
+};
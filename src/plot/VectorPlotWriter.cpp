@@ -0,0 +1,693 @@
+#include "VectorPlotWriter.h"
+#include "PlotEngine.h"
+#include <QHash>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <zlib.h>
+
+namespace {
+
+constexpr size_t BufferSize = 1 << 20;
+constexpr double PointsPerMillimetre = 72.0 / 25.4;
+constexpr float JoinTolerance = 1.0e-4f;        // mm between a segment end and the next start
+constexpr double MergeTolerance = 1.0e-3;       // mm a dropped vertex may lie off the merged line
+
+// Fixed object numbers; layers and symbols follow
+enum PdfObject { Catalog = 1, Pages, Page, Content, ContentLength, FirstLayer };
+
+// UTF-16BE hex string, so any layer name is safe
+std::string pdfText(const QString& text)
+{
+    std::string out = "<FEFF";
+    char hex[8];
+    for (QChar c : text) {
+        std::snprintf(hex, sizeof(hex), "%04X", c.unicode());
+        out += hex;
+    }
+    out += '>';
+    return out;
+}
+
+QString xmlEscaped(const QString& text)
+{
+    return text.toHtmlEscaped();
+}
+
+std::string svgColor(QRgb color)
+{
+    char text[8];
+    std::snprintf(text, sizeof(text), "#%02x%02x%02x", qRed(color), qGreen(color), qBlue(color));
+    return text;
+}
+
+} // namespace
+
+struct VectorPlotWriter::Deflater
+{
+    z_stream stream;
+    bool initialized;
+
+    Deflater() : initialized(false) { std::memset(&stream, 0, sizeof(stream)); }
+    ~Deflater()
+    {
+        if (initialized) {
+            deflateEnd(&stream);
+        }
+    }
+};
+
+struct VectorPlotWriter::Item
+{
+    int layer;
+    const PlotPen* pen;
+    int index;                  // Batch index, or instance index when instance is set
+    bool instance;
+};
+
+VectorPlotWriter::VectorPlotWriter()
+    : m_bytesWritten(0)
+    , m_compressedBytes(0)
+{
+}
+
+VectorPlotWriter::~VectorPlotWriter() = default;
+
+bool VectorPlotWriter::formatFromSuffix(const QString& suffix, Format& format)
+{
+    const QString lower = suffix.toLower();
+    if (lower == QLatin1String("pdf")) {
+        format = Pdf;
+        return true;
+    }
+    if (lower == QLatin1String("svg")) {
+        format = Svg;
+        return true;
+    }
+    return false;
+}
+
+bool VectorPlotWriter::write(const QString& path, Format format, const PlotSheet& sheet)
+{
+    m_bytesWritten = 0;
+    m_error.clear();
+    m_stats = VectorPlotStats();
+    m_buffer.clear();
+    m_buffer.reserve(BufferSize + 4096);
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return fail(QString("Cannot write %1: %2").arg(path, m_file.errorString()));
+    }
+
+    // Layer by layer, then by pen so each run sets its state once; stable keeps drawing order within a run
+    std::vector<QString> layers;
+    QHash<QString, int> layerIndex;
+    auto layerOf = [&](const QString& name) {
+        auto it = layerIndex.constFind(name);
+        if (it != layerIndex.constEnd()) {
+            return it.value();
+        }
+        layers.push_back(name);
+        return layerIndex.insert(name, static_cast<int>(layers.size()) - 1).value();
+    };
+
+    std::vector<Item> items;
+    items.reserve(sheet.batches.size() + sheet.instances.size());
+    for (size_t i = 0; i < sheet.batches.size(); ++i) {
+        if (!sheet.batches[i].segments.empty()) {
+            items.push_back(Item{layerOf(sheet.batches[i].layer), &sheet.batches[i].pen, static_cast<int>(i), false});
+        }
+    }
+    for (size_t i = 0; i < sheet.instances.size(); ++i) {
+        items.push_back(Item{layerOf(sheet.instances[i].layer), &sheet.instances[i].pen, static_cast<int>(i), true});
+    }
+
+    std::vector<int> layerOrder(layers.size());
+    for (size_t i = 0; i < layers.size(); ++i) {
+        layerOrder[i] = static_cast<int>(i);
+    }
+    std::sort(layerOrder.begin(), layerOrder.end(), [&](int a, int b) { return layers[a] < layers[b]; });
+    std::vector<int> layerRank(layers.size());
+    for (size_t i = 0; i < layerOrder.size(); ++i) {
+        layerRank[layerOrder[i]] = static_cast<int>(i);
+    }
+    std::stable_sort(items.begin(), items.end(), [&](const Item& a, const Item& b) {
+        if (a.layer != b.layer) {
+            return layerRank[a.layer] < layerRank[b.layer];
+        }
+        if (a.pen->color != b.pen->color) {
+            return a.pen->color < b.pen->color;
+        }
+        if (a.pen->width != b.pen->width) {
+            return a.pen->width < b.pen->width;
+        }
+        return a.pen->lineType < b.pen->lineType;
+    });
+
+    m_stats.layers = static_cast<int>(layers.size());
+    m_stats.symbols = static_cast<int>(sheet.symbols.size());
+    m_stats.instances = static_cast<int>(sheet.instances.size());
+
+    const bool ok = format == Pdf ? writePdf(sheet, items, layers) : writeSvg(sheet, items, layers);
+    const bool flushed = ok && flush(true) && m_file.flush();
+    m_file.close();
+    m_deflater.reset();
+    m_buffer = std::string();
+    m_compressed = std::vector<char>();
+    if (!flushed) {
+        fail(m_file.errorString());
+        m_file.remove();
+    }
+    return flushed;
+}
+
+// PDF
+bool VectorPlotWriter::writePdf(const PlotSheet& sheet, const std::vector<Item>& items, const std::vector<QString>& layers)
+{
+    const int firstSymbol = FirstLayer + static_cast<int>(layers.size());
+    const int objectCount = firstSymbol + static_cast<int>(sheet.symbols.size());
+    std::vector<qint64> offsets(objectCount, 0);
+    auto beginObject = [&](int number) {
+        offsets[number] = m_bytesWritten + static_cast<qint64>(m_buffer.size());
+        append(std::to_string(number));
+        append(" 0 obj\n");
+    };
+
+    append("%PDF-1.5\n%\xe2\xe3\xcf\xd3\n");
+
+    for (size_t i = 0; i < layers.size(); ++i) {
+        beginObject(FirstLayer + static_cast<int>(i));
+        append("<< /Type /OCG /Name ");
+        append(pdfText(layers[i]));
+        append(" >>\nendobj\n");
+    }
+
+    // Form bounding boxes clip, so they must cover the widest stroke any insert draws
+    std::vector<double> symbolMargin(sheet.symbols.size(), 0.0);
+    for (const PlotInstance& instance : sheet.instances) {
+        const double scale = std::sqrt(std::abs(instance.transform.determinant()));
+        if (scale > 0.0 && instance.symbol >= 0 && instance.symbol < static_cast<int>(symbolMargin.size())) {
+            symbolMargin[instance.symbol] = std::max(symbolMargin[instance.symbol], instance.pen.width / scale);
+        }
+    }
+
+    // Symbols are small; each is compressed whole so its length is known up front
+    for (size_t i = 0; i < sheet.symbols.size(); ++i) {
+        const PlotSymbol& symbol = sheet.symbols[i];
+        if (!flush(true)) {
+            return false;
+        }
+        appendPath(symbol.segments, false);
+        append("S\n");
+        const std::string content = std::move(m_buffer);
+        m_buffer.clear();
+
+        std::vector<Bytef> compressed(compressBound(static_cast<uLong>(content.size())));
+        uLongf size = static_cast<uLongf>(compressed.size());
+        if (compress2(compressed.data(), &size, reinterpret_cast<const Bytef*>(content.data()),
+                      static_cast<uLong>(content.size()), Z_BEST_SPEED) != Z_OK) {
+            return fail(QStringLiteral("zlib compression failed"));
+        }
+
+        beginObject(firstSymbol + static_cast<int>(i));
+        append("<< /Type /XObject /Subtype /Form /BBox [");
+        const double margin = symbolMargin[i];
+        appendNumber(symbol.bounds.left() - margin);
+        appendNumber(symbol.bounds.top() - margin);
+        appendNumber(symbol.bounds.right() + margin);
+        appendNumber(symbol.bounds.bottom() + margin, '\0');
+        append("] /Filter /FlateDecode /Length ");
+        append(std::to_string(size));
+        append(" >>\nstream\n");
+        if (!flush(true) || !writeRaw(reinterpret_cast<const char*>(compressed.data()), static_cast<qint64>(size))) {
+            return false;
+        }
+        append("\nendstream\nendobj\n");
+    }
+
+    // Page content, compressed as it is produced; coordinates stay in mm
+    beginObject(Content);
+    append("<< /Length ");
+    append(std::to_string(ContentLength));
+    append(" 0 R /Filter /FlateDecode >>\nstream\n");
+    if (!beginCompressed()) {
+        return false;
+    }
+    append("2.83464567 0 0 2.83464567 0 0 cm 1 j\n");
+
+    int currentLayer = -1;
+    const PlotPen* currentPen = nullptr;
+    bool pathOpen = false;
+    for (const Item& item : items) {
+        if (item.layer != currentLayer) {
+            if (pathOpen) {
+                append("S\n");
+                pathOpen = false;
+            }
+            if (currentLayer >= 0) {
+                append("EMC\n");
+            }
+            currentLayer = item.layer;
+            currentPen = nullptr;
+            append("/OC /L");
+            append(std::to_string(item.layer));
+            append(" BDC\n");
+        }
+        if (!currentPen || *currentPen != *item.pen) {
+            if (pathOpen) {
+                append("S\n");
+                pathOpen = false;
+            }
+            currentPen = item.pen;
+            appendPdfPen(*currentPen, 1.0);
+        }
+
+        if (!item.instance) {
+            appendPath(sheet.batches[item.index].segments, false);
+            pathOpen = true;
+        } else {
+            if (pathOpen) {
+                append("S\n");
+                pathOpen = false;
+            }
+            const PlotInstance& instance = sheet.instances[item.index];
+            const QTransform& t = instance.transform;
+            append("q ");
+            appendNumber(t.m11());
+            appendNumber(t.m12());
+            appendNumber(t.m21());
+            appendNumber(t.m22());
+            appendNumber(t.dx());
+            appendNumber(t.dy());
+            append("cm ");
+            const double scale = std::sqrt(std::abs(t.determinant()));
+            if (std::abs(scale - 1.0) > 1.0e-9 && scale > 0.0) {
+                appendPdfPen(*item.pen, scale);
+            }
+            append("/S");
+            append(std::to_string(instance.symbol));
+            append(" Do Q\n");
+        }
+        if (!flush()) {
+            return false;
+        }
+    }
+    if (pathOpen) {
+        append("S\n");
+    }
+    if (currentLayer >= 0) {
+        append("EMC\n");
+    }
+    if (!endCompressed()) {
+        return false;
+    }
+    append("\nendstream\nendobj\n");
+
+    beginObject(ContentLength);
+    append(std::to_string(m_compressedBytes));
+    append("\nendobj\n");
+
+    beginObject(Page);
+    append("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 ");
+    appendNumber(sheet.paperSize.width() * PointsPerMillimetre);
+    appendNumber(sheet.paperSize.height() * PointsPerMillimetre, '\0');
+    append("] /Contents 4 0 R /Resources << /XObject <<");
+    for (size_t i = 0; i < sheet.symbols.size(); ++i) {
+        append(" /S" + std::to_string(i) + " " + std::to_string(firstSymbol + i) + " 0 R");
+    }
+    append(" >> /Properties <<");
+    for (size_t i = 0; i < layers.size(); ++i) {
+        append(" /L" + std::to_string(i) + " " + std::to_string(FirstLayer + i) + " 0 R");
+    }
+    append(" >> >> >>\nendobj\n");
+
+    beginObject(Pages);
+    append("<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+
+    // Layers show up in the viewer's layer panel in name order
+    std::string groups;
+    std::vector<int> order(layers.size());
+    for (size_t i = 0; i < layers.size(); ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return layers[a] < layers[b]; });
+    for (int layer : order) {
+        groups += " " + std::to_string(FirstLayer + layer) + " 0 R";
+    }
+    beginObject(Catalog);
+    append("<< /Type /Catalog /Pages 2 0 R /OCProperties << /OCGs [");
+    append(groups);
+    append(" ] /D << /Order [");
+    append(groups);
+    append(" ] >> >> >>\nendobj\n");
+
+    const qint64 xref = m_bytesWritten + static_cast<qint64>(m_buffer.size());
+    append("xref\n0 " + std::to_string(objectCount) + "\n0000000000 65535 f \n");
+    char entry[32];
+    for (int i = 1; i < objectCount; ++i) {
+        std::snprintf(entry, sizeof(entry), "%010lld 00000 n \n", static_cast<long long>(offsets[i]));
+        append(entry);
+    }
+    append("trailer\n<< /Size " + std::to_string(objectCount) + " /Root 1 0 R >>\nstartxref\n");
+    append(std::to_string(xref));
+    append("\n%%EOF\n");
+    return true;
+}
+
+void VectorPlotWriter::appendPdfPen(const PlotPen& pen, double scale)
+{
+    // Scaled instances keep the run's colour and only compensate width and dashes
+    if (scale == 1.0) {
+        appendNumber(qRed(pen.color) / 255.0);
+        appendNumber(qGreen(pen.color) / 255.0);
+        appendNumber(qBlue(pen.color) / 255.0);
+        append("RG ");
+    }
+    appendNumber(pen.width / scale);
+    append("w [");
+    const std::vector<double>& dashes = PlotEngine::dashLengths(pen.lineType);
+    for (double length : dashes) {
+        appendNumber(length / scale);
+    }
+    append(dashes.empty() ? "] 0 d 1 J\n" : "] 0 d 0 J\n");
+}
+
+// SVG
+bool VectorPlotWriter::writeSvg(const PlotSheet& sheet, const std::vector<Item>& items, const std::vector<QString>& layers)
+{
+    const double width = sheet.paperSize.width();
+    const double height = sheet.paperSize.height();
+
+    append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+           "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"");
+    appendNumber(width, '\0');
+    append("mm\" height=\"");
+    appendNumber(height, '\0');
+    append("mm\" viewBox=\"0 0 ");
+    appendNumber(width);
+    appendNumber(height, '\0');
+    append("\">\n");
+
+    if (!sheet.symbols.empty()) {
+        append("<defs>\n");
+        for (size_t i = 0; i < sheet.symbols.size(); ++i) {
+            append("<symbol id=\"s" + std::to_string(i) + "\" overflow=\"visible\"><path d=\"");
+            appendPath(sheet.symbols[i].segments, true);
+            append("\"/></symbol>\n");
+            if (!flush()) {
+                return false;
+            }
+        }
+        append("</defs>\n");
+    }
+
+    // Sheet coordinates have y up
+    append("<g transform=\"matrix(1 0 0 -1 0 ");
+    appendNumber(height, '\0');
+    append(")\" fill=\"none\" stroke-linejoin=\"round\">\n");
+
+    int currentLayer = -1;
+    const PlotPen* currentPen = nullptr;
+    bool pathOpen = false;
+    auto closePath = [&]() {
+        if (pathOpen) {
+            append("\"/>\n");
+            pathOpen = false;
+        }
+    };
+    for (const Item& item : items) {
+        if (item.layer != currentLayer) {
+            closePath();
+            if (currentPen) {
+                append("</g>\n");
+            }
+            if (currentLayer >= 0) {
+                append("</g>\n");
+            }
+            currentLayer = item.layer;
+            currentPen = nullptr;
+            append("<g id=\"layer");
+            append(std::to_string(item.layer));
+            append("\" data-layer=\"");
+            append(xmlEscaped(layers[item.layer]));
+            append("\">\n");
+        }
+        if (!currentPen || *currentPen != *item.pen) {
+            closePath();
+            if (currentPen) {
+                append("</g>\n");
+            }
+            currentPen = item.pen;
+            appendSvgPen(*currentPen);
+        }
+
+        if (!item.instance) {
+            if (!pathOpen) {
+                append("<path d=\"");
+                pathOpen = true;
+            }
+            appendPath(sheet.batches[item.index].segments, true);
+        } else {
+            closePath();
+            const PlotInstance& instance = sheet.instances[item.index];
+            const QTransform& t = instance.transform;
+            append("<use xlink:href=\"#s" + std::to_string(instance.symbol) + "\" transform=\"matrix(");
+            appendNumber(t.m11());
+            appendNumber(t.m12());
+            appendNumber(t.m21());
+            appendNumber(t.m22());
+            appendNumber(t.dx());
+            appendNumber(t.dy(), '\0');
+            append(")\"");
+            const double scale = std::sqrt(std::abs(t.determinant()));
+            if (std::abs(scale - 1.0) > 1.0e-9 && scale > 0.0) {
+                append(" stroke-width=\"");
+                appendNumber(item.pen->width / scale, '\0');
+                append("\"");
+                const std::vector<double>& dashes = PlotEngine::dashLengths(item.pen->lineType);
+                if (!dashes.empty()) {
+                    append(" stroke-dasharray=\"");
+                    for (size_t i = 0; i < dashes.size(); ++i) {
+                        appendNumber(dashes[i] / scale, i + 1 < dashes.size() ? ' ' : '\0');
+                    }
+                    append("\"");
+                }
+            }
+            append("/>\n");
+        }
+        if (!flush()) {
+            return false;
+        }
+    }
+    closePath();
+    if (currentPen) {
+        append("</g>\n");
+    }
+    if (currentLayer >= 0) {
+        append("</g>\n");
+    }
+    append("</g>\n</svg>\n");
+    return true;
+}
+
+void VectorPlotWriter::appendSvgPen(const PlotPen& pen)
+{
+    const std::vector<double>& dashes = PlotEngine::dashLengths(pen.lineType);
+    append("<g stroke=\"");
+    append(svgColor(pen.color));
+    append("\" stroke-width=\"");
+    appendNumber(pen.width, '\0');
+    append(dashes.empty() ? "\" stroke-linecap=\"round\"" : "\" stroke-linecap=\"butt\"");
+    if (!dashes.empty()) {
+        append(" stroke-dasharray=\"");
+        for (size_t i = 0; i < dashes.size(); ++i) {
+            appendNumber(dashes[i], i + 1 < dashes.size() ? ' ' : '\0');
+        }
+        append("\"");
+    }
+    append(">\n");
+}
+
+// Path encoding
+void VectorPlotWriter::appendPath(const std::vector<float>& segments, bool svg)
+{
+    const char* moveTo = svg ? "M" : "m\n";
+    const char* lineTo = svg ? "L" : "l\n";
+    auto vertex = [&](double x, double y, const char* op) {
+        if (svg) {
+            append(op);
+        }
+        appendNumber(x);
+        appendNumber(y);
+        if (!svg) {
+            append(op);
+        }
+        ++m_stats.verticesOut;
+    };
+
+    // Chain segments that continue each other; a vertex is dropped when it lies on the
+    // line from the last written vertex to the new end, between the two
+    bool open = false;
+    double anchorX = 0.0, anchorY = 0.0, pendingX = 0.0, pendingY = 0.0;
+    for (size_t i = 0; i + 3 < segments.size(); i += 4) {
+        const float x0 = segments[i], y0 = segments[i + 1], x1 = segments[i + 2], y1 = segments[i + 3];
+        ++m_stats.segmentsIn;
+        if (open && std::abs(x0 - pendingX) <= JoinTolerance && std::abs(y0 - pendingY) <= JoinTolerance) {
+            const double dx = x1 - anchorX, dy = y1 - anchorY;
+            const double length = std::sqrt(dx * dx + dy * dy);
+            const double cross = (pendingX - anchorX) * dy - (pendingY - anchorY) * dx;
+            const double along = (pendingX - anchorX) * dx + (pendingY - anchorY) * dy;
+            if (length > 0.0 && std::abs(cross) <= MergeTolerance * length && along >= 0.0 && along <= length * length) {
+                pendingX = x1;
+                pendingY = y1;
+                continue;
+            }
+            vertex(pendingX, pendingY, lineTo);
+            anchorX = pendingX;
+            anchorY = pendingY;
+        } else {
+            if (open) {
+                vertex(pendingX, pendingY, lineTo);
+            }
+            vertex(x0, y0, moveTo);
+            anchorX = x0;
+            anchorY = y0;
+            open = true;
+        }
+        pendingX = x1;
+        pendingY = y1;
+    }
+    if (open) {
+        vertex(pendingX, pendingY, lineTo);
+    }
+}
+
+// Output
+void VectorPlotWriter::append(const char* text)
+{
+    m_buffer.append(text);
+}
+
+void VectorPlotWriter::append(const QString& text)
+{
+    m_buffer.append(text.toStdString());
+}
+
+void VectorPlotWriter::appendNumber(double value, char separator)
+{
+    // Micrometre precision, trailing zeros dropped
+    char text[32];
+    auto result = std::to_chars(text, text + sizeof(text) - 1, value, std::chars_format::fixed, 3);
+    char* end = result.ptr;
+    if (result.ec != std::errc()) {
+        end = text + std::snprintf(text, sizeof(text) - 1, "%.3f", value);
+    }
+    while (end > text && end[-1] == '0') {
+        --end;
+    }
+    if (end > text && end[-1] == '.') {
+        --end;
+    }
+    if (end == text || (end - text == 1 && text[0] == '-') || (end - text == 2 && text[0] == '-' && text[1] == '0')) {
+        text[0] = '0';
+        end = text + 1;
+    }
+    if (separator != '\0') {
+        *end++ = separator;
+    }
+    m_buffer.append(text, static_cast<size_t>(end - text));
+}
+
+bool VectorPlotWriter::flush(bool force)
+{
+    if (m_buffer.empty() || (!force && m_buffer.size() < BufferSize)) {
+        return m_error.isEmpty();
+    }
+
+    bool ok = true;
+    if (m_deflater) {
+        z_stream& stream = m_deflater->stream;
+        stream.next_in = reinterpret_cast<Bytef*>(m_buffer.data());
+        stream.avail_in = static_cast<uInt>(m_buffer.size());
+        m_compressed.resize(BufferSize);
+        while (ok && stream.avail_in > 0) {
+            stream.next_out = reinterpret_cast<Bytef*>(m_compressed.data());
+            stream.avail_out = static_cast<uInt>(m_compressed.size());
+            if (deflate(&stream, Z_NO_FLUSH) == Z_STREAM_ERROR) {
+                ok = fail(QStringLiteral("zlib compression failed"));
+                break;
+            }
+            const qint64 produced = static_cast<qint64>(m_compressed.size() - stream.avail_out);
+            m_compressedBytes += produced;
+            ok = writeRaw(m_compressed.data(), produced);
+        }
+    } else {
+        ok = writeRaw(m_buffer.data(), static_cast<qint64>(m_buffer.size()));
+    }
+    m_buffer.clear();
+    return ok;
+}
+
+bool VectorPlotWriter::beginCompressed()
+{
+    if (!flush(true)) {
+        return false;
+    }
+    m_deflater = std::make_unique<Deflater>();
+    if (deflateInit(&m_deflater->stream, Z_BEST_SPEED) != Z_OK) {
+        m_deflater.reset();
+        return fail(QStringLiteral("Cannot initialize zlib"));
+    }
+    m_deflater->initialized = true;
+    m_compressedBytes = 0;
+    return true;
+}
+
+bool VectorPlotWriter::endCompressed()
+{
+    if (!flush(true)) {
+        return false;
+    }
+
+    z_stream& stream = m_deflater->stream;
+    stream.next_in = nullptr;
+    stream.avail_in = 0;
+    m_compressed.resize(BufferSize);
+    int status = Z_OK;
+    while (status != Z_STREAM_END) {
+        stream.next_out = reinterpret_cast<Bytef*>(m_compressed.data());
+        stream.avail_out = static_cast<uInt>(m_compressed.size());
+        status = deflate(&stream, Z_FINISH);
+        if (status == Z_STREAM_ERROR) {
+            return fail(QStringLiteral("zlib compression failed"));
+        }
+        const qint64 produced = static_cast<qint64>(m_compressed.size() - stream.avail_out);
+        m_compressedBytes += produced;
+        if (!writeRaw(m_compressed.data(), produced)) {
+            return false;
+        }
+    }
+    m_deflater.reset();
+    return true;
+}
+
+bool VectorPlotWriter::writeRaw(const char* data, qint64 size)
+{
+    if (size > 0 && m_file.write(data, size) != size) {
+        return fail(m_file.errorString());
+    }
+    m_bytesWritten += size;
+    return true;
+}
+
+bool VectorPlotWriter::fail(const QString& error)
+{
+    if (m_error.isEmpty()) {
+        m_error = error;
+    }
+    return false;
+}
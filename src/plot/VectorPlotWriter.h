@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct PlotPen;
+struct PlotSheet;
+
+/**
+ * @brief Counters of one vector plot
+ */
+struct VectorPlotStats
+{
+    size_t segmentsIn;
+    size_t verticesOut;         // After chaining and collinear merging
+    int layers;
+    int symbols;
+    int instances;
+
+    VectorPlotStats() : segmentsIn(0), verticesOut(0), layers(0), symbols(0), instances(0) {}
+};
+
+/**
+ * @brief Streaming PDF/SVG encoder for plot sheets
+ *
+ * Line work is written layer by layer (PDF optional content groups, SVG
+ * groups) and, within a layer, in runs of equal pens so state is set once
+ * per run. Segments that continue each other are chained into polylines and
+ * collinear runs are merged into single lines before they are formatted.
+ *
+ * Block symbols are written once, as PDF form XObjects or SVG symbols, and
+ * every instance is a transformed reference to them; line widths and dashes
+ * are compensated for the instance scale.
+ *
+ * Output goes through a fixed-size buffer (PDF page content through zlib
+ * as well), so memory does not grow with the sheet beyond the sheet itself.
+ */
+class VectorPlotWriter
+{
+public:
+    enum Format {
+        Pdf,
+        Svg
+    };
+
+    VectorPlotWriter();
+    ~VectorPlotWriter();
+
+    static bool formatFromSuffix(const QString& suffix, Format& format);
+
+    bool write(const QString& path, Format format, const PlotSheet& sheet);
+
+    const VectorPlotStats& stats() const { return m_stats; }
+    qint64 bytesWritten() const { return m_bytesWritten; }
+    QString errorString() const { return m_error; }
+
+private:
+    struct Deflater;
+    struct Item;
+
+    bool writePdf(const PlotSheet& sheet, const std::vector<Item>& items, const std::vector<QString>& layers);
+    bool writeSvg(const PlotSheet& sheet, const std::vector<Item>& items, const std::vector<QString>& layers);
+    void appendPath(const std::vector<float>& segments, bool svg);
+    void appendPdfPen(const PlotPen& pen, double scale);
+    void appendSvgPen(const PlotPen& pen);
+
+    // Buffered output; while compressing, flushes go through zlib first
+    void append(const char* text);
+    void append(const std::string& text) { m_buffer.append(text); }
+    void append(const QString& text);
+    void appendNumber(double value, char separator = ' ');     // '\0': no separator
+    bool flush(bool force = false);
+    bool beginCompressed();
+    bool endCompressed();
+    bool writeRaw(const char* data, qint64 size);
+    bool fail(const QString& error);
+
+    QFile m_file;
+    std::string m_buffer;
+    std::unique_ptr<Deflater> m_deflater;
+    std::vector<char> m_compressed;
+    qint64 m_bytesWritten;
+    qint64 m_compressedBytes;
+    QString m_error;
+    VectorPlotStats m_stats;
+};
@@ -0,0 +1,462 @@
+#include "BlockManager.h"
+#include "DxfReader.h"
+#include "DxfWriter.h"
+#include "GeometryEngine.h"
+#include "LayerManager.h"
+#include "PlotEngine.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <BRepAdaptor_Curve.hxx>
+#include <BRepBuilderAPI_MakeEdge.hxx>
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepBuilderAPI_MakePolygon.hxx>
+#include <BRepBuilderAPI_MakeVertex.hxx>
+#include <BRepBuilderAPI_MakeWire.hxx>
+#include <BRepGProp.hxx>
+#include <BRep_Tool.hxx>
+#include <ElCLib.hxx>
+#include <GC_MakeArcOfCircle.hxx>
+#include <GProp_GProps.hxx>
+#include <TopExp.hxx>
+#include <TopoDS.hxx>
+
+#include <cmath>
+#include <map>
+#include <memory>
+
+namespace {
+
+/**
+ * @brief Engine, layers and blocks of one drawing
+ */
+struct Document
+{
+    GeometryEngine engine;
+    LayerManager layers;
+    BlockManager blocks;
+
+    Document()
+    {
+        engine.setHeadless(true);
+        layers.setGeometryEngine(&engine);
+        blocks.setGeometryEngine(&engine);
+    }
+
+    std::vector<const CADEntity*> entitiesOfType(CADEntity::Type type) const
+    {
+        std::vector<const CADEntity*> found;
+        for (int id : engine.getAllEntityIds()) {
+            const CADEntity* entity = engine.findEntity(id);
+            if (entity->type == type) {
+                found.push_back(entity);
+            }
+        }
+        return found;
+    }
+};
+
+CADEntity makeEntity(CADEntity::Type type, const TopoDS_Shape& shape, const QString& layer = QStringLiteral("0"))
+{
+    CADEntity entity;
+    entity.type = type;
+    entity.shape = shape;
+    entity.layer = layer;
+    return entity;
+}
+
+double length(const TopoDS_Shape& shape)
+{
+    GProp_GProps properties;
+    BRepGProp::LinearProperties(shape, properties);
+    return properties.Mass();
+}
+
+// Group code and trimmed value pairs of an ASCII DXF file
+std::vector<std::pair<int, QString>> readGroups(const QString& path)
+{
+    std::vector<std::pair<int, QString>> groups;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return groups;
+    }
+    const QStringList lines = QString::fromLatin1(file.readAll()).split(QLatin1Char('\n'));
+    for (int i = 0; i + 1 < lines.size(); i += 2) {
+        groups.emplace_back(lines[i].trimmed().toInt(), lines[i + 1].trimmed());
+    }
+    return groups;
+}
+
+} // namespace
+
+/**
+ * @brief Writes a drawing to DXF and reads it back into an empty one
+ */
+class DxfRoundTripTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void layers();
+    void geometry();
+    void blocks();
+    void structure();
+    void truncated();
+    void nearestAci();
+
+private:
+    DxfReadResult roundTrip();
+
+    QTemporaryDir m_dir;
+    std::unique_ptr<Document> m_source;
+    std::unique_ptr<Document> m_target;
+};
+
+void DxfRoundTripTest::init()
+{
+    m_source = std::make_unique<Document>();
+    m_target = std::make_unique<Document>();
+}
+
+void DxfRoundTripTest::cleanup()
+{
+    m_target.reset();
+    m_source.reset();
+}
+
+DxfReadResult DxfRoundTripTest::roundTrip()
+{
+    const QString path = m_dir.filePath(QString("%1.dxf").arg(QTest::currentTestFunction()));
+    const DxfWriteResult written = DxfWriter(&m_source->engine, &m_source->layers, &m_source->blocks).write(path);
+    if (!written.success) {
+        qWarning() << "Write failed:" << written.error;
+        return DxfReadResult();
+    }
+    return DxfReader(&m_target->engine, &m_target->layers, &m_target->blocks).read(path);
+}
+
+void DxfRoundTripTest::layers()
+{
+    LayerProperties walls("Walls");
+    walls.color = QColor(200, 30, 40);      // Not in the ACI palette: written as true colour
+    walls.lineType = "Dashed";
+    walls.lineWeight = 0.5;
+    walls.locked = true;
+    walls.plottable = false;
+    QVERIFY(m_source->layers.createLayer("Walls", walls));
+
+    LayerProperties off("Off");
+    off.color = DxfReader::aciColor(3);
+    off.visible = false;
+    QVERIFY(m_source->layers.createLayer("Off", off));
+
+    LayerProperties frozen("Frozen");
+    frozen.frozen = true;
+    frozen.lineWeight = 0.13;
+    QVERIFY(m_source->layers.createLayer("Frozen", frozen));
+
+    m_source->engine.addEntity(makeEntity(CADEntity::Line,
+                                          BRepBuilderAPI_MakeEdge(gp_Pnt(0, 0, 0), gp_Pnt(1, 0, 0)).Edge(), "Walls"));
+
+    const DxfReadResult result = roundTrip();
+    QVERIFY2(result.success, qPrintable(result.error));
+
+    for (const QString& name : {QStringLiteral("Walls"), QStringLiteral("Off"), QStringLiteral("Frozen")}) {
+        QVERIFY(m_target->layers.layerExists(name));
+        const LayerProperties expected = m_source->layers.getLayerProperties(name);
+        const LayerProperties actual = m_target->layers.getLayerProperties(name);
+        QCOMPARE(actual.color.rgb(), expected.color.rgb());
+        QCOMPARE(actual.lineType, expected.lineType);
+        QCOMPARE(actual.lineWeight, expected.lineWeight);
+        QCOMPARE(actual.visible, expected.visible);
+        QCOMPARE(actual.frozen, expected.frozen);
+        QCOMPARE(actual.locked, expected.locked);
+        QCOMPARE(actual.plottable, expected.plottable);
+    }
+}
+
+void DxfRoundTripTest::geometry()
+{
+    // Coordinates that only survive with shortest round-trip formatting
+    const gp_Pnt start(1.0 / 3.0, -2.0e-7, 0.1 + 0.2);
+    const gp_Pnt end(12345.678901234567, 9.87654321e5, 0.0);
+    CADEntity line = makeEntity(CADEntity::Line, BRepBuilderAPI_MakeEdge(start, end).Edge());
+    line.color = 3;
+    line.lineType = PlotEngine::lineTypeIndex("Center");
+    line.lineWeight = 0.35;
+    m_source->engine.addEntity(line);
+
+    const gp_Circ circle(gp_Ax2(gp_Pnt(10, 10, 0), gp_Dir(0, 0, 1)), 5.0);
+    m_source->engine.addEntity(makeEntity(CADEntity::Circle, BRepBuilderAPI_MakeEdge(circle).Edge()));
+    m_source->engine.addEntity(
+        makeEntity(CADEntity::Arc, BRepBuilderAPI_MakeEdge(circle, M_PI / 6.0, 2.0 * M_PI / 3.0).Edge()));
+
+    // Closed outline of a line and a half circle: one LWPOLYLINE with a bulge
+    BRepBuilderAPI_MakeWire outline;
+    outline.Add(BRepBuilderAPI_MakeEdge(gp_Pnt(0, 0, 2), gp_Pnt(10, 0, 2)).Edge());
+    outline.Add(BRepBuilderAPI_MakeEdge(GC_MakeArcOfCircle(gp_Pnt(10, 0, 2), gp_Pnt(5, 5, 2), gp_Pnt(0, 0, 2)).Value()).Edge());
+    m_source->engine.addEntity(makeEntity(CADEntity::Polyline, outline.Wire()));
+
+    BRepBuilderAPI_MakePolygon quad(gp_Pnt(0, 0, 0), gp_Pnt(4, 0, 0), gp_Pnt(4, 3, 0), gp_Pnt(0, 3, 0), Standard_True);
+    m_source->engine.addEntity(makeEntity(CADEntity::Surface, BRepBuilderAPI_MakeFace(quad.Wire()).Face()));
+
+    CADEntity text = makeEntity(CADEntity::Text, BRepBuilderAPI_MakeVertex(gp_Pnt(3, 4, 0)).Vertex());
+    text.properties["text"] = QString::fromUtf8("Größe Ω ±0.5");
+    text.properties["height"] = 3.5;
+    text.properties["rotation"] = 15.0;
+    m_source->engine.addEntity(text);
+
+    const DxfReadResult result = roundTrip();
+    QVERIFY2(result.success, qPrintable(result.error));
+    QCOMPARE(result.entities, 6);
+    QCOMPARE(result.skipped, 0);
+
+    const auto lines = m_target->entitiesOfType(CADEntity::Line);
+    QCOMPARE(lines.size(), size_t(1));
+    const TopoDS_Edge& readLine = TopoDS::Edge(lines[0]->shape);
+    const gp_Pnt readStart = BRep_Tool::Pnt(TopExp::FirstVertex(readLine, Standard_True));
+    const gp_Pnt readEnd = BRep_Tool::Pnt(TopExp::LastVertex(readLine, Standard_True));
+    QVERIFY(readStart.X() == start.X() && readStart.Y() == start.Y() && readStart.Z() == start.Z());
+    QVERIFY(readEnd.X() == end.X() && readEnd.Y() == end.Y() && readEnd.Z() == end.Z());
+    QCOMPARE(lines[0]->color, 3);
+    QCOMPARE(lines[0]->lineType, line.lineType);
+    QCOMPARE(lines[0]->lineWeight, 0.35);
+
+    QCOMPARE(m_target->entitiesOfType(CADEntity::Circle).size(), size_t(1));
+    const auto arcs = m_target->entitiesOfType(CADEntity::Arc);
+    QCOMPARE(arcs.size(), size_t(1));
+    BRepAdaptor_Curve arc(TopoDS::Edge(arcs[0]->shape));
+    QVERIFY(arc.Value(arc.FirstParameter()).IsEqual(ElCLib::Value(M_PI / 6.0, circle), 1e-9));
+    QVERIFY(arc.Value(arc.LastParameter()).IsEqual(ElCLib::Value(2.0 * M_PI / 3.0, circle), 1e-9));
+
+    const auto polylines = m_target->entitiesOfType(CADEntity::Polyline);
+    QCOMPARE(polylines.size(), size_t(1));
+    QVERIFY(std::abs(length(polylines[0]->shape) - (10.0 + 5.0 * M_PI)) < 1e-9);
+
+    QCOMPARE(m_target->entitiesOfType(CADEntity::Surface).size(), size_t(1));
+
+    const auto texts = m_target->entitiesOfType(CADEntity::Text);
+    QCOMPARE(texts.size(), size_t(1));
+    QCOMPARE(texts[0]->properties.value("text").toString(), text.properties["text"].toString());
+    QCOMPARE(texts[0]->properties.value("height").toDouble(), 3.5);
+    QCOMPARE(texts[0]->properties.value("rotation").toDouble(), 15.0);
+}
+
+void DxfRoundTripTest::blocks()
+{
+    BlockDefinition door;
+    door.name = "Door";
+    door.basePoint = gp_Pnt(5, 5, 0);
+    door.geometry.push_back(BRepBuilderAPI_MakeEdge(gp_Pnt(5, 5, 0), gp_Pnt(5, 15, 0)).Edge());
+    door.geometry.push_back(BRepBuilderAPI_MakeEdge(gp_Circ(gp_Ax2(gp_Pnt(5, 5, 0), gp_Dir(0, 0, 1)), 10.0), 0.0, M_PI / 2.0).Edge());
+    door.attributes.push_back(BlockAttribute{"NUMBER", "Door number", "1", gp_Pnt(7, 7, 0)});
+    QVERIFY(m_source->blocks.defineBlock(door));
+
+    gp_Trsf placed;
+    placed.SetTranslation(gp_Vec(20, 0, 0));
+    BlockDefinition frame;
+    frame.name = "Frame";
+    frame.geometry.push_back(BRepBuilderAPI_MakeEdge(gp_Pnt(0, 0, 0), gp_Pnt(40, 0, 0)).Edge());
+    frame.nestedBlocks.push_back(NestedBlockReference{"Door", placed});
+    QVERIFY(m_source->blocks.defineBlock(frame));
+
+    gp_Trsf rotation;
+    rotation.SetRotation(gp_Ax1(gp_Pnt(0, 0, 0), gp_Dir(0, 0, 1)), M_PI / 6.0);
+    gp_Trsf translation;
+    translation.SetTranslation(gp_Vec(100, 50, 0));
+    const gp_Trsf transform = translation * rotation;
+    QVERIFY(m_source->blocks.insertBlock("Door", transform, {{"NUMBER", "7"}}) >= 0);
+    QVERIFY(m_source->blocks.insertBlock("Frame", translation) >= 0);
+
+    const DxfReadResult result = roundTrip();
+    QVERIFY2(result.success, qPrintable(result.error));
+    QCOMPARE(result.blocks, 2);
+    QCOMPARE(result.inserts, 2);
+
+    const BlockDefinition* readDoor = m_target->blocks.getBlockDefinition("Door");
+    QVERIFY(readDoor);
+    QVERIFY(readDoor->basePoint.IsEqual(door.basePoint, 0.0));
+    QCOMPARE(readDoor->geometry.size(), size_t(2));
+    QCOMPARE(readDoor->attributes.size(), size_t(1));
+    QCOMPARE(readDoor->attributes[0].tag, QString("NUMBER"));
+    QCOMPARE(readDoor->attributes[0].prompt, QString("Door number"));
+    QCOMPARE(readDoor->attributes[0].defaultValue, QString("1"));
+
+    const BlockDefinition* readFrame = m_target->blocks.getBlockDefinition("Frame");
+    QVERIFY(readFrame);
+    QCOMPARE(readFrame->nestedBlocks.size(), size_t(1));
+    QCOMPARE(readFrame->nestedBlocks[0].blockName, QString("Door"));
+    QVERIFY(readFrame->nestedBlocks[0].transform.TranslationPart().IsEqual(placed.TranslationPart(), 1e-9));
+
+    const auto inserts = m_target->entitiesOfType(CADEntity::Block);
+    QCOMPARE(inserts.size(), size_t(2));
+    for (const CADEntity* insert : inserts) {
+        const gp_Trsf readTransform = insert->shape.Location().Transformation();
+        if (insert->properties.value("blockName").toString() == "Door") {
+            QCOMPARE(insert->properties.value("attributes").toMap().value("NUMBER").toString(), QString("7"));
+            gp_Pnt probe(3, 4, 0), expected(3, 4, 0);
+            readTransform.Transforms(probe.ChangeCoord());
+            transform.Transforms(expected.ChangeCoord());
+            QVERIFY(probe.IsEqual(expected, 1e-9));
+        } else {
+            QCOMPARE(insert->properties.value("blockName").toString(), QString("Frame"));
+            QVERIFY(!insert->properties.contains("attributes"));
+            QVERIFY(readTransform.TranslationPart().IsEqual(translation.TranslationPart(), 1e-9));
+        }
+    }
+}
+
+void DxfRoundTripTest::structure()
+{
+    // Enough entities for several chunks, a 3D polyline with vertices and an insert with attributes
+    for (int i = 0; i < 200; ++i) {
+        m_source->engine.addEntity(
+            makeEntity(CADEntity::Line, BRepBuilderAPI_MakeEdge(gp_Pnt(i, 0, 0), gp_Pnt(i, 10, 0)).Edge()));
+    }
+    BRepBuilderAPI_MakePolygon skew(gp_Pnt(0, 0, 0), gp_Pnt(10, 0, 5), gp_Pnt(10, 10, 0));
+    m_source->engine.addEntity(makeEntity(CADEntity::Polyline, skew.Wire()));
+
+    BlockDefinition tag;
+    tag.name = "Tag";
+    tag.geometry.push_back(BRepBuilderAPI_MakeEdge(gp_Pnt(0, 0, 0), gp_Pnt(5, 0, 0)).Edge());
+    tag.attributes.push_back(BlockAttribute{"ID", "Identifier", "A", gp_Pnt(0, 1, 0)});
+    QVERIFY(m_source->blocks.defineBlock(tag));
+    QVERIFY(m_source->blocks.insertBlock("Tag", gp_Trsf(), {{"ID", "B"}}) >= 0);
+
+    const DxfReadResult result = roundTrip();
+    QVERIFY2(result.success, qPrintable(result.error));
+    QCOMPARE(result.inserts, 1);
+
+    const auto groups = readGroups(m_dir.filePath("structure.dxf"));
+    QVERIFY(!groups.empty());
+
+    QString section, variable, type;
+    QString version;
+    quint64 handleSeed = 0;
+    std::map<quint64, QString> handles;             // Handle -> object type
+    std::vector<std::pair<QString, quint64>> owners;  // Object type -> owner handle
+    QStringList tables, blockRecords, sections, dictionaryEntries;
+    quint64 current = 0;
+    for (const auto& [code, value] : groups) {
+        if (code == 0) {
+            type = value;
+            current = 0;
+            continue;
+        }
+        if (type == "SECTION" && code == 2) {
+            section = value;
+            sections.append(value);
+        } else if (section == "HEADER" && code == 9) {
+            variable = value;
+        } else if (section == "HEADER" && variable == "$ACADVER" && code == 1) {
+            version = value;
+        } else if (section == "HEADER" && variable == "$HANDSEED" && code == 5) {
+            handleSeed = value.toULongLong(nullptr, 16);
+        } else if (code == 5 || (code == 105 && type == "DIMSTYLE")) {
+            bool ok = false;
+            current = value.toULongLong(&ok, 16);
+            QVERIFY2(ok && current > 0, qPrintable(type + " handle " + value));
+            QVERIFY2(handles.emplace(current, type).second, qPrintable("Duplicate handle " + value));
+        } else if (code == 330) {
+            QVERIFY2(current > 0, qPrintable(type + " has an owner but no handle before it"));
+            owners.emplace_back(type, value.toULongLong(nullptr, 16));
+        } else if (type == "TABLE" && code == 2) {
+            tables.append(value);
+        } else if (type == "BLOCK_RECORD" && code == 2) {
+            blockRecords.append(value);
+        } else if (type == "DICTIONARY" && code == 3) {
+            dictionaryEntries.append(value);
+        }
+    }
+
+    QCOMPARE(version, QString("AC1015"));
+    QCOMPARE(sections, QStringList({"HEADER", "CLASSES", "TABLES", "BLOCKS", "ENTITIES", "OBJECTS"}));
+    QCOMPARE(tables, QStringList({"VPORT", "LTYPE", "LAYER", "STYLE", "VIEW", "UCS", "APPID", "DIMSTYLE",
+                                  "BLOCK_RECORD"}));
+    QCOMPARE(blockRecords, QStringList({"*Model_Space", "*Paper_Space", "Tag"}));
+    QVERIFY(dictionaryEntries.contains("ACAD_GROUP"));
+
+    // Every entity, vertex and attribute has a handle below the seed
+    QVERIFY(!handles.empty());
+    QVERIFY(handleSeed > handles.rbegin()->first);
+    int lines = 0, vertices = 0, attributes = 0;
+    for (const auto& [handle, object] : handles) {
+        lines += object == "LINE" ? 1 : 0;
+        vertices += object == "VERTEX" ? 1 : 0;
+        attributes += object == "ATTRIB" ? 1 : 0;
+    }
+    QCOMPARE(lines, 201);                           // Block contents included
+    QCOMPARE(vertices, 3);
+    QCOMPARE(attributes, 1);
+
+    // Owners exist and have the right kind: block records for entities, parents for sub-entities
+    for (const auto& [object, owner] : owners) {
+        if (owner == 0) {
+            QVERIFY2(object == "TABLE" || object == "DICTIONARY", qPrintable(object + " without owner"));
+            continue;
+        }
+        const auto found = handles.find(owner);
+        QVERIFY2(found != handles.end(), qPrintable(object + " owned by a missing handle"));
+        if (object == "VERTEX") {
+            QCOMPARE(found->second, QString("POLYLINE"));
+        } else if (object == "ATTRIB") {
+            QCOMPARE(found->second, QString("INSERT"));
+        } else if (object == "SEQEND") {
+            QVERIFY(found->second == "POLYLINE" || found->second == "INSERT");
+        } else if (object == "LINE" || object == "INSERT" || object == "POLYLINE" || object == "BLOCK"
+                   || object == "ENDBLK" || object == "ATTDEF") {
+            QCOMPARE(found->second, QString("BLOCK_RECORD"));
+        }
+    }
+}
+
+void DxfRoundTripTest::truncated()
+{
+    for (int i = 0; i < 10; ++i) {
+        m_source->engine.addEntity(
+            makeEntity(CADEntity::Line, BRepBuilderAPI_MakeEdge(gp_Pnt(i, 0, 0), gp_Pnt(i, 10, 0)).Edge()));
+    }
+    const QString path = m_dir.filePath("truncated.dxf");
+    QVERIFY(DxfWriter(&m_source->engine, &m_source->layers, &m_source->blocks).write(path).success);
+
+    // Cut inside the ENTITIES section, on a line boundary so every group still parses
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray contents = file.readAll();
+    file.close();
+    const QByteArray cut = contents.left(contents.lastIndexOf("LINE\n") + 5);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(cut);
+    file.close();
+
+    // The drawing being replaced stays as it was
+    m_target->engine.addEntity(
+        makeEntity(CADEntity::Line, BRepBuilderAPI_MakeEdge(gp_Pnt(0, 0, 0), gp_Pnt(1, 1, 0)).Edge()));
+    bool cleared = false;
+    const DxfReadResult result = DxfReader(&m_target->engine, &m_target->layers, &m_target->blocks)
+                                     .read(path, [&cleared]() { cleared = true; });
+    QVERIFY(!result.success);
+    QVERIFY(!result.error.isEmpty());
+    QVERIFY(!cleared);
+    QCOMPARE(m_target->engine.getAllEntityIds().size(), size_t(1));
+}
+
+void DxfRoundTripTest::nearestAci()
+{
+    QCOMPARE(DxfWriter::nearestAci(QColor(Qt::red)), 1);
+    QCOMPARE(DxfWriter::nearestAci(QColor(Qt::white)), 7);
+    QCOMPARE(DxfWriter::nearestAci(QColor(250, 5, 3)), 1);
+    for (int index : {10, 35, 123, 211, 249, 252}) {
+        const QColor color = DxfReader::aciColor(index);
+        QCOMPARE(DxfReader::aciColor(DxfWriter::nearestAci(color)).rgb(), color.rgb());
+    }
+}
+
+QTEST_GUILESS_MAIN(DxfRoundTripTest)
+
+#include "DxfRoundTripTest.moc"
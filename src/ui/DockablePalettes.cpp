@@ -0,0 +1,283 @@
+#include "DockablePalettes.h"
+#include "CADApplication.h"
+#include "GeometryEngine.h"
+#include "LayerManager.h"
+#include "LayerTableModel.h"
+#include "SelectionPropertiesModel.h"
+
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMenu>
+#include <QSortFilterProxyModel>
+#include <QTableView>
+#include <QToolButton>
+#include <QTreeView>
+#include <QVBoxLayout>
+
+Q_LOGGING_CATEGORY(cadPalettes, "cad.palettes")
+
+// PropertiesPalette implementation
+PropertiesPalette::PropertiesPalette(QWidget* parent)
+    : QWidget(parent)
+    , m_layout(nullptr)
+    , m_headerLayout(nullptr)
+    , m_categorizeButton(nullptr)
+    , m_searchEdit(nullptr)
+    , m_statusLabel(nullptr)
+    , m_propertyView(nullptr)
+    , m_model(nullptr)
+    , m_filterModel(nullptr)
+    , m_categorized(true)
+{
+    setupUI();
+}
+
+PropertiesPalette::~PropertiesPalette() = default;
+
+void PropertiesPalette::setupUI()
+{
+    m_layout = new QVBoxLayout(this);
+    m_layout->setContentsMargins(2, 2, 2, 2);
+
+    m_headerLayout = new QHBoxLayout();
+    m_categorizeButton = new QToolButton();
+    m_categorizeButton->setText("Categorized");
+    m_categorizeButton->setCheckable(true);
+    m_categorizeButton->setChecked(m_categorized);
+    m_searchEdit = new QLineEdit();
+    m_searchEdit->setPlaceholderText("Search properties...");
+    m_headerLayout->addWidget(m_categorizeButton);
+    m_headerLayout->addWidget(m_searchEdit, 1);
+    m_layout->addLayout(m_headerLayout);
+
+    m_statusLabel = new QLabel("No selection");
+    m_layout->addWidget(m_statusLabel);
+
+    m_model = new SelectionPropertiesModel(CADApplication::instance()->geometryEngine(), this);
+    m_filterModel = new QSortFilterProxyModel(this);
+    m_filterModel->setSourceModel(m_model);
+    m_filterModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
+    m_filterModel->setRecursiveFilteringEnabled(true);
+    m_filterModel->setFilterKeyColumn(SelectionPropertiesModel::PropertyColumn);
+
+    m_propertyView = new QTreeView();
+    m_propertyView->setModel(m_filterModel);
+    m_propertyView->setUniformRowHeights(true);
+    m_propertyView->setAlternatingRowColors(true);
+    m_propertyView->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
+    m_layout->addWidget(m_propertyView, 1);
+
+    connect(m_categorizeButton, &QToolButton::toggled, this, &PropertiesPalette::onCategorizeToggled);
+    connect(m_searchEdit, &QLineEdit::textChanged, m_filterModel, &QSortFilterProxyModel::setFilterFixedString);
+    connect(m_model, &SelectionPropertiesModel::propertyEdited, this, &PropertiesPalette::propertyChanged);
+    connect(m_model, &SelectionPropertiesModel::aggregationStarted, this, &PropertiesPalette::onAggregationStarted);
+    connect(m_model, &SelectionPropertiesModel::aggregationFinished, this, &PropertiesPalette::onAggregationFinished);
+    connect(m_model, &QAbstractItemModel::modelReset, m_propertyView, &QTreeView::expandAll);
+}
+
+void PropertiesPalette::setSelectedObjects(const QList<int>& objectIds)
+{
+    m_selectedObjects = objectIds;
+    m_model->setSelection(std::vector<int>(objectIds.begin(), objectIds.end()));
+    if (objectIds.isEmpty()) {
+        m_statusLabel->setText("No selection");
+    }
+}
+
+void PropertiesPalette::clearSelection()
+{
+    setSelectedObjects(QList<int>());
+}
+
+void PropertiesPalette::refreshProperties()
+{
+    setSelectedObjects(m_selectedObjects);
+}
+
+void PropertiesPalette::onCategorizeToggled(bool categorized)
+{
+    // Uncategorized keeps every group open without expand arrows
+    m_categorized = categorized;
+    m_propertyView->setRootIsDecorated(categorized);
+    m_propertyView->setItemsExpandable(categorized);
+    m_propertyView->expandAll();
+}
+
+void PropertiesPalette::onAggregationStarted()
+{
+    m_statusLabel->setText(QString("%1 objects selected, computing...").arg(m_model->selectionSize()));
+}
+
+void PropertiesPalette::onAggregationFinished()
+{
+    m_statusLabel->setText(QString("%1 objects selected").arg(m_model->selectionSize()));
+}
+
+// LayerPalette implementation
+LayerPalette::LayerPalette(QWidget* parent)
+    : QWidget(parent)
+    , m_layout(nullptr)
+    , m_toolbarLayout(nullptr)
+    , m_newLayerButton(nullptr)
+    , m_deleteLayerButton(nullptr)
+    , m_setCurrentButton(nullptr)
+    , m_filterEdit(nullptr)
+    , m_layerView(nullptr)
+    , m_model(nullptr)
+    , m_filterModel(nullptr)
+    , m_layerManager(CADApplication::instance()->layerManager())
+{
+    setupUI();
+}
+
+LayerPalette::~LayerPalette() = default;
+
+void LayerPalette::setupUI()
+{
+    m_layout = new QVBoxLayout(this);
+    m_layout->setContentsMargins(2, 2, 2, 2);
+
+    m_toolbarLayout = new QHBoxLayout();
+    m_newLayerButton = new QToolButton();
+    m_newLayerButton->setIcon(QIcon(":/icons/layer_new.png"));
+    m_newLayerButton->setToolTip("New Layer");
+    m_deleteLayerButton = new QToolButton();
+    m_deleteLayerButton->setIcon(QIcon(":/icons/layer_delete.png"));
+    m_deleteLayerButton->setToolTip("Delete Layer");
+    m_setCurrentButton = new QToolButton();
+    m_setCurrentButton->setIcon(QIcon(":/icons/layer_current.png"));
+    m_setCurrentButton->setToolTip("Set Current");
+    m_toolbarLayout->addWidget(m_newLayerButton);
+    m_toolbarLayout->addWidget(m_deleteLayerButton);
+    m_filterEdit = new QLineEdit();
+    m_filterEdit->setPlaceholderText("Filter layers...");
+    m_filterEdit->setClearButtonEnabled(true);
+    m_toolbarLayout->addWidget(m_setCurrentButton);
+    m_toolbarLayout->addWidget(m_filterEdit, 1);
+    m_layout->addLayout(m_toolbarLayout);
+
+    m_model = new LayerTableModel(m_layerManager, this);
+    m_filterModel = new LayerFilterProxyModel(m_model, m_layerManager, this);
+
+    // Fixed row heights and column widths keep layout independent of the row count
+    m_layerView = new QTableView();
+    m_layerView->setModel(m_filterModel);
+    m_layerView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_layerView->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_layerView->setEditTriggers(QAbstractItemView::EditKeyPressed | QAbstractItemView::SelectedClicked);
+    m_layerView->setContextMenuPolicy(Qt::CustomContextMenu);
+    m_layerView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_layerView->verticalHeader()->setDefaultSectionSize(m_layerView->fontMetrics().height() + 6);
+    m_layerView->verticalHeader()->hide();
+    m_layerView->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    m_layerView->horizontalHeader()->setStretchLastSection(true);
+    m_layout->addWidget(m_layerView, 1);
+
+    connect(m_newLayerButton, &QToolButton::clicked, this, &LayerPalette::onNewLayer);
+    connect(m_deleteLayerButton, &QToolButton::clicked, this, &LayerPalette::onDeleteLayer);
+    connect(m_setCurrentButton, &QToolButton::clicked, this, [this]() {
+        setCurrentLayer(selectedLayer());
+    });
+    connect(m_filterEdit, &QLineEdit::textChanged, this, &LayerPalette::onFilterTextChanged);
+    connect(m_layerManager, &LayerManager::filterApplied, this, [this](const QString& filterName) {
+        m_filterEdit->setText(m_layerManager->getFilterCriteria(filterName));
+    });
+    connect(m_layerManager, &LayerManager::filterCleared, m_filterEdit, &QLineEdit::clear);
+    connect(m_layerView, &QTableView::doubleClicked, this, &LayerPalette::onLayerDoubleClicked);
+    connect(m_layerView, &QTableView::customContextMenuRequested, this, &LayerPalette::onLayerContextMenu);
+    connect(m_layerManager, &LayerManager::currentLayerChanged, this, &LayerPalette::layerChanged);
+    connect(m_layerManager, &LayerManager::layerCreated, this, &LayerPalette::layerCreated);
+    connect(m_layerManager, &LayerManager::layerDeleted, this, &LayerPalette::layerDeleted);
+}
+
+void LayerPalette::refreshLayers()
+{
+    m_model->reload();
+}
+
+void LayerPalette::setCurrentLayer(const QString& layerName)
+{
+    if (!layerName.isEmpty()) {
+        m_layerManager->setCurrentLayer(layerName);
+    }
+}
+
+QString LayerPalette::getCurrentLayer() const
+{
+    return m_layerManager->getCurrentLayer();
+}
+
+QString LayerPalette::selectedLayer() const
+{
+    const QModelIndexList rows = m_layerView->selectionModel()->selectedRows();
+    return rows.isEmpty() ? QString() : m_filterModel->layerAt(rows.first().row());
+}
+
+void LayerPalette::onNewLayer()
+{
+    // First free "Layer N"; existence checks are map lookups
+    int number = m_layerManager->getLayerCount();
+    QString name;
+    do {
+        name = QString("Layer%1").arg(number++);
+    } while (m_layerManager->layerExists(name));
+
+    if (m_layerManager->createLayer(name, LayerProperties(name))) {
+        // The new layer may not pass the current filter
+        const int row = m_filterModel->rowOf(name);
+        if (row >= 0) {
+            m_layerView->selectRow(row);
+            m_layerView->edit(m_filterModel->index(row, LayerTableModel::NameColumn));
+        }
+    }
+}
+
+void LayerPalette::onDeleteLayer()
+{
+    const QString name = selectedLayer();
+    if (!name.isEmpty() && !m_layerManager->deleteLayer(name)) {
+        qCWarning(cadPalettes) << "Cannot delete layer:" << name;
+    }
+}
+
+void LayerPalette::onLayerDoubleClicked(const QModelIndex& index)
+{
+    if (index.column() == LayerTableModel::CurrentColumn || index.column() == LayerTableModel::NameColumn) {
+        setCurrentLayer(m_filterModel->layerAt(index.row()));
+    }
+}
+
+void LayerPalette::onLayerContextMenu(const QPoint& position)
+{
+    const QModelIndex index = m_layerView->indexAt(position);
+    if (!index.isValid()) {
+        return;
+    }
+
+    const QString name = m_filterModel->layerAt(index.row());
+    QMenu menu(this);
+    menu.addAction("Set Current", this, [this, name]() { setCurrentLayer(name); });
+    menu.addAction("Rename", this, [this, index]() {
+        m_layerView->edit(m_filterModel->index(index.row(), LayerTableModel::NameColumn));
+    });
+    menu.addSeparator();
+    menu.addAction("Isolate", this, [this, name]() {
+        m_layerManager->freezeAllLayersExcept(name);
+    });
+    menu.addAction("Delete", this, [this, name]() {
+        if (!m_layerManager->deleteLayer(name)) {
+            qCWarning(cadPalettes) << "Cannot delete layer:" << name;
+        }
+    });
+    menu.exec(m_layerView->viewport()->mapToGlobal(position));
+}
+
+void LayerPalette::onFilterTextChanged(const QString& text)
+{
+    // Incomplete criteria while typing keep the last valid filter
+    QString error;
+    const bool valid = m_filterModel->setCriteria(text, &error);
+    m_filterEdit->setToolTip(valid ? QString() : error);
+}
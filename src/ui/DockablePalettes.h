@@ -19,11 +19,23 @@ class QSpinBox;
 class QCheckBox;
 class QGroupBox;
 class QTabWidget;
+class QTreeView;
+class QTableView;
+class QLabel;
+class QSortFilterProxyModel;
+class QModelIndex;
+class LayerManager;
+class LayerTableModel;
+class LayerFilterProxyModel;
+class SelectionPropertiesModel;
 
 Q_DECLARE_LOGGING_CATEGORY(cadPalettes)
 
 /**
  * @brief Properties palette for object inspection and editing
+ *
+ * Shows a SelectionPropertiesModel; large selections are aggregated off
+ * the GUI thread while the palette shows a status line.
  */
 class PropertiesPalette : public QWidget
 {
@@ -37,23 +49,27 @@ public:
     void clearSelection();
     void refreshProperties();
 
+    SelectionPropertiesModel* model() const { return m_model; }
+
 signals:
     void propertyChanged(const QString& property, const QVariant& value);
 
 private slots:
-    void onPropertyValueChanged();
     void onCategorizeToggled(bool categorized);
+    void onAggregationStarted();
+    void onAggregationFinished();
 
 private:
     void setupUI();
-    void populateProperties();
-    void addProperty(const QString& category, const QString& name, const QVariant& value, const QString& type = "string");
 
     QVBoxLayout* m_layout;
     QHBoxLayout* m_headerLayout;
     QToolButton* m_categorizeButton;
     QLineEdit* m_searchEdit;
-    QTreeWidget* m_propertyTree;
+    QLabel* m_statusLabel;
+    QTreeView* m_propertyView;
+    SelectionPropertiesModel* m_model;
+    QSortFilterProxyModel* m_filterModel;
     
     QList<int> m_selectedObjects;
     bool m_categorized;
@@ -61,6 +77,10 @@ private:
 
 /**
  * @brief Layer manager palette
+ *
+ * A virtualized table over LayerTableModel; rows are created only for the
+ * visible part of the layer list. The filter field takes LayerPredicate
+ * criteria and follows the manager's active filter.
  */
 class LayerPalette : public QWidget
 {
@@ -74,6 +94,8 @@ public:
     void setCurrentLayer(const QString& layerName);
     QString getCurrentLayer() const;
 
+    LayerTableModel* model() const { return m_model; }
+
 signals:
     void layerChanged(const QString& layerName);
     void layerCreated(const QString& layerName);
@@ -83,22 +105,24 @@ signals:
 private slots:
     void onNewLayer();
     void onDeleteLayer();
-    void onLayerDoubleClicked();
+    void onLayerDoubleClicked(const QModelIndex& index);
     void onLayerContextMenu(const QPoint& position);
+    void onFilterTextChanged(const QString& text);
 
 private:
     void setupUI();
-    void populateLayers();
-    void addLayer(const QString& name, bool visible, bool frozen, bool locked, const QColor& color, const QString& lineType);
+    QString selectedLayer() const;
 
     QVBoxLayout* m_layout;
     QHBoxLayout* m_toolbarLayout;
     QToolButton* m_newLayerButton;
     QToolButton* m_deleteLayerButton;
     QToolButton* m_setCurrentButton;
-    QTreeWidget* m_layerTree;
-    
-    QString m_currentLayer;
+    QLineEdit* m_filterEdit;
+    QTableView* m_layerView;
+    LayerTableModel* m_model;
+    LayerFilterProxyModel* m_filterModel;
+    LayerManager* m_layerManager;
 };
 
 /**
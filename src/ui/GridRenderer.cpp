@@ -0,0 +1,207 @@
+#include "GridRenderer.h"
+#include "Tracing.h"
+#include "RenderResources.h"
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QVector4D>
+
+Q_LOGGING_CATEGORY(cadGrid, "cad.grid")
+
+namespace {
+
+const char* const GridShaderName = "procedural_grid";
+
+const char* const GridVertexShader = R"(
+#version 450 core
+uniform mat4 u_inverseViewProjection;
+out vec3 v_nearPoint;
+out vec3 v_farPoint;
+
+vec3 unproject(vec2 ndc, float depth)
+{
+    vec4 p = u_inverseViewProjection * vec4(ndc, depth, 1.0);
+    return p.xyz / p.w;
+}
+
+void main()
+{
+    // One triangle covering the whole viewport, no vertex attributes
+    vec2 ndc = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+    v_nearPoint = unproject(ndc, -1.0);
+    v_farPoint = unproject(ndc, 1.0);
+    gl_Position = vec4(ndc, 0.0, 1.0);
+}
+)";
+
+const char* const GridFragmentShader = R"(
+#version 450 core
+in vec3 v_nearPoint;
+in vec3 v_farPoint;
+out vec4 fragColor;
+
+uniform mat4 u_viewProjection;
+uniform int u_plane;
+uniform float u_spacing;
+uniform float u_majorEvery;
+uniform float u_minPixels;
+uniform vec4 u_minorColor;
+uniform vec4 u_majorColor;
+uniform vec4 u_xAxisColor;
+uniform vec4 u_yAxisColor;
+
+vec2 planeCoords(vec3 p) { return u_plane == 0 ? p.xy : (u_plane == 1 ? p.xz : p.yz); }
+float planeHeight(vec3 p) { return u_plane == 0 ? p.z : (u_plane == 1 ? p.y : p.x); }
+
+// Anti-aliased line coverage for a grid of the given cell size
+float coverage(vec2 coord, vec2 pixel, float cell)
+{
+    vec2 g = abs(fract(coord / cell - 0.5) - 0.5) * cell / pixel;
+    return 1.0 - min(min(g.x, g.y), 1.0);
+}
+
+void main()
+{
+    float nearHeight = planeHeight(v_nearPoint);
+    float farHeight = planeHeight(v_farPoint);
+    float denom = farHeight - nearHeight;
+    float t = abs(denom) > 1e-12 ? -nearHeight / denom : -1.0;
+
+    vec3 p = mix(v_nearPoint, v_farPoint, t);
+    vec2 coord = planeCoords(p);
+
+    // Derivatives are taken before any discard so neighbouring pixels stay valid
+    vec2 pixel = max(fwidth(coord), vec2(1e-12));
+    float worldPerPixel = max(pixel.x, pixel.y);
+
+    if (t < 0.0 || t > 1.0) {
+        discard;
+    }
+
+    // Fractional level: 0 when the base spacing is exactly u_minPixels wide
+    float lod = max(0.0, log(u_minPixels * worldPerPixel / u_spacing) / log(u_majorEvery));
+    float level = floor(lod);
+    float fade = lod - level;
+
+    float cell0 = u_spacing * pow(u_majorEvery, level);
+    float cell1 = cell0 * u_majorEvery;
+    float cell2 = cell1 * u_majorEvery;
+
+    float c0 = coverage(coord, pixel, cell0) * (1.0 - fade);
+    float c1 = coverage(coord, pixel, cell1);
+    float c2 = coverage(coord, pixel, cell2);
+
+    // Level 1 lines turn from minor into major as level 0 fades out
+    vec4 color = vec4(u_minorColor.rgb, u_minorColor.a * c0);
+    vec4 promoted = mix(u_minorColor, u_majorColor, fade);
+    if (c1 > 0.0) {
+        color = vec4(promoted.rgb, max(color.a, promoted.a * c1));
+    }
+    if (c2 > 0.0) {
+        color = vec4(u_majorColor.rgb, max(color.a, u_majorColor.a * c2));
+    }
+
+    // Principal axes through the origin
+    vec2 axis = abs(coord) / pixel;
+    if (axis.y < 1.0) {
+        color = vec4(u_xAxisColor.rgb, max(color.a, u_xAxisColor.a * (1.0 - axis.y)));
+    }
+    if (axis.x < 1.0) {
+        color = vec4(u_yAxisColor.rgb, max(color.a, u_yAxisColor.a * (1.0 - axis.x)));
+    }
+
+    // Fade towards the horizon where lines would alias in grazing views
+    vec3 ray = normalize(v_farPoint - v_nearPoint);
+    vec3 normal = u_plane == 0 ? vec3(0, 0, 1) : (u_plane == 1 ? vec3(0, 1, 0) : vec3(1, 0, 0));
+    color.a *= clamp(abs(dot(ray, normal)) * 4.0, 0.0, 1.0);
+
+    if (color.a <= 0.001) {
+        discard;
+    }
+
+    vec4 clip = u_viewProjection * vec4(p, 1.0);
+    gl_FragDepth = clamp(clip.z / clip.w * 0.5 + 0.5, 0.0, 1.0);
+    fragColor = color;
+}
+)";
+
+QVector4D toVector(const QColor& color)
+{
+    return QVector4D(color.redF(), color.greenF(), color.blueF(), color.alphaF());
+}
+
+} // namespace
+
+GridRenderer::GridRenderer() = default;
+
+GridRenderer::~GridRenderer() = default;
+
+void GridRenderer::registerShader()
+{
+    SharedRenderResources* resources = SharedRenderResources::instance();
+    if (!resources->hasShader(GridShaderName)) {
+        resources->registerShader(GridShaderName, GridVertexShader, GridFragmentShader);
+    }
+}
+
+void GridRenderer::initialize()
+{
+    registerShader();
+
+    m_vao = std::make_unique<QOpenGLVertexArrayObject>();
+    if (!m_vao->create()) {
+        qCWarning(cadGrid) << "Failed to create grid vertex array";
+        m_vao.reset();
+    }
+}
+
+void GridRenderer::cleanup()
+{
+    m_vao.reset();
+}
+
+void GridRenderer::render(const QMatrix4x4& viewProjection, Plane plane)
+{
+    CAD_TRACE_SCOPE("render", "grid");
+
+    if (!m_vao) {
+        return;
+    }
+
+    QOpenGLShaderProgram* program = SharedRenderResources::instance()->shaderProgram(GridShaderName);
+    if (!program || !program->bind()) {
+        return;
+    }
+
+    bool invertible = false;
+    QMatrix4x4 inverse = viewProjection.inverted(&invertible);
+    if (!invertible) {
+        program->release();
+        return;
+    }
+
+    program->setUniformValue("u_inverseViewProjection", inverse);
+    program->setUniformValue("u_viewProjection", viewProjection);
+    program->setUniformValue("u_plane", static_cast<int>(plane));
+    program->setUniformValue("u_spacing", static_cast<float>(qMax(m_settings.spacing, 1e-9)));
+    program->setUniformValue("u_majorEvery", static_cast<float>(qMax(m_settings.majorEvery, 2)));
+    program->setUniformValue("u_minPixels", static_cast<float>(qMax(m_settings.minPixelSpacing, 1.0)));
+    program->setUniformValue("u_minorColor", toVector(m_settings.minorColor));
+    program->setUniformValue("u_majorColor", toVector(m_settings.majorColor));
+    program->setUniformValue("u_xAxisColor", toVector(m_settings.xAxisColor));
+    program->setUniformValue("u_yAxisColor", toVector(m_settings.yAxisColor));
+
+    QOpenGLFunctions* gl = QOpenGLContext::currentContext()->functions();
+    gl->glEnable(GL_BLEND);
+    gl->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl->glDepthMask(GL_FALSE);
+
+    m_vao->bind();
+    gl->glDrawArrays(GL_TRIANGLES, 0, 3);
+    m_vao->release();
+
+    gl->glDepthMask(GL_TRUE);
+    gl->glDisable(GL_BLEND);
+    program->release();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QColor>
+#include <QMatrix4x4>
+#include <QLoggingCategory>
+#include <memory>
+
+class QOpenGLVertexArrayObject;
+
+Q_DECLARE_LOGGING_CATEGORY(cadGrid)
+
+/**
+ * @brief Procedural drawing grid rendered as a single full-screen pass
+ *
+ * No grid geometry exists on the CPU or GPU:
+ * - The vertex stage emits one oversized triangle and unprojects each
+ *   corner to a near/far ray
+ * - The fragment stage intersects the ray with the grid plane and derives
+ *   line coverage analytically from screen-space derivatives
+ * - The visible level is chosen per pixel from the world size of a pixel,
+ *   so minor lines fade into major lines as the view zooms out
+ *
+ * Cost is one triangle and a fixed amount of fragment work, independent of
+ * drawing extents and grid spacing. The shader program is shared through
+ * SharedRenderResources; only the (non-shareable) VAO is per viewport.
+ */
+class GridRenderer
+{
+public:
+    enum Plane {
+        PlaneXY,        // Top, bottom and isometric views
+        PlaneXZ,        // Front and back views
+        PlaneYZ         // Left and right views
+    };
+
+    struct Settings {
+        double spacing;             // Finest grid cell in world units
+        int majorEvery;             // Minor cells per major cell, also the zoom step
+        double minPixelSpacing;     // Lines closer than this fade out
+        QColor minorColor;
+        QColor majorColor;
+        QColor xAxisColor;
+        QColor yAxisColor;
+
+        Settings()
+            : spacing(10.0), majorEvery(10), minPixelSpacing(8.0)
+            , minorColor(80, 80, 80, 110), majorColor(110, 110, 110, 200)
+            , xAxisColor(200, 70, 70, 230), yAxisColor(70, 200, 70, 230) {}
+    };
+
+    GridRenderer();
+    ~GridRenderer();
+
+    // Must be called with the viewport's context current
+    void initialize();
+    void cleanup();
+
+    void render(const QMatrix4x4& viewProjection, Plane plane);
+
+    Settings& settings() { return m_settings; }
+    const Settings& settings() const { return m_settings; }
+
+private:
+    static void registerShader();
+
+    Settings m_settings;
+    std::unique_ptr<QOpenGLVertexArrayObject> m_vao;
+};
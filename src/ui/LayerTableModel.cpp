@@ -0,0 +1,353 @@
+#include "LayerTableModel.h"
+#include <QTimer>
+#include <algorithm>
+
+LayerTableModel::LayerTableModel(LayerManager* layerManager, QObject* parent)
+    : QAbstractTableModel(parent)
+    , m_layerManager(layerManager)
+    , m_cachedRow(-1)
+    , m_dirtyFirst(-1)
+    , m_dirtyLast(-1)
+    , m_flushPending(false)
+{
+    connect(m_layerManager, &LayerManager::layerCreated, this, &LayerTableModel::onLayerCreated);
+    connect(m_layerManager, &LayerManager::layerDeleted, this, &LayerTableModel::onLayerDeleted);
+    connect(m_layerManager, &LayerManager::layerRenamed, this, &LayerTableModel::onLayerRenamed);
+    connect(m_layerManager, &LayerManager::currentLayerChanged, this, &LayerTableModel::onCurrentLayerChanged);
+    connect(m_layerManager, &LayerManager::layerPropertiesChanged, this,
+            [this](const QString& name, const LayerProperties&) { onLayerChanged(name); });
+    connect(m_layerManager, &LayerManager::layerVisibilityChanged, this,
+            [this](const QString& name, bool) { onLayerChanged(name); });
+    connect(m_layerManager, &LayerManager::layerFrozenChanged, this,
+            [this](const QString& name, bool) { onLayerChanged(name); });
+    connect(m_layerManager, &LayerManager::layerLockedChanged, this,
+            [this](const QString& name, bool) { onLayerChanged(name); });
+
+    reload();
+}
+
+LayerTableModel::~LayerTableModel() = default;
+
+void LayerTableModel::reload()
+{
+    beginResetModel();
+    m_names = m_layerManager->getLayerNames();
+    m_currentLayer = m_layerManager->getCurrentLayer();
+    m_cachedRow = -1;
+    m_dirtyFirst = m_dirtyLast = -1;
+    endResetModel();
+}
+
+int LayerTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_names.size();
+}
+
+int LayerTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QString LayerTableModel::layerAt(int row) const
+{
+    return row >= 0 && row < m_names.size() ? m_names[row] : QString();
+}
+
+int LayerTableModel::rowOf(const QString& layerName) const
+{
+    // Names are kept in the manager's (std::map) order
+    auto it = std::lower_bound(m_names.cbegin(), m_names.cend(), layerName);
+    return it != m_names.cend() && *it == layerName ? static_cast<int>(it - m_names.cbegin()) : -1;
+}
+
+int LayerTableModel::insertionRow(const QString& name) const
+{
+    return static_cast<int>(std::lower_bound(m_names.cbegin(), m_names.cend(), name) - m_names.cbegin());
+}
+
+const LayerProperties& LayerTableModel::propertiesAt(int row) const
+{
+    if (row != m_cachedRow) {
+        m_cachedProperties = m_layerManager->getLayerProperties(m_names[row]);
+        m_cachedRow = row;
+    }
+    return m_cachedProperties;
+}
+
+QVariant LayerTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_names.size()) {
+        return QVariant();
+    }
+
+    const int column = index.column();
+    if (column == CurrentColumn) {
+        if (role == Qt::DisplayRole) {
+            return m_names[index.row()] == m_currentLayer ? QStringLiteral("Current") : QString();
+        }
+        return QVariant();
+    }
+
+    const LayerProperties& layer = propertiesAt(index.row());
+
+    if (role == Qt::CheckStateRole) {
+        switch (column) {
+        case OnColumn: return layer.visible ? Qt::Checked : Qt::Unchecked;
+        case FreezeColumn: return layer.frozen ? Qt::Checked : Qt::Unchecked;
+        case LockColumn: return layer.locked ? Qt::Checked : Qt::Unchecked;
+        case PlotColumn: return layer.plottable ? Qt::Checked : Qt::Unchecked;
+        default: return QVariant();
+        }
+    }
+
+    if (role == Qt::DecorationRole && column == ColorColumn) {
+        return layer.color;
+    }
+
+    if (role == Qt::DisplayRole || role == Qt::EditRole) {
+        switch (column) {
+        case NameColumn: return layer.name.isEmpty() ? m_names[index.row()] : layer.name;
+        case ColorColumn: return role == Qt::EditRole ? QVariant(layer.color) : QVariant(layer.color.name());
+        case LineTypeColumn: return layer.lineType;
+        case LineWeightColumn:
+            return role == Qt::EditRole ? QVariant(layer.lineWeight) : QVariant(QString("%1 mm").arg(layer.lineWeight, 0, 'f', 2));
+        case DescriptionColumn: return layer.description;
+        default: return QVariant();
+        }
+    }
+
+    return QVariant();
+}
+
+QVariant LayerTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (section) {
+    case CurrentColumn: return QStringLiteral("Status");
+    case NameColumn: return QStringLiteral("Name");
+    case OnColumn: return QStringLiteral("On");
+    case FreezeColumn: return QStringLiteral("Freeze");
+    case LockColumn: return QStringLiteral("Lock");
+    case PlotColumn: return QStringLiteral("Plot");
+    case ColorColumn: return QStringLiteral("Color");
+    case LineTypeColumn: return QStringLiteral("Linetype");
+    case LineWeightColumn: return QStringLiteral("Lineweight");
+    case DescriptionColumn: return QStringLiteral("Description");
+    default: return QVariant();
+    }
+}
+
+Qt::ItemFlags LayerTableModel::flags(const QModelIndex& index) const
+{
+    Qt::ItemFlags flags = QAbstractTableModel::flags(index);
+    switch (index.column()) {
+    case OnColumn:
+    case FreezeColumn:
+    case LockColumn:
+    case PlotColumn:
+        flags |= Qt::ItemIsUserCheckable;
+        break;
+    case NameColumn:
+    case ColorColumn:
+    case LineTypeColumn:
+    case LineWeightColumn:
+    case DescriptionColumn:
+        flags |= Qt::ItemIsEditable;
+        break;
+    default:
+        break;
+    }
+    return flags;
+}
+
+bool LayerTableModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (!index.isValid() || index.row() >= m_names.size()) {
+        return false;
+    }
+
+    // The manager's change signals update the row
+    const QString name = m_names[index.row()];
+    if (role == Qt::CheckStateRole) {
+        const bool checked = value.toInt() == Qt::Checked;
+        switch (index.column()) {
+        case OnColumn: return m_layerManager->setLayerVisible(name, checked);
+        case FreezeColumn: return m_layerManager->setLayerFrozen(name, checked);
+        case LockColumn: return m_layerManager->setLayerLocked(name, checked);
+        case PlotColumn: return m_layerManager->setLayerPlottable(name, checked);
+        default: return false;
+        }
+    }
+
+    if (role != Qt::EditRole) {
+        return false;
+    }
+
+    switch (index.column()) {
+    case NameColumn: return value.toString() != name && m_layerManager->renameLayer(name, value.toString());
+    case ColorColumn: return m_layerManager->setLayerColor(name, value.value<QColor>());
+    case LineTypeColumn: return m_layerManager->setLayerLineType(name, value.toString());
+    case LineWeightColumn: return m_layerManager->setLayerLineWeight(name, value.toDouble());
+    case DescriptionColumn: return m_layerManager->setLayerDescription(name, value.toString());
+    default: return false;
+    }
+}
+
+void LayerTableModel::onLayerCreated(const QString& name)
+{
+    if (rowOf(name) >= 0) {
+        return;
+    }
+
+    flushChangedRows();
+    const int row = insertionRow(name);
+    beginInsertRows(QModelIndex(), row, row);
+    m_names.insert(row, name);
+    m_cachedRow = -1;
+    endInsertRows();
+}
+
+void LayerTableModel::onLayerDeleted(const QString& name)
+{
+    const int row = rowOf(name);
+    if (row < 0) {
+        return;
+    }
+
+    flushChangedRows();
+    beginRemoveRows(QModelIndex(), row, row);
+    m_names.removeAt(row);
+    m_cachedRow = -1;
+    endRemoveRows();
+}
+
+void LayerTableModel::onLayerRenamed(const QString& oldName, const QString& newName)
+{
+    const int row = rowOf(oldName);
+    if (row < 0) {
+        onLayerCreated(newName);
+        return;
+    }
+
+    flushChangedRows();
+    m_cachedRow = -1;
+    if (m_currentLayer == oldName) {
+        m_currentLayer = newName;
+    }
+
+    // Target position in the list without the old entry
+    QStringList remaining = m_names;
+    remaining.removeAt(row);
+    const int target = static_cast<int>(std::lower_bound(remaining.cbegin(), remaining.cend(), newName) - remaining.cbegin());
+
+    if (target == row) {
+        m_names[row] = newName;
+        emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+        return;
+    }
+
+    // beginMoveRows takes the destination in pre-move coordinates
+    const int destination = target > row ? target + 1 : target;
+    beginMoveRows(QModelIndex(), row, row, QModelIndex(), destination);
+    m_names.removeAt(row);
+    m_names.insert(target, newName);
+    endMoveRows();
+    emit dataChanged(index(target, 0), index(target, ColumnCount - 1));
+}
+
+void LayerTableModel::onLayerChanged(const QString& name)
+{
+    const int row = rowOf(name);
+    if (row == m_cachedRow) {
+        m_cachedRow = -1;
+    }
+    markRowChanged(row);
+}
+
+void LayerTableModel::onCurrentLayerChanged(const QString& name)
+{
+    const QString previous = m_currentLayer;
+    m_currentLayer = name;
+    markRowChanged(rowOf(previous));
+    markRowChanged(rowOf(name));
+}
+
+void LayerTableModel::markRowChanged(int row)
+{
+    if (row < 0) {
+        return;
+    }
+
+    if (m_dirtyFirst < 0) {
+        m_dirtyFirst = m_dirtyLast = row;
+    } else {
+        m_dirtyFirst = std::min(m_dirtyFirst, row);
+        m_dirtyLast = std::max(m_dirtyLast, row);
+    }
+
+    if (!m_flushPending) {
+        m_flushPending = true;
+        QTimer::singleShot(0, this, &LayerTableModel::flushChangedRows);
+    }
+}
+
+void LayerTableModel::flushChangedRows()
+{
+    m_flushPending = false;
+    if (m_dirtyFirst < 0) {
+        return;
+    }
+
+    const int first = m_dirtyFirst;
+    const int last = std::min(m_dirtyLast, static_cast<int>(m_names.size()) - 1);
+    m_dirtyFirst = m_dirtyLast = -1;
+    m_cachedRow = -1;
+
+    if (first <= last) {
+        emit dataChanged(index(first, 0), index(last, ColumnCount - 1));
+    }
+}
+
+// LayerFilterProxyModel implementation
+LayerFilterProxyModel::LayerFilterProxyModel(LayerTableModel* model, LayerManager* layerManager, QObject* parent)
+    : QSortFilterProxyModel(parent)
+    , m_model(model)
+    , m_layerManager(layerManager)
+{
+    setSourceModel(m_model);
+}
+
+bool LayerFilterProxyModel::setCriteria(const QString& criteria, QString* error)
+{
+    LayerPredicate predicate = LayerPredicate::compile(criteria, error);
+    if (!predicate.isValid()) {
+        return false;
+    }
+    if (predicate.criteria() == m_predicate.criteria()) {
+        return true;
+    }
+
+    m_predicate = std::move(predicate);
+    invalidateRowsFilter();
+    return true;
+}
+
+QString LayerFilterProxyModel::layerAt(int row) const
+{
+    return m_model->layerAt(mapToSource(index(row, 0)).row());
+}
+
+int LayerFilterProxyModel::rowOf(const QString& layerName) const
+{
+    const int sourceRow = m_model->rowOf(layerName);
+    return sourceRow < 0 ? -1 : mapFromSource(m_model->index(sourceRow, 0)).row();
+}
+
+bool LayerFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
+{
+    Q_UNUSED(sourceParent);
+    return m_predicate.matchesAll() || m_layerManager->layerMatches(m_model->layerAt(sourceRow), m_predicate);
+}
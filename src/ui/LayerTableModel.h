@@ -0,0 +1,107 @@
+#pragma once
+
+#include "LayerManager.h"
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QStringList>
+
+/**
+ * @brief Table model over the layers of a LayerManager
+ *
+ * Rows hold only layer names, in the manager's order; cell data is read
+ * from the manager when a view asks for it, so only visible rows are ever
+ * touched. Manager signals become row inserts, removals, moves and
+ * dataChanged ranges. Property changes are coalesced per event loop pass,
+ * so bulk operations over thousands of layers produce one update.
+ */
+class LayerTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        CurrentColumn,
+        NameColumn,
+        OnColumn,
+        FreezeColumn,
+        LockColumn,
+        PlotColumn,
+        ColorColumn,
+        LineTypeColumn,
+        LineWeightColumn,
+        DescriptionColumn,
+        ColumnCount
+    };
+
+    explicit LayerTableModel(LayerManager* layerManager, QObject* parent = nullptr);
+    ~LayerTableModel();
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+
+    QString layerAt(int row) const;
+    int rowOf(const QString& layerName) const;
+
+    // Full resynchronization, e.g. after a layer standard was loaded
+    void reload();
+
+private slots:
+    void onLayerCreated(const QString& name);
+    void onLayerDeleted(const QString& name);
+    void onLayerRenamed(const QString& oldName, const QString& newName);
+    void onLayerChanged(const QString& name);
+    void onCurrentLayerChanged(const QString& name);
+
+private:
+    int insertionRow(const QString& name) const;
+    const LayerProperties& propertiesAt(int row) const;
+    void markRowChanged(int row);
+    void flushChangedRows();
+
+    LayerManager* m_layerManager;
+    QStringList m_names;
+    QString m_currentLayer;
+
+    // Views read a row's cells back to back; keep the last fetched row
+    mutable int m_cachedRow;
+    mutable LayerProperties m_cachedProperties;
+
+    // Pending dataChanged range
+    int m_dirtyFirst;
+    int m_dirtyLast;
+    bool m_flushPending;
+};
+
+/**
+ * @brief Filters LayerTableModel rows by compiled layer filter criteria
+ *
+ * The criteria are compiled once per change; each row test is then a
+ * lookup into the manager's columnar layer table. Row updates re-test only
+ * the rows reported by dataChanged.
+ */
+class LayerFilterProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit LayerFilterProxyModel(LayerTableModel* model, LayerManager* layerManager, QObject* parent = nullptr);
+
+    // Returns false, keeping the previous filter, if the criteria do not compile
+    bool setCriteria(const QString& criteria, QString* error = nullptr);
+    QString criteria() const { return m_predicate.criteria(); }
+
+    QString layerAt(int row) const;
+    int rowOf(const QString& layerName) const;
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
+
+private:
+    LayerTableModel* m_model;
+    LayerManager* m_layerManager;
+    LayerPredicate m_predicate;
+};
@@ -0,0 +1,449 @@
+#include "RenderResources.h"
+#include "Tracing.h"
+#include "GeometryEngine.h"
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLContext>
+
+// Tessellation
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepAdaptor_Curve.hxx>
+#include <BRep_Tool.hxx>
+#include <GCPnts_TangentialDeflection.hxx>
+#include <Poly_Triangulation.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Face.hxx>
+#include <TopoDS_Edge.hxx>
+#include <gp.hxx>
+
+Q_LOGGING_CATEGORY(cadRenderResources, "cad.render.resources")
+
+SharedRenderResources* SharedRenderResources::s_instance = nullptr;
+
+MeshBuffers::MeshBuffers()
+    : indexCount(0)
+    , edgeVertexCount(0)
+    , gpuBytes(0)
+{
+}
+
+MeshBuffers::~MeshBuffers() = default;
+
+SharedRenderResources::SharedRenderResources(QObject* parent)
+    : QObject(parent)
+    , m_geometryEngine(nullptr)
+    , m_linearDeflection(0.1)
+    , m_angularDeflection(0.5)
+    , m_viewportRefs(0)
+    , m_tessellationBytes(0)
+    , m_gpuBytes(0)
+    , m_uploadCount(0)
+    , m_tessellationCount(0)
+{
+    qCDebug(cadRenderResources) << "Shared render resources created";
+}
+
+SharedRenderResources::~SharedRenderResources()
+{
+    clear();
+    qCDebug(cadRenderResources) << "Shared render resources destroyed";
+}
+
+SharedRenderResources* SharedRenderResources::instance()
+{
+    if (!s_instance) {
+        s_instance = new SharedRenderResources();
+    }
+    return s_instance;
+}
+
+void SharedRenderResources::destroyInstance()
+{
+    delete s_instance;
+    s_instance = nullptr;
+}
+
+void SharedRenderResources::attachGeometryEngine(GeometryEngine* engine)
+{
+    if (!engine) {
+        return;
+    }
+
+    m_geometryEngine = engine;
+    connect(engine, &GeometryEngine::entityAdded, this, &SharedRenderResources::onEntityAdded);
+    connect(engine, &GeometryEngine::entitiesAdded, this, &SharedRenderResources::onEntitiesAdded);
+    connect(engine, &GeometryEngine::entityModified, this, &SharedRenderResources::onEntityChanged);
+    connect(engine, &GeometryEngine::entityRemoved, this, &SharedRenderResources::onEntityRemoved);
+    connect(engine, &GeometryEngine::entitiesCleared, this, &SharedRenderResources::onEntitiesCleared);
+
+    m_hiddenLineRemoval = std::make_unique<HiddenLineRemoval>(engine);
+
+    m_sceneBVH.clear();
+    for (int entityId : engine->getAllEntityIds()) {
+        updateEntityBounds(entityId);
+    }
+}
+
+// Shader programs
+void SharedRenderResources::registerShader(const QString& name, const QString& vertexSource, const QString& fragmentSource)
+{
+    ShaderSource source;
+    source.vertex = vertexSource;
+    source.fragment = fragmentSource;
+    m_shaderSources[name] = source;
+
+    // Force recompilation on next use
+    delete m_shaderPrograms.take(name);
+}
+
+QOpenGLShaderProgram* SharedRenderResources::shaderProgram(const QString& name)
+{
+    auto it = m_shaderPrograms.find(name);
+    if (it != m_shaderPrograms.end()) {
+        return it.value();
+    }
+
+    auto sourceIt = m_shaderSources.find(name);
+    if (sourceIt == m_shaderSources.end()) {
+        qCWarning(cadRenderResources) << "Shader not registered:" << name;
+        return nullptr;
+    }
+
+    if (!QOpenGLContext::currentContext()) {
+        qCWarning(cadRenderResources) << "Cannot compile shader without a current context:" << name;
+        return nullptr;
+    }
+
+    auto program = std::make_unique<QOpenGLShaderProgram>();
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, sourceIt->vertex) ||
+        !program->addShaderFromSourceCode(QOpenGLShader::Fragment, sourceIt->fragment) ||
+        !program->link()) {
+        qCWarning(cadRenderResources) << "Failed to build shader" << name << ":" << program->log();
+        return nullptr;
+    }
+
+    qCDebug(cadRenderResources) << "Shader compiled:" << name;
+    QOpenGLShaderProgram* result = program.release();
+    m_shaderPrograms.insert(name, result);
+    return result;
+}
+
+// Tessellation
+void SharedRenderResources::setDeflection(double linear, double angular)
+{
+    if (linear == m_linearDeflection && angular == m_angularDeflection) {
+        return;
+    }
+
+    m_linearDeflection = linear;
+    m_angularDeflection = angular;
+
+    // Existing tessellations were computed for the old tolerance
+    m_tessellations.clear();
+    m_tessellationBytes = 0;
+    releaseGpu();
+}
+
+const TessellatedMesh* SharedRenderResources::tessellation(int entityId, const TopoDS_Shape& shape)
+{
+    auto it = m_tessellations.find(entityId);
+    if (it != m_tessellations.end()) {
+        return it->second.get();
+    }
+
+    if (shape.IsNull()) {
+        return nullptr;
+    }
+
+    auto mesh = std::make_unique<TessellatedMesh>(tessellate(shape, m_linearDeflection, m_angularDeflection));
+    m_tessellationBytes += mesh->byteSize();
+    ++m_tessellationCount;
+
+    const TessellatedMesh* result = mesh.get();
+    m_tessellations[entityId] = std::move(mesh);
+    return result;
+}
+
+TessellatedMesh SharedRenderResources::tessellate(const TopoDS_Shape& shape, double linearDeflection, double angularDeflection)
+{
+    CAD_TRACE_SCOPE("render", "tessellate");
+
+    TessellatedMesh mesh;
+    mesh.deflection = linearDeflection;
+
+    BRepMesh_IncrementalMesh mesher(shape, linearDeflection, Standard_False, angularDeflection, Standard_True);
+
+    // Faces
+    for (TopExp_Explorer faceExp(shape, TopAbs_FACE); faceExp.More(); faceExp.Next()) {
+        const TopoDS_Face& face = TopoDS::Face(faceExp.Current());
+        TopLoc_Location location;
+        Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(face, location);
+        if (triangulation.IsNull()) {
+            continue;
+        }
+
+        const gp_Trsf& trsf = location.Transformation();
+        bool reversed = face.Orientation() == TopAbs_REVERSED;
+        unsigned int base = static_cast<unsigned int>(mesh.triangleVertices.size() / 3);
+        size_t normalBase = mesh.triangleNormals.size();
+
+        for (int i = 1; i <= triangulation->NbNodes(); ++i) {
+            gp_Pnt p = triangulation->Node(i).Transformed(trsf);
+            mesh.triangleVertices.push_back(static_cast<float>(p.X()));
+            mesh.triangleVertices.push_back(static_cast<float>(p.Y()));
+            mesh.triangleVertices.push_back(static_cast<float>(p.Z()));
+            mesh.triangleNormals.insert(mesh.triangleNormals.end(), {0.0f, 0.0f, 0.0f});
+        }
+
+        for (int i = 1; i <= triangulation->NbTriangles(); ++i) {
+            int n1, n2, n3;
+            triangulation->Triangle(i).Get(n1, n2, n3);
+            if (reversed) {
+                std::swap(n2, n3);
+            }
+
+            // Accumulate face normals per node, normalized below
+            gp_Pnt p1 = triangulation->Node(n1).Transformed(trsf);
+            gp_Pnt p2 = triangulation->Node(n2).Transformed(trsf);
+            gp_Pnt p3 = triangulation->Node(n3).Transformed(trsf);
+            gp_Vec normal = gp_Vec(p1, p2).Crossed(gp_Vec(p1, p3));
+            for (int node : {n1, n2, n3}) {
+                size_t offset = normalBase + static_cast<size_t>(node - 1) * 3;
+                mesh.triangleNormals[offset] += static_cast<float>(normal.X());
+                mesh.triangleNormals[offset + 1] += static_cast<float>(normal.Y());
+                mesh.triangleNormals[offset + 2] += static_cast<float>(normal.Z());
+            }
+
+            mesh.triangleIndices.push_back(base + n1 - 1);
+            mesh.triangleIndices.push_back(base + n2 - 1);
+            mesh.triangleIndices.push_back(base + n3 - 1);
+        }
+    }
+
+    for (size_t i = 0; i + 2 < mesh.triangleNormals.size(); i += 3) {
+        gp_Vec n(mesh.triangleNormals[i], mesh.triangleNormals[i + 1], mesh.triangleNormals[i + 2]);
+        if (n.Magnitude() > gp::Resolution()) {
+            n.Normalize();
+        }
+        mesh.triangleNormals[i] = static_cast<float>(n.X());
+        mesh.triangleNormals[i + 1] = static_cast<float>(n.Y());
+        mesh.triangleNormals[i + 2] = static_cast<float>(n.Z());
+    }
+
+    // Edges
+    for (TopExp_Explorer edgeExp(shape, TopAbs_EDGE); edgeExp.More(); edgeExp.Next()) {
+        const TopoDS_Edge& edge = TopoDS::Edge(edgeExp.Current());
+        if (BRep_Tool::Degenerated(edge)) {
+            continue;
+        }
+
+        BRepAdaptor_Curve curve(edge);
+        GCPnts_TangentialDeflection discretizer(curve, angularDeflection, linearDeflection);
+        for (int i = 1; i < discretizer.NbPoints(); ++i) {
+            gp_Pnt a = discretizer.Value(i);
+            gp_Pnt b = discretizer.Value(i + 1);
+            mesh.edgeVertices.insert(mesh.edgeVertices.end(), {
+                static_cast<float>(a.X()), static_cast<float>(a.Y()), static_cast<float>(a.Z()),
+                static_cast<float>(b.X()), static_cast<float>(b.Y()), static_cast<float>(b.Z())
+            });
+        }
+    }
+
+    return mesh;
+}
+
+// Mesh buffers
+MeshBuffers* SharedRenderResources::meshBuffers(int entityId, const TopoDS_Shape& shape)
+{
+    CAD_TRACE_SCOPE("render", "meshBuffers");
+
+    auto it = m_meshBuffers.find(entityId);
+    if (it != m_meshBuffers.end()) {
+        return it->second.get();
+    }
+
+    if (!QOpenGLContext::currentContext()) {
+        qCWarning(cadRenderResources) << "Cannot upload mesh without a current context:" << entityId;
+        return nullptr;
+    }
+
+    const TessellatedMesh* mesh = tessellation(entityId, shape);
+    if (!mesh) {
+        return nullptr;
+    }
+
+    auto upload = [](std::unique_ptr<QOpenGLBuffer>& buffer, QOpenGLBuffer::Type type, const void* data, int bytes) {
+        buffer = std::make_unique<QOpenGLBuffer>(type);
+        buffer->create();
+        buffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+        buffer->bind();
+        buffer->allocate(data, bytes);
+        buffer->release();
+    };
+
+    auto buffers = std::make_unique<MeshBuffers>();
+
+    if (!mesh->triangleIndices.empty()) {
+        int vertexBytes = static_cast<int>(mesh->triangleVertices.size() * sizeof(float));
+        int indexBytes = static_cast<int>(mesh->triangleIndices.size() * sizeof(unsigned int));
+        upload(buffers->vertexBuffer, QOpenGLBuffer::VertexBuffer, mesh->triangleVertices.data(), vertexBytes);
+        upload(buffers->normalBuffer, QOpenGLBuffer::VertexBuffer, mesh->triangleNormals.data(), vertexBytes);
+        upload(buffers->indexBuffer, QOpenGLBuffer::IndexBuffer, mesh->triangleIndices.data(), indexBytes);
+        buffers->indexCount = static_cast<int>(mesh->triangleIndices.size());
+        buffers->gpuBytes += 2 * vertexBytes + indexBytes;
+    }
+
+    if (!mesh->edgeVertices.empty()) {
+        int edgeBytes = static_cast<int>(mesh->edgeVertices.size() * sizeof(float));
+        upload(buffers->edgeBuffer, QOpenGLBuffer::VertexBuffer, mesh->edgeVertices.data(), edgeBytes);
+        buffers->edgeVertexCount = static_cast<int>(mesh->edgeVertices.size() / 3);
+        buffers->gpuBytes += edgeBytes;
+    }
+
+    m_gpuBytes += buffers->gpuBytes;
+    ++m_uploadCount;
+
+    MeshBuffers* result = buffers.get();
+    m_meshBuffers[entityId] = std::move(buffers);
+    return result;
+}
+
+// Static helper buffers
+QOpenGLBuffer* SharedRenderResources::staticBuffer(const QString& key, const std::function<std::vector<float>()>& builder)
+{
+    auto it = m_staticBuffers.find(key);
+    if (it != m_staticBuffers.end()) {
+        return it.value();
+    }
+
+    if (!QOpenGLContext::currentContext()) {
+        qCWarning(cadRenderResources) << "Cannot create static buffer without a current context:" << key;
+        return nullptr;
+    }
+
+    std::vector<float> data = builder();
+    int bytes = static_cast<int>(data.size() * sizeof(float));
+
+    QOpenGLBuffer* buffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    buffer->create();
+    buffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+    buffer->bind();
+    buffer->allocate(data.data(), bytes);
+    buffer->release();
+
+    m_gpuBytes += bytes;
+    ++m_uploadCount;
+    m_staticBuffers.insert(key, buffer);
+    return buffer;
+}
+
+void SharedRenderResources::releaseStaticBuffer(const QString& key)
+{
+    QOpenGLBuffer* buffer = m_staticBuffers.take(key);
+    if (buffer) {
+        m_gpuBytes -= static_cast<size_t>(buffer->size());
+        buffer->destroy();
+        delete buffer;
+    }
+}
+
+// Invalidation
+void SharedRenderResources::invalidateEntity(int entityId)
+{
+    auto tessIt = m_tessellations.find(entityId);
+    if (tessIt != m_tessellations.end()) {
+        m_tessellationBytes -= tessIt->second->byteSize();
+        m_tessellations.erase(tessIt);
+    }
+
+    auto bufferIt = m_meshBuffers.find(entityId);
+    if (bufferIt != m_meshBuffers.end()) {
+        m_gpuBytes -= bufferIt->second->gpuBytes;
+        m_meshBuffers.erase(bufferIt);
+    }
+}
+
+void SharedRenderResources::clear()
+{
+    m_tessellations.clear();
+    m_tessellationBytes = 0;
+    releaseGpu();
+}
+
+void SharedRenderResources::releaseGpu()
+{
+    m_meshBuffers.clear();
+
+    for (QOpenGLBuffer* buffer : std::as_const(m_staticBuffers)) {
+        buffer->destroy();
+        delete buffer;
+    }
+    m_staticBuffers.clear();
+
+    qDeleteAll(m_shaderPrograms);
+    m_shaderPrograms.clear();
+
+    m_gpuBytes = 0;
+}
+
+// Viewport registration
+void SharedRenderResources::addViewportRef()
+{
+    ++m_viewportRefs;
+}
+
+void SharedRenderResources::releaseViewportRef()
+{
+    if (m_viewportRefs > 0 && --m_viewportRefs == 0) {
+        // Last view gone: GPU objects die with the share group, CPU data stays
+        qCDebug(cadRenderResources) << "Last viewport released, freeing GPU resources";
+        releaseGpu();
+    }
+}
+
+void SharedRenderResources::onEntityAdded(int entityId)
+{
+    // Ids are reused after a clear or undo, so drop whatever was cached under this one
+    invalidateEntity(entityId);
+    updateEntityBounds(entityId);
+}
+
+void SharedRenderResources::onEntitiesAdded(const std::vector<int>& entityIds)
+{
+    // Insertions only mark the BVH dirty; it is rebuilt once on the next cull
+    for (int entityId : entityIds) {
+        invalidateEntity(entityId);
+        updateEntityBounds(entityId);
+    }
+}
+
+void SharedRenderResources::onEntityChanged(int entityId)
+{
+    invalidateEntity(entityId);
+    updateEntityBounds(entityId);
+}
+
+void SharedRenderResources::onEntityRemoved(int entityId)
+{
+    invalidateEntity(entityId);
+    m_sceneBVH.remove(entityId);
+}
+
+void SharedRenderResources::onEntitiesCleared()
+{
+    clear();
+    m_sceneBVH.clear();
+}
+
+void SharedRenderResources::updateEntityBounds(int entityId)
+{
+    if (!m_geometryEngine) {
+        return;
+    }
+
+    auto bounds = m_geometryEngine->getBoundingBox(entityId);
+    m_sceneBVH.update(entityId, SceneBounds(bounds.first.X(), bounds.first.Y(), bounds.first.Z(),
+                                            bounds.second.X(), bounds.second.Y(), bounds.second.Z()));
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QLoggingCategory>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <TopoDS_Shape.hxx>
+#include "SceneBVH.h"
+#include "HiddenLineRemoval.h"
+
+class QOpenGLBuffer;
+class QOpenGLShaderProgram;
+class GeometryEngine;
+
+Q_DECLARE_LOGGING_CATEGORY(cadRenderResources)
+
+/**
+ * @brief CPU-side tessellation of an entity shape
+ *
+ * Triangles are used for shaded modes, polylines for wireframe edges.
+ * Both are interleaved as x, y, z floats.
+ */
+struct TessellatedMesh
+{
+    std::vector<float> triangleVertices;
+    std::vector<float> triangleNormals;
+    std::vector<unsigned int> triangleIndices;
+    std::vector<float> edgeVertices;       // GL_LINES pairs
+    double deflection;
+
+    TessellatedMesh() : deflection(0.0) {}
+
+    size_t byteSize() const
+    {
+        return (triangleVertices.size() + triangleNormals.size() + edgeVertices.size()) * sizeof(float)
+             + triangleIndices.size() * sizeof(unsigned int);
+    }
+};
+
+/**
+ * @brief GPU buffers for one entity, uploaded once and drawn by every viewport
+ */
+struct MeshBuffers
+{
+    std::unique_ptr<QOpenGLBuffer> vertexBuffer;
+    std::unique_ptr<QOpenGLBuffer> normalBuffer;
+    std::unique_ptr<QOpenGLBuffer> indexBuffer;
+    std::unique_ptr<QOpenGLBuffer> edgeBuffer;
+    int indexCount;
+    int edgeVertexCount;
+    size_t gpuBytes;
+
+    MeshBuffers();
+    ~MeshBuffers();
+};
+
+/**
+ * @brief Render resources shared by all model-space and layout viewports
+ *
+ * Holds exactly one copy of:
+ * - Shader programs (compiled once per process)
+ * - Tessellation data per entity (computed once, reused by every view)
+ * - Mesh buffers per entity (uploaded once into the shared GL context)
+ * - Static helper buffers such as axis and view cube geometry
+ *
+ * Viewports keep only their camera and visibility state. Sharing relies on
+ * Qt::AA_ShareOpenGLContexts so every QOpenGLWidget lives in one share group.
+ * All GPU-side calls must be made with a current context, i.e. from paintGL.
+ */
+class SharedRenderResources : public QObject
+{
+    Q_OBJECT
+
+public:
+    static SharedRenderResources* instance();
+    static void destroyInstance();
+
+    ~SharedRenderResources();
+
+    // Track geometry changes so stale tessellation and buffers are dropped
+    void attachGeometryEngine(GeometryEngine* engine);
+
+    // Shader programs
+    void registerShader(const QString& name, const QString& vertexSource, const QString& fragmentSource);
+    QOpenGLShaderProgram* shaderProgram(const QString& name);
+    bool hasShader(const QString& name) const { return m_shaderSources.contains(name); }
+
+    // Tessellation (CPU, no context required)
+    const TessellatedMesh* tessellation(int entityId, const TopoDS_Shape& shape);
+    void setDeflection(double linear, double angular);
+    double linearDeflection() const { return m_linearDeflection; }
+
+    // Mesh buffers (GPU, context required)
+    MeshBuffers* meshBuffers(int entityId, const TopoDS_Shape& shape);
+
+    // Scene hierarchy for culling, kept in sync with the attached engine
+    SceneBVH& sceneBVH() { return m_sceneBVH; }
+
+    // Hidden-line results cached per view direction, shared with plotting
+    HiddenLineRemoval* hiddenLineRemoval() const { return m_hiddenLineRemoval.get(); }
+
+    // Static helper buffers (axis, view cube, ...)
+    QOpenGLBuffer* staticBuffer(const QString& key, const std::function<std::vector<float>()>& builder);
+    void releaseStaticBuffer(const QString& key);
+
+    // Invalidation
+    void invalidateEntity(int entityId);
+    void clear();
+
+    // Viewport registration (resources are freed when the last viewport goes)
+    void addViewportRef();
+    void releaseViewportRef();
+    int viewportRefCount() const { return m_viewportRefs; }
+
+    // Statistics
+    size_t tessellationBytes() const { return m_tessellationBytes; }
+    size_t gpuBytes() const { return m_gpuBytes; }
+    quint64 uploadCount() const { return m_uploadCount; }
+    quint64 tessellationCount() const { return m_tessellationCount; }
+
+private slots:
+    void onEntityAdded(int entityId);
+    void onEntitiesAdded(const std::vector<int>& entityIds);
+    void onEntityChanged(int entityId);
+    void onEntityRemoved(int entityId);
+    void onEntitiesCleared();
+
+private:
+    explicit SharedRenderResources(QObject* parent = nullptr);
+
+    static TessellatedMesh tessellate(const TopoDS_Shape& shape, double linearDeflection, double angularDeflection);
+    void releaseGpu();
+    void updateEntityBounds(int entityId);
+
+    struct ShaderSource {
+        QString vertex;
+        QString fragment;
+    };
+
+    QHash<QString, ShaderSource> m_shaderSources;
+    QHash<QString, QOpenGLShaderProgram*> m_shaderPrograms;
+
+    std::unordered_map<int, std::unique_ptr<TessellatedMesh>> m_tessellations;
+    std::unordered_map<int, std::unique_ptr<MeshBuffers>> m_meshBuffers;
+    QHash<QString, QOpenGLBuffer*> m_staticBuffers;
+
+    GeometryEngine* m_geometryEngine;
+    SceneBVH m_sceneBVH;
+    std::unique_ptr<HiddenLineRemoval> m_hiddenLineRemoval;
+
+    double m_linearDeflection;
+    double m_angularDeflection;
+
+    int m_viewportRefs;
+    size_t m_tessellationBytes;
+    size_t m_gpuBytes;
+    quint64 m_uploadCount;
+    quint64 m_tessellationCount;
+
+    static SharedRenderResources* s_instance;
+};
@@ -0,0 +1,330 @@
+#include "RenderScheduler.h"
+#include "ObjectSnaps.h"
+#include "StartupTimeline.h"
+#include "Tracing.h"
+#include <QTimer>
+#include <QPainter>
+#include <QPolygon>
+
+Q_LOGGING_CATEGORY(cadRender, "cad.render")
+
+RenderScheduler::RenderScheduler(QObject* parent)
+    : QObject(parent)
+    , m_dirty(ViewDirty | SceneDirty | OverlayDirty)
+    , m_quality(Quality::Full)
+    , m_interacting(false)
+    , m_framePending(false)
+    , m_needsRefine(false)
+    , m_lodLevel(0)
+    , m_maxLodLevel(3)
+    , m_frameBudgetMs(16.0)
+    , m_minFrameIntervalMs(16)
+    , m_idleRefineDelayMs(150)
+    , m_lastFrameMs(0.0)
+    , m_frameCount(0)
+    , m_sceneFrameCount(0)
+    , m_coalesceTimer(std::make_unique<QTimer>())
+    , m_idleTimer(std::make_unique<QTimer>())
+{
+    m_coalesceTimer->setSingleShot(true);
+    m_coalesceTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_coalesceTimer.get(), &QTimer::timeout, this, &RenderScheduler::onFrameTimer);
+
+    m_idleTimer->setSingleShot(true);
+    connect(m_idleTimer.get(), &QTimer::timeout, this, &RenderScheduler::onIdleTimer);
+
+    m_sinceLastFrame.start();
+}
+
+RenderScheduler::~RenderScheduler() = default;
+
+void RenderScheduler::invalidateView()
+{
+    invalidate(ViewDirty);
+}
+
+void RenderScheduler::invalidateScene()
+{
+    invalidate(SceneDirty);
+}
+
+void RenderScheduler::invalidateOverlay()
+{
+    invalidate(OverlayDirty);
+}
+
+void RenderScheduler::invalidate(DirtyFlags flags)
+{
+    if (flags == None) {
+        return;
+    }
+
+    m_dirty |= flags;
+
+    // Anything that touches the model restarts the idle refinement countdown
+    if (flags & (ViewDirty | SceneDirty)) {
+        if (m_interacting || m_quality == Quality::Coarse) {
+            m_needsRefine = true;
+            m_idleTimer->start(m_idleRefineDelayMs);
+        }
+    }
+
+    scheduleFrame();
+}
+
+bool RenderScheduler::needsSceneRender() const
+{
+    return m_frameDirty & (ViewDirty | SceneDirty);
+}
+
+void RenderScheduler::beginInteraction()
+{
+    if (m_interacting) {
+        return;
+    }
+
+    m_interacting = true;
+    m_idleTimer->stop();
+    qCDebug(cadRender) << "Interaction started";
+}
+
+void RenderScheduler::endInteraction()
+{
+    if (!m_interacting) {
+        return;
+    }
+
+    m_interacting = false;
+    if (m_needsRefine || m_quality == Quality::Coarse) {
+        m_needsRefine = true;
+        m_idleTimer->start(m_idleRefineDelayMs);
+    }
+    qCDebug(cadRender) << "Interaction ended";
+}
+
+RenderScheduler::Quality RenderScheduler::beginFrame()
+{
+    m_framePending = false;
+    m_frameDirty = m_dirty;
+    m_dirty = None;
+
+    Quality quality = m_interacting ? Quality::Coarse : Quality::Full;
+    if (quality == Quality::Full) {
+        m_lodLevel = 0;
+        m_needsRefine = false;
+    }
+
+    if (quality != m_quality) {
+        m_quality = quality;
+        emit qualityChanged(quality);
+    }
+
+    m_frameTimer.start();
+    return m_quality;
+}
+
+void RenderScheduler::endFrame()
+{
+    m_lastFrameMs = m_frameTimer.nsecsElapsed() / 1.0e6;
+    m_sinceLastFrame.restart();
+    ++m_frameCount;
+    CAD_TRACE_COUNTER("render", "frameUs", m_lastFrameMs * 1000.0);
+
+    if (m_frameCount == 1) {
+        StartupTimeline::frameRendered();
+    }
+
+    if (m_frameDirty & (ViewDirty | SceneDirty)) {
+        ++m_sceneFrameCount;
+        if (m_quality == Quality::Coarse) {
+            adaptLod();
+        }
+    }
+
+    m_frameDirty = None;
+
+    // Requests that arrived while painting get their own frame
+    if (m_dirty != None) {
+        scheduleFrame();
+    }
+}
+
+void RenderScheduler::setMaxLodLevel(int level)
+{
+    m_maxLodLevel = qMax(0, level);
+    m_lodLevel = qMin(m_lodLevel, m_maxLodLevel);
+}
+
+void RenderScheduler::setFrameBudget(double milliseconds)
+{
+    m_frameBudgetMs = qMax(1.0, milliseconds);
+}
+
+void RenderScheduler::setMinFrameInterval(int milliseconds)
+{
+    m_minFrameIntervalMs = qMax(0, milliseconds);
+}
+
+void RenderScheduler::setIdleRefineDelay(int milliseconds)
+{
+    m_idleRefineDelayMs = qMax(0, milliseconds);
+}
+
+void RenderScheduler::onFrameTimer()
+{
+    emit frameRequested();
+}
+
+void RenderScheduler::onIdleTimer()
+{
+    if (m_interacting || !m_needsRefine) {
+        return;
+    }
+
+    qCDebug(cadRender) << "Idle refinement at full quality";
+    m_dirty |= SceneDirty;
+    scheduleFrame();
+}
+
+void RenderScheduler::scheduleFrame()
+{
+    if (m_framePending) {
+        return;
+    }
+
+    m_framePending = true;
+
+    // Coalesce bursts of mouse events into one frame per refresh interval
+    qint64 elapsed = m_sinceLastFrame.elapsed();
+    int delay = elapsed >= m_minFrameIntervalMs ? 0 : static_cast<int>(m_minFrameIntervalMs - elapsed);
+    m_coalesceTimer->start(delay);
+}
+
+void RenderScheduler::adaptLod()
+{
+    // Step coarser when over budget, finer when comfortably under it
+    if (m_lastFrameMs > m_frameBudgetMs && m_lodLevel < m_maxLodLevel) {
+        ++m_lodLevel;
+        qCDebug(cadRender) << "Frame over budget:" << m_lastFrameMs << "ms, LOD ->" << m_lodLevel;
+    } else if (m_lastFrameMs < m_frameBudgetMs * 0.5 && m_lodLevel > 0) {
+        --m_lodLevel;
+    }
+}
+
+// Overlay painting
+namespace {
+
+void drawSnapGlyph(QPainter& painter, const QPoint& p, SnapType type)
+{
+    const int s = 6;
+
+    switch (type) {
+    case SnapType::Endpoint:
+        painter.drawRect(p.x() - s, p.y() - s, 2 * s, 2 * s);
+        break;
+    case SnapType::Midpoint: {
+        QPolygon triangle;
+        triangle << QPoint(p.x(), p.y() - s) << QPoint(p.x() + s, p.y() + s) << QPoint(p.x() - s, p.y() + s);
+        painter.drawPolygon(triangle);
+        break;
+    }
+    case SnapType::Center:
+    case SnapType::GeometricCenter:
+        painter.drawEllipse(p, s, s);
+        break;
+    case SnapType::Quadrant: {
+        QPolygon diamond;
+        diamond << QPoint(p.x(), p.y() - s) << QPoint(p.x() + s, p.y())
+                << QPoint(p.x(), p.y() + s) << QPoint(p.x() - s, p.y());
+        painter.drawPolygon(diamond);
+        break;
+    }
+    case SnapType::Intersection:
+    case SnapType::Apparent:
+        painter.drawLine(p.x() - s, p.y() - s, p.x() + s, p.y() + s);
+        painter.drawLine(p.x() - s, p.y() + s, p.x() + s, p.y() - s);
+        break;
+    case SnapType::Perpendicular:
+        painter.drawLine(p.x() - s, p.y() + s, p.x() + s, p.y() + s);
+        painter.drawLine(p.x() - s, p.y() + s, p.x() - s, p.y() - s);
+        painter.drawLine(p.x() - s, p.y(), p.x(), p.y());
+        painter.drawLine(p.x(), p.y(), p.x(), p.y() + s);
+        break;
+    case SnapType::Tangent:
+        painter.drawEllipse(p, s, s);
+        painter.drawLine(p.x() - s, p.y() - s, p.x() + s, p.y() - s);
+        break;
+    case SnapType::Nearest:
+        painter.drawLine(p.x() - s, p.y() - s, p.x() + s, p.y() - s);
+        painter.drawLine(p.x() + s, p.y() - s, p.x() - s, p.y() + s);
+        painter.drawLine(p.x() - s, p.y() + s, p.x() + s, p.y() + s);
+        painter.drawLine(p.x() + s, p.y() + s, p.x() - s, p.y() - s);
+        break;
+    default:
+        painter.drawLine(p.x() - s, p.y(), p.x() + s, p.y());
+        painter.drawLine(p.x(), p.y() - s, p.x(), p.y() + s);
+        painter.drawEllipse(p, s / 2, s / 2);
+        break;
+    }
+}
+
+} // namespace
+
+void paintViewportOverlay(QPainter& painter, const QRect& viewportRect, const ViewportOverlay& overlay)
+{
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing, false);
+    painter.setBrush(Qt::NoBrush);
+
+    // Rubber band (selection window or line preview)
+    if (overlay.rubberBandVisible) {
+        QPen pen(overlay.rubberBandColor);
+        if (overlay.rubberBandRectangle) {
+            // Crossing selection (right to left) is dashed, window selection is solid
+            bool crossing = overlay.rubberBandEnd.x() < overlay.rubberBandStart.x();
+            pen.setStyle(crossing ? Qt::DashLine : Qt::SolidLine);
+            painter.setPen(pen);
+
+            QColor fill = overlay.rubberBandColor;
+            fill.setAlpha(40);
+            QRect band = QRect(overlay.rubberBandStart, overlay.rubberBandEnd).normalized();
+            painter.fillRect(band, fill);
+            painter.drawRect(band);
+        } else {
+            painter.setPen(pen);
+            painter.drawLine(overlay.rubberBandStart, overlay.rubberBandEnd);
+        }
+    }
+
+    // Crosshair and pickbox
+    if (overlay.crosshairVisible && viewportRect.contains(overlay.cursorPos)) {
+        painter.setPen(QPen(overlay.crosshairColor, 1));
+
+        const QPoint& c = overlay.cursorPos;
+        int left = viewportRect.left();
+        int right = viewportRect.right();
+        int top = viewportRect.top();
+        int bottom = viewportRect.bottom();
+        if (overlay.crosshairSize > 0) {
+            left = qMax(left, c.x() - overlay.crosshairSize);
+            right = qMin(right, c.x() + overlay.crosshairSize);
+            top = qMax(top, c.y() - overlay.crosshairSize);
+            bottom = qMin(bottom, c.y() + overlay.crosshairSize);
+        }
+
+        int box = overlay.pickboxSize;
+        painter.drawLine(left, c.y(), c.x() - box, c.y());
+        painter.drawLine(c.x() + box, c.y(), right, c.y());
+        painter.drawLine(c.x(), top, c.x(), c.y() - box);
+        painter.drawLine(c.x(), c.y() + box, c.x(), bottom);
+        painter.drawRect(c.x() - box, c.y() - box, 2 * box, 2 * box);
+    }
+
+    // Snap marker
+    if (overlay.snapMarkerVisible) {
+        painter.setPen(QPen(overlay.snapMarkerColor, 2));
+        drawSnapGlyph(painter, overlay.snapMarkerPos, static_cast<SnapType>(overlay.snapMarkerType));
+    }
+
+    painter.restore();
+}
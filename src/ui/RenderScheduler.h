@@ -0,0 +1,166 @@
+#pragma once
+
+#include <QObject>
+#include <QPoint>
+#include <QRect>
+#include <QColor>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <memory>
+
+class QTimer;
+class QPainter;
+
+Q_DECLARE_LOGGING_CATEGORY(cadRender)
+
+/**
+ * @brief Cursor-only overlay state drawn over the cached scene image
+ *
+ * Everything in here changes with mouse movement and must never force the
+ * model to be redrawn; it is painted in a separate cheap pass.
+ */
+struct ViewportOverlay
+{
+    bool crosshairVisible;
+    QPoint cursorPos;
+    int crosshairSize;          // Half length in pixels, 0 = full viewport
+    int pickboxSize;
+
+    bool snapMarkerVisible;
+    QPoint snapMarkerPos;
+    int snapMarkerType;         // SnapType value, selects marker glyph
+
+    bool rubberBandVisible;
+    QPoint rubberBandStart;
+    QPoint rubberBandEnd;
+    bool rubberBandRectangle;   // Rectangle (window/crossing) or line
+
+    QColor crosshairColor;
+    QColor snapMarkerColor;
+    QColor rubberBandColor;
+
+    ViewportOverlay()
+        : crosshairVisible(true)
+        , crosshairSize(0)
+        , pickboxSize(5)
+        , snapMarkerVisible(false)
+        , snapMarkerType(0)
+        , rubberBandVisible(false)
+        , rubberBandRectangle(false)
+        , crosshairColor(Qt::white)
+        , snapMarkerColor(QColor(255, 200, 0))
+        , rubberBandColor(QColor(0, 120, 215))
+    {}
+};
+
+/**
+ * @brief On-demand frame scheduler for a viewport
+ *
+ * Replaces continuous redraw with dirty-driven repaints:
+ * - View changes (pan, zoom, orbit) and entity changes invalidate the scene
+ * - Cursor overlays only invalidate the overlay pass
+ * - Requests are coalesced into at most one frame per refresh interval
+ * - A frame-time budget picks coarse LOD while interacting and schedules
+ *   a full-quality refinement frame once the view has been idle
+ */
+class RenderScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum DirtyFlag {
+        None = 0x0,
+        ViewDirty = 0x1,
+        SceneDirty = 0x2,
+        OverlayDirty = 0x4
+    };
+    Q_DECLARE_FLAGS(DirtyFlags, DirtyFlag)
+
+    enum class Quality {
+        Coarse,
+        Full
+    };
+
+    explicit RenderScheduler(QObject* parent = nullptr);
+    ~RenderScheduler();
+
+    // Invalidation
+    void invalidateView();
+    void invalidateScene();
+    void invalidateOverlay();
+    void invalidate(DirtyFlags flags);
+    DirtyFlags dirtyFlags() const { return m_dirty; }
+
+    // Whether the next frame must re-render the model or can reuse the cached image
+    bool needsSceneRender() const;
+
+    // Interaction tracking (orbit, pan, zoom drag)
+    void beginInteraction();
+    void endInteraction();
+    bool isInteracting() const { return m_interacting; }
+
+    // Frame lifecycle, called from paintGL
+    Quality beginFrame();
+    void endFrame();
+    Quality currentQuality() const { return m_quality; }
+
+    // Level of detail to use for the current frame (0 = full detail)
+    int lodLevel() const { return m_lodLevel; }
+    int maxLodLevel() const { return m_maxLodLevel; }
+    void setMaxLodLevel(int level);
+
+    // Budget and timing
+    void setFrameBudget(double milliseconds);
+    double frameBudget() const { return m_frameBudgetMs; }
+
+    void setMinFrameInterval(int milliseconds);
+    int minFrameInterval() const { return m_minFrameIntervalMs; }
+
+    void setIdleRefineDelay(int milliseconds);
+    int idleRefineDelay() const { return m_idleRefineDelayMs; }
+
+    double lastFrameTime() const { return m_lastFrameMs; }
+    quint64 frameCount() const { return m_frameCount; }
+    quint64 sceneFrameCount() const { return m_sceneFrameCount; }
+
+signals:
+    void frameRequested();
+    void qualityChanged(RenderScheduler::Quality quality);
+
+private slots:
+    void onFrameTimer();
+    void onIdleTimer();
+
+private:
+    void scheduleFrame();
+    void adaptLod();
+
+    DirtyFlags m_dirty;
+    DirtyFlags m_frameDirty;
+    Quality m_quality;
+    bool m_interacting;
+    bool m_framePending;
+    bool m_needsRefine;
+
+    int m_lodLevel;
+    int m_maxLodLevel;
+
+    double m_frameBudgetMs;
+    int m_minFrameIntervalMs;
+    int m_idleRefineDelayMs;
+    double m_lastFrameMs;
+    quint64 m_frameCount;
+    quint64 m_sceneFrameCount;
+
+    QElapsedTimer m_frameTimer;
+    QElapsedTimer m_sinceLastFrame;
+    std::unique_ptr<QTimer> m_coalesceTimer;
+    std::unique_ptr<QTimer> m_idleTimer;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(RenderScheduler::DirtyFlags)
+
+/**
+ * @brief Paints crosshair, snap marker and rubber band with QPainter
+ */
+void paintViewportOverlay(QPainter& painter, const QRect& viewportRect, const ViewportOverlay& overlay);
@@ -1,4 +1,5 @@
 #include "RibbonInterface.h"
+#include "Tracing.h"
 #include <QTabBar>
 #include <QStackedWidget>
 #include <QHBoxLayout>
@@ -368,23 +369,22 @@ void RibbonInterface::createDefaultTabs()
 {
     qCDebug(cadRibbon) << "Creating default ribbon tabs...";
 
-    createHomeTab();
-    createInsertTab();
-    createAnnotateTab();
-    createParametricTab();
-    createViewTab();
-    createManageTab();
-    createOutputTab();
-    createAddInsTab();
+    // Only the current tab's buttons and icons are built at startup
+    addLazyTab("Home", [this](RibbonTab* tab) { createHomeTab(tab); });
+    addLazyTab("Insert", [this](RibbonTab* tab) { createInsertTab(tab); });
+    addLazyTab("Annotate", [this](RibbonTab* tab) { createAnnotateTab(tab); });
+    addLazyTab("Parametric", [this](RibbonTab* tab) { createParametricTab(tab); });
+    addLazyTab("View", [this](RibbonTab* tab) { createViewTab(tab); });
+    addLazyTab("Manage", [this](RibbonTab* tab) { createManageTab(tab); });
+    addLazyTab("Output", [this](RibbonTab* tab) { createOutputTab(tab); });
+    addLazyTab("Add-ins", [this](RibbonTab* tab) { createAddInsTab(tab); });
 
     // Set Home tab as default
     setCurrentTab("Home");
 }
 
-void RibbonInterface::createHomeTab()
+void RibbonInterface::createHomeTab(RibbonTab* homeTab)
 {
-    RibbonTab* homeTab = addTab("Home");
-
     // Draw panel
     RibbonPanel* drawPanel = homeTab->addPanel("Draw");
     drawPanel->addLargeButton("Line", QIcon(":/icons/line.png"), "Draw a line");
@@ -436,10 +436,8 @@ void RibbonInterface::createHomeTab()
     clipboardPanel->addMediumButton("Copy with Base Point", QIcon(":/icons/copy_base.png"), "Copy with base point");
 }
 
-void RibbonInterface::createInsertTab()
+void RibbonInterface::createInsertTab(RibbonTab* insertTab)
 {
-    RibbonTab* insertTab = addTab("Insert");
-
     // Block panel
     RibbonPanel* blockPanel = insertTab->addPanel("Block");
     blockPanel->addLargeButton("Insert", QIcon(":/icons/block_insert.png"), "Insert block");
@@ -467,10 +465,8 @@ void RibbonInterface::createInsertTab()
     dataPanel->addMediumButton("Object", QIcon(":/icons/ole_object.png"), "Insert OLE object");
 }
 
-void RibbonInterface::createAnnotateTab()
+void RibbonInterface::createAnnotateTab(RibbonTab* annotateTab)
 {
-    RibbonTab* annotateTab = addTab("Annotate");
-
     // Text panel
     RibbonPanel* textPanel = annotateTab->addPanel("Text");
     textPanel->addLargeButton("Multiline\nText", QIcon(":/icons/mtext.png"), "Multiline text");
@@ -502,10 +498,8 @@ void RibbonInterface::createAnnotateTab()
     markupPanel->addMediumButton("Markup", QIcon(":/icons/markup.png"), "Markup set");
 }
 
-void RibbonInterface::createViewTab()
+void RibbonInterface::createViewTab(RibbonTab* viewTab)
 {
-    RibbonTab* viewTab = addTab("View");
-
     // Views panel
     RibbonPanel* viewsPanel = viewTab->addPanel("Views");
     viewsPanel->addLargeButton("Top", QIcon(":/icons/view_top.png"), "Top view");
@@ -543,10 +537,8 @@ void RibbonInterface::createViewTab()
     visualPanel->addLargeButton("Conceptual", QIcon(":/icons/visual_conceptual.png"), "Conceptual visual style");
 }
 
-void RibbonInterface::createOutputTab()
+void RibbonInterface::createOutputTab(RibbonTab* outputTab)
 {
-    RibbonTab* outputTab = addTab("Output");
-
     // Plot panel
     RibbonPanel* plotPanel = outputTab->addPanel("Plot");
     plotPanel->addLargeButton("Plot", QIcon(":/icons/plot.png"), "Plot drawing");
@@ -571,17 +563,73 @@ void RibbonInterface::createOutputTab()
 // Tab management methods
 RibbonTab* RibbonInterface::addTab(const QString& name)
 {
+    addLazyTab(name, TabBuilder());
+    return ensureTab(m_tabIndexMap[name]);
+}
+
+void RibbonInterface::addLazyTab(const QString& name, TabBuilder builder)
+{
+    int index = static_cast<int>(m_tabs.size());
+    m_tabIndexMap[name] = index;
+    m_tabNames.append(name);
+    m_tabs.push_back(nullptr);
+    m_tabBuilders.push_back(std::move(builder));
+
+    // Empty placeholder keeps stack indices aligned with the tab bar
+    m_contentStack->addWidget(new QWidget());
+
+    // Adding the first tab makes it current, which builds it
+    m_tabBar->addTab(name);
+}
+
+bool RibbonInterface::isTabBuilt(const QString& name) const
+{
+    auto it = m_tabIndexMap.find(name);
+    return it != m_tabIndexMap.end() && m_tabs[it->second] != nullptr;
+}
+
+RibbonTab* RibbonInterface::getTab(const QString& name) const
+{
+    auto it = m_tabIndexMap.find(name);
+    if (it == m_tabIndexMap.end()) {
+        return nullptr;
+    }
+    return const_cast<RibbonInterface*>(this)->ensureTab(it->second);
+}
+
+RibbonTab* RibbonInterface::ensureTab(int index)
+{
+    if (index < 0 || index >= static_cast<int>(m_tabs.size())) {
+        return nullptr;
+    }
+    if (m_tabs[index]) {
+        return m_tabs[index].get();
+    }
+
+    CAD_TRACE_SCOPE("ui", "buildRibbonTab");
+    const QString& name = m_tabNames[index];
+    qCDebug(cadRibbon) << "Building ribbon tab" << name;
+
     auto tab = std::make_unique<RibbonTab>(name, this);
     RibbonTab* tabPtr = tab.get();
-
     connect(tabPtr, &RibbonTab::buttonClicked, this, &RibbonInterface::commandTriggered);
 
-    int index = m_tabBar->addTab(name);
-    m_tabIndexMap[name] = index;
+    if (m_tabBuilders[index]) {
+        m_tabBuilders[index](tabPtr);
+        m_tabBuilders[index] = TabBuilder();
+    }
 
-    m_contentStack->addWidget(tabPtr);
-    m_tabs.push_back(std::move(tab));
+    // Swap the placeholder for the real tab at the same stack index
+    QWidget* placeholder = m_contentStack->widget(index);
+    const bool wasCurrent = m_contentStack->currentIndex() == index;
+    m_contentStack->insertWidget(index, tabPtr);
+    m_contentStack->removeWidget(placeholder);
+    delete placeholder;
+    if (wasCurrent) {
+        m_contentStack->setCurrentIndex(index);
+    }
 
+    m_tabs[index] = std::move(tab);
     return tabPtr;
 }
 
@@ -589,6 +637,7 @@ void RibbonInterface::setCurrentTab(const QString& name)
 {
     auto it = m_tabIndexMap.find(name);
     if (it != m_tabIndexMap.end()) {
+        ensureTab(it->second);
         m_tabBar->setCurrentIndex(it->second);
         m_contentStack->setCurrentIndex(it->second);
         m_currentTab = name;
@@ -596,6 +645,16 @@ void RibbonInterface::setCurrentTab(const QString& name)
     }
 }
 
+QString RibbonInterface::getCurrentTab() const
+{
+    return m_currentTab;
+}
+
+QStringList RibbonInterface::getTabNames() const
+{
+    return m_tabNames;
+}
+
 void RibbonInterface::addQuickAccessButton(const QString& text, const QIcon& icon, const QString& command)
 {
     QAction* action = m_quickAccessToolbar->addAction(icon, text);
@@ -646,8 +705,9 @@ void RibbonInterface::applyRibbonStyling()
 void RibbonInterface::onTabChanged(int index)
 {
     if (index >= 0 && index < static_cast<int>(m_tabs.size())) {
+        ensureTab(index);
         m_contentStack->setCurrentIndex(index);
-        m_currentTab = m_tabs[index]->name();
+        m_currentTab = m_tabNames[index];
         emit tabChanged(m_currentTab);
     }
 }
@@ -673,20 +733,20 @@ void RibbonInterface::onApplicationButtonClicked()
 }
 
 // Placeholder methods for remaining tabs
-void RibbonInterface::createParametricTab()
+void RibbonInterface::createParametricTab(RibbonTab* parametricTab)
 {
-    RibbonTab* parametricTab = addTab("Parametric");
+    Q_UNUSED(parametricTab)
     // TODO: Add parametric tools
 }
 
-void RibbonInterface::createManageTab()
+void RibbonInterface::createManageTab(RibbonTab* manageTab)
 {
-    RibbonTab* manageTab = addTab("Manage");
+    Q_UNUSED(manageTab)
     // TODO: Add management tools
 }
 
-void RibbonInterface::createAddInsTab()
+void RibbonInterface::createAddInsTab(RibbonTab* addInsTab)
 {
-    RibbonTab* addInsTab = addTab("Add-ins");
+    Q_UNUSED(addInsTab)
     // TODO: Add plugin/add-in tools
 }
@@ -3,6 +3,7 @@
 #include <QToolBar>
 #include <QTabWidget>
 #include <QLoggingCategory>
+#include <functional>
 #include <memory>
 
 class QTabBar;
@@ -111,7 +112,12 @@ public:
     ~RibbonInterface();
 
     // Tab management
+    using TabBuilder = std::function<void(RibbonTab*)>;
+
     RibbonTab* addTab(const QString& name);
+    // Adds the tab bar entry now; panels are built when the tab is first shown
+    void addLazyTab(const QString& name, TabBuilder builder);
+    bool isTabBuilt(const QString& name) const;
     void removeTab(const QString& name);
     RibbonTab* getTab(const QString& name) const;
     void setCurrentTab(const QString& name);
@@ -152,14 +158,16 @@ private slots:
 private:
     void setupUI();
     void createDefaultTabs();
-    void createHomeTab();
-    void createInsertTab();
-    void createAnnotateTab();
-    void createParametricTab();
-    void createViewTab();
-    void createManageTab();
-    void createOutputTab();
-    void createAddInsTab();
+    void createHomeTab(RibbonTab* homeTab);
+    void createInsertTab(RibbonTab* insertTab);
+    void createAnnotateTab(RibbonTab* annotateTab);
+    void createParametricTab(RibbonTab* parametricTab);
+    void createViewTab(RibbonTab* viewTab);
+    void createManageTab(RibbonTab* manageTab);
+    void createOutputTab(RibbonTab* outputTab);
+    void createAddInsTab(RibbonTab* addInsTab);
+    
+    RibbonTab* ensureTab(int index);
     
     void setupQuickAccessToolbar();
     void setupApplicationButton();
@@ -182,8 +190,10 @@ private:
     // Content area
     QStackedWidget* m_contentStack;
     
-    // Tabs
+    // Tabs; entries stay null until a lazy tab is first shown
     std::vector<std::unique_ptr<RibbonTab>> m_tabs;
+    std::vector<TabBuilder> m_tabBuilders;
+    QStringList m_tabNames;
     std::map<QString, int> m_tabIndexMap;
     
     // State
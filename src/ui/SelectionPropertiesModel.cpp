@@ -0,0 +1,424 @@
+#include "SelectionPropertiesModel.h"
+#include "Tracing.h"
+#include <QCoreApplication>
+#include <QPointer>
+#include <QThreadPool>
+#include <algorithm>
+
+#include <BRepGProp.hxx>
+#include <GProp_GProps.hxx>
+#include <TopExp_Explorer.hxx>
+
+namespace {
+
+const QString VariesText = QStringLiteral("*VARIES*");
+
+QString typeName(CADEntity::Type type)
+{
+    switch (type) {
+    case CADEntity::Point: return QStringLiteral("Point");
+    case CADEntity::Line: return QStringLiteral("Line");
+    case CADEntity::Circle: return QStringLiteral("Circle");
+    case CADEntity::Arc: return QStringLiteral("Arc");
+    case CADEntity::Ellipse: return QStringLiteral("Ellipse");
+    case CADEntity::Polyline: return QStringLiteral("Polyline");
+    case CADEntity::Spline: return QStringLiteral("Spline");
+    case CADEntity::Rectangle: return QStringLiteral("Rectangle");
+    case CADEntity::Polygon: return QStringLiteral("Polygon");
+    case CADEntity::Text: return QStringLiteral("Text");
+    case CADEntity::Dimension: return QStringLiteral("Dimension");
+    case CADEntity::Hatch: return QStringLiteral("Hatch");
+    case CADEntity::Block: return QStringLiteral("Block Reference");
+    case CADEntity::Box: return QStringLiteral("Box");
+    case CADEntity::Sphere: return QStringLiteral("Sphere");
+    case CADEntity::Cylinder: return QStringLiteral("Cylinder");
+    case CADEntity::Cone: return QStringLiteral("Cone");
+    case CADEntity::Torus: return QStringLiteral("Torus");
+    case CADEntity::Wedge: return QStringLiteral("Wedge");
+    case CADEntity::Surface: return QStringLiteral("Surface");
+    case CADEntity::Solid: return QStringLiteral("3D Solid");
+    }
+    return QStringLiteral("Unknown");
+}
+
+QString colorName(int color)
+{
+    static const char* const names[] = { "ByBlock", "Red", "Yellow", "Green", "Cyan", "Blue", "Magenta", "White" };
+    if (color >= 0 && color <= 7) {
+        return QString::fromLatin1(names[color]);
+    }
+    return color == 256 ? QStringLiteral("ByLayer") : QString("Color %1").arg(color);
+}
+
+// Tracks whether every value seen so far is equal
+template <typename T>
+struct Common
+{
+    T value{};
+    bool seen = false;
+    bool varies = false;
+
+    void add(const T& next)
+    {
+        if (!seen) {
+            value = next;
+            seen = true;
+        } else if (!varies && !(value == next)) {
+            varies = true;
+        }
+    }
+};
+
+} // namespace
+
+SelectionPropertiesModel::SelectionPropertiesModel(GeometryEngine* engine, QObject* parent)
+    : QAbstractItemModel(parent)
+    , m_geometryEngine(engine)
+    , m_generation(std::make_shared<std::atomic<quint64>>(0))
+    , m_aggregating(false)
+{
+    // Edits often arrive as one entityModified per selected entity
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(50);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &SelectionPropertiesModel::refresh);
+
+    connect(m_geometryEngine, &GeometryEngine::entityModified, this, &SelectionPropertiesModel::onEntityModified);
+    connect(m_geometryEngine, &GeometryEngine::entityRemoved, this, &SelectionPropertiesModel::onEntityRemoved);
+}
+
+SelectionPropertiesModel::~SelectionPropertiesModel()
+{
+    // Cancels any aggregation still running
+    ++*m_generation;
+}
+
+void SelectionPropertiesModel::setSelection(const std::vector<int>& entityIds)
+{
+    m_selection = entityIds;
+    m_selectionSet = std::unordered_set<int>(entityIds.begin(), entityIds.end());
+    m_refreshTimer.stop();
+    refresh();
+}
+
+void SelectionPropertiesModel::clearSelection()
+{
+    setSelection({});
+}
+
+void SelectionPropertiesModel::onEntityModified(int entityId)
+{
+    if (m_selectionSet.count(entityId)) {
+        m_refreshTimer.start();
+    }
+}
+
+void SelectionPropertiesModel::onEntityRemoved(int entityId)
+{
+    if (m_selectionSet.erase(entityId)) {
+        m_selection.erase(std::remove(m_selection.begin(), m_selection.end(), entityId), m_selection.end());
+        m_refreshTimer.start();
+    }
+}
+
+void SelectionPropertiesModel::refresh()
+{
+    CAD_TRACE_SCOPE("ui", "snapshotSelection");
+
+    const quint64 expected = ++*m_generation;
+
+    if (m_selection.empty()) {
+        m_aggregating = false;
+        applyCategories({});
+        return;
+    }
+
+    // Only cheap fields and shape handles are copied on the GUI thread
+    std::vector<EntitySnapshot> snapshot;
+    snapshot.reserve(m_selection.size());
+    for (int id : m_selection) {
+        if (const CADEntity* entity = m_geometryEngine->findEntity(id)) {
+            snapshot.push_back(EntitySnapshot{entity->type, entity->layer, entity->color, entity->lineType,
+                                              entity->lineWeight, entity->visible, entity->shape});
+        }
+    }
+
+    if (!m_aggregating) {
+        m_aggregating = true;
+        emit aggregationStarted();
+    }
+
+    QPointer<SelectionPropertiesModel> guard(this);
+    std::shared_ptr<std::atomic<quint64>> generation = m_generation;
+    QThreadPool::globalInstance()->start([guard, generation, expected, snapshot = std::move(snapshot)]() {
+        std::vector<Category> categories = aggregate(snapshot, *generation, expected);
+        if (generation->load() != expected) {
+            return;
+        }
+
+        // Delivered on the GUI thread; the guard is only checked there
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, generation, expected, categories]() {
+            if (guard && generation->load() == expected) {
+                guard->m_aggregating = false;
+                guard->applyCategories(categories);
+                emit guard->aggregationFinished();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+std::vector<SelectionPropertiesModel::Category> SelectionPropertiesModel::aggregate(
+    const std::vector<EntitySnapshot>& entities, const std::atomic<quint64>& generation, quint64 expected)
+{
+    CAD_TRACE_SCOPE("ui", "aggregateSelection");
+
+    Common<int> type;
+    Common<QString> layer;
+    Common<int> color;
+    Common<int> lineType;
+    Common<double> lineWeight;
+    Common<bool> visible;
+    double length = 0.0;
+    double area = 0.0;
+    double volume = 0.0;
+
+    for (size_t i = 0; i < entities.size(); ++i) {
+        if ((i & 255) == 0 && generation.load(std::memory_order_relaxed) != expected) {
+            return {};
+        }
+
+        const EntitySnapshot& entity = entities[i];
+        type.add(entity.type);
+        layer.add(entity.layer);
+        color.add(entity.color);
+        lineType.add(entity.lineType);
+        lineWeight.add(entity.lineWeight);
+        visible.add(entity.visible);
+
+        if (entity.shape.IsNull()) {
+            continue;
+        }
+
+        // Measure each entity by its highest dimension only
+        GProp_GProps props;
+        if (TopExp_Explorer(entity.shape, TopAbs_SOLID).More()) {
+            BRepGProp::VolumeProperties(entity.shape, props);
+            volume += props.Mass();
+            GProp_GProps surface;
+            BRepGProp::SurfaceProperties(entity.shape, surface);
+            area += surface.Mass();
+        } else if (TopExp_Explorer(entity.shape, TopAbs_FACE).More()) {
+            BRepGProp::SurfaceProperties(entity.shape, props);
+            area += props.Mass();
+        } else if (TopExp_Explorer(entity.shape, TopAbs_EDGE).More()) {
+            BRepGProp::LinearProperties(entity.shape, props);
+            length += props.Mass();
+        }
+    }
+
+    const bool single = entities.size() == 1;
+
+    Category general{QStringLiteral("General"), {}};
+    general.properties.push_back({QStringLiteral("Objects"), static_cast<int>(entities.size()), false, false});
+    general.properties.push_back({QStringLiteral("Type"),
+                                  type.varies ? QVariant() : QVariant(typeName(static_cast<CADEntity::Type>(type.value))),
+                                  type.varies, false});
+    general.properties.push_back({QStringLiteral("Layer"), layer.value, layer.varies, true});
+    general.properties.push_back({QStringLiteral("Color"), color.value, color.varies, true});
+    general.properties.push_back({QStringLiteral("Linetype"), lineType.value, lineType.varies, false});
+    general.properties.push_back({QStringLiteral("Lineweight"), lineWeight.value, lineWeight.varies, false});
+    general.properties.push_back({QStringLiteral("Visible"), visible.value, visible.varies, true});
+
+    Category geometry{QStringLiteral("Geometry"), {}};
+    if (length > 0.0) {
+        geometry.properties.push_back({single ? QStringLiteral("Length") : QStringLiteral("Total length"), length, false, false});
+    }
+    if (area > 0.0) {
+        geometry.properties.push_back({single ? QStringLiteral("Area") : QStringLiteral("Total area"), area, false, false});
+    }
+    if (volume > 0.0) {
+        geometry.properties.push_back({single ? QStringLiteral("Volume") : QStringLiteral("Total volume"), volume, false, false});
+    }
+
+    std::vector<Category> categories;
+    categories.push_back(std::move(general));
+    if (!geometry.properties.empty()) {
+        categories.push_back(std::move(geometry));
+    }
+    return categories;
+}
+
+void SelectionPropertiesModel::applyCategories(std::vector<Category> categories)
+{
+    // Same rows as before: update values in place so the view keeps its state
+    bool sameShape = categories.size() == m_categories.size();
+    for (size_t c = 0; sameShape && c < categories.size(); ++c) {
+        const auto& next = categories[c].properties;
+        const auto& current = m_categories[c].properties;
+        sameShape = categories[c].name == m_categories[c].name && next.size() == current.size();
+        for (size_t p = 0; sameShape && p < next.size(); ++p) {
+            sameShape = next[p].name == current[p].name;
+        }
+    }
+
+    if (!sameShape) {
+        beginResetModel();
+        m_categories = std::move(categories);
+        endResetModel();
+        return;
+    }
+
+    m_categories = std::move(categories);
+    for (size_t c = 0; c < m_categories.size(); ++c) {
+        const int last = static_cast<int>(m_categories[c].properties.size()) - 1;
+        if (last >= 0) {
+            const QModelIndex parentIndex = index(static_cast<int>(c), 0);
+            emit dataChanged(index(0, ValueColumn, parentIndex), index(last, ValueColumn, parentIndex));
+        }
+    }
+}
+
+const SelectionPropertiesModel::Property* SelectionPropertiesModel::propertyAt(const QModelIndex& index) const
+{
+    if (!index.isValid() || index.internalId() == 0) {
+        return nullptr;
+    }
+    const size_t category = index.internalId() - 1;
+    if (category >= m_categories.size() || index.row() >= static_cast<int>(m_categories[category].properties.size())) {
+        return nullptr;
+    }
+    return &m_categories[category].properties[index.row()];
+}
+
+// Category rows carry internal id 0; property rows carry their category index + 1
+QModelIndex SelectionPropertiesModel::index(int row, int column, const QModelIndex& parent) const
+{
+    if (row < 0 || column < 0 || column >= ColumnCount) {
+        return QModelIndex();
+    }
+    if (!parent.isValid()) {
+        return row < static_cast<int>(m_categories.size()) ? createIndex(row, column, quintptr(0)) : QModelIndex();
+    }
+    if (parent.internalId() != 0 || parent.row() >= static_cast<int>(m_categories.size())) {
+        return QModelIndex();
+    }
+    if (row >= static_cast<int>(m_categories[parent.row()].properties.size())) {
+        return QModelIndex();
+    }
+    return createIndex(row, column, quintptr(parent.row() + 1));
+}
+
+QModelIndex SelectionPropertiesModel::parent(const QModelIndex& child) const
+{
+    if (!child.isValid() || child.internalId() == 0) {
+        return QModelIndex();
+    }
+    return createIndex(static_cast<int>(child.internalId() - 1), 0, quintptr(0));
+}
+
+int SelectionPropertiesModel::rowCount(const QModelIndex& parent) const
+{
+    if (!parent.isValid()) {
+        return static_cast<int>(m_categories.size());
+    }
+    if (parent.internalId() == 0 && parent.column() == 0 && parent.row() < static_cast<int>(m_categories.size())) {
+        return static_cast<int>(m_categories[parent.row()].properties.size());
+    }
+    return 0;
+}
+
+int SelectionPropertiesModel::columnCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent)
+    return ColumnCount;
+}
+
+QVariant SelectionPropertiesModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    if (index.internalId() == 0) {
+        if (role == Qt::DisplayRole && index.column() == PropertyColumn && index.row() < static_cast<int>(m_categories.size())) {
+            return m_categories[index.row()].name;
+        }
+        return QVariant();
+    }
+
+    const Property* property = propertyAt(index);
+    if (!property) {
+        return QVariant();
+    }
+
+    if (index.column() == PropertyColumn) {
+        return role == Qt::DisplayRole ? QVariant(property->name) : QVariant();
+    }
+
+    if (role == Qt::EditRole) {
+        return property->varies ? QVariant() : property->value;
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    if (property->varies) {
+        return VariesText;
+    }
+
+    // Display formatting only; EditRole keeps the raw value
+    if (property->name == QLatin1String("Color")) {
+        return colorName(property->value.toInt());
+    }
+    if (property->name == QLatin1String("Lineweight")) {
+        return QString("%1 mm").arg(property->value.toDouble(), 0, 'f', 2);
+    }
+    if (property->name == QLatin1String("Visible")) {
+        return property->value.toBool() ? QStringLiteral("Yes") : QStringLiteral("No");
+    }
+    if (property->value.typeId() == QMetaType::Double) {
+        return QString::number(property->value.toDouble(), 'f', 4);
+    }
+    return property->value;
+}
+
+QVariant SelectionPropertiesModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    return section == PropertyColumn ? QStringLiteral("Property") : QStringLiteral("Value");
+}
+
+Qt::ItemFlags SelectionPropertiesModel::flags(const QModelIndex& index) const
+{
+    Qt::ItemFlags flags = QAbstractItemModel::flags(index);
+    const Property* property = propertyAt(index);
+    if (property && property->editable && index.column() == ValueColumn) {
+        flags |= Qt::ItemIsEditable;
+    }
+    return flags;
+}
+
+bool SelectionPropertiesModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    const Property* property = propertyAt(index);
+    if (role != Qt::EditRole || !property || !property->editable || index.column() != ValueColumn) {
+        return false;
+    }
+
+    const QString name = property->name;
+    m_geometryEngine->beginDeferredDisplay();
+    for (int id : m_selection) {
+        if (name == QLatin1String("Layer")) {
+            m_geometryEngine->setEntityLayer(id, value.toString());
+        } else if (name == QLatin1String("Color")) {
+            m_geometryEngine->setEntityColor(id, value.toInt());
+        } else if (name == QLatin1String("Visible")) {
+            m_geometryEngine->setEntityVisible(id, value.toBool());
+        }
+    }
+    m_geometryEngine->endDeferredDisplay();
+
+    emit propertyEdited(name, value);
+    m_refreshTimer.start();
+    return true;
+}
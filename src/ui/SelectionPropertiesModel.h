@@ -0,0 +1,96 @@
+#pragma once
+
+#include "GeometryEngine.h"
+#include <QAbstractItemModel>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Two-level model of the properties shared by a selection
+ *
+ * Categories ("General", "Geometry") hold property rows; a property whose
+ * value differs across the selection shows *VARIES*. The selection is
+ * snapshotted on the GUI thread (entity fields and shape handles only) and
+ * aggregated on the global thread pool, including lengths, areas and
+ * volumes. A newer selection cancels the pending aggregation. Edits to
+ * selected entities trigger a debounced re-aggregation.
+ */
+class SelectionPropertiesModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        PropertyColumn,
+        ValueColumn,
+        ColumnCount
+    };
+
+    struct Property {
+        QString name;
+        QVariant value;
+        bool varies;
+        bool editable;
+    };
+
+    struct Category {
+        QString name;
+        std::vector<Property> properties;
+    };
+
+    explicit SelectionPropertiesModel(GeometryEngine* engine, QObject* parent = nullptr);
+    ~SelectionPropertiesModel();
+
+    void setSelection(const std::vector<int>& entityIds);
+    void clearSelection();
+    int selectionSize() const { return static_cast<int>(m_selection.size()); }
+    bool isAggregating() const { return m_aggregating; }
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+
+signals:
+    void aggregationStarted();
+    void aggregationFinished();
+    void propertyEdited(const QString& property, const QVariant& value);
+
+private slots:
+    void onEntityModified(int entityId);
+    void onEntityRemoved(int entityId);
+    void refresh();
+
+private:
+    struct EntitySnapshot {
+        CADEntity::Type type;
+        QString layer;
+        int color;
+        int lineType;
+        double lineWeight;
+        bool visible;
+        TopoDS_Shape shape;
+    };
+
+    static std::vector<Category> aggregate(const std::vector<EntitySnapshot>& entities,
+                                           const std::atomic<quint64>& generation, quint64 expected);
+    void applyCategories(std::vector<Category> categories);
+    const Property* propertyAt(const QModelIndex& index) const;
+
+    GeometryEngine* m_geometryEngine;
+    std::vector<int> m_selection;
+    std::unordered_set<int> m_selectionSet;
+    std::vector<Category> m_categories;
+
+    // Shared with workers so a stale result can be detected after this model is gone
+    std::shared_ptr<std::atomic<quint64>> m_generation;
+    bool m_aggregating;
+    QTimer m_refreshTimer;
+};
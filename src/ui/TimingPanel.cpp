@@ -0,0 +1,134 @@
+#include "TimingPanel.h"
+#include "CommandTelemetry.h"
+
+#include <QCheckBox>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTableWidget>
+#include <QTimer>
+#include <QToolButton>
+#include <QVBoxLayout>
+
+TimingPanel::TimingPanel(CommandTelemetry* telemetry, QWidget* parent)
+    : QWidget(parent)
+    , m_telemetry(telemetry)
+    , m_recordCheck(nullptr)
+    , m_clearButton(nullptr)
+    , m_exportButton(nullptr)
+    , m_table(nullptr)
+    , m_summaryLabel(nullptr)
+    , m_refreshTimer(new QTimer(this))
+{
+    setupUI();
+
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(250);
+    connect(m_refreshTimer, &QTimer::timeout, this, &TimingPanel::refresh);
+
+    connect(m_telemetry, &CommandTelemetry::sampleRecorded, this, &TimingPanel::scheduleRefresh);
+    connect(m_telemetry, &CommandTelemetry::cleared, this, &TimingPanel::refresh);
+    connect(m_telemetry, &CommandTelemetry::enabledChanged, m_recordCheck, &QCheckBox::setChecked);
+    connect(m_recordCheck, &QCheckBox::toggled, m_telemetry, &CommandTelemetry::setEnabled);
+    connect(m_clearButton, &QToolButton::clicked, m_telemetry, &CommandTelemetry::clear);
+    connect(m_exportButton, &QToolButton::clicked, this, &TimingPanel::onExport);
+}
+
+TimingPanel::~TimingPanel() = default;
+
+void TimingPanel::setupUI()
+{
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(2, 2, 2, 2);
+
+    QHBoxLayout* toolbarLayout = new QHBoxLayout();
+    m_recordCheck = new QCheckBox("Record");
+    m_recordCheck->setChecked(m_telemetry->isEnabled());
+    m_clearButton = new QToolButton();
+    m_clearButton->setText("Clear");
+    m_exportButton = new QToolButton();
+    m_exportButton->setText("Export...");
+    toolbarLayout->addWidget(m_recordCheck);
+    toolbarLayout->addStretch();
+    toolbarLayout->addWidget(m_clearButton);
+    toolbarLayout->addWidget(m_exportButton);
+    layout->addLayout(toolbarLayout);
+
+    m_table = new QTableWidget(0, 9);
+    m_table->setHorizontalHeaderLabels(QStringList() << "Command" << "Count" << "p50 ms" << "p90 ms"
+                                                     << "p99 ms" << "Max ms" << "CPU ms" << "Allocs" << "Entities");
+    m_table->verticalHeader()->setVisible(false);
+    m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setSortingEnabled(true);
+    layout->addWidget(m_table);
+
+    m_summaryLabel = new QLabel();
+    layout->addWidget(m_summaryLabel);
+}
+
+void TimingPanel::scheduleRefresh()
+{
+    if (isVisible() && !m_refreshTimer->isActive()) {
+        m_refreshTimer->start();
+    }
+}
+
+void TimingPanel::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    refresh();
+}
+
+void TimingPanel::refresh()
+{
+    const QList<CommandTimingStats> stats = m_telemetry->statistics();
+
+    auto number = [](double value, int precision) {
+        QTableWidgetItem* item = new QTableWidgetItem();
+        item->setData(Qt::DisplayRole, QString::number(value, 'f', precision).toDouble());
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        return item;
+    };
+
+    m_table->setSortingEnabled(false);
+    m_table->setRowCount(stats.size());
+    for (int row = 0; row < stats.size(); ++row) {
+        const CommandTimingStats& s = stats[row];
+        m_table->setItem(row, 0, new QTableWidgetItem(s.name));
+        m_table->setItem(row, 1, number(s.count, 0));
+        m_table->setItem(row, 2, number(s.p50Ms, 3));
+        m_table->setItem(row, 3, number(s.p90Ms, 3));
+        m_table->setItem(row, 4, number(s.p99Ms, 3));
+        m_table->setItem(row, 5, number(s.maxMs, 3));
+        m_table->setItem(row, 6, number(s.meanCpuMs, 3));
+        if (s.meanAllocations < 0) {
+            m_table->setItem(row, 7, new QTableWidgetItem("n/a"));
+        } else {
+            m_table->setItem(row, 7, number(s.meanAllocations, 0));
+        }
+        m_table->setItem(row, 8, number(static_cast<double>(s.entitiesTouched), 0));
+    }
+    m_table->setSortingEnabled(true);
+
+    m_summaryLabel->setText(QString("%1 samples, ring holds %2")
+                                .arg(m_telemetry->sampleCount()).arg(m_telemetry->capacity()));
+}
+
+void TimingPanel::onExport()
+{
+    QString selectedFilter;
+    const QString path = QFileDialog::getSaveFileName(this, "Export Command Timings", "command-timings.csv",
+                                                      "CSV files (*.csv);;JSON files (*.json)", &selectedFilter);
+    if (path.isEmpty()) {
+        return;
+    }
+
+    if (path.endsWith(".json", Qt::CaseInsensitive) || selectedFilter.startsWith("JSON")) {
+        m_telemetry->exportJson(path);
+    } else {
+        m_telemetry->exportCsv(path);
+    }
+}
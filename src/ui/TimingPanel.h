@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QWidget>
+
+class QCheckBox;
+class QLabel;
+class QTableWidget;
+class QTimer;
+class QToolButton;
+class CommandTelemetry;
+
+/**
+ * @brief Dockable view of per-command timing percentiles
+ *
+ * Shows one row per command name from CommandTelemetry::statistics().
+ * Refreshes are coalesced, so a burst of commands costs one table rebuild,
+ * and nothing is rebuilt while the panel is hidden.
+ */
+class TimingPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TimingPanel(CommandTelemetry* telemetry, QWidget* parent = nullptr);
+    ~TimingPanel();
+
+public slots:
+    void refresh();
+
+protected:
+    void showEvent(QShowEvent* event) override;
+
+private slots:
+    void scheduleRefresh();
+    void onExport();
+
+private:
+    void setupUI();
+
+    CommandTelemetry* m_telemetry;
+
+    QCheckBox* m_recordCheck;
+    QToolButton* m_clearButton;
+    QToolButton* m_exportButton;
+    QTableWidget* m_table;
+    QLabel* m_summaryLabel;
+    QTimer* m_refreshTimer;
+};
@@ -1,8 +1,13 @@
 #pragma once
 
 #include <QWidget>
+#include <QSet>
 #include <QLoggingCategory>
 #include <memory>
+#include "RenderScheduler.h"
+#include "SceneBVH.h"
+#include "HiddenLineRemoval.h"
+#include "GridRenderer.h"
 
 class QSplitter;
 class QTabWidget;
@@ -11,6 +16,8 @@ class QVBoxLayout;
 class QHBoxLayout;
 class QLabel;
 class QToolButton;
+class QOpenGLFramebufferObject;
+class SharedRenderResources;
 
 Q_DECLARE_LOGGING_CATEGORY(cadViewport)
 
@@ -71,6 +78,8 @@ public:
     // Display properties
     void setGridVisible(bool visible);
     bool isGridVisible() const { return m_gridVisible; }
+    void setGridSpacing(double spacing) { m_gridRenderer->settings().spacing = spacing; invalidateView(); }
+    double gridSpacing() const { return m_gridRenderer->settings().spacing; }
     
     void setAxisVisible(bool visible);
     bool isAxisVisible() const { return m_axisVisible; }
@@ -78,6 +87,11 @@ public:
     void setBackgroundColor(const QColor& color);
     QColor getBackgroundColor() const { return m_backgroundColor; }
 
+    // Per-viewport layer visibility (VP freeze); geometry itself is shared
+    void setLayerFrozenInViewport(const QString& layer, bool frozen);
+    bool isLayerFrozenInViewport(const QString& layer) const { return m_frozenLayers.contains(layer); }
+    QSet<QString> frozenLayers() const { return m_frozenLayers; }
+
     // Selection
     void setSelectionMode(bool enabled) { m_selectionMode = enabled; }
     bool isSelectionMode() const { return m_selectionMode; }
@@ -86,6 +100,25 @@ public:
     void setActive(bool active);
     bool isActive() const { return m_active; }
 
+    // On-demand rendering
+    RenderScheduler* renderScheduler() const { return m_renderScheduler.get(); }
+    void invalidateScene() { m_renderScheduler->invalidateScene(); }
+    void invalidateView() { m_renderScheduler->invalidateView(); }
+
+    // Cursor overlays (composited over the cached scene, never redraw the model)
+    void setCursorPosition(const QPoint& pos) { m_overlay.cursorPos = pos; m_renderScheduler->invalidateOverlay(); }
+    void setCrosshairVisible(bool visible) { m_overlay.crosshairVisible = visible; m_renderScheduler->invalidateOverlay(); }
+    void setSnapMarker(const QPoint& pos, int snapType);
+    void clearSnapMarker();
+    void setRubberBand(const QPoint& start, const QPoint& end, bool rectangle);
+    void clearRubberBand();
+    const ViewportOverlay& overlay() const { return m_overlay; }
+
+    // Culling: entities projecting below the threshold are drawn as proxies
+    void setSmallFeatureThreshold(double pixels) { m_smallFeatureThreshold = pixels; invalidateView(); }
+    double smallFeatureThreshold() const { return m_smallFeatureThreshold; }
+    const CullStats& cullStats() const { return m_cullResult.stats; }
+
 signals:
     void viewChanged();
     void selectionChanged();
@@ -105,7 +138,16 @@ protected:
 
 private:
     void setupOpenGL();
+    void renderScene(RenderScheduler::Quality quality);
+    void cullScene();
+    void drawProxies();
+    void updateHiddenLines();
+    void drawHiddenLines();
+    void compositeScene();
+    void drawOverlay();
+    void ensureSceneBuffer();
     void drawGrid();
+    GridRenderer::Plane gridPlane() const;
     void drawAxis();
     void drawViewCube();
     void updateProjection();
@@ -133,10 +175,29 @@ private:
     float m_panX, m_panY;
     float m_rotationX, m_rotationY;
     
-    // OpenGL resources
-    unsigned int m_gridVBO;
-    unsigned int m_axisVBO;
-    unsigned int m_shaderProgram;
+    // Per-viewport visibility
+    QSet<QString> m_frozenLayers;
+
+    // Shaders, mesh buffers, grid and axis geometry are owned by the shared
+    // resource layer so additional viewports cost only camera state
+    SharedRenderResources* m_resources;
+
+    // Procedural grid: one full-screen pass, no per-zoom vertex data
+    std::unique_ptr<GridRenderer> m_gridRenderer;
+
+    // On-demand rendering: the model is rendered into m_sceneBuffer only when
+    // the scheduler reports view/scene changes; overlays are painted on top
+    std::unique_ptr<RenderScheduler> m_renderScheduler;
+    std::unique_ptr<QOpenGLFramebufferObject> m_sceneBuffer;
+    ViewportOverlay m_overlay;
+
+    // Culling stage run before drawing; the BVH itself is shared
+    CullResult m_cullResult;
+    double m_smallFeatureThreshold;
+
+    // Hidden view mode draws projected line work from the shared HLR cache;
+    // recomputed only when the view direction or the scene changes
+    HLRResult m_hiddenLines;
 };
 
 /**